@@ -0,0 +1,750 @@
+
+#ifndef _ASYNC_WRITER_HPP_
+#define _ASYNC_WRITER_HPP_
+
+#include <algorithm>
+#include <assert.h>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && \
+    (defined(__GNUC__) || defined(__clang__)) && \
+    __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && \
+    defined(__NR_io_uring_enter) && \
+    defined(__NR_io_uring_register)
+#define ND_ARRAY_IO_URING 1
+#endif
+#endif
+
+#include "file_header.hpp"
+#include "nd_array.hpp"
+#include "serialize.hpp"
+#include "span.hpp"
+
+namespace ND_Array_internals_ {
+
+// Writes arrays to a file in the background, so a
+// simulation can keep computing while its checkpoints are
+// written. Each write is copied into one of two staging
+// buffers and returns at once; when a buffer is full, or
+// is flushed, its writes are submitted and the other
+// buffer is filled while they complete, so the array can
+// be modified as soon as write() returns.
+//
+// The writes are submitted with io_uring where the kernel
+// supports it, with the staging buffers registered with
+// the ring so they're pinned once rather than for every
+// write; otherwise a thread writes them with pwrite. Each
+// write returns a future which is ready once it, and every
+// earlier write, is in the file, with the first error of
+// any of them; writes are only submitted when a buffer
+// fills or on flush(), so flush before waiting on them.
+// Writes which overlap in the file may complete in any
+// order. Requires POSIX
+
+enum class async_backend { automatic, io_uring, thread };
+
+#ifdef ND_ARRAY_IO_URING
+// The submission and completion queues of an io_uring,
+// used through the system calls directly so there's no
+// dependency on liburing. Entries must only be prepared
+// and submitted by one thread, and completions reaped by
+// one thread
+class io_uring_queue_ {
+ public:
+  explicit io_uring_queue_(
+      const unsigned entries) noexcept {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(
+        syscall(__NR_io_uring_setup, entries, &params));
+    if(fd_ < 0) {
+      return;
+    }
+    sq_bytes_ = params.sq_off.array +
+                params.sq_entries * sizeof(unsigned);
+    cq_bytes_ = params.cq_off.cqes +
+                params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_map =
+        params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_map) {
+      sq_bytes_ = std::max(sq_bytes_, cq_bytes_);
+      cq_bytes_ = sq_bytes_;
+    }
+    sq_ring_ = map(sq_bytes_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_map
+                   ? sq_ring_
+                   : map(cq_bytes_, IORING_OFF_CQ_RING);
+    sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *const sqes = map(sqes_bytes_, IORING_OFF_SQES);
+    if(sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED ||
+       sqes == MAP_FAILED) {
+      release(sqes);
+      return;
+    }
+    char *const sq = static_cast<char *>(sq_ring_);
+    char *const cq = static_cast<char *>(cq_ring_);
+    const auto field = [](char *ring, const unsigned off) {
+      return reinterpret_cast<unsigned *>(ring + off);
+    };
+    sq_head_ = field(sq, params.sq_off.head);
+    sq_tail_ = field(sq, params.sq_off.tail);
+    sq_mask_ = *field(sq, params.sq_off.ring_mask);
+    sq_array_ = field(sq, params.sq_off.array);
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+    cq_head_ = field(cq, params.cq_off.head);
+    cq_tail_ = field(cq, params.cq_off.tail);
+    cq_mask_ = *field(cq, params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(
+        cq + params.cq_off.cqes);
+    entries_ = params.sq_entries;
+  }
+
+  io_uring_queue_(const io_uring_queue_ &) = delete;
+  io_uring_queue_ &operator=(const io_uring_queue_ &) =
+      delete;
+
+  ~io_uring_queue_() noexcept { release(sqes_); }
+
+  [[nodiscard]] bool is_open() const noexcept {
+    return sqes_ != nullptr;
+  }
+
+  // The number of entries which can be prepared before
+  // they're submitted
+  [[nodiscard]] unsigned entries() const noexcept {
+    return entries_;
+  }
+
+  // Registers buffers, which can then be written with
+  // IORING_OP_WRITE_FIXED without pinning them each time
+  [[nodiscard]] bool register_buffers(
+      const iovec *buffers, const unsigned count) noexcept {
+    return syscall(__NR_io_uring_register, fd_,
+                   IORING_REGISTER_BUFFERS, buffers,
+                   count) == 0;
+  }
+
+  // The next submission entry, cleared
+  [[nodiscard]] io_uring_sqe &prepare() noexcept {
+    assert(prepared_ < entries_);
+    const unsigned idx = (*sq_tail_ + prepared_) & sq_mask_;
+    prepared_++;
+    sq_array_[idx] = idx;
+    std::memset(&sqes_[idx], 0, sizeof(io_uring_sqe));
+    return sqes_[idx];
+  }
+
+  // Submits the prepared entries, returning how many were
+  // submitted before any error. Those which weren't are
+  // dropped, so they can't be submitted by a later call
+  unsigned submit() noexcept {
+    const unsigned tail = *sq_tail_;
+    __atomic_store_n(sq_tail_, tail + prepared_,
+                     __ATOMIC_RELEASE);
+    unsigned submitted = 0;
+    while(submitted < prepared_) {
+      const long count =
+          syscall(__NR_io_uring_enter, fd_,
+                  prepared_ - submitted, 0, 0, nullptr, 0);
+      if(count < 0 && (errno == EINTR || errno == EAGAIN ||
+                       errno == EBUSY)) {
+        continue;
+      }
+      if(count <= 0) {
+        break;
+      }
+      submitted += static_cast<unsigned>(count);
+    }
+    if(submitted < prepared_) {
+      // Without SQPOLL the kernel only consumes entries
+      // during io_uring_enter, so its head is where they
+      // stopped; each one it consumed will complete
+      const unsigned head =
+          __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+      submitted = head - tail;
+      __atomic_store_n(sq_tail_, head, __ATOMIC_RELEASE);
+    }
+    prepared_ = 0;
+    return submitted;
+  }
+
+  // Waits for at least one completion, and calls
+  // f(user_data, result) for each completion
+  template <typename F>
+  [[nodiscard]] bool reap(F &&f) noexcept {
+    unsigned head = *cq_head_;
+    unsigned tail =
+        __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while(head == tail) {
+      if(syscall(__NR_io_uring_enter, fd_, 0, 1,
+                 IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+         errno != EINTR) {
+        return false;
+      }
+      tail =
+          __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    }
+    for(; head != tail; head++) {
+      const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+      f(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return true;
+  }
+
+ private:
+  void *map(const std::size_t bytes,
+            const off_t offset) const noexcept {
+    return mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd_, offset);
+  }
+
+  void release(void *sqes) noexcept {
+    if(sqes != nullptr && sqes != MAP_FAILED) {
+      munmap(sqes, sqes_bytes_);
+    }
+    if(cq_ring_ != nullptr && cq_ring_ != MAP_FAILED &&
+       cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_bytes_);
+    }
+    if(sq_ring_ != nullptr && sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_bytes_);
+    }
+    if(fd_ >= 0) {
+      ::close(fd_);
+    }
+    fd_ = -1;
+    sq_ring_ = cq_ring_ = nullptr;
+    sqes_ = nullptr;
+  }
+
+  int fd_ = -1;
+  unsigned entries_ = 0;
+  unsigned prepared_ = 0;
+  void *sq_ring_ = nullptr;
+  void *cq_ring_ = nullptr;
+  std::size_t sq_bytes_ = 0;
+  std::size_t cq_bytes_ = 0;
+  std::size_t sqes_bytes_ = 0;
+  unsigned *sq_head_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned *sq_array_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe *cqes_ = nullptr;
+};
+#endif
+
+class async_writer {
+ public:
+  using future_type = std::shared_future<io_status>;
+
+  static constexpr std::size_t default_staging_bytes =
+      std::size_t(16) << 20;
+
+  // Creates the file at path, replacing it if it exists,
+  // with two staging buffers of staging_bytes. The backend
+  // is io_uring when it's available unless a thread is
+  // requested, and falls back to a thread otherwise
+  explicit async_writer(
+      const char *path,
+      const std::size_t staging_bytes =
+          default_staging_bytes,
+      const async_backend backend =
+          async_backend::automatic)
+      : fd_(open(path, O_WRONLY | O_CREAT | O_TRUNC,
+                 0644)) {
+    assert(staging_bytes > 0 && staging_bytes < UINT32_MAX);
+    if(fd_ < 0) {
+      status_ = io_status::open_failed;
+      last_future_ = ready_future(status_);
+      return;
+    }
+    last_future_ = ready_future(io_status::ok);
+    for(unsigned b = 0; b < 2; b++) {
+      buffers_[b].data.reset(
+          static_cast<unsigned char *>(::operator new(
+              staging_bytes,
+              std::align_val_t(staging_alignment))));
+      buffers_[b].capacity = staging_bytes;
+      buffers_[b].index = b;
+      buffers_[b].reset();
+    }
+#ifdef ND_ARRAY_IO_URING
+    if(backend != async_backend::thread) {
+      ring_ =
+          std::make_unique<io_uring_queue_>(ring_entries);
+      if(ring_->is_open()) {
+        const iovec buffers[2] = {
+            {buffers_[0].data.get(), staging_bytes},
+            {buffers_[1].data.get(), staging_bytes}};
+        fixed_buffers_ =
+            ring_->register_buffers(buffers, 2);
+        backend_ = async_backend::io_uring;
+        completer_ = std::thread(&async_writer::reap, this);
+        return;
+      }
+      ring_.reset();
+    }
+#endif
+    (void)backend;
+    backend_ = async_backend::thread;
+    completer_ = std::thread(&async_writer::work, this);
+  }
+
+  async_writer(const async_writer &) = delete;
+  async_writer &operator=(const async_writer &) = delete;
+
+  ~async_writer() noexcept { close(); }
+
+  // Whether the file was created, and then the first error
+  // of the writes which have completed
+  [[nodiscard]] io_status status() const noexcept {
+    if(status_ != io_status::ok) {
+      return status_;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+  }
+
+  // The backend the writes are submitted with
+  [[nodiscard]] async_backend backend() const noexcept {
+    return backend_;
+  }
+
+  // Copies bytes bytes from data to be written at offset in
+  // the file. Only blocks when both staging buffers are
+  // full and the older hasn't been written yet. Writes to a
+  // writer which isn't open fail at once
+  future_type write(const void *data, std::size_t bytes,
+                    std::uint64_t offset) {
+    if(fd_ < 0) {
+      return ready_future(status_ != io_status::ok
+                              ? status_
+                              : io_status::io_failed);
+    }
+    const unsigned char *src =
+        static_cast<const unsigned char *>(data);
+    future_type future = buffers_[current_].future;
+    while(bytes > 0) {
+      staging_buffer_ &buf = buffers_[current_];
+      const bool extends =
+          !buf.segments.empty() &&
+          buf.segments.back().offset +
+                  buf.segments.back().bytes ==
+              offset;
+      if(buf.used == buf.capacity ||
+         (!extends &&
+          buf.segments.size() == max_segments)) {
+        submit();
+        continue;
+      }
+      const std::size_t n =
+          std::min(bytes, buf.capacity - buf.used);
+      std::memcpy(buf.data.get() + buf.used, src, n);
+      if(extends) {
+        buf.segments.back().bytes += n;
+      } else {
+        buf.segments.push_back({offset, buf.used, n});
+      }
+      buf.used += n;
+      src += n;
+      bytes -= n;
+      offset += n;
+      future = buf.future;
+    }
+    return future;
+  }
+
+  // Writes arr, an nd_array_ or nd_span_, as an array file
+  // which can be loaded with load() or mapped. The header
+  // has no checksum, as it's computed by save() from the
+  // elements
+  template <typename Array>
+  future_type write_array(const Array &arr) {
+    write_header<Array>();
+    return write(arr.data(),
+                 make_file_header<Array>().data_bytes,
+                 file_data_offset());
+  }
+
+  // Writes the header of an array file of an Array, whose
+  // outer slices can then be written with write_slice()
+  template <typename Array>
+  future_type write_header() {
+    static_assert(is_nd_array_<Array>::value ||
+                      is_nd_span_<Array>::value,
+                  "Only arrays and spans can be written");
+    const nd_file_header header = make_file_header<Array>();
+    unsigned char prefix[file_data_offset()] = {};
+    std::memcpy(prefix, &header, sizeof(header));
+    return write(prefix, sizeof(prefix), 0);
+  }
+
+  // Writes the outer slice of arr at indices into its place
+  // in an array file of arr, eg to checkpoint each slice of
+  // a field as soon as it's been updated
+  template <typename Array, typename... int_t>
+  future_type write_slice(const Array &arr,
+                          const int_t... indices) {
+    static_assert(is_nd_array_<Array>::value ||
+                      is_nd_span_<Array>::value,
+                  "Only arrays and spans can be written");
+    using T = typename Array::value_type;
+    const auto &slice = arr.outer_slice(indices...);
+    const std::uint64_t offset =
+        file_data_offset() +
+        (slice.data() - arr.data()) * sizeof(T);
+    return write(slice.data(),
+                 slice.storage_size() * sizeof(T), offset);
+  }
+
+  // Submits the staged writes, returning the future of the
+  // last
+  future_type flush() {
+    if(status_ == io_status::ok) {
+      submit();
+    }
+    return last_future_;
+  }
+
+  // Writes everything staged, and waits for it to complete
+  io_status wait() { return flush().get(); }
+
+  // Waits for the writes and closes the file, returning
+  // the first error
+  io_status close() noexcept {
+    if(fd_ < 0) {
+      return status_;
+    }
+    if(status_ == io_status::ok) {
+      (void)wait();
+      stop();
+    }
+    const io_status result = status();
+    const bool closed = ::close(fd_) == 0;
+    fd_ = -1;
+    if(result == io_status::ok && !closed) {
+      status_ = io_status::io_failed;
+    }
+    return closed ? result : io_status::io_failed;
+  }
+
+ private:
+  // The alignment of the staging buffers, which is enough
+  // for O_DIRECT on common devices
+  static constexpr std::size_t staging_alignment = 4096;
+  // The writes of a buffer which aren't contiguous in the
+  // file each take a queue entry; this allows both buffers
+  // to be in flight in the completion queue, which has
+  // twice as many entries as the submission queue
+  static constexpr unsigned ring_entries = 64;
+  static constexpr std::size_t max_segments = ring_entries;
+  static constexpr std::uint64_t stop_tag =
+      ~std::uint64_t(0);
+
+  static future_type ready_future(const io_status status) {
+    std::promise<io_status> done;
+    done.set_value(status);
+    return done.get_future().share();
+  }
+
+  struct aligned_delete_ {
+    void operator()(unsigned char *data) const noexcept {
+      ::operator delete(
+          data, std::align_val_t(staging_alignment));
+    }
+  };
+
+  struct staging_buffer_ {
+    // A contiguous write from the buffer
+    struct segment {
+      std::uint64_t offset;
+      std::size_t pos;
+      std::size_t bytes;
+    };
+
+    std::unique_ptr<unsigned char[], aligned_delete_> data;
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+    std::vector<segment> segments;
+    std::promise<io_status> done;
+    future_type future;
+    bool submitted = false;
+    // The segments which haven't completed, and the first
+    // error of those which have
+    std::size_t pending = 0;
+    io_status status = io_status::ok;
+    unsigned index = 0;
+
+    void reset() {
+      used = 0;
+      segments.clear();
+      done = std::promise<io_status>();
+      future = done.get_future().share();
+      submitted = false;
+      status = io_status::ok;
+    }
+  };
+
+  // Submits the current buffer, then switches to the other,
+  // waiting for its writes to complete
+  void submit() {
+    staging_buffer_ &buf = buffers_[current_];
+    if(!buf.segments.empty()) {
+      bool queued = true;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(broken_) {
+          // Nothing would complete the buffer
+          queued = false;
+          buf.done.set_value(error_);
+        } else {
+          buf.pending = buf.segments.size();
+          in_flight_.push_back(&buf);
+        }
+      }
+      buf.submitted = true;
+      last_future_ = buf.future;
+#ifdef ND_ARRAY_IO_URING
+      if(queued && ring_ != nullptr) {
+        submit_ring(buf);
+      }
+#endif
+      if(queued) {
+        work_ready_.notify_one();
+      }
+    }
+    current_ ^= 1;
+    staging_buffer_ &next = buffers_[current_];
+    if(next.submitted) {
+      next.future.wait();
+      // The completion thread may still be in set_value()
+      std::lock_guard<std::mutex> lock(mutex_);
+      next.reset();
+    }
+  }
+
+  // Records that a segment of buffer b completed, and
+  // completes the buffers at the front of the queue whose
+  // segments have all completed
+  void segment_done(const unsigned b,
+                    const io_status status) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    staging_buffer_ &buf = buffers_[b];
+    if(status != io_status::ok &&
+       buf.status == io_status::ok) {
+      buf.status = status;
+    }
+    buf.pending--;
+    while(!in_flight_.empty() &&
+          in_flight_.front()->pending == 0) {
+      staging_buffer_ &front = *in_flight_.front();
+      in_flight_.pop_front();
+      if(error_ == io_status::ok) {
+        error_ = front.status;
+      }
+      front.done.set_value(error_);
+    }
+  }
+
+  // The thread backend, which writes the buffers in order
+  void work() noexcept {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true) {
+      work_ready_.wait(lock, [this]() {
+        return stop_ || !in_flight_.empty();
+      });
+      if(in_flight_.empty()) {
+        return;
+      }
+      staging_buffer_ &buf = *in_flight_.front();
+      lock.unlock();
+      // buf is reused once its last segment is done
+      const std::size_t segments = buf.segments.size();
+      for(std::size_t s = 0; s < segments; s++) {
+        const auto &segment = buf.segments[s];
+        const bool written =
+            write_bytes(fd_, buf.data.get() + segment.pos,
+                        segment.bytes, segment.offset);
+        segment_done(buf.index, written
+                                    ? io_status::ok
+                                    : io_status::io_failed);
+      }
+      lock.lock();
+    }
+  }
+
+  void stop() noexcept {
+#ifdef ND_ARRAY_IO_URING
+    if(ring_ != nullptr) {
+      // The completion thread uses the writer, so it's
+      // always joined; the stop entry is submitted until
+      // the ring takes it, unless the thread has returned
+      // as completions couldn't be reaped
+      while(true) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if(broken_) {
+            break;
+          }
+        }
+        io_uring_sqe &sqe = ring_->prepare();
+        sqe.opcode = IORING_OP_NOP;
+        sqe.user_data = stop_tag;
+        if(ring_->submit() == 1) {
+          break;
+        }
+        std::this_thread::yield();
+      }
+      completer_.join();
+      return;
+    }
+#endif
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_ready_.notify_one();
+    completer_.join();
+  }
+
+#ifdef ND_ARRAY_IO_URING
+  void submit_ring(staging_buffer_ &buf) noexcept {
+    const std::size_t segments = buf.segments.size();
+    std::size_t first = 0;
+    while(first < segments) {
+      const std::size_t n = std::min<std::size_t>(
+          segments - first, ring_->entries());
+      for(std::size_t s = first; s < first + n; s++) {
+        const auto &segment = buf.segments[s];
+        io_uring_sqe &sqe = ring_->prepare();
+        sqe.opcode = fixed_buffers_ ? IORING_OP_WRITE_FIXED
+                                    : IORING_OP_WRITE;
+        sqe.fd = fd_;
+        sqe.addr = reinterpret_cast<std::uint64_t>(
+            buf.data.get() + segment.pos);
+        sqe.len = static_cast<std::uint32_t>(segment.bytes);
+        sqe.off = segment.offset;
+        sqe.buf_index = fixed_buffers_ ? buf.index : 0;
+        sqe.user_data =
+            (std::uint64_t(buf.index) << 32) | s;
+      }
+      const unsigned submitted = ring_->submit();
+      first += submitted;
+      if(submitted < n) {
+        // The rest were dropped, so will never complete
+        for(; first < segments; first++) {
+          segment_done(buf.index, io_status::io_failed);
+        }
+      }
+    }
+  }
+
+  // The io_uring backend's completion thread
+  void reap() noexcept {
+    bool stopping = false;
+    while(!stopping) {
+      const bool reaped = ring_->reap(
+          [&](const std::uint64_t tag, const int res) {
+            if(tag == stop_tag) {
+              stopping = true;
+              return;
+            }
+            const unsigned b =
+                static_cast<unsigned>(tag >> 32);
+            // The ring orders this after the segment was
+            // queued, but only in the kernel, so the lock
+            // makes that visible to the memory model
+            staging_buffer_::segment segment;
+            {
+              std::lock_guard<std::mutex> lock(mutex_);
+              segment =
+                  buffers_[b].segments[tag & 0xFFFFFFFF];
+            }
+            const std::size_t done =
+                res > 0 ? std::size_t(res) : 0;
+            bool written = res >= 0;
+            // Short writes are finished synchronously
+            if(written && done < segment.bytes) {
+              written = write_bytes(
+                  fd_,
+                  buffers_[b].data.get() + segment.pos +
+                      done,
+                  segment.bytes - done,
+                  segment.offset + done);
+            }
+            segment_done(b, written ? io_status::ok
+                                    : io_status::io_failed);
+          });
+      if(!reaped) {
+        fail_in_flight();
+        return;
+      }
+    }
+  }
+
+  // Fails the buffers in flight when completions can't be
+  // reaped, so waiting on them doesn't block forever, and
+  // the buffers submitted after them
+  void fail_in_flight() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    broken_ = true;
+    error_ = io_status::io_failed;
+    for(staging_buffer_ *buf : in_flight_) {
+      buf->done.set_value(error_);
+    }
+    in_flight_.clear();
+  }
+#endif
+
+  int fd_;
+  io_status status_ = io_status::ok;
+  async_backend backend_ = async_backend::thread;
+  staging_buffer_ buffers_[2];
+  // The buffer being filled
+  unsigned current_ = 0;
+  future_type last_future_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable work_ready_;
+  // The submitted buffers which haven't completed, in order
+  std::deque<staging_buffer_ *> in_flight_;
+  io_status error_ = io_status::ok;
+  bool stop_ = false;
+  // Set when the completion thread has returned early, so
+  // nothing would complete the buffers submitted after
+  bool broken_ = false;
+  std::thread completer_;
+#ifdef ND_ARRAY_IO_URING
+  std::unique_ptr<io_uring_queue_> ring_;
+  bool fixed_buffers_ = false;
+#endif
+};
+
+}  // namespace ND_Array_internals_
+
+#endif  // _ASYNC_WRITER_HPP_
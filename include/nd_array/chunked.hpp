@@ -0,0 +1,824 @@
+
+#ifndef _CHUNKED_HPP_
+#define _CHUNKED_HPP_
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "file_header.hpp"
+#include "nd_array.hpp"
+#include "parallel.hpp"
+#include "serialize.hpp"
+#include "span.hpp"
+
+namespace ND_Array_internals_ {
+
+// Saves and loads arrays as chunked files, for arrays too
+// large to read or write whole. The storage is split into
+// chunks of consecutive outer slices which are compressed
+// independently, and an index at the end of the file
+// records where each chunk is, so a range of outer slices
+// can be loaded by decompressing only the chunks holding
+// it. The chunks are encoded and decoded in parallel on a
+// thread_pool.
+//
+// Each chunk is byte shuffled, grouping the first bytes of
+// its elements, then their second bytes, and so on, which
+// puts the slowly varying exponents and high bytes of
+// smooth fields next to each other, and then compressed
+// with an LZ77 compressor in the style of LZ4. Chunks which
+// don't compress are stored as they are.
+// Requires POSIX
+
+/* Byte shuffling */
+
+// Transposes the bytes of elems elements of elem_bytes
+// bytes, so dest holds byte 0 of every element, then byte
+// 1 of every element, ...
+template <std::size_t elem_bytes>
+void byte_shuffle(const unsigned char *src,
+                  unsigned char *dest,
+                  const std::size_t elems) noexcept {
+  for(std::size_t b = 0; b < elem_bytes; b++) {
+    unsigned char *const plane = dest + b * elems;
+    for(std::size_t i = 0; i < elems; i++) {
+      plane[i] = src[i * elem_bytes + b];
+    }
+  }
+}
+
+// The inverse of byte_shuffle. Each element is gathered
+// from the planes, so dest is written sequentially
+template <std::size_t elem_bytes>
+void byte_unshuffle(const unsigned char *src,
+                    unsigned char *dest,
+                    const std::size_t elems) noexcept {
+  for(std::size_t i = 0; i < elems; i++) {
+    for(std::size_t b = 0; b < elem_bytes; b++) {
+      dest[i * elem_bytes + b] = src[b * elems + i];
+    }
+  }
+}
+
+/* Compression */
+
+// The compressed data is a sequence of literal runs and
+// matches. Each starts with a token byte, whose high
+// nibble is the number of literals and whose low nibble is
+// the length of the match less lz_min_match; a nibble of
+// 15 is followed by bytes which are added to it, up to and
+// including the first which isn't 255. The literals follow,
+// then the match's 2 byte little endian offset back from
+// the end of the literals. The last sequence has no match
+constexpr std::size_t lz_min_match = 4;
+constexpr std::size_t lz_max_offset = 0xFFFF;
+constexpr int lz_hash_bits = 16;
+// Positions at most lz_max_offset apart share a window, so
+// the chains of earlier positions are indexed by the
+// position modulo the window
+constexpr std::size_t lz_window = lz_max_offset + 1;
+constexpr int max_compression_level = 9;
+// Copies are done in blocks of this size when there's room
+constexpr std::size_t lz_copy_block = 16;
+
+// The size of a buffer which any compressed data of bytes
+// bytes fits in
+[[nodiscard]] constexpr std::size_t lz_compress_bound(
+    const std::size_t bytes) noexcept {
+  return bytes + bytes / 255 + 16;
+}
+
+[[nodiscard]] inline std::uint32_t lz_load32(
+    const unsigned char *src) noexcept {
+  std::uint32_t value;
+  std::memcpy(&value, src, sizeof(value));
+  return value;
+}
+
+[[nodiscard]] inline std::uint64_t lz_load64(
+    const unsigned char *src) noexcept {
+  std::uint64_t value;
+  std::memcpy(&value, src, sizeof(value));
+  return value;
+}
+
+// Writes the rest of a length which didn't fit in its
+// nibble
+[[nodiscard]] inline unsigned char *lz_put_length(
+    unsigned char *dest, std::size_t len) noexcept {
+  for(; len >= 255; len -= 255) {
+    *dest++ = 255;
+  }
+  *dest++ = static_cast<unsigned char>(len);
+  return dest;
+}
+
+// Reads the rest of a length, failing at the end of src
+[[nodiscard]] inline bool lz_get_length(
+    const unsigned char *&src, const unsigned char *end,
+    std::size_t &len) noexcept {
+  unsigned char byte;
+  do {
+    if(src == end) {
+      return false;
+    }
+    byte = *src++;
+    len += byte;
+  } while(byte == 255);
+  return true;
+}
+
+// Writes lit_len literals followed by a match, or no match
+// when match_len is 0
+[[nodiscard]] inline unsigned char *lz_put_sequence(
+    unsigned char *dest, const unsigned char *literals,
+    const std::size_t lit_len, const std::size_t offset,
+    const std::size_t match_len) noexcept {
+  unsigned char *const token = dest++;
+  const std::size_t lit_code =
+      std::min<std::size_t>(lit_len, 15);
+  if(lit_len >= 15) {
+    dest = lz_put_length(dest, lit_len - 15);
+  }
+  std::memcpy(dest, literals, lit_len);
+  dest += lit_len;
+  std::size_t match_code = 0;
+  if(match_len != 0) {
+    *dest++ = static_cast<unsigned char>(offset & 0xFF);
+    *dest++ = static_cast<unsigned char>(offset >> 8);
+    const std::size_t len = match_len - lz_min_match;
+    match_code = std::min<std::size_t>(len, 15);
+    if(len >= 15) {
+      dest = lz_put_length(dest, len - 15);
+    }
+  }
+  *token = static_cast<unsigned char>(lit_code << 4 |
+                                      match_code);
+  return dest;
+}
+
+// Finds repeated strings with a hash table of the last
+// position each 4 byte string was seen at. Level 1 only
+// tries that position, and skips ahead faster the longer
+// it goes without a match, for speed; higher levels also
+// chain the earlier positions with the same hash, and try
+// up to 2^(level - 1) of them for the longest match. The
+// tables are kept between calls to avoid reallocating them
+class lz_compressor {
+ public:
+  lz_compressor() : head_(std::size_t(1) << lz_hash_bits) {}
+
+  // Compresses bytes bytes of src into dest, which must
+  // have room for lz_compress_bound(bytes) bytes, and
+  // returns the compressed size
+  [[nodiscard]] std::size_t compress(
+      const unsigned char *src, const std::size_t bytes,
+      unsigned char *dest, const int level) {
+    assert(level >= 1 && level <= max_compression_level);
+    assert(bytes < UINT32_MAX);
+    // Positions are stored plus one, so 0 is empty
+    std::fill(head_.begin(), head_.end(), 0);
+    if(level == 1) {
+      return compress<false>(src, bytes, dest, 1);
+    }
+    chain_.resize(lz_window);
+    return compress<true>(src, bytes, dest,
+                          1 << (level - 1));
+  }
+
+ private:
+  template <bool chained>
+  [[nodiscard]] std::size_t compress(
+      const unsigned char *src, const std::size_t bytes,
+      unsigned char *dest, const int depth) noexcept {
+    unsigned char *out = dest;
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    std::size_t misses = 0;
+    while(pos + lz_min_match <= bytes) {
+      std::size_t best_len = 0;
+      std::size_t best_offset = 0;
+      std::uint32_t candidate = insert<chained>(src, pos);
+      for(int tries = 0; candidate != 0 && tries < depth;
+          tries++) {
+        const std::size_t prev = candidate - 1;
+        if(pos - prev > lz_max_offset) {
+          break;
+        }
+        const std::size_t len =
+            match_length(src, prev, pos, bytes);
+        if(len > best_len) {
+          best_len = len;
+          best_offset = pos - prev;
+        }
+        if constexpr(!chained) {
+          break;
+        }
+        candidate = chain_[prev % lz_window];
+      }
+      if(best_len < lz_min_match) {
+        pos += chained ? 1 : 1 + (misses++ >> 5);
+        continue;
+      }
+      out = lz_put_sequence(out, src + anchor, pos - anchor,
+                            best_offset, best_len);
+      const std::size_t end = pos + best_len;
+      if constexpr(chained) {
+        // Later matches can start inside this one
+        for(pos++; pos < end && pos + lz_min_match <= bytes;
+            pos++) {
+          insert<chained>(src, pos);
+        }
+      }
+      pos = anchor = end;
+      misses = 0;
+    }
+    out = lz_put_sequence(out, src + anchor, bytes - anchor,
+                          0, 0);
+    return out - dest;
+  }
+
+  // Records pos as the last position of its string, and
+  // returns the previous one
+  template <bool chained>
+  std::uint32_t insert(const unsigned char *src,
+                       const std::size_t pos) noexcept {
+    const std::uint32_t hash =
+        (lz_load32(src + pos) * 2654435761u) >>
+        (32 - lz_hash_bits);
+    const std::uint32_t prev = head_[hash];
+    head_[hash] = static_cast<std::uint32_t>(pos + 1);
+    if constexpr(chained) {
+      chain_[pos % lz_window] = prev;
+    }
+    return prev;
+  }
+
+  // The length of the common prefix of the strings at prev
+  // and pos, which is 0 when it's shorter than lz_min_match
+  [[nodiscard]] static std::size_t match_length(
+      const unsigned char *src, const std::size_t prev,
+      const std::size_t pos,
+      const std::size_t bytes) noexcept {
+    if(lz_load32(src + prev) != lz_load32(src + pos)) {
+      return 0;
+    }
+    std::size_t len = lz_min_match;
+    while(pos + len + 8 <= bytes) {
+      const std::uint64_t diff =
+          lz_load64(src + prev + len) ^
+          lz_load64(src + pos + len);
+      if(diff != 0) {
+#if defined(__BYTE_ORDER__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        // The first differing byte is the lowest
+        return len + __builtin_ctzll(diff) / 8;
+#else
+        break;
+#endif
+      }
+      len += 8;
+    }
+    while(pos + len < bytes &&
+          src[prev + len] == src[pos + len]) {
+      len++;
+    }
+    return len;
+  }
+
+  std::vector<std::uint32_t> head_;
+  std::vector<std::uint32_t> chain_;
+};
+
+// Decompresses bytes bytes of compressed data from src
+// into the dest_bytes bytes of dest, failing if the data
+// is corrupt or doesn't decompress to exactly dest_bytes
+[[nodiscard]] inline bool lz_decompress(
+    const unsigned char *src, const std::size_t bytes,
+    unsigned char *dest,
+    const std::size_t dest_bytes) noexcept {
+  const unsigned char *const end = src + bytes;
+  unsigned char *out = dest;
+  unsigned char *const out_end = dest + dest_bytes;
+  while(src < end) {
+    const unsigned token = *src++;
+    std::size_t lit_len = token >> 4;
+    if(lit_len == 15 && !lz_get_length(src, end, lit_len)) {
+      return false;
+    }
+    if(lit_len > std::size_t(end - src) ||
+       lit_len > std::size_t(out_end - out)) {
+      return false;
+    }
+    // Short runs are copied as a whole block when there's
+    // room, which avoids a variable length copy; the extra
+    // bytes are overwritten by what follows
+    if(lit_len <= lz_copy_block &&
+       std::size_t(end - src) >= lz_copy_block &&
+       std::size_t(out_end - out) >= lz_copy_block) {
+      std::memcpy(out, src, lz_copy_block);
+    } else {
+      std::memcpy(out, src, lit_len);
+    }
+    out += lit_len;
+    src += lit_len;
+    if(src == end) {
+      return out == out_end;
+    }
+    if(end - src < 2) {
+      return false;
+    }
+    const std::size_t offset =
+        src[0] | (std::size_t(src[1]) << 8);
+    src += 2;
+    std::size_t match_len = token & 15;
+    if(match_len == 15 &&
+       !lz_get_length(src, end, match_len)) {
+      return false;
+    }
+    match_len += lz_min_match;
+    if(offset == 0 || offset > std::size_t(out - dest) ||
+       match_len > std::size_t(out_end - out)) {
+      return false;
+    }
+    // Matches can overlap their own output, repeating the
+    // last offset bytes. Copying from the start of the
+    // match, each copy doubles the whole periods available
+    // to copy without overlapping
+    const unsigned char *const match = out - offset;
+    if(offset >= lz_copy_block &&
+       std::size_t(out_end - out) >=
+           match_len + lz_copy_block) {
+      for(std::size_t copied = 0; copied < match_len;
+          copied += lz_copy_block) {
+        std::memcpy(out + copied, match + copied,
+                    lz_copy_block);
+      }
+    } else {
+      for(std::size_t copied = 0; copied < match_len;) {
+        const std::size_t n =
+            std::min(match_len - copied, offset + copied);
+        std::memcpy(out + copied, match, n);
+        copied += n;
+      }
+    }
+    out += match_len;
+  }
+  // The data must end with the last sequence's literals
+  return false;
+}
+
+/* Chunked files */
+
+struct chunked_options {
+  // The uncompressed size of the chunks, which is rounded
+  // down to a whole number of outer slices, and is at least
+  // one
+  std::size_t chunk_bytes = std::size_t(1) << 20;
+  // 0 stores the chunks uncompressed, 1 is the fastest and
+  // max_compression_level compresses the most
+  int level = 1;
+  bool shuffle = true;
+  // The pool to run on, or nullptr for the default pool
+  thread_pool *pool = nullptr;
+};
+
+// The header at the start of a chunked file. array
+// describes the array as for an array file, except that
+// its magic is magic_string() and its data_offset is the
+// start of the first chunk
+struct chunked_file_header {
+  nd_file_header array;
+  // The number of outer slices in each chunk, except the
+  // last which may be shorter
+  std::uint64_t chunk_slices;
+  std::uint64_t chunks;
+  // The offset of the chunk_entry of each chunk, which is 0
+  // until every chunk has been written
+  std::uint64_t index_offset;
+  std::uint32_t level;
+  std::uint32_t reserved;
+
+  [[nodiscard]] static constexpr const char *
+  magic_string() noexcept {
+    return "NDCHUNK";
+  }
+};
+
+static_assert(std::is_trivially_copyable<
+                  chunked_file_header>::value,
+              "The header is written as bytes");
+
+// Where a chunk is in a chunked file, and how it's encoded
+struct chunk_entry {
+  static constexpr std::uint32_t compressed_flag = 1;
+  static constexpr std::uint32_t shuffled_flag = 2;
+
+  std::uint64_t offset;
+  // The size of the encoded chunk in the file
+  std::uint64_t bytes;
+  // The file_checksum() of the decoded chunk
+  std::uint64_t checksum;
+  std::uint32_t flags;
+  std::uint32_t reserved;
+};
+
+// The offset of the first chunk, after the header and its
+// padding
+[[nodiscard]] constexpr std::uint64_t
+chunked_data_offset() noexcept {
+  constexpr std::uint64_t align =
+      nd_file_header::data_alignment;
+  return (sizeof(chunked_file_header) + align - 1) / align *
+         align;
+}
+
+// Encodes a chunk of bytes bytes of elements of T. If it
+// compresses, it's encoded into encoded, and data is set to
+// the bytes to write. The shuffling buffer and compressor
+// are reused by the thread between chunks
+template <typename T>
+[[nodiscard]] chunk_entry encode_chunk(
+    const unsigned char *chunk, const std::size_t bytes,
+    const chunked_options &options,
+    std::vector<unsigned char> &encoded,
+    const unsigned char *&data) {
+  chunk_entry entry{};
+  entry.bytes = bytes;
+  entry.checksum = file_checksum(chunk, bytes);
+  data = chunk;
+  if(options.level == 0) {
+    return entry;
+  }
+  thread_local lz_compressor compressor;
+  thread_local std::vector<unsigned char> shuffled;
+  const bool shuffle = options.shuffle && sizeof(T) > 1;
+  const unsigned char *src = chunk;
+  if(shuffle) {
+    shuffled.resize(bytes);
+    byte_shuffle<sizeof(T)>(chunk, shuffled.data(),
+                            bytes / sizeof(T));
+    src = shuffled.data();
+  }
+  encoded.resize(lz_compress_bound(bytes));
+  const std::size_t compressed = compressor.compress(
+      src, bytes, encoded.data(), options.level);
+  if(compressed < bytes) {
+    entry.bytes = compressed;
+    entry.flags = chunk_entry::compressed_flag;
+    if(shuffle) {
+      entry.flags |= chunk_entry::shuffled_flag;
+    }
+    data = encoded.data();
+  }
+  return entry;
+}
+
+// Writes arr, an nd_array_ or nd_span_ of a row major
+// layout, to a chunked file at path, replacing it if it
+// exists. The chunks are encoded in parallel in batches
+// of a few per thread, and each batch is written with a
+// single gathered write once it's been encoded, before the
+// next batch is started. Returns out_of_memory if the
+// encoding buffers can't be allocated
+template <typename Array>
+[[nodiscard]] io_status save_chunked(
+    const Array &arr, const char *path,
+    const chunked_options &options = {}) noexcept {
+  static_assert(is_nd_array_<Array>::value ||
+                    is_nd_span_<Array>::value,
+                "Only arrays and spans can be saved");
+  static_assert(Array::MAPPING::is_row_major,
+                "Chunks are blocks of outer slices, which "
+                "requires a row major layout");
+  assert(options.level >= 0 &&
+         options.level <= max_compression_level);
+  using T = typename std::remove_const<
+      typename Array::value_type>::type;
+  const std::uint64_t slices = Array::extent(0);
+  const std::uint64_t slice_bytes =
+      Array::storage_size() / slices * sizeof(T);
+
+  chunked_file_header header;
+  std::memset(&header, 0, sizeof(header));
+  header.array = make_file_header<Array>();
+  std::memcpy(header.array.magic,
+              chunked_file_header::magic_string(),
+              sizeof(header.array.magic));
+  header.array.data_offset = chunked_data_offset();
+  header.chunk_slices = std::clamp<std::uint64_t>(
+      options.chunk_bytes / slice_bytes, 1, slices);
+  header.chunks = (slices + header.chunk_slices - 1) /
+                  header.chunk_slices;
+  header.level = options.level;
+
+  const int fd =
+      open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0) {
+    return io_status::open_failed;
+  }
+  // The header is rewritten with the index's offset once
+  // the chunks have been written
+  unsigned char prefix[chunked_data_offset()] = {};
+  std::memcpy(prefix, &header, sizeof(header));
+  iovec prefix_iov = {prefix, sizeof(prefix)};
+  bool written = write_buffers(fd, &prefix_iov, 1);
+
+  thread_pool &pool = options.pool != nullptr
+                          ? *options.pool
+                          : default_thread_pool();
+  const std::size_t batch = std::min<std::size_t>(
+      header.chunks,
+      std::clamp<std::size_t>(2 * pool.size(), 1, 256));
+  std::vector<chunk_entry> index;
+  std::uint64_t offset = chunked_data_offset();
+  try {
+    index.resize(header.chunks);
+    std::vector<std::vector<unsigned char>> encoded(batch);
+    std::vector<const unsigned char *> data(batch);
+    std::vector<iovec> iov(batch);
+    const unsigned char *const storage =
+        reinterpret_cast<const unsigned char *>(arr.data());
+    for(std::size_t first = 0;
+        written && first < header.chunks; first += batch) {
+      const std::size_t n = std::min<std::size_t>(
+          batch, header.chunks - first);
+      pool.run(n, schedule::dynamic_chunks,
+               [&](const std::size_t k) {
+                 const std::uint64_t begin =
+                     (first + k) * header.chunk_slices;
+                 const std::uint64_t end = std::min(
+                     begin + header.chunk_slices, slices);
+                 index[first + k] = encode_chunk<T>(
+                     storage + begin * slice_bytes,
+                     (end - begin) * slice_bytes, options,
+                     encoded[k], data[k]);
+               });
+      for(std::size_t k = 0; k < n; k++) {
+        index[first + k].offset = offset;
+        offset += index[first + k].bytes;
+        iov[k] = {const_cast<unsigned char *>(data[k]),
+                  index[first + k].bytes};
+      }
+      written = write_buffers(fd, iov.data(), n);
+    }
+  } catch(const std::bad_alloc &) {
+    close(fd);
+    return io_status::out_of_memory;
+  }
+
+  header.index_offset = offset;
+  std::memcpy(prefix, &header, sizeof(header));
+  iovec index_iov = {index.data(),
+                     index.size() * sizeof(chunk_entry)};
+  prefix_iov = {prefix, sizeof(prefix)};
+  written = written && write_buffers(fd, &index_iov, 1) &&
+            lseek(fd, 0, SEEK_SET) == 0 &&
+            write_buffers(fd, &prefix_iov, 1);
+  const bool closed = close(fd) == 0;
+  return written && closed ? io_status::ok
+                           : io_status::io_failed;
+}
+
+// Reads chunked files, keeping the file open and its index
+// in memory so ranges of outer slices can be loaded as
+// they're needed
+class chunked_reader {
+ public:
+  explicit chunked_reader(const char *path) noexcept
+      : fd_(open(path, O_RDONLY)),
+        status_(fd_ < 0 ? io_status::open_failed
+                        : read_index()) {}
+
+  chunked_reader(const chunked_reader &) = delete;
+  chunked_reader &operator=(const chunked_reader &) =
+      delete;
+
+  ~chunked_reader() noexcept {
+    if(fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  // Whether the header and index were read
+  [[nodiscard]] io_status status() const noexcept {
+    return status_;
+  }
+
+  [[nodiscard]] const chunked_file_header &header()
+      const noexcept {
+    return header_;
+  }
+
+  [[nodiscard]] std::size_t chunks() const noexcept {
+    return index_.size();
+  }
+
+  // The size of the encoded chunks
+  [[nodiscard]] std::uint64_t compressed_bytes()
+      const noexcept {
+    std::uint64_t bytes = 0;
+    for(const chunk_entry &entry : index_) {
+      bytes += entry.bytes;
+    }
+    return bytes;
+  }
+
+  // Loads every chunk into arr, which must have the
+  // array's type, extents, and layout
+  template <typename Array>
+  [[nodiscard]] io_status load(
+      Array &arr,
+      thread_pool *pool = nullptr) const noexcept {
+    return load_slices(arr, 0, Array::extent(0), pool);
+  }
+
+  // Loads the outer slices [begin, end) of arr, decoding
+  // only the chunks which hold them; the other slices of
+  // those chunks are also loaded. If a chunk is corrupt the
+  // others are still loaded, and checksum_mismatch is
+  // returned
+  template <typename Array>
+  [[nodiscard]] io_status load_slices(
+      Array &arr, const std::size_t begin,
+      const std::size_t end,
+      thread_pool *pool = nullptr) const noexcept {
+    static_assert(is_nd_array_<Array>::value ||
+                      is_nd_span_<Array>::value,
+                  "Only arrays and spans can be loaded");
+    static_assert(
+        !std::is_const<typename Array::value_type>::value,
+        "Spans of const elements can't be loaded");
+    using T = typename Array::value_type;
+    assert(begin <= end && end <= Array::extent(0));
+    if(status_ != io_status::ok) {
+      return status_;
+    }
+    const io_status shape =
+        check_file_shape<Array>(header_.array);
+    if(shape != io_status::ok || begin == end) {
+      return shape;
+    }
+    const std::uint64_t first =
+        begin / header_.chunk_slices;
+    const std::uint64_t last =
+        (end - 1) / header_.chunk_slices + 1;
+    unsigned char *const storage =
+        reinterpret_cast<unsigned char *>(arr.data());
+    std::atomic<io_status> result(io_status::ok);
+    thread_pool &threads =
+        pool != nullptr ? *pool : default_thread_pool();
+    threads.run(last - first, schedule::dynamic_chunks,
+                [&](const std::size_t k) {
+                  const io_status status =
+                      decode_chunk<T>(first + k, storage);
+                  if(status != io_status::ok) {
+                    result.store(status,
+                                 std::memory_order_relaxed);
+                  }
+                });
+    return result.load();
+  }
+
+ private:
+  // Decodes a chunk into its place in storage
+  template <typename T>
+  [[nodiscard]] io_status decode_chunk(
+      const std::size_t chunk,
+      unsigned char *storage) const noexcept {
+    const chunk_entry &entry = index_[chunk];
+    const std::uint64_t slices = header_.array.extents[0];
+    const std::uint64_t slice_bytes =
+        header_.array.data_bytes / slices;
+    const std::uint64_t begin =
+        chunk * header_.chunk_slices;
+    const std::uint64_t end =
+        std::min(begin + header_.chunk_slices, slices);
+    const std::size_t bytes = (end - begin) * slice_bytes;
+    unsigned char *const dest =
+        storage + begin * slice_bytes;
+    if(!(entry.flags & chunk_entry::compressed_flag)) {
+      if(entry.bytes != bytes) {
+        return io_status::bad_header;
+      }
+      if(!read_bytes(fd_, dest, bytes, entry.offset)) {
+        return io_status::io_failed;
+      }
+    } else {
+      thread_local std::vector<unsigned char> compressed;
+      thread_local std::vector<unsigned char> shuffled;
+      const bool shuffle =
+          entry.flags & chunk_entry::shuffled_flag;
+      try {
+        compressed.resize(entry.bytes);
+        if(shuffle) {
+          shuffled.resize(bytes);
+        }
+      } catch(const std::bad_alloc &) {
+        return io_status::out_of_memory;
+      }
+      if(!read_bytes(fd_, compressed.data(), entry.bytes,
+                     entry.offset)) {
+        return io_status::io_failed;
+      }
+      unsigned char *const out =
+          shuffle ? shuffled.data() : dest;
+      if(!lz_decompress(compressed.data(), entry.bytes, out,
+                        bytes)) {
+        return io_status::checksum_mismatch;
+      }
+      if(shuffle) {
+        byte_unshuffle<sizeof(T)>(out, dest,
+                                  bytes / sizeof(T));
+      }
+    }
+    return file_checksum(dest, bytes) == entry.checksum
+               ? io_status::ok
+               : io_status::checksum_mismatch;
+  }
+
+  [[nodiscard]] io_status read_index() noexcept {
+    struct stat file_stat;
+    if(fstat(fd_, &file_stat) != 0) {
+      return io_status::io_failed;
+    }
+    const std::uint64_t file_bytes = file_stat.st_size;
+    if(file_bytes < sizeof(header_) ||
+       !read_bytes(fd_, &header_, sizeof(header_), 0)) {
+      return io_status::bad_header;
+    }
+    const nd_file_header &array = header_.array;
+    if(std::memcmp(array.magic,
+                   chunked_file_header::magic_string(),
+                   sizeof(array.magic)) != 0 ||
+       array.byte_order !=
+           nd_file_header::byte_order_mark ||
+       array.version != nd_file_header::current_version ||
+       array.dims == 0 || array.extents[0] == 0 ||
+       header_.chunk_slices == 0 ||
+       header_.chunks !=
+           array.extents[0] / header_.chunk_slices +
+               (array.extents[0] % header_.chunk_slices !=
+                0)) {
+      return io_status::bad_header;
+    }
+    // An interrupted save leaves the index offset as 0. The
+    // sizes are from the file, so they're compared without
+    // overflowing before anything is allocated from them
+    const std::uint64_t index_offset = header_.index_offset;
+    if(index_offset < chunked_data_offset() ||
+       index_offset > file_bytes ||
+       header_.chunks > (file_bytes - index_offset) /
+                            sizeof(chunk_entry)) {
+      return io_status::truncated;
+    }
+    try {
+      index_.resize(header_.chunks);
+    } catch(const std::bad_alloc &) {
+      return io_status::out_of_memory;
+    }
+    if(!read_bytes(fd_, index_.data(),
+                   header_.chunks * sizeof(chunk_entry),
+                   index_offset)) {
+      return io_status::io_failed;
+    }
+    for(const chunk_entry &entry : index_) {
+      if(entry.offset > index_offset ||
+         entry.bytes > index_offset - entry.offset) {
+        return io_status::truncated;
+      }
+    }
+    return io_status::ok;
+  }
+
+  int fd_;
+  chunked_file_header header_;
+  std::vector<chunk_entry> index_;
+  io_status status_;
+};
+
+// Loads the chunked file at path into arr, see
+// chunked_reader
+template <typename Array>
+[[nodiscard]] io_status load_chunked(
+    const char *path, Array &arr,
+    thread_pool *pool = nullptr) noexcept {
+  const chunked_reader reader(path);
+  return reader.load(arr, pool);
+}
+
+}  // namespace ND_Array_internals_
+
+#endif  // _CHUNKED_HPP_
@@ -4,6 +4,7 @@
 
 #include <assert.h>
 #include <type_traits>
+#include <utility>
 
 namespace ND_Array_internals_ {
 
@@ -36,17 +37,42 @@ struct CT_Array {
                      : Next::trailing_product(idx - 1));
   }
 
-  template <typename... indices>
+  // The product with the last value increased by pad, ie
+  // the storage required when the rows are padded
+  template <FieldT pad>
+  static constexpr FieldT padded_product() {
+    return leading * Next::template padded_product<pad>();
+  }
+
+  // pad is the number of elements of padding after each
+  // row of the last dimension
+  template <FieldT pad = 0, typename... indices>
   static constexpr int slice_idx(int idx, indices... tail) {
     assert(idx >= 0);
     assert(idx < value(0));
-    return idx * Next::product() + Next::slice_idx(tail...);
+    return idx * Next::template padded_product<pad>() +
+           Next::template slice_idx<pad>(tail...);
   }
 
+  template <FieldT pad = 0>
   static constexpr int slice_idx(int idx) {
     assert(idx >= 0);
     assert(idx < value(0));
-    return idx * Next::product();
+    return idx * Next::template padded_product<pad>();
+  }
+
+  // Computes the same value as slice_idx, but permits
+  // negative indices and indices past the extents, for
+  // computing relative offsets
+  template <typename... indices>
+  static constexpr int offset_idx(int offset,
+                                  indices... tail) {
+    return offset * static_cast<int>(Next::product()) +
+           Next::offset_idx(tail...);
+  }
+
+  static constexpr int offset_idx(int offset) {
+    return offset * static_cast<int>(Next::product());
   }
 
   template <typename Idx_Array,
@@ -91,12 +117,22 @@ struct CT_Array<FieldT_, val> {
     return val;
   }
 
+  template <FieldT pad>
+  static constexpr FieldT padded_product() {
+    return val + pad;
+  }
+
+  template <FieldT pad = 0>
   static constexpr int slice_idx(int idx) {
     assert(idx >= 0);
     assert(idx < val);
     return idx;
   }
 
+  static constexpr int offset_idx(int offset) {
+    return offset;
+  }
+
   template <typename Idx_Array>
   static constexpr FieldT slice_idx() {
     static_assert(Idx_Array::len() == 1,
@@ -120,6 +156,23 @@ struct forward_truncate_array<0, array> {
   using type = array;
 };
 
+// The array with the value at index axis removed
+template <int axis, typename array,
+          typename seq =
+              std::make_index_sequence<array::len() - 1>>
+struct remove_axis_array;
+
+template <int axis, typename FieldT, FieldT... vals,
+          std::size_t... Is>
+struct remove_axis_array<axis, CT_Array<FieldT, vals...>,
+                         std::index_sequence<Is...>> {
+  static_assert(axis >= 0 && axis < int(sizeof...(vals)),
+                "Axis is out of bounds");
+  using type = CT_Array<
+      FieldT, CT_Array<FieldT, vals...>::value(
+                  int(Is) < axis ? Is : Is + 1)...>;
+};
+
 }  // namespace ND_Array_internals_
 
 #endif
@@ -0,0 +1,493 @@
+
+#ifndef _DYNARRAY_HPP_
+#define _DYNARRAY_HPP_
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "rt_array.hpp"
+#include "strided_view.hpp"
+
+namespace ND_Array_internals_ {
+
+// The runtime extent counterpart to nd_array_. Extents
+// marked dynamic_extent are passed to the constructor, and
+// the storage is allocated on the heap. The row major
+// strides are computed once on construction; strides which
+// only depend on static extents are compile time constants,
+// so indexing is the same multiply-add as nd_array_.
+//
+// When owning_ is false, this is a non-owning view into
+// another array's storage, as returned by outer_slice() and
+// reshape(). Copying a view does not copy the elements.
+template <typename value_type_, typename Extents_RT_Array,
+          bool owning_ = true>
+class [[nodiscard]] nd_dyn_array_ {
+ public:
+  using EXTENTS = Extents_RT_Array;
+  using STRIDES =
+      typename row_major_strides<Extents_RT_Array>::type;
+
+  using value_type = value_type_;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using pointer = value_type *;
+  using const_pointer = const value_type *;
+
+  using size_type = typename Extents_RT_Array::FieldT;
+  using difference_type = std::ptrdiff_t;
+
+  using nd_array_type =
+      nd_dyn_array_<value_type, Extents_RT_Array, owning_>;
+  using view_type =
+      nd_dyn_array_<value_type, Extents_RT_Array, false>;
+  using const_view_type =
+      nd_dyn_array_<const value_type, Extents_RT_Array,
+                    false>;
+
+  // Only the dynamic extents are passed, in order
+  template <typename... int_t, bool owns = owning_,
+            typename std::enable_if<
+                owns && (std::is_integral<int_t>::value &&
+                         ...),
+                int>::type = 0>
+  explicit nd_dyn_array_(int_t... dynamic_extents)
+      : extents_(dynamic_extents...),
+        strides_(row_major_strides<EXTENTS>::compute(
+            extents_)),
+        size_(extents_.product()),
+        storage_(new value_type[size_]) {}
+
+  nd_dyn_array_(const nd_dyn_array_ &src)
+      : extents_(src.extents_),
+        strides_(src.strides_),
+        size_(src.size_),
+        storage_(copy_storage(src)) {}
+
+  // A moved from array is empty, with its dynamic extents
+  // zero, and can be assigned to
+  nd_dyn_array_(nd_dyn_array_ &&src) noexcept
+      : extents_(src.extents_),
+        strides_(src.strides_),
+        size_(src.size_),
+        storage_(std::move(src.storage_)) {
+    src.make_empty();
+  }
+
+  nd_dyn_array_ &operator=(const nd_dyn_array_ &src) {
+    if(this != &src) {
+      *this = nd_dyn_array_(src);
+    }
+    return *this;
+  }
+
+  nd_dyn_array_ &operator=(nd_dyn_array_ &&src) noexcept {
+    if(this != &src) {
+      extents_ = src.extents_;
+      strides_ = src.strides_;
+      size_ = src.size_;
+      storage_ = std::move(src.storage_);
+      src.make_empty();
+    }
+    return *this;
+  }
+
+  // Views of mutable elements can be used as views of
+  // constant elements
+  template <typename other_value_type,
+            bool owns = owning_,
+            typename std::enable_if<
+                !owns &&
+                    std::is_same<const other_value_type,
+                                 value_type>::value,
+                int>::type = 0>
+  nd_dyn_array_(const nd_dyn_array_<other_value_type,
+                                    EXTENTS, false> &src)
+      : extents_(src.extents_),
+        strides_(src.strides_),
+        size_(src.size_),
+        storage_(src.data()) {}
+
+  template <typename... int_t>
+  [[nodiscard]] const_reference at(
+      int_t... indices) const noexcept {
+    static_assert(sizeof...(int_t) == EXTENTS::len(),
+                  "Number of indices passed is incorrect");
+    assert(in_bounds(indices...));
+    return data()[linear_idx(strides_, indices...)];
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] reference at(int_t... indices) noexcept {
+    static_assert(sizeof...(int_t) == EXTENTS::len(),
+                  "Number of indices passed is incorrect");
+    assert(in_bounds(indices...));
+    return data()[linear_idx(strides_, indices...)];
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] reference operator()(
+      int_t... indices) noexcept {
+    return at(indices...);
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] const_reference operator()(
+      int_t... indices) const noexcept {
+    return at(indices...);
+  }
+
+  [[nodiscard]] reference front() noexcept {
+    return data()[0];
+  }
+
+  [[nodiscard]] const_reference front() const noexcept {
+    return data()[0];
+  }
+
+  [[nodiscard]] reference back() noexcept {
+    return data()[size() - 1];
+  }
+
+  [[nodiscard]] const_reference back() const noexcept {
+    return data()[size() - 1];
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] nd_dyn_array_<
+      const value_type,
+      typename forward_truncate_rt_array<
+          sizeof...(int_t), Extents_RT_Array>::type,
+      false>
+  outer_slice(int_t... indices) const noexcept {
+    using ret_type = nd_dyn_array_<
+        const value_type,
+        typename forward_truncate_rt_array<
+            sizeof...(int_t), EXTENTS>::type,
+        false>;
+    return make_slice<ret_type>(indices...);
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] nd_dyn_array_<
+      value_type,
+      typename forward_truncate_rt_array<
+          sizeof...(int_t), Extents_RT_Array>::type,
+      false>
+  outer_slice(int_t... indices) noexcept {
+    using ret_type = nd_dyn_array_<
+        value_type,
+        typename forward_truncate_rt_array<
+            sizeof...(int_t), EXTENTS>::type,
+        false>;
+    return make_slice<ret_type>(indices...);
+  }
+
+  using strided_view_type =
+      nd_strided_view_<value_type, EXTENTS, STRIDES>;
+  using const_strided_view_type =
+      nd_strided_view_<const value_type, EXTENTS, STRIDES>;
+
+  // A view of every element, from which views through any
+  // dimension can be taken
+  [[nodiscard]] strided_view_type strided_view() noexcept {
+    return strided_view_type(data(), extents_, strides_);
+  }
+
+  [[nodiscard]] const_strided_view_type strided_view() const
+      noexcept {
+    return const_strided_view_type(data(), extents_,
+                                   strides_);
+  }
+
+  // The view with Dim fixed at idx; unlike outer_slice(),
+  // Dim can be any dimension
+  template <int Dim>
+  [[nodiscard]]
+  typename strided_view_type::template slice_type<Dim>
+  slice(const size_type idx) noexcept {
+    return strided_view().template slice<Dim>(idx);
+  }
+
+  template <int Dim>
+  [[nodiscard]] typename const_strided_view_type::
+      template slice_type<Dim>
+      slice(const size_type idx) const noexcept {
+    return strided_view().template slice<Dim>(idx);
+  }
+
+  // The view of the indices [begin, end) of Dim
+  template <int Dim>
+  [[nodiscard]]
+  typename strided_view_type::template subrange_type<Dim>
+  subrange(const size_type begin,
+           const size_type end) noexcept {
+    return strided_view().template subrange<Dim>(begin,
+                                                 end);
+  }
+
+  template <int Dim>
+  [[nodiscard]] typename const_strided_view_type::
+      template subrange_type<Dim>
+      subrange(const size_type begin,
+               const size_type end) const noexcept {
+    return strided_view().template subrange<Dim>(begin,
+                                                 end);
+  }
+
+  // The view of every step'th index of Dim
+  template <int Dim>
+  [[nodiscard]]
+  typename strided_view_type::template stride_type<Dim>
+  stride(const size_type step) noexcept {
+    return strided_view().template stride<Dim>(step);
+  }
+
+  template <int Dim>
+  [[nodiscard]] typename const_strided_view_type::
+      template stride_type<Dim>
+      stride(const size_type step) const noexcept {
+    return strided_view().template stride<Dim>(step);
+  }
+
+  // Reshaped_Array is the type of the array to view the
+  // elements as, which only needs its dynamic extents
+  // specified
+  template <typename Reshaped_Array, typename... int_t>
+  [[nodiscard]] typename Reshaped_Array::view_type reshape(
+      int_t... dynamic_extents) noexcept {
+    using ret_type = typename Reshaped_Array::view_type;
+    static_assert(
+        std::is_same<typename ret_type::value_type,
+                     value_type>::value,
+        "Reshaped array has a different value type");
+    const typename ret_type::EXTENTS extents(
+        dynamic_extents...);
+    assert(extents.product() == size());
+    return ret_type(data(), extents);
+  }
+
+  template <typename Reshaped_Array, typename... int_t>
+  [[nodiscard]] typename Reshaped_Array::const_view_type
+  reshape(int_t... dynamic_extents) const noexcept {
+    using ret_type =
+        typename Reshaped_Array::const_view_type;
+    const typename ret_type::EXTENTS extents(
+        dynamic_extents...);
+    assert(extents.product() == size());
+    return ret_type(data(), extents);
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  [[nodiscard]] size_type extent(int dim) const noexcept {
+    return extents_.value(dim);
+  }
+
+  [[nodiscard]] size_type stride(int dim) const noexcept {
+    return strides_.value(dim);
+  }
+
+  [[nodiscard]] size_type size() const noexcept {
+    return size_;
+  }
+
+  [[nodiscard]] size_type max_size() const noexcept {
+    return size();
+  }
+
+  [[nodiscard]] static constexpr int dimension() {
+    return EXTENTS::len();
+  }
+
+  [[nodiscard]] pointer data() noexcept {
+    if constexpr(owning_) {
+      return storage_.get();
+    } else {
+      return storage_;
+    }
+  }
+
+  [[nodiscard]] const_pointer data() const noexcept {
+    if constexpr(owning_) {
+      return storage_.get();
+    } else {
+      return storage_;
+    }
+  }
+
+  void fill(const_reference value) noexcept {
+    for(reference elem : (*this)) {
+      elem = value;
+    }
+  }
+
+  // Owning arrays exchange their storage; views exchange
+  // the elements they refer to
+  void swap(nd_array_type &rhs) noexcept {
+    if constexpr(owning_) {
+      std::swap(extents_, rhs.extents_);
+      std::swap(strides_, rhs.strides_);
+      std::swap(size_, rhs.size_);
+      std::swap(storage_, rhs.storage_);
+    } else {
+      assert(size() == rhs.size());
+      iterator iter_l = begin();
+      iterator iter_r = rhs.begin();
+      while(iter_l != end()) {
+        std::swap(*iter_l, *iter_r);
+        iter_l++;
+        iter_r++;
+      }
+    }
+  }
+
+  using iterator = value_type *;
+
+  [[nodiscard]] iterator begin() noexcept { return data(); }
+
+  [[nodiscard]] iterator end() noexcept {
+    return data() + size();
+  }
+
+  using const_iterator = const value_type *;
+
+  [[nodiscard]] const_iterator cbegin() const noexcept {
+    return data();
+  }
+
+  [[nodiscard]] const_iterator cend() const noexcept {
+    return data() + size();
+  }
+
+  [[nodiscard]] size_type index(const const_iterator &itr,
+                                const int dim) const
+      noexcept {
+    assert(dim >= 0);
+    assert(dim < EXTENTS::len());
+    const difference_type idx = itr - cbegin();
+    return (idx / strides_.value(dim)) %
+           extents_.value(dim);
+  }
+
+  // WARNING: This function can return an invalid iterator,
+  // comparisons of the returned iterator against begin()
+  // and end() should be inequalities rather than equalities
+  template <typename... int_t>
+  [[nodiscard]] iterator offset(
+      const iterator &origin, const int_t &... offset) const
+      noexcept {
+    return origin + linear_idx(strides_, offset...);
+  }
+
+  template <typename _value_type,
+            typename _Extents_RT_Array, bool _owning>
+  friend class nd_dyn_array_;
+
+ private:
+  using storage_type =
+      typename std::conditional<
+          owning_, std::unique_ptr<value_type[]>,
+          pointer>::type;
+
+  nd_dyn_array_(pointer vals, const EXTENTS &extents)
+      : extents_(extents),
+        strides_(
+            row_major_strides<EXTENTS>::compute(extents_)),
+        size_(extents_.product()),
+        storage_(vals) {
+    static_assert(!owning_,
+                  "Only views can be constructed from a "
+                  "pointer");
+  }
+
+  nd_dyn_array_(pointer vals, const EXTENTS &extents,
+                const STRIDES &strides)
+      : extents_(extents),
+        strides_(strides),
+        size_(extents_.product()),
+        storage_(vals) {
+    static_assert(!owning_,
+                  "Only views can be constructed from a "
+                  "pointer");
+  }
+
+  static storage_type copy_storage(
+      const nd_dyn_array_ &src) {
+    if constexpr(owning_) {
+      storage_type vals(new value_type[src.size()]);
+      std::copy(src.cbegin(), src.cend(), vals.get());
+      return vals;
+    } else {
+      return src.storage_;
+    }
+  }
+
+  // Views still refer to the elements after being moved
+  void make_empty() noexcept {
+    if constexpr(owning_) {
+      size_type values[EXTENTS::len()];
+      for(int i = 0; i < EXTENTS::len(); i++) {
+        values[i] = EXTENTS::is_static(i)
+                        ? EXTENTS::static_value(i)
+                        : 0;
+      }
+      extents_ = EXTENTS::from_values(values);
+      strides_ =
+          row_major_strides<EXTENTS>::compute(extents_);
+      size_ = 0;
+    }
+  }
+
+  template <typename ret_type, typename... int_t>
+  ret_type make_slice(int_t... indices) const noexcept {
+    constexpr int truncated = sizeof...(int_t);
+    static_assert(truncated < EXTENTS::len(),
+                  "Too many indices for a slice");
+    assert(in_bounds(indices...));
+    return ret_type(
+        const_cast<pointer>(data()) +
+            linear_idx(strides_, indices...),
+        ret_type::EXTENTS::from_values(extents_.values() +
+                                       truncated),
+        ret_type::STRIDES::from_values(strides_.values() +
+                                       truncated));
+  }
+
+  template <std::size_t... Is, typename... int_t>
+  bool in_bounds_impl(std::index_sequence<Is...>,
+                      int_t... indices) const noexcept {
+    return ((static_cast<difference_type>(indices) >= 0 &&
+             static_cast<size_type>(indices) <
+                 extents_.template get<Is>()) &&
+            ... && true);
+  }
+
+  template <typename... int_t>
+  bool in_bounds(int_t... indices) const noexcept {
+    return in_bounds_impl(
+        std::make_index_sequence<sizeof...(int_t)>{},
+        indices...);
+  }
+
+  EXTENTS extents_;
+  STRIDES strides_;
+  size_type size_;
+  storage_type storage_;
+};
+
+}  // namespace ND_Array_internals_
+
+constexpr int ND_Dynamic =
+    ND_Array_internals_::dynamic_extent;
+
+template <typename value_type, int... Dims>
+using ND_Dyn_Array = ND_Array_internals_::nd_dyn_array_<
+    value_type,
+    ND_Array_internals_::RT_Array<size_t, Dims...>>;
+
+#endif
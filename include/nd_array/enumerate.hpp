@@ -0,0 +1,265 @@
+
+#ifndef _ENUMERATE_HPP_
+#define _ENUMERATE_HPP_
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "nd_array.hpp"
+
+namespace ND_Array_internals_ {
+
+// Iterates over the elements of an array in row major index
+// order, keeping the indices of the current element. A step
+// increments the last index, and only carries into the
+// previous dimension at the end of a row, so the indices
+// never need the divides and modulos of index(). Strided
+// layouts step their storage offset with the indices; other
+// layouts compute it from the indices when dereferenced
+template <typename value_type_, typename Dims,
+          typename Mapping>
+class indexed_iterator {
+ public:
+  using value_type =
+      typename std::remove_cv<value_type_>::type;
+  using size_type = typename Dims::FieldT;
+  using indices_type = std::array<size_type, Dims::len()>;
+  using reference = value_type_ &;
+  using pointer = value_type_ *;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::forward_iterator_tag;
+
+  constexpr indexed_iterator() noexcept
+      : vals_(nullptr), offset_(0), pos_(0), idx_{} {}
+
+  // Only the first or one past the last element, as
+  // reaching others requires the divides this avoids
+  constexpr indexed_iterator(pointer vals,
+                             const bool at_end) noexcept
+      : vals_(vals),
+        offset_(0),
+        pos_(at_end ? Dims::product() : 0),
+        idx_{} {
+    if(at_end) {
+      idx_[0] = Dims::value(0);
+      if constexpr(Mapping::is_strided) {
+        offset_ = idx_[0] * Mapping::stride(0);
+      }
+    }
+  }
+
+  [[nodiscard]] constexpr reference operator*() const
+      noexcept {
+    return vals_[storage_offset()];
+  }
+
+  [[nodiscard]] constexpr pointer operator->() const
+      noexcept {
+    return &vals_[storage_offset()];
+  }
+
+  [[nodiscard]] constexpr const indices_type &indices()
+      const noexcept {
+    return idx_;
+  }
+
+  template <int dim>
+  [[nodiscard]] constexpr size_type index() const noexcept {
+    static_assert(dim >= 0 && dim < Dims::len(),
+                  "Invalid dimension");
+    return std::get<dim>(idx_);
+  }
+
+  constexpr indexed_iterator &operator++() noexcept {
+    ++pos_;
+    increment<last_>();
+    return *this;
+  }
+
+  constexpr indexed_iterator operator++(int) noexcept {
+    const auto copy = *this;
+    ++(*this);
+    return copy;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator==(
+      const indexed_iterator<other_value_type, Dims,
+                             Mapping> &cmp) const noexcept {
+    return pos_ == cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator!=(
+      const indexed_iterator<other_value_type, Dims,
+                             Mapping> &cmp) const noexcept {
+    return pos_ != cmp.pos_;
+  }
+
+  template <typename _value_type, typename _Dims,
+            typename _Mapping>
+  friend class indexed_iterator;
+
+ private:
+  static constexpr int last_ = Dims::len() - 1;
+
+  template <int dim>
+  constexpr void increment() noexcept {
+    if constexpr(Mapping::is_strided) {
+      offset_ += Mapping::stride(dim);
+    }
+    idx_[dim]++;
+    if constexpr(dim > 0) {
+      if(idx_[dim] == Dims::value(dim)) {
+        idx_[dim] = 0;
+        if constexpr(Mapping::is_strided) {
+          offset_ -=
+              Dims::value(dim) * Mapping::stride(dim);
+        }
+        increment<dim - 1>();
+      }
+    }
+  }
+
+  template <std::size_t... Is>
+  constexpr size_type slice_offset(
+      std::index_sequence<Is...>) const noexcept {
+    return Mapping::slice_idx(std::get<Is>(idx_)...);
+  }
+
+  constexpr size_type storage_offset() const noexcept {
+    if constexpr(Mapping::is_strided) {
+      return offset_;
+    } else {
+      return slice_offset(
+          std::make_index_sequence<Dims::len()>{});
+    }
+  }
+
+  pointer vals_;
+  // The storage offset of the element; only tracked for
+  // strided layouts
+  size_type offset_;
+  // The index of the element in row major order
+  size_type pos_;
+  indices_type idx_;
+};
+
+// The elements of an array with their indices, for loops
+// which need both:
+//
+// for(auto [idx, v] : enumerate(arr)) {
+//   v = idx[0] == 0 ? boundary : interior;
+// }
+//
+// The indices are a reference into the iterator, so they
+// must be copied to be kept past the current iteration
+template <typename value_type_, typename Dims,
+          typename Mapping>
+class enumerate_range {
+ public:
+  using base_iterator =
+      indexed_iterator<value_type_, Dims, Mapping>;
+  using indices_type = typename base_iterator::indices_type;
+  using element_type =
+      std::pair<const indices_type &, value_type_ &>;
+
+  class iterator : public base_iterator {
+   public:
+    using value_type = element_type;
+    using reference = element_type;
+    using pointer = void;
+
+    using base_iterator::base_iterator;
+
+    [[nodiscard]] constexpr element_type operator*() const
+        noexcept {
+      return element_type(this->indices(),
+                          base_iterator::operator*());
+    }
+
+    constexpr iterator &operator++() noexcept {
+      base_iterator::operator++();
+      return *this;
+    }
+
+    constexpr iterator operator++(int) noexcept {
+      const auto copy = *this;
+      ++(*this);
+      return copy;
+    }
+  };
+
+  explicit constexpr enumerate_range(
+      value_type_ *vals) noexcept
+      : vals_(vals) {}
+
+  [[nodiscard]] constexpr iterator begin() const noexcept {
+    return iterator(vals_, false);
+  }
+
+  [[nodiscard]] constexpr iterator end() const noexcept {
+    return iterator(vals_, true);
+  }
+
+  [[nodiscard]] static constexpr std::size_t
+  size() noexcept {
+    return Dims::product();
+  }
+
+ private:
+  value_type_ *vals_;
+};
+
+template <typename value_type, typename Dims,
+          std::size_t alignment, typename Layout>
+[[nodiscard]] constexpr enumerate_range<
+    value_type, Dims,
+    typename Layout::template mapping<Dims>>
+enumerate(nd_array_<value_type, Dims, alignment, Layout>
+              &arr) noexcept {
+  return enumerate_range<
+      value_type, Dims,
+      typename Layout::template mapping<Dims>>(arr.data());
+}
+
+template <typename value_type, typename Dims,
+          std::size_t alignment, typename Layout>
+[[nodiscard]] constexpr enumerate_range<
+    const value_type, Dims,
+    typename Layout::template mapping<Dims>>
+enumerate(const nd_array_<value_type, Dims, alignment,
+                          Layout> &arr) noexcept {
+  return enumerate_range<
+      const value_type, Dims,
+      typename Layout::template mapping<Dims>>(arr.data());
+}
+
+// Iterators over the elements of an array in row major
+// index order which keep their indices
+template <typename value_type, typename Dims,
+          std::size_t alignment, typename Layout>
+[[nodiscard]] constexpr indexed_iterator<
+    value_type, Dims,
+    typename Layout::template mapping<Dims>>
+indexed_begin(nd_array_<value_type, Dims, alignment, Layout>
+                  &arr) noexcept {
+  return {arr.data(), false};
+}
+
+template <typename value_type, typename Dims,
+          std::size_t alignment, typename Layout>
+[[nodiscard]] constexpr indexed_iterator<
+    value_type, Dims,
+    typename Layout::template mapping<Dims>>
+indexed_end(nd_array_<value_type, Dims, alignment, Layout>
+                &arr) noexcept {
+  return {arr.data(), true};
+}
+
+}  // namespace ND_Array_internals_
+
+#endif  // _ENUMERATE_HPP_
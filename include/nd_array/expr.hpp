@@ -0,0 +1,363 @@
+
+#ifndef _EXPR_HPP_
+#define _EXPR_HPP_
+
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "nd_array.hpp"
+#include "span.hpp"
+
+namespace ND_Array_internals_ {
+
+// Lazily evaluated elementwise arithmetic on nd_array_ and
+// nd_span_.
+// The operators build a tree of expressions holding
+// references to the arrays, which is evaluated in a single
+// pass when it's assigned to an array, so
+//   u = a * u + b * (v - w);
+// reads each element of u, v, and w once and writes each
+// element of u once, without any temporary arrays.
+//
+// Every expression has the DIMS of the arrays it's computed
+// from (or void for a scalar), and evaluates its idx'th
+// element in row major order with eval(idx). The shapes of
+// the operands are checked at compile time.
+//
+// The arrays in an expression must outlive it; expressions
+// should be assigned immediately rather than stored
+
+// Whether T can be an operand of the expression operators
+template <typename T>
+struct is_nd_operand_
+    : std::integral_constant<
+          bool, is_nd_array_<T>::value ||
+                    is_nd_span_<T>::value ||
+                    is_nd_expr_<T>::value> {};
+
+template <typename Array>
+class array_expr_ {
+ public:
+  using DIMS = typename Array::DIMS;
+  using value_type = typename std::remove_const<
+      typename Array::value_type>::type;
+  using size_type = typename Array::size_type;
+
+  explicit constexpr array_expr_(const Array &arr) noexcept
+      : arr_(arr) {}
+
+  [[nodiscard]] constexpr value_type eval(
+      const size_type idx) const noexcept {
+    return arr_.data()[Array::MAPPING::storage_idx(idx)];
+  }
+
+ private:
+  // Spans are cheap to copy, and may be temporaries
+  typename std::conditional<is_nd_span_<Array>::value,
+                            Array, const Array &>::type
+      arr_;
+};
+
+// Broadcasts a scalar to every element of the other operand
+template <typename T>
+class scalar_expr_ {
+ public:
+  using DIMS = void;
+  using value_type = T;
+
+  explicit constexpr scalar_expr_(const T &val) noexcept
+      : val_(val) {}
+
+  template <typename size_type>
+  [[nodiscard]] constexpr value_type eval(
+      const size_type) const noexcept {
+    return val_;
+  }
+
+ private:
+  T val_;
+};
+
+template <typename Op, typename Operand>
+class unary_expr_ {
+ public:
+  using DIMS = typename Operand::DIMS;
+  using value_type = typename std::decay<decltype(
+      std::declval<Op>()(
+          std::declval<typename Operand::value_type>()))>::
+      type;
+
+  explicit constexpr unary_expr_(
+      const Operand &operand) noexcept
+      : operand_(operand) {}
+
+  template <typename size_type>
+  [[nodiscard]] constexpr value_type eval(
+      const size_type idx) const noexcept {
+    return Op()(operand_.eval(idx));
+  }
+
+ private:
+  Operand operand_;
+};
+
+template <typename Op, typename LHS, typename RHS>
+class binary_expr_ {
+ public:
+  static_assert(
+      std::is_void<typename LHS::DIMS>::value ||
+          std::is_void<typename RHS::DIMS>::value ||
+          std::is_same<typename LHS::DIMS,
+                       typename RHS::DIMS>::value,
+      "Shapes don't match");
+
+  using DIMS = typename std::conditional<
+      std::is_void<typename LHS::DIMS>::value,
+      typename RHS::DIMS, typename LHS::DIMS>::type;
+  using value_type = typename std::decay<decltype(
+      std::declval<Op>()(
+          std::declval<typename LHS::value_type>(),
+          std::declval<typename RHS::value_type>()))>::type;
+
+  constexpr binary_expr_(const LHS &lhs,
+                         const RHS &rhs) noexcept
+      : lhs_(lhs), rhs_(rhs) {}
+
+  template <typename size_type>
+  [[nodiscard]] constexpr value_type eval(
+      const size_type idx) const noexcept {
+    return Op()(lhs_.eval(idx), rhs_.eval(idx));
+  }
+
+ private:
+  LHS lhs_;
+  RHS rhs_;
+};
+
+template <typename Array>
+struct is_nd_expr_<array_expr_<Array>> : std::true_type {};
+
+template <typename Op, typename Operand>
+struct is_nd_expr_<unary_expr_<Op, Operand>>
+    : std::true_type {};
+
+template <typename Op, typename LHS, typename RHS>
+struct is_nd_expr_<binary_expr_<Op, LHS, RHS>>
+    : std::true_type {};
+
+// Converts an operand to the expression holding it
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout>
+constexpr array_expr_<
+    nd_array_<value_type, Dims_CT_Array, alignment, Layout>>
+to_expr(const nd_array_<value_type, Dims_CT_Array,
+                        alignment, Layout> &arr) noexcept {
+  return array_expr_<nd_array_<value_type, Dims_CT_Array,
+                               alignment, Layout>>(arr);
+}
+
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout>
+constexpr array_expr_<
+    nd_span_<value_type, Dims_CT_Array, alignment, Layout>>
+to_expr(const nd_span_<value_type, Dims_CT_Array,
+                       alignment, Layout> &span) noexcept {
+  return array_expr_<nd_span_<value_type, Dims_CT_Array,
+                              alignment, Layout>>(span);
+}
+
+template <typename Expr,
+          typename std::enable_if<is_nd_expr_<Expr>::value,
+                                  int>::type = 0>
+constexpr Expr to_expr(const Expr &expr) noexcept {
+  return expr;
+}
+
+template <typename T,
+          typename std::enable_if<
+              std::is_arithmetic<T>::value, int>::type = 0>
+constexpr scalar_expr_<T> to_expr(const T &val) noexcept {
+  return scalar_expr_<T>(val);
+}
+
+template <typename T>
+using to_expr_t =
+    decltype(to_expr(std::declval<const T &>()));
+
+// Binary operations require at least one array or
+// expression; the other operand may be a scalar
+template <typename LHS, typename RHS>
+struct enable_binary_expr_
+    : std::enable_if<
+          (is_nd_operand_<LHS>::value &&
+           (is_nd_operand_<RHS>::value ||
+            std::is_arithmetic<RHS>::value)) ||
+              (std::is_arithmetic<LHS>::value &&
+               is_nd_operand_<RHS>::value),
+          int> {};
+
+template <typename Op, typename LHS, typename RHS>
+using binary_expr_t =
+    binary_expr_<Op, to_expr_t<LHS>, to_expr_t<RHS>>;
+
+template <typename Op, typename LHS, typename RHS>
+constexpr binary_expr_t<Op, LHS, RHS> make_binary_expr(
+    const LHS &lhs, const RHS &rhs) noexcept {
+  return binary_expr_t<Op, LHS, RHS>(to_expr(lhs),
+                                     to_expr(rhs));
+}
+
+template <typename LHS, typename RHS,
+          typename enable_binary_expr_<LHS, RHS>::type = 0>
+[[nodiscard]] constexpr binary_expr_t<std::plus<>, LHS, RHS>
+operator+(const LHS &lhs, const RHS &rhs) noexcept {
+  return make_binary_expr<std::plus<>>(lhs, rhs);
+}
+
+template <typename LHS, typename RHS,
+          typename enable_binary_expr_<LHS, RHS>::type = 0>
+[[nodiscard]] constexpr binary_expr_t<std::minus<>, LHS,
+                                      RHS>
+operator-(const LHS &lhs, const RHS &rhs) noexcept {
+  return make_binary_expr<std::minus<>>(lhs, rhs);
+}
+
+template <typename LHS, typename RHS,
+          typename enable_binary_expr_<LHS, RHS>::type = 0>
+[[nodiscard]] constexpr binary_expr_t<std::multiplies<>,
+                                      LHS, RHS>
+operator*(const LHS &lhs, const RHS &rhs) noexcept {
+  return make_binary_expr<std::multiplies<>>(lhs, rhs);
+}
+
+template <typename LHS, typename RHS,
+          typename enable_binary_expr_<LHS, RHS>::type = 0>
+[[nodiscard]] constexpr binary_expr_t<std::divides<>, LHS,
+                                      RHS>
+operator/(const LHS &lhs, const RHS &rhs) noexcept {
+  return make_binary_expr<std::divides<>>(lhs, rhs);
+}
+
+struct expr_pow_ {
+  template <typename T, typename U>
+  constexpr auto operator()(const T &base,
+                            const U &exponent) const {
+    using std::pow;
+    return pow(base, exponent);
+  }
+};
+
+template <typename LHS, typename RHS,
+          typename enable_binary_expr_<LHS, RHS>::type = 0>
+[[nodiscard]] constexpr binary_expr_t<expr_pow_, LHS, RHS>
+pow(const LHS &base, const RHS &exponent) noexcept {
+  return make_binary_expr<expr_pow_>(base, exponent);
+}
+
+template <typename Operand,
+          typename std::enable_if<
+              is_nd_operand_<Operand>::value,
+              int>::type = 0>
+[[nodiscard]] constexpr unary_expr_<std::negate<>,
+                                    to_expr_t<Operand>>
+operator-(const Operand &operand) noexcept {
+  return unary_expr_<std::negate<>, to_expr_t<Operand>>(
+      to_expr(operand));
+}
+
+// Defines the functor and the function building the
+// expression for the elementwise unary math function name
+#define ND_ARRAY_EXPR_UNARY_FUNCTION(name)                 \
+  struct expr_##name##_ {                                  \
+    template <typename T>                                  \
+    constexpr auto operator()(const T &val) const {        \
+      using std::name;                                     \
+      return name(val);                                    \
+    }                                                      \
+  };                                                       \
+                                                           \
+  template <typename Operand,                              \
+            typename std::enable_if<                       \
+                is_nd_operand_<Operand>::value,            \
+                int>::type = 0>                            \
+  [[nodiscard]] constexpr unary_expr_<expr_##name##_,      \
+                                      to_expr_t<Operand>>  \
+  name(const Operand &operand) noexcept {                  \
+    return unary_expr_<expr_##name##_,                     \
+                       to_expr_t<Operand>>(                \
+        to_expr(operand));                                 \
+  }
+
+ND_ARRAY_EXPR_UNARY_FUNCTION(abs)
+ND_ARRAY_EXPR_UNARY_FUNCTION(sqrt)
+ND_ARRAY_EXPR_UNARY_FUNCTION(exp)
+ND_ARRAY_EXPR_UNARY_FUNCTION(log)
+ND_ARRAY_EXPR_UNARY_FUNCTION(sin)
+ND_ARRAY_EXPR_UNARY_FUNCTION(cos)
+
+#undef ND_ARRAY_EXPR_UNARY_FUNCTION
+
+// Compound assignment evaluates arr = arr op rhs in a
+// single pass
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout,
+          typename RHS>
+constexpr typename std::enable_if<
+    is_nd_operand_<RHS>::value ||
+        std::is_arithmetic<RHS>::value,
+    nd_array_<value_type, Dims_CT_Array, alignment,
+              Layout> &>::type
+operator+=(nd_array_<value_type, Dims_CT_Array, alignment,
+                     Layout> &arr,
+           const RHS &rhs) noexcept {
+  return arr = arr + rhs;
+}
+
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout,
+          typename RHS>
+constexpr typename std::enable_if<
+    is_nd_operand_<RHS>::value ||
+        std::is_arithmetic<RHS>::value,
+    nd_array_<value_type, Dims_CT_Array, alignment,
+              Layout> &>::type
+operator-=(nd_array_<value_type, Dims_CT_Array, alignment,
+                     Layout> &arr,
+           const RHS &rhs) noexcept {
+  return arr = arr - rhs;
+}
+
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout,
+          typename RHS>
+constexpr typename std::enable_if<
+    is_nd_operand_<RHS>::value ||
+        std::is_arithmetic<RHS>::value,
+    nd_array_<value_type, Dims_CT_Array, alignment,
+              Layout> &>::type
+operator*=(nd_array_<value_type, Dims_CT_Array, alignment,
+                     Layout> &arr,
+           const RHS &rhs) noexcept {
+  return arr = arr * rhs;
+}
+
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout,
+          typename RHS>
+constexpr typename std::enable_if<
+    is_nd_operand_<RHS>::value ||
+        std::is_arithmetic<RHS>::value,
+    nd_array_<value_type, Dims_CT_Array, alignment,
+              Layout> &>::type
+operator/=(nd_array_<value_type, Dims_CT_Array, alignment,
+                     Layout> &arr,
+           const RHS &rhs) noexcept {
+  return arr = arr / rhs;
+}
+
+}  // namespace ND_Array_internals_
+
+#endif
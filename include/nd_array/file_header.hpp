@@ -0,0 +1,297 @@
+
+#ifndef _FILE_HEADER_HPP_
+#define _FILE_HEADER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "layout.hpp"
+
+namespace ND_Array_internals_ {
+
+// The results of reading and writing array files, which
+// are returned rather than thrown
+enum class io_status {
+  ok,
+  // The file couldn't be opened or created
+  open_failed,
+  // The file couldn't be mapped, read, or written
+  io_failed,
+  // The file isn't an array file, or was written by another
+  // version or on a machine with another byte order
+  bad_header,
+  // The elements are of another type
+  type_mismatch,
+  // The extents or the layout are different
+  shape_mismatch,
+  // The file is shorter than its header says
+  truncated,
+  // The elements don't match the checksum in the header
+  checksum_mismatch,
+  // The file uses a feature which isn't implemented
+  unsupported,
+  // The array couldn't be allocated
+  out_of_memory
+};
+
+[[nodiscard]] constexpr const char *io_status_name(
+    const io_status status) noexcept {
+  switch(status) {
+    case io_status::ok:
+      return "ok";
+    case io_status::open_failed:
+      return "open failed";
+    case io_status::io_failed:
+      return "io failed";
+    case io_status::bad_header:
+      return "bad header";
+    case io_status::type_mismatch:
+      return "type mismatch";
+    case io_status::shape_mismatch:
+      return "shape mismatch";
+    case io_status::truncated:
+      return "truncated";
+    case io_status::checksum_mismatch:
+      return "checksum mismatch";
+    case io_status::out_of_memory:
+      return "out of memory";
+    default:
+      return "unsupported";
+  }
+}
+
+// The element type of an array file, as the kind of the
+// type and its size: 'f' for floating point, 'i' and 'u'
+// for signed and unsigned integers, 'b' for bool, and 'V'
+// for other trivially copyable types, which are only
+// checked by their size
+template <typename T>
+[[nodiscard]] constexpr std::uint32_t
+element_kind() noexcept {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Array files require trivially copyable "
+                "elements");
+  if constexpr(std::is_same<T, bool>::value) {
+    return 'b';
+  } else if constexpr(std::is_floating_point<T>::value) {
+    return 'f';
+  } else if constexpr(std::is_integral<T>::value) {
+    return std::is_signed<T>::value ? 'i' : 'u';
+  } else {
+    return 'V';
+  }
+}
+
+// The layout of an array file, as an id and the layout's
+// parameters
+template <typename Layout>
+struct layout_code;
+
+template <>
+struct layout_code<row_major> {
+  static constexpr std::uint32_t id = 0;
+  static constexpr std::uint32_t params[2] = {0, 0};
+};
+
+template <std::size_t pad>
+struct layout_code<padded_row_major<pad>> {
+  static constexpr std::uint32_t id = 1;
+  static constexpr std::uint32_t params[2] = {pad, 0};
+};
+
+template <>
+struct layout_code<col_major> {
+  static constexpr std::uint32_t id = 2;
+  static constexpr std::uint32_t params[2] = {0, 0};
+};
+
+template <std::size_t tile_rows, std::size_t tile_cols>
+struct layout_code<tiled<tile_rows, tile_cols>> {
+  static constexpr std::uint32_t id = 3;
+  static constexpr std::uint32_t params[2] = {tile_rows,
+                                              tile_cols};
+};
+
+template <>
+struct layout_code<morton> {
+  static constexpr std::uint32_t id = 4;
+  static constexpr std::uint32_t params[2] = {0, 0};
+};
+
+// The header at the start of an array file, describing the
+// elements which follow it at data_offset. The elements are
+// the array's storage, including any padding, in the byte
+// order of the machine which wrote them
+struct nd_file_header {
+  static constexpr std::size_t max_dims = 16;
+  static constexpr std::uint32_t current_version = 1;
+  // Written as a number, so it reads back differently on a
+  // machine with the other byte order
+  static constexpr std::uint32_t byte_order_mark =
+      0x01020304;
+  // The alignment of the elements in the file
+  static constexpr std::uint64_t data_alignment = 64;
+  // Set when checksum is the file_checksum() of the
+  // elements; files which are modified in place, such as
+  // mapped arrays, don't have one
+  static constexpr std::uint32_t checksum_flag = 1;
+
+  char magic[8];
+  std::uint32_t byte_order;
+  std::uint32_t version;
+  std::uint64_t data_offset;
+  std::uint64_t data_bytes;
+  std::uint32_t type_kind;
+  std::uint32_t type_size;
+  std::uint32_t layout;
+  std::uint32_t layout_params[2];
+  std::uint32_t dims;
+  std::uint32_t flags;
+  std::uint32_t reserved;
+  std::uint64_t checksum;
+  std::uint64_t extents[max_dims];
+
+  [[nodiscard]] static constexpr const char *
+  magic_string() noexcept {
+    return "NDARRAY";
+  }
+};
+
+static_assert(std::is_trivially_copyable<
+                  nd_file_header>::value,
+              "The header is written as bytes");
+
+// The offset of the elements in the files this version
+// writes, after the header and its padding
+[[nodiscard]] constexpr std::uint64_t
+file_data_offset() noexcept {
+  constexpr std::uint64_t align =
+      nd_file_header::data_alignment;
+  return (sizeof(nd_file_header) + align - 1) / align *
+         align;
+}
+
+// A 64 bit checksum of bytes bytes, which isn't
+// cryptographic. The words are mixed into four independent
+// accumulators so it isn't limited by the latency of the
+// multiplies, and runs at close to memory bandwidth
+[[nodiscard]] inline std::uint64_t file_checksum(
+    const void *data, const std::size_t bytes) noexcept {
+  constexpr std::uint64_t prime_1 = 0x9E3779B185EBCA87ull;
+  constexpr std::uint64_t prime_2 = 0xC2B2AE3D27D4EB4Full;
+  const auto mix = [](std::uint64_t acc,
+                      const std::uint64_t word) {
+    acc += word * prime_2;
+    acc = (acc << 31) | (acc >> 33);
+    return acc * prime_1;
+  };
+  const unsigned char *src =
+      static_cast<const unsigned char *>(data);
+  std::uint64_t acc[4] = {prime_1 + prime_2, prime_2, 0,
+                          0 - prime_1};
+  std::size_t i = 0;
+  for(; i + sizeof(acc) <= bytes; i += sizeof(acc)) {
+    for(int lane = 0; lane < 4; lane++) {
+      std::uint64_t word;
+      std::memcpy(&word, src + i + lane * sizeof(word),
+                  sizeof(word));
+      acc[lane] = mix(acc[lane], word);
+    }
+  }
+  std::uint64_t hash = bytes * prime_1;
+  for(int lane = 0; lane < 4; lane++) {
+    hash = mix(hash, acc[lane]);
+  }
+  for(; i < bytes; i++) {
+    hash = mix(hash, src[i]);
+  }
+  hash ^= hash >> 33;
+  hash *= prime_2;
+  hash ^= hash >> 29;
+  return hash;
+}
+
+// The header of an array file holding the elements of an
+// Array, which is an nd_array_ or an nd_span_
+template <typename Array>
+[[nodiscard]] nd_file_header make_file_header() noexcept {
+  using T = typename std::remove_const<
+      typename Array::value_type>::type;
+  using Dims = typename Array::DIMS;
+  using code = layout_code<typename Array::LAYOUT>;
+  static_assert(Dims::len() <= nd_file_header::max_dims,
+                "Too many dimensions for an array file");
+
+  nd_file_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, nd_file_header::magic_string(),
+              sizeof(header.magic));
+  header.byte_order = nd_file_header::byte_order_mark;
+  header.version = nd_file_header::current_version;
+  header.data_offset = file_data_offset();
+  header.data_bytes =
+      std::uint64_t(Array::storage_size()) * sizeof(T);
+  header.type_kind = element_kind<T>();
+  header.type_size = sizeof(T);
+  header.layout = code::id;
+  header.layout_params[0] = code::params[0];
+  header.layout_params[1] = code::params[1];
+  header.dims = Dims::len();
+  for(int d = 0; d < Dims::len(); d++) {
+    header.extents[d] = Dims::value(d);
+  }
+  return header;
+}
+
+// Checks that the element type, extents, and layout of a
+// header are an Array's
+template <typename Array>
+[[nodiscard]] io_status check_file_shape(
+    const nd_file_header &header) noexcept {
+  const nd_file_header expected = make_file_header<Array>();
+  if(header.type_kind != expected.type_kind ||
+     header.type_size != expected.type_size) {
+    return io_status::type_mismatch;
+  }
+  if(header.layout != expected.layout ||
+     header.layout_params[0] != expected.layout_params[0] ||
+     header.layout_params[1] != expected.layout_params[1] ||
+     header.dims != expected.dims ||
+     header.data_bytes != expected.data_bytes ||
+     std::memcmp(header.extents, expected.extents,
+                 sizeof(header.extents)) != 0) {
+    return io_status::shape_mismatch;
+  }
+  return io_status::ok;
+}
+
+// Checks that a header read from a file of file_bytes bytes
+// describes the elements of an Array
+template <typename Array>
+[[nodiscard]] io_status check_file_header(
+    const nd_file_header &header,
+    const std::uint64_t file_bytes) noexcept {
+  const nd_file_header expected = make_file_header<Array>();
+  if(std::memcmp(header.magic, expected.magic,
+                 sizeof(header.magic)) != 0 ||
+     header.byte_order != expected.byte_order ||
+     header.version != expected.version ||
+     header.data_offset < sizeof(nd_file_header) ||
+     header.data_offset % expected.data_alignment != 0) {
+    return io_status::bad_header;
+  }
+  const io_status status = check_file_shape<Array>(header);
+  if(status != io_status::ok) {
+    return status;
+  }
+  if(file_bytes < header.data_offset + header.data_bytes) {
+    return io_status::truncated;
+  }
+  return io_status::ok;
+}
+
+}  // namespace ND_Array_internals_
+
+#endif  // _FILE_HEADER_HPP_
@@ -0,0 +1,1078 @@
+
+#ifndef _LAYOUT_HPP_
+#define _LAYOUT_HPP_
+
+#include <assert.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "ct_array.hpp"
+
+namespace ND_Array_internals_ {
+
+// Layouts determine where the elements of an nd_array_ are
+// placed in its storage. Each provides a mapping for the
+// array's extents, which computes
+//  - the storage required,
+//  - the storage offset of indices (slice_idx), and of the
+//    idx'th element in row major order (storage_idx),
+//  - the iterator used to traverse the elements, which
+//    visits them in storage order, and the indices of the
+//    element at each position of the traversal (index),
+//  - the runs of contiguous elements in the storage, which
+//    elementwise kernels can process without indexing.
+// The flags describe what else the layout supports:
+//  - is_contiguous: the storage is the elements in row
+//    major order,
+//  - is_row_major: the elements are in row major order,
+//    so outer slices are arrays of the same layout and
+//    rows of the last dimension are contiguous,
+//  - is_strided: the distance between consecutive indices
+//    of each dimension is a constant, stride(dim), so
+//    strided views can be taken and iterators can be offset
+
+// The default C-style layout
+struct row_major {
+  template <typename Dims>
+  struct mapping {
+    using size_type = typename Dims::FieldT;
+
+    static constexpr bool is_contiguous = true;
+    static constexpr bool is_row_major = true;
+    static constexpr bool is_strided = true;
+
+    static constexpr size_type storage_size() {
+      return Dims::product();
+    }
+
+    template <typename... int_t>
+    static constexpr int slice_idx(int_t... indices) {
+      return Dims::slice_idx(indices...);
+    }
+
+    template <typename... int_t>
+    static constexpr int offset_idx(int_t... offsets) {
+      return Dims::offset_idx(offsets...);
+    }
+
+    static constexpr size_type storage_idx(
+        const size_type idx) noexcept {
+      return idx;
+    }
+
+    static constexpr size_type stride(const int dim) {
+      return dim + 1 == Dims::len()
+                 ? 1
+                 : Dims::trailing_product(dim + 1);
+    }
+
+    static constexpr size_type index(const size_type pos,
+                                     const int dim) {
+      return (pos / stride(dim)) % Dims::value(dim);
+    }
+
+    template <typename F>
+    static constexpr void for_each_run(F f) {
+      f(size_type(0), storage_size());
+    }
+
+    template <typename T>
+    using iterator = T *;
+
+    template <typename T>
+    static constexpr iterator<T> make_iterator(
+        T *storage, const size_type idx) noexcept {
+      return storage + idx;
+    }
+  };
+};
+
+// Iterates over the elements of a row major array whose
+// rows are followed by pad unused elements, skipping the
+// padding
+template <typename value_type_, std::size_t row_len,
+          std::size_t pad>
+class padded_iterator {
+ public:
+  using value_type =
+      typename std::remove_cv<value_type_>::type;
+  using reference = value_type_ &;
+  using pointer = value_type_ *;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+
+  constexpr padded_iterator() noexcept
+      : ptr_(nullptr), col_(0) {}
+
+  constexpr padded_iterator(pointer ptr,
+                            difference_type col) noexcept
+      : ptr_(ptr), col_(col) {}
+
+  // Allows converting iterators to const_iterators
+  template <typename other_value_type,
+            typename std::enable_if<
+                std::is_same<const other_value_type,
+                             value_type_>::value,
+                int>::type = 0>
+  constexpr padded_iterator(
+      const padded_iterator<other_value_type, row_len, pad>
+          &src) noexcept
+      : ptr_(src.ptr_), col_(src.col_) {}
+
+  [[nodiscard]] constexpr reference operator*() const
+      noexcept {
+    return *ptr_;
+  }
+
+  [[nodiscard]] constexpr pointer operator->() const
+      noexcept {
+    return ptr_;
+  }
+
+  [[nodiscard]] constexpr reference operator[](
+      const difference_type n) const noexcept {
+    return *(*this + n);
+  }
+
+  constexpr padded_iterator &operator++() noexcept {
+    ++ptr_;
+    ++col_;
+    if(col_ == row_len_) {
+      ptr_ += pad;
+      col_ = 0;
+    }
+    return *this;
+  }
+
+  constexpr padded_iterator &operator--() noexcept {
+    if(col_ == 0) {
+      ptr_ -= pad;
+      col_ = row_len_;
+    }
+    --ptr_;
+    --col_;
+    return *this;
+  }
+
+  constexpr padded_iterator operator++(int) noexcept {
+    const auto copy = *this;
+    ++(*this);
+    return copy;
+  }
+
+  constexpr padded_iterator operator--(int) noexcept {
+    const auto copy = *this;
+    --(*this);
+    return copy;
+  }
+
+  constexpr padded_iterator &operator+=(
+      const difference_type n) noexcept {
+    const difference_type pos = col_ + n;
+    difference_type rows = pos / row_len_;
+    if(pos < 0 && rows * row_len_ != pos) {
+      // Round towards negative infinity
+      rows--;
+    }
+    ptr_ += n + rows * pad_;
+    col_ = pos - rows * row_len_;
+    return *this;
+  }
+
+  constexpr padded_iterator &operator-=(
+      const difference_type n) noexcept {
+    return (*this) += -n;
+  }
+
+  [[nodiscard]] constexpr padded_iterator operator+(
+      const difference_type n) const noexcept {
+    padded_iterator sum = *this;
+    sum += n;
+    return sum;
+  }
+
+  [[nodiscard]] constexpr padded_iterator operator-(
+      const difference_type n) const noexcept {
+    padded_iterator diff = *this;
+    diff -= n;
+    return diff;
+  }
+
+  [[nodiscard]] friend constexpr padded_iterator operator+(
+      const difference_type n,
+      const padded_iterator &itr) noexcept {
+    return itr + n;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr difference_type operator-(
+      const padded_iterator<other_value_type, row_len, pad>
+          &rhs) const noexcept {
+    const difference_type col_diff = col_ - rhs.col_;
+    const difference_type rows =
+        ((ptr_ - rhs.ptr_) - col_diff) / (row_len_ + pad_);
+    return rows * row_len_ + col_diff;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator==(
+      const padded_iterator<other_value_type, row_len, pad>
+          &cmp) const noexcept {
+    return ptr_ == cmp.ptr_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator!=(
+      const padded_iterator<other_value_type, row_len, pad>
+          &cmp) const noexcept {
+    return ptr_ != cmp.ptr_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator<(
+      const padded_iterator<other_value_type, row_len, pad>
+          &cmp) const noexcept {
+    return ptr_ < cmp.ptr_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator<=(
+      const padded_iterator<other_value_type, row_len, pad>
+          &cmp) const noexcept {
+    return ptr_ <= cmp.ptr_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator>(
+      const padded_iterator<other_value_type, row_len, pad>
+          &cmp) const noexcept {
+    return ptr_ > cmp.ptr_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator>=(
+      const padded_iterator<other_value_type, row_len, pad>
+          &cmp) const noexcept {
+    return ptr_ >= cmp.ptr_;
+  }
+
+  template <typename _value_type, std::size_t _row_len,
+            std::size_t _pad>
+  friend class padded_iterator;
+
+ private:
+  static constexpr difference_type row_len_ = row_len;
+  static constexpr difference_type pad_ = pad;
+
+  pointer ptr_;
+  // The index of the element in its row
+  difference_type col_;
+};
+
+// A row major layout with pad unused elements after each
+// row of the last dimension. Padding the rows of arrays
+// whose last extent is a power of two prevents the rows
+// from mapping onto the same cache sets.
+// The iterators skip the padding, so the elements are
+// traversed in the same order as with row_major
+template <std::size_t pad>
+struct padded_row_major {
+  template <typename Dims>
+  struct mapping {
+    using size_type = typename Dims::FieldT;
+
+    static constexpr bool is_contiguous = (pad == 0);
+    static constexpr bool is_row_major = true;
+    static constexpr bool is_strided = true;
+
+    static constexpr size_type row_len =
+        Dims::value(Dims::len() - 1);
+
+    static constexpr size_type storage_size() {
+      return Dims::template padded_product<pad>();
+    }
+
+    template <typename... int_t>
+    static constexpr int slice_idx(int_t... indices) {
+      return Dims::template slice_idx<pad>(indices...);
+    }
+
+    // Offsets are between positions of the iterators, which
+    // skip the padding
+    template <typename... int_t>
+    static constexpr int offset_idx(int_t... offsets) {
+      return Dims::offset_idx(offsets...);
+    }
+
+    static constexpr size_type storage_idx(
+        const size_type idx) noexcept {
+      return idx + (idx / row_len) * pad;
+    }
+
+    static constexpr size_type stride(const int dim) {
+      return dim + 1 == Dims::len()
+                 ? 1
+                 : Dims::trailing_product(dim + 1) /
+                       row_len * (row_len + pad);
+    }
+
+    static constexpr size_type index(const size_type pos,
+                                     const int dim) {
+      return row_major::mapping<Dims>::index(pos, dim);
+    }
+
+    template <typename F>
+    static constexpr void for_each_run(F f) {
+      if constexpr(is_contiguous) {
+        f(size_type(0), storage_size());
+      } else {
+        constexpr size_type rows =
+            Dims::product() / row_len;
+        for(size_type row = 0; row < rows; row++) {
+          f(row * (row_len + pad), row_len);
+        }
+      }
+    }
+
+    template <typename T>
+    using iterator = typename std::conditional<
+        is_contiguous, T *,
+        padded_iterator<T, row_len, pad>>::type;
+
+    template <typename T>
+    static constexpr iterator<T> make_iterator(
+        T *storage, const size_type idx) noexcept {
+      if constexpr(is_contiguous) {
+        return storage + idx;
+      } else {
+        return iterator<T>(storage + storage_idx(idx),
+                           idx % row_len);
+      }
+    }
+  };
+};
+
+// The Fortran style layout, where the first index varies
+// fastest. The iterators traverse the storage in order, so
+// they also vary the first index fastest
+struct col_major {
+  template <typename Dims>
+  struct mapping {
+    using size_type = typename Dims::FieldT;
+
+    static constexpr bool is_contiguous =
+        (Dims::len() == 1);
+    static constexpr bool is_row_major =
+        (Dims::len() == 1);
+    static constexpr bool is_strided = true;
+
+    static constexpr size_type storage_size() {
+      return Dims::product();
+    }
+
+    static constexpr size_type stride(const int dim) {
+      size_type s = 1;
+      for(int d = 0; d < dim; d++) {
+        s *= Dims::value(d);
+      }
+      return s;
+    }
+
+    // Unlike the row major layouts, every index is required
+    template <typename... int_t>
+    static constexpr int slice_idx(int_t... indices) {
+      static_assert(sizeof...(int_t) == Dims::len(),
+                    "Column major arrays can't be sliced");
+      assert(in_bounds(indices...));
+      return offset_idx(indices...);
+    }
+
+    template <typename... int_t>
+    static constexpr int offset_idx(int_t... offsets) {
+      int dim = 0;
+      int offset = 0;
+      ((offset += static_cast<int>(offsets) *
+                  static_cast<int>(stride(dim++))),
+       ...);
+      return offset;
+    }
+
+    static constexpr size_type storage_idx(
+        size_type idx) noexcept {
+      size_type offset = 0;
+      for(int d = Dims::len() - 1; d >= 0; d--) {
+        offset += (idx % Dims::value(d)) * stride(d);
+        idx /= Dims::value(d);
+      }
+      return offset;
+    }
+
+    static constexpr size_type index(const size_type pos,
+                                     const int dim) {
+      return (pos / stride(dim)) % Dims::value(dim);
+    }
+
+    template <typename F>
+    static constexpr void for_each_run(F f) {
+      f(size_type(0), storage_size());
+    }
+
+    template <typename T>
+    using iterator = T *;
+
+    template <typename T>
+    static constexpr iterator<T> make_iterator(
+        T *storage, const size_type idx) noexcept {
+      return storage + idx;
+    }
+
+   private:
+    template <typename... int_t>
+    static constexpr bool in_bounds(int_t... indices) {
+      int dim = 0;
+      return ((indices >= 0 &&
+               static_cast<size_type>(indices) <
+                   Dims::value(dim++)) &&
+              ...);
+    }
+  };
+};
+
+// The sizes of the tiles of a tiled layout, and the
+// position of an element in them
+template <typename Dims, std::size_t tile_rows_,
+          std::size_t tile_cols_>
+struct tile_shape {
+  using size_type = typename Dims::FieldT;
+
+  static_assert(Dims::len() >= 2,
+                "Tiled layouts need at least 2 dimensions");
+  static_assert(tile_rows_ > 0 && tile_cols_ > 0,
+                "Tiles can't be empty");
+
+  static constexpr size_type tile_rows = tile_rows_;
+  static constexpr size_type tile_cols = tile_cols_;
+
+  static constexpr size_type rows =
+      Dims::value(Dims::len() - 2);
+  static constexpr size_type cols =
+      Dims::value(Dims::len() - 1);
+  static_assert(rows > 0 && cols > 0,
+                "Tiled arrays can't be empty");
+
+  static constexpr size_type tiles_down =
+      (rows + tile_rows - 1) / tile_rows;
+  static constexpr size_type tiles_across =
+      (cols + tile_cols - 1) / tile_cols;
+  static constexpr size_type tile_size =
+      tile_rows * tile_cols;
+  // Each plane is the tiles of one index of the leading
+  // dimensions, including the unused parts of the tiles on
+  // the edges
+  static constexpr size_type plane_size =
+      tiles_down * tiles_across * tile_size;
+  static constexpr size_type planes =
+      Dims::product() / (rows * cols);
+  static constexpr bool is_dense =
+      rows % tile_rows == 0 && cols % tile_cols == 0;
+
+  // The number of rows and columns of the tile, which are
+  // fewer than the tile size on the bottom and right edges
+  static constexpr size_type tile_height(
+      const size_type tile_row) noexcept {
+    return std::min<size_type>(tile_rows,
+                               rows - tile_row * tile_rows);
+  }
+
+  static constexpr size_type tile_width(
+      const size_type tile_col) noexcept {
+    return std::min<size_type>(tile_cols,
+                               cols - tile_col * tile_cols);
+  }
+
+  static constexpr size_type offset(
+      const size_type plane, const size_type row,
+      const size_type col) noexcept {
+    return plane * plane_size +
+           (row / tile_rows * tiles_across +
+            col / tile_cols) *
+               tile_size +
+           row % tile_rows * tile_cols + col % tile_cols;
+  }
+
+  // The position of the pos'th element of the storage order
+  // traversal, skipping the unused parts of the tiles
+  struct position {
+    size_type plane;
+    size_type tile_row;
+    size_type tile_col;
+    size_type row;
+    size_type col;
+  };
+
+  static constexpr position locate(size_type pos) noexcept {
+    position p{};
+    p.plane = pos / (rows * cols);
+    pos %= rows * cols;
+    p.tile_row = pos / (tile_rows * cols);
+    pos -= p.tile_row * tile_rows * cols;
+    const size_type height = tile_height(p.tile_row);
+    p.tile_col = pos / (height * tile_cols);
+    pos -= p.tile_col * height * tile_cols;
+    const size_type width = tile_width(p.tile_col);
+    p.row = pos / width;
+    p.col = pos % width;
+    return p;
+  }
+};
+
+// Iterates over the elements of a tiled array in storage
+// order: the elements of each tile in row major order, the
+// tiles of each plane in row major order, and then the
+// planes. The unused parts of the tiles on the edges are
+// skipped
+template <typename value_type_, typename Shape>
+class tiled_iterator {
+ public:
+  using value_type =
+      typename std::remove_cv<value_type_>::type;
+  using reference = value_type_ &;
+  using pointer = value_type_ *;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+
+  constexpr tiled_iterator() noexcept
+      : base_(nullptr), ptr_(nullptr), pos_(0), p_{} {}
+
+  // pos is the position in the traversal
+  constexpr tiled_iterator(
+      pointer base, const difference_type pos) noexcept
+      : base_(base), ptr_(base), pos_(0), p_{} {
+    seek(pos);
+  }
+
+  // Allows converting iterators to const_iterators
+  template <typename other_value_type,
+            typename std::enable_if<
+                std::is_same<const other_value_type,
+                             value_type_>::value,
+                int>::type = 0>
+  constexpr tiled_iterator(
+      const tiled_iterator<other_value_type, Shape>
+          &src) noexcept
+      : base_(src.base_),
+        ptr_(src.ptr_),
+        pos_(src.pos_),
+        p_(src.p_) {}
+
+  [[nodiscard]] constexpr reference operator*() const
+      noexcept {
+    return *ptr_;
+  }
+
+  [[nodiscard]] constexpr pointer operator->() const
+      noexcept {
+    return ptr_;
+  }
+
+  [[nodiscard]] constexpr reference operator[](
+      const difference_type n) const noexcept {
+    return *(*this + n);
+  }
+
+  constexpr tiled_iterator &operator++() noexcept {
+    ++pos_;
+    ++ptr_;
+    ++p_.col;
+    const size_type width = Shape::tile_width(p_.tile_col);
+    if(p_.col == width) {
+      ptr_ += tile_cols_ - width;
+      p_.col = 0;
+      ++p_.row;
+      const size_type height =
+          Shape::tile_height(p_.tile_row);
+      if(p_.row == height) {
+        // The next tile starts after the unused rows
+        ptr_ += (tile_rows_ - height) * tile_cols_;
+        p_.row = 0;
+        ++p_.tile_col;
+        if(p_.tile_col == Shape::tiles_across) {
+          p_.tile_col = 0;
+          ++p_.tile_row;
+          if(p_.tile_row == Shape::tiles_down) {
+            p_.tile_row = 0;
+            ++p_.plane;
+          }
+        }
+      }
+    }
+    return *this;
+  }
+
+  constexpr tiled_iterator &operator--() noexcept {
+    --pos_;
+    if(p_.col == 0) {
+      if(p_.row == 0) {
+        if(p_.tile_col == 0) {
+          if(p_.tile_row == 0) {
+            p_.tile_row = Shape::tiles_down;
+            --p_.plane;
+          }
+          --p_.tile_row;
+          p_.tile_col = Shape::tiles_across;
+        }
+        --p_.tile_col;
+        const size_type height =
+            Shape::tile_height(p_.tile_row);
+        ptr_ -= (tile_rows_ - height) * tile_cols_;
+        p_.row = height;
+      }
+      --p_.row;
+      const size_type width =
+          Shape::tile_width(p_.tile_col);
+      ptr_ -= tile_cols_ - width;
+      p_.col = width;
+    }
+    --p_.col;
+    --ptr_;
+    return *this;
+  }
+
+  constexpr tiled_iterator operator++(int) noexcept {
+    const auto copy = *this;
+    ++(*this);
+    return copy;
+  }
+
+  constexpr tiled_iterator operator--(int) noexcept {
+    const auto copy = *this;
+    --(*this);
+    return copy;
+  }
+
+  constexpr tiled_iterator &operator+=(
+      const difference_type n) noexcept {
+    seek(pos_ + n);
+    return *this;
+  }
+
+  constexpr tiled_iterator &operator-=(
+      const difference_type n) noexcept {
+    seek(pos_ - n);
+    return *this;
+  }
+
+  [[nodiscard]] constexpr tiled_iterator operator+(
+      const difference_type n) const noexcept {
+    tiled_iterator sum = *this;
+    sum += n;
+    return sum;
+  }
+
+  [[nodiscard]] constexpr tiled_iterator operator-(
+      const difference_type n) const noexcept {
+    tiled_iterator diff = *this;
+    diff -= n;
+    return diff;
+  }
+
+  [[nodiscard]] friend constexpr tiled_iterator operator+(
+      const difference_type n,
+      const tiled_iterator &itr) noexcept {
+    return itr + n;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr difference_type operator-(
+      const tiled_iterator<other_value_type, Shape> &rhs)
+      const noexcept {
+    return pos_ - rhs.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator==(
+      const tiled_iterator<other_value_type, Shape> &cmp)
+      const noexcept {
+    return pos_ == cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator!=(
+      const tiled_iterator<other_value_type, Shape> &cmp)
+      const noexcept {
+    return pos_ != cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator<(
+      const tiled_iterator<other_value_type, Shape> &cmp)
+      const noexcept {
+    return pos_ < cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator<=(
+      const tiled_iterator<other_value_type, Shape> &cmp)
+      const noexcept {
+    return pos_ <= cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator>(
+      const tiled_iterator<other_value_type, Shape> &cmp)
+      const noexcept {
+    return pos_ > cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator>=(
+      const tiled_iterator<other_value_type, Shape> &cmp)
+      const noexcept {
+    return pos_ >= cmp.pos_;
+  }
+
+  template <typename _value_type, typename _Shape>
+  friend class tiled_iterator;
+
+ private:
+  using size_type = typename Shape::size_type;
+  using position = typename Shape::position;
+
+  static constexpr size_type tile_rows_ = Shape::tile_rows;
+  static constexpr size_type tile_cols_ = Shape::tile_cols;
+
+  constexpr void seek(const difference_type pos) noexcept {
+    pos_ = pos;
+    p_ = Shape::locate(static_cast<size_type>(pos));
+    ptr_ = base_ +
+           Shape::offset(p_.plane,
+                         p_.tile_row * tile_rows_ + p_.row,
+                         p_.tile_col * tile_cols_ + p_.col);
+  }
+
+  pointer base_;
+  pointer ptr_;
+  difference_type pos_;
+  position p_;
+};
+
+// Stores the last two dimensions in tiles of tile_rows x
+// tile_cols elements, each of which is contiguous, so
+// elements which are close in both dimensions are close in
+// the storage. The leading dimensions index planes of
+// tiles. When the extents aren't multiples of the tile
+// size, the tiles on the bottom and right edges are padded
+template <std::size_t tile_rows, std::size_t tile_cols>
+struct tiled {
+  template <typename Dims>
+  struct mapping {
+    using size_type = typename Dims::FieldT;
+    using shape = tile_shape<Dims, tile_rows, tile_cols>;
+
+    static constexpr bool is_contiguous = false;
+    static constexpr bool is_row_major = false;
+    static constexpr bool is_strided = false;
+
+    static constexpr size_type storage_size() {
+      return shape::planes * shape::plane_size;
+    }
+
+    // Every index is required
+    template <typename... int_t>
+    static constexpr int slice_idx(int_t... indices) {
+      static_assert(sizeof...(int_t) == Dims::len(),
+                    "Tiled arrays can't be sliced");
+      const size_type idx[] = {
+          static_cast<size_type>(indices)...};
+      size_type plane = 0;
+      for(int d = 0; d < Dims::len() - 2; d++) {
+        assert(idx[d] < Dims::value(d));
+        plane = plane * Dims::value(d) + idx[d];
+      }
+      assert(idx[Dims::len() - 2] < shape::rows);
+      assert(idx[Dims::len() - 1] < shape::cols);
+      return static_cast<int>(
+          shape::offset(plane, idx[Dims::len() - 2],
+                        idx[Dims::len() - 1]));
+    }
+
+    static constexpr size_type storage_idx(
+        const size_type idx) noexcept {
+      constexpr size_type plane_elems =
+          shape::rows * shape::cols;
+      return shape::offset(
+          idx / plane_elems,
+          idx % plane_elems / shape::cols,
+          idx % shape::cols);
+    }
+
+    static constexpr size_type index(const size_type pos,
+                                     const int dim) {
+      const auto p = shape::locate(pos);
+      if(dim == Dims::len() - 1) {
+        return p.tile_col * tile_cols + p.col;
+      } else if(dim == Dims::len() - 2) {
+        return p.tile_row * tile_rows + p.row;
+      } else {
+        const size_type inner_planes =
+            Dims::trailing_product(dim + 1) /
+            (shape::rows * shape::cols);
+        return (p.plane / inner_planes) % Dims::value(dim);
+      }
+    }
+
+    // The rows of each tile, or all of the storage when
+    // there are no partial tiles
+    template <typename F>
+    static constexpr void for_each_run(F f) {
+      if constexpr(shape::is_dense) {
+        f(size_type(0), storage_size());
+      } else {
+        size_type offset = 0;
+        for(size_type plane = 0; plane < shape::planes;
+            plane++) {
+          for(size_type tr = 0; tr < shape::tiles_down;
+              tr++) {
+            const size_type height = shape::tile_height(tr);
+            for(size_type tc = 0; tc < shape::tiles_across;
+                tc++) {
+              const size_type width = shape::tile_width(tc);
+              for(size_type r = 0; r < height; r++) {
+                f(offset + r * tile_cols, width);
+              }
+              offset += shape::tile_size;
+            }
+          }
+        }
+      }
+    }
+
+    template <typename T>
+    using iterator = tiled_iterator<T, shape>;
+
+    template <typename T>
+    static constexpr iterator<T> make_iterator(
+        T *storage, const size_type idx) noexcept {
+      return iterator<T>(storage, idx);
+    }
+  };
+};
+
+// Scatters the low bits of value into the set bits of
+// mask, in order from the least significant. When compiled
+// for BMI2 this is the pdep instruction, which is
+// microcoded and slow on AMD processors before Zen 3
+inline std::uint64_t deposit_bits(
+    std::uint64_t value, std::uint64_t mask) noexcept {
+#if defined(__BMI2__)
+  return _pdep_u64(value, mask);
+#else
+  std::uint64_t result = 0;
+  for(; mask != 0; mask &= mask - 1) {
+    if(value & 1) {
+      result |= mask & -mask;
+    }
+    value >>= 1;
+  }
+  return result;
+#endif
+}
+
+// Gathers the bits of value selected by mask into the low
+// bits of the result; the inverse of deposit_bits
+inline std::uint64_t extract_bits(
+    const std::uint64_t value,
+    std::uint64_t mask) noexcept {
+#if defined(__BMI2__)
+  return _pext_u64(value, mask);
+#else
+  std::uint64_t result = 0;
+  for(std::uint64_t bit = 1; mask != 0;
+      mask &= mask - 1, bit <<= 1) {
+    if(value & mask & -mask) {
+      result |= bit;
+    }
+  }
+  return result;
+#endif
+}
+
+// The bits of a Morton order storage offset which hold the
+// bits of each dimension's index. The bits are interleaved
+// from the least significant, with the last dimension's bit
+// lowest at each level; dimensions with fewer bits drop out
+// of the interleaving once theirs are used
+template <typename Dims>
+struct morton_shape {
+  using size_type = typename Dims::FieldT;
+
+  static constexpr int log2(size_type extent) {
+    int bits = 0;
+    for(; extent > 1; extent >>= 1) {
+      bits++;
+    }
+    return bits;
+  }
+
+  static constexpr bool extents_valid() {
+    int total_bits = 0;
+    for(int d = 0; d < Dims::len(); d++) {
+      const size_type extent = Dims::value(d);
+      if(extent == 0 || (extent & (extent - 1)) != 0) {
+        return false;
+      }
+      total_bits += log2(extent);
+    }
+    return total_bits <= 63;
+  }
+
+  static_assert(extents_valid(),
+                "Morton layouts need power of two extents "
+                "and fewer than 2^63 elements");
+
+  using mask_array = std::array<std::uint64_t, Dims::len()>;
+
+  static constexpr mask_array make_masks() {
+    mask_array masks{};
+    int max_bits = 0;
+    for(int d = 0; d < Dims::len(); d++) {
+      max_bits = std::max(max_bits, log2(Dims::value(d)));
+    }
+    int bit = 0;
+    for(int level = 0; level < max_bits; level++) {
+      for(int d = Dims::len() - 1; d >= 0; d--) {
+        if(level < log2(Dims::value(d))) {
+          masks[d] |= std::uint64_t(1) << bit;
+          bit++;
+        }
+      }
+    }
+    return masks;
+  }
+
+  static constexpr mask_array masks = make_masks();
+};
+
+// Stores the elements in Morton (Z-order), interleaving the
+// bits of the indices so elements which are close in every
+// dimension are close in the storage. The extents must be
+// powers of two; when they differ the storage is still
+// dense. The last index varies fastest, so neighbouring
+// elements in the last dimension are adjacent.
+// The iterators traverse the storage in order
+struct morton {
+  template <typename Dims>
+  struct mapping {
+    using size_type = typename Dims::FieldT;
+    using difference_type = std::ptrdiff_t;
+    using shape = morton_shape<Dims>;
+
+    static constexpr bool is_contiguous =
+        (Dims::len() == 1);
+    static constexpr bool is_row_major =
+        (Dims::len() == 1);
+    static constexpr bool is_strided = false;
+
+    static constexpr size_type storage_size() {
+      return Dims::product();
+    }
+
+    // Every index is required
+    template <typename... int_t>
+    static constexpr int slice_idx(int_t... indices) {
+      static_assert(sizeof...(int_t) == Dims::len(),
+                    "Morton arrays can't be sliced");
+      assert(in_bounds(indices...));
+      return static_cast<int>(
+          encode(std::index_sequence_for<int_t...>(),
+                 indices...));
+    }
+
+    // The offset of the element delta indices away from the
+    // element at offset in dimension dim, computed without
+    // decoding the offset. Steps past the edges wrap around
+    // to the other side of the array
+    template <int dim>
+    static constexpr size_type step(
+        const size_type offset,
+        const difference_type delta) noexcept {
+      static_assert(dim >= 0 && dim < Dims::len(),
+                    "Invalid dimension");
+      constexpr std::uint64_t mask = shape::masks[dim];
+      const std::uint64_t code = offset;
+      std::uint64_t moved;
+      if(delta >= 0) {
+        // Setting the other dimensions' bits carries the
+        // addition through them
+        moved = (code | ~mask) + deposit_bits(delta, mask);
+      } else {
+        moved = (code & mask) - deposit_bits(-delta, mask);
+      }
+      return static_cast<size_type>((moved & mask) |
+                                    (code & ~mask));
+    }
+
+    static constexpr size_type storage_idx(
+        size_type idx) noexcept {
+      std::uint64_t offset = 0;
+      for(int d = Dims::len() - 1; d >= 0; d--) {
+        offset |= deposit_bits(idx % Dims::value(d),
+                               shape::masks[d]);
+        idx /= Dims::value(d);
+      }
+      return static_cast<size_type>(offset);
+    }
+
+    static constexpr size_type index(const size_type pos,
+                                     const int dim) {
+      return static_cast<size_type>(
+          extract_bits(pos, shape::masks[dim]));
+    }
+
+    template <typename F>
+    static constexpr void for_each_run(F f) {
+      f(size_type(0), storage_size());
+    }
+
+    template <typename T>
+    using iterator = T *;
+
+    template <typename T>
+    static constexpr iterator<T> make_iterator(
+        T *storage, const size_type idx) noexcept {
+      return storage + idx;
+    }
+
+   private:
+    template <std::size_t... dims, typename... int_t>
+    static constexpr std::uint64_t encode(
+        std::index_sequence<dims...>, int_t... indices) {
+      return (deposit_bits(
+                  static_cast<std::uint64_t>(indices),
+                  shape::masks[dims]) |
+              ...);
+    }
+
+    template <typename... int_t>
+    static constexpr bool in_bounds(int_t... indices) {
+      int dim = 0;
+      return ((indices >= 0 &&
+               static_cast<size_type>(indices) <
+                   Dims::value(dim++)) &&
+              ...);
+    }
+  };
+};
+
+}  // namespace ND_Array_internals_
+
+#endif
@@ -0,0 +1,333 @@
+
+#ifndef _MAPPED_ARRAY_HPP_
+#define _MAPPED_ARRAY_HPP_
+
+#include <assert.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ct_array.hpp"
+#include "file_header.hpp"
+#include "layout.hpp"
+#include "span.hpp"
+
+namespace ND_Array_internals_ {
+
+// Hints to the page cache about how the elements will be
+// accessed, see madvise(2)
+enum class mmap_advice {
+  normal,
+  sequential,
+  random,
+  willneed,
+  dontneed
+};
+
+[[nodiscard]] inline int madvise_flag(
+    const mmap_advice advice) noexcept {
+  switch(advice) {
+    case mmap_advice::sequential:
+      return MADV_SEQUENTIAL;
+    case mmap_advice::random:
+      return MADV_RANDOM;
+    case mmap_advice::willneed:
+      return MADV_WILLNEED;
+    case mmap_advice::dontneed:
+      return MADV_DONTNEED;
+    default:
+      return MADV_NORMAL;
+  }
+}
+
+// The format of the array files written by save(), see
+// file_header.hpp. Mapped arrays can map other formats
+// which store the elements contiguously after a header,
+// given a type with the same members
+struct nd_file_format {
+  // The alignment of the elements in the files
+  static constexpr std::size_t data_alignment =
+      nd_file_header::data_alignment;
+
+  // The size of the header of a new file of an Array
+  template <typename Array>
+  [[nodiscard]] static std::uint64_t
+  data_offset() noexcept {
+    return file_data_offset();
+  }
+
+  // Writes the header of a new file of an Array at the
+  // start of the mapped file
+  template <typename Array>
+  static void write_header(void *file) noexcept {
+    const nd_file_header header =
+        make_file_header<Array>();
+    std::memcpy(file, &header, sizeof(header));
+  }
+
+  // Checks that the mapped file of file_bytes bytes holds
+  // an Array, and finds the offset of its elements; the
+  // file may only be modified when it's writable
+  template <typename Array>
+  [[nodiscard]] static io_status read_header(
+      void *file, const std::uint64_t file_bytes,
+      const bool writable,
+      std::uint64_t &data_offset) noexcept {
+    nd_file_header header;
+    if(file_bytes < sizeof(header)) {
+      return io_status::bad_header;
+    }
+    std::memcpy(&header, file, sizeof(header));
+    const io_status status =
+        check_file_header<Array>(header, file_bytes);
+    if(status == io_status::ok && writable) {
+      // Writes through the mapping would invalidate the
+      // checksum
+      header.flags &= ~nd_file_header::checksum_flag;
+      std::memcpy(file, &header, sizeof(header));
+    }
+    data_offset = header.data_offset;
+    return status;
+  }
+};
+
+// An array whose elements are in a memory mapped file,
+// which is loaded by the page cache as the elements are
+// accessed, so arrays larger than memory can be used
+// without reading them into buffers. The file starts with
+// a header recording the element type, extents, and
+// layout, in the format of Format_, which is checked
+// against the array's when it's opened.
+//
+// The file is mapped read only when value_type_ is const,
+// and otherwise writes to the elements are written back to
+// the file. The elements are accessed with the API of
+// nd_span_; as the file can fail to open, status() must be
+// checked first. Requires POSIX
+template <typename value_type_, typename Dims_CT_Array,
+          typename Layout_ = row_major,
+          typename Format_ = nd_file_format>
+class [[nodiscard]] nd_mapped_array_
+    : public nd_span_<value_type_, Dims_CT_Array,
+                      Format_::data_alignment, Layout_> {
+ public:
+  using span_type =
+      nd_span_<value_type_, Dims_CT_Array,
+               Format_::data_alignment, Layout_>;
+  using pointer = typename span_type::pointer;
+
+  static constexpr bool read_only =
+      std::is_const<value_type_>::value;
+
+  // Maps the array file at path
+  explicit nd_mapped_array_(const char *path) noexcept
+      : span_type(nullptr),
+        base_(nullptr),
+        bytes_(0),
+        status_(io_status::open_failed) {
+    map(path, false);
+  }
+
+  // Creates the array file at path, replacing any existing
+  // file, and maps it; the elements are zero
+  [[nodiscard]] static nd_mapped_array_ create(
+      const char *path) noexcept {
+    static_assert(!read_only,
+                  "Read only arrays can't create files");
+    nd_mapped_array_ arr;
+    arr.map(path, true);
+    return arr;
+  }
+
+  nd_mapped_array_(const nd_mapped_array_ &) = delete;
+  nd_mapped_array_ &operator=(const nd_mapped_array_ &) =
+      delete;
+
+  nd_mapped_array_(nd_mapped_array_ &&src) noexcept
+      : span_type(src),
+        base_(src.base_),
+        bytes_(src.bytes_),
+        status_(src.status_) {
+    src.release();
+  }
+
+  nd_mapped_array_ &operator=(
+      nd_mapped_array_ &&src) noexcept {
+    if(this != &src) {
+      unmap();
+      span_type::operator=(src);
+      base_ = src.base_;
+      bytes_ = src.bytes_;
+      status_ = src.status_;
+      src.release();
+    }
+    return *this;
+  }
+
+  ~nd_mapped_array_() noexcept { unmap(); }
+
+  // Whether the file was mapped, or why it wasn't
+  [[nodiscard]] io_status status() const noexcept {
+    return status_;
+  }
+
+  [[nodiscard]] bool is_open() const noexcept {
+    return status_ == io_status::ok;
+  }
+
+  // The span of the elements
+  [[nodiscard]] span_type span() const noexcept {
+    return *this;
+  }
+
+  // Hints how all of the elements will be accessed
+  bool advise(const mmap_advice advice) const noexcept {
+    assert(is_open());
+    return advise_bytes(
+        this->data(),
+        span_type::storage_size() * sizeof(value_type_),
+        advice);
+  }
+
+  // Hints how the elements of the outer slice at indices
+  // will be accessed, eg to prefetch the next time step of
+  // a simulation while processing this one
+  template <typename... int_t>
+  bool advise(const mmap_advice advice,
+              const int_t... indices) const noexcept {
+    assert(is_open());
+    const auto slice = this->outer_slice(indices...);
+    return advise_bytes(
+        slice.data(),
+        slice.storage_size() * sizeof(value_type_), advice);
+  }
+
+  // Writes the modified elements back to the file before
+  // returning, rather than when the page cache chooses to
+  bool flush() const noexcept {
+    assert(is_open());
+    return read_only || msync(base_, bytes_, MS_SYNC) == 0;
+  }
+
+ private:
+  nd_mapped_array_() noexcept
+      : span_type(nullptr),
+        base_(nullptr),
+        bytes_(0),
+        status_(io_status::open_failed) {}
+
+  void map(const char *path, const bool create) noexcept {
+    const int flags =
+        create ? O_RDWR | O_CREAT | O_TRUNC
+               : (read_only ? O_RDONLY : O_RDWR);
+    const int fd = open(path, flags, 0644);
+    if(fd < 0) {
+      status_ = io_status::open_failed;
+      return;
+    }
+    std::uint64_t data_offset =
+        Format_::template data_offset<span_type>();
+    std::uint64_t file_bytes =
+        data_offset +
+        span_type::storage_size() * sizeof(value_type_);
+    struct stat file_stat;
+    if(create) {
+      if(ftruncate(fd, file_bytes) != 0) {
+        close(fd);
+        status_ = io_status::io_failed;
+        return;
+      }
+    } else if(fstat(fd, &file_stat) != 0) {
+      close(fd);
+      status_ = io_status::io_failed;
+      return;
+    } else {
+      file_bytes = file_stat.st_size;
+    }
+    if(file_bytes == 0) {
+      close(fd);
+      status_ = io_status::bad_header;
+      return;
+    }
+    const int prot =
+        read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+    void *const base =
+        mmap(nullptr, file_bytes, prot, MAP_SHARED, fd, 0);
+    // The mapping keeps the file open
+    close(fd);
+    if(base == MAP_FAILED) {
+      status_ = io_status::io_failed;
+      return;
+    }
+    if(create) {
+      Format_::template write_header<span_type>(base);
+    } else {
+      status_ = Format_::template read_header<span_type>(
+          base, file_bytes, !read_only, data_offset);
+      if(status_ != io_status::ok) {
+        munmap(base, file_bytes);
+        return;
+      }
+    }
+    assert(data_offset % Format_::data_alignment == 0);
+    base_ = base;
+    bytes_ = file_bytes;
+    status_ = io_status::ok;
+    char *const elems =
+        static_cast<char *>(base) + data_offset;
+    span_type::operator=(
+        span_type(reinterpret_cast<pointer>(elems)));
+  }
+
+  void unmap() noexcept {
+    if(base_ != nullptr) {
+      munmap(base_, bytes_);
+    }
+    release();
+  }
+
+  // Forgets the mapping, without unmapping it
+  void release() noexcept {
+    span_type::operator=(span_type(nullptr));
+    base_ = nullptr;
+    bytes_ = 0;
+    status_ = io_status::open_failed;
+  }
+
+  // madvise requires the start to be page aligned, so the
+  // advice also applies to the rest of the first page
+  static bool advise_bytes(
+      const void *start, const std::size_t bytes,
+      const mmap_advice advice) noexcept {
+    const std::uintptr_t page =
+        static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    const std::uintptr_t addr =
+        reinterpret_cast<std::uintptr_t>(start);
+    const std::uintptr_t aligned = addr - addr % page;
+    return madvise(reinterpret_cast<void *>(aligned),
+                   bytes + (addr - aligned),
+                   madvise_flag(advice)) == 0;
+  }
+
+  void *base_;
+  std::size_t bytes_;
+  io_status status_;
+};
+
+}  // namespace ND_Array_internals_
+
+// A row major array in a memory mapped file; the file is
+// read only when value_type is const
+template <typename value_type, int... Dims>
+using ND_Mapped_Array =
+    ND_Array_internals_::nd_mapped_array_<
+        value_type,
+        ND_Array_internals_::CT_Array<size_t, Dims...>>;
+
+#endif  // _MAPPED_ARRAY_HPP_
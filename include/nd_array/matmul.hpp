@@ -0,0 +1,227 @@
+
+#ifndef _MATMUL_HPP_
+#define _MATMUL_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "nd_array.hpp"
+
+namespace ND_Array_internals_ {
+
+// The width of the widest vector registers the compiler is
+// targeting, in bytes
+#if defined(__AVX512F__)
+constexpr std::size_t simd_bytes = 64;
+#elif defined(__AVX__)
+constexpr std::size_t simd_bytes = 32;
+#else
+constexpr std::size_t simd_bytes = 16;
+#endif
+
+// Tile sizes for multiplying an M x K matrix by a K x N
+// matrix, following the usual decomposition of a matrix
+// multiply into a register tile (mr x nr), a block of the
+// right operand which stays in L1 for each register tile
+// (kc x nr), a block of the left operand which stays in L2
+// (mc x kc), and a packed block of the right operand which
+// stays in L3 (kc x nc).
+// Tiles are clamped to the extents so small matrices don't
+// do extra work
+template <typename value_type, std::size_t M, std::size_t K,
+          std::size_t N>
+struct matmul_tiling {
+  static constexpr std::size_t clamp(std::size_t tile,
+                                     std::size_t extent) {
+    return tile < extent ? tile : extent;
+  }
+
+  static constexpr std::size_t round_down(
+      std::size_t value, std::size_t multiple) {
+    return value < multiple ? multiple
+                            : value - value % multiple;
+  }
+
+  static constexpr std::size_t l1_bytes = 32 * 1024;
+  static constexpr std::size_t l2_bytes = 256 * 1024;
+  static constexpr std::size_t l3_bytes = 2 * 1024 * 1024;
+
+  static constexpr std::size_t lanes =
+      simd_bytes / sizeof(value_type) > 0
+          ? simd_bytes / sizeof(value_type)
+          : 1;
+
+  // Two vector registers of the result per row, four rows.
+  // nr isn't clamped, as the packed panels are zero filled
+  // to whole vector registers
+  static constexpr std::size_t mr = clamp(4, M);
+  static constexpr std::size_t nr = 2 * lanes;
+
+  // Half of L1 for the right operand's panel
+  static constexpr std::size_t kc = clamp(
+      l1_bytes / 2 / (nr * sizeof(value_type)), K);
+  // Half of L2 for the block of the left operand
+  static constexpr std::size_t mc = clamp(
+      round_down(l2_bytes / 2 / (kc * sizeof(value_type)),
+                 mr),
+      M);
+  // Half of L3 for the packed block of the right operand
+  static constexpr std::size_t nc = clamp(
+      round_down(l3_bytes / 2 / (kc * sizeof(value_type)),
+                 nr),
+      N);
+  // The packed block is padded to a multiple of nr columns
+  static constexpr std::size_t packed_cols =
+      (nc + nr - 1) / nr * nr;
+};
+
+// Computes an mr x nr tile of the result from kc columns of
+// mr rows of the left operand and a packed kc x nr panel of
+// the right operand. Rows past m and columns past n are
+// computed (from valid memory) but not stored
+template <std::size_t mr, std::size_t nr, typename T>
+inline void matmul_micro_kernel(
+    const std::size_t kc, const T *const *a_rows,
+    const T *packed_b, T *const *c_rows,
+    const std::size_t m, const std::size_t n,
+    const bool accumulate) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  // The compilers don't reliably keep the accumulators in
+  // registers with the scalar loops, so use their vector
+  // extensions to make the register tile explicit
+  constexpr std::size_t lanes = simd_bytes / sizeof(T);
+  static_assert(nr % lanes == 0,
+                "The register tile must be a whole number "
+                "of vector registers");
+  constexpr std::size_t nv = nr / lanes;
+  typedef T vec __attribute__((vector_size(simd_bytes)));
+  vec acc_v[mr][nv] = {};
+  for(std::size_t p = 0; p < kc; p++) {
+    vec b[nv];
+    std::memcpy(&b[0], packed_b + p * nr, sizeof(b));
+    for(std::size_t i = 0; i < mr; i++) {
+      const T a = a_rows[i][p];
+      for(std::size_t v = 0; v < nv; v++) {
+        acc_v[i][v] += a * b[v];
+      }
+    }
+  }
+  T acc[mr][nr];
+  std::memcpy(&acc[0][0], &acc_v[0][0], sizeof(acc));
+#else
+  T acc[mr][nr] = {};
+  for(std::size_t p = 0; p < kc; p++) {
+    const T *b = packed_b + p * nr;
+    for(std::size_t i = 0; i < mr; i++) {
+      const T a = a_rows[i][p];
+      for(std::size_t j = 0; j < nr; j++) {
+        acc[i][j] += a * b[j];
+      }
+    }
+  }
+#endif
+  if(m == mr && n == nr) {
+    for(std::size_t i = 0; i < mr; i++) {
+      for(std::size_t j = 0; j < nr; j++) {
+        c_rows[i][j] = accumulate ? c_rows[i][j] + acc[i][j]
+                                  : acc[i][j];
+      }
+    }
+  } else {
+    for(std::size_t i = 0; i < m; i++) {
+      for(std::size_t j = 0; j < n; j++) {
+        c_rows[i][j] = accumulate ? c_rows[i][j] + acc[i][j]
+                                  : acc[i][j];
+      }
+    }
+  }
+}
+
+// Computes result = lhs * rhs for 2D arrays with a cache
+// blocked algorithm, packing blocks of rhs into contiguous
+// panels for the register tiles.
+// The rows of the arrays must be contiguous, which is the
+// case with the row major and padded row major layouts;
+// result must not alias lhs or rhs
+template <typename M1, typename M2, typename M3>
+M3 &matmul(const M1 &lhs, const M2 &rhs, M3 &result) {
+  static_assert(M1::dimension() == 2 &&
+                    M2::dimension() == 2 &&
+                    M3::dimension() == 2,
+                "matmul requires 2D arrays");
+  static_assert(M1::MAPPING::is_row_major &&
+                    M2::MAPPING::is_row_major &&
+                    M3::MAPPING::is_row_major,
+                "matmul requires row major arrays");
+  static_assert(M1::extent(0) == M3::extent(0),
+                "Shapes don't match");
+  static_assert(M1::extent(1) == M2::extent(0),
+                "Shapes don't match");
+  static_assert(M2::extent(1) == M3::extent(1),
+                "Shapes don't match");
+  using value_type = typename M3::value_type;
+  using size_type = std::size_t;
+  constexpr size_type M = M1::extent(0);
+  constexpr size_type K = M1::extent(1);
+  constexpr size_type N = M2::extent(1);
+  using tiling = matmul_tiling<value_type, M, K, N>;
+  constexpr size_type mr = tiling::mr;
+  constexpr size_type nr = tiling::nr;
+
+  const std::unique_ptr<value_type[]> packed(
+      new value_type[tiling::kc * tiling::packed_cols]);
+
+  for(size_type jc = 0; jc < N; jc += tiling::nc) {
+    const size_type nc = std::min(tiling::nc, N - jc);
+    for(size_type pc = 0; pc < K; pc += tiling::kc) {
+      const size_type kc = std::min(tiling::kc, K - pc);
+      // Pack the kc x nc block of rhs into panels of nr
+      // columns, zero filling the last panel
+      for(size_type jr = 0; jr < nc; jr += nr) {
+        value_type *panel = &packed[jr * tiling::kc];
+        const size_type n = std::min(nr, nc - jr);
+        for(size_type p = 0; p < kc; p++) {
+          const value_type *src = &rhs(pc + p, jc + jr);
+          for(size_type j = 0; j < n; j++) {
+            panel[p * nr + j] = src[j];
+          }
+          for(size_type j = n; j < nr; j++) {
+            panel[p * nr + j] = value_type(0);
+          }
+        }
+      }
+      for(size_type ic = 0; ic < M; ic += tiling::mc) {
+        const size_type mc = std::min(tiling::mc, M - ic);
+        for(size_type jr = 0; jr < nc; jr += nr) {
+          const value_type *panel =
+              &packed[jr * tiling::kc];
+          const size_type n = std::min(nr, nc - jr);
+          for(size_type ir = 0; ir < mc; ir += mr) {
+            const size_type m = std::min(mr, mc - ir);
+            const value_type *a_rows[mr];
+            value_type *c_rows[mr];
+            for(size_type i = 0; i < mr; i++) {
+              // Rows past the end reuse the last row, so
+              // every read is valid
+              const size_type row =
+                  ic + ir + (i < m ? i : m - 1);
+              a_rows[i] = &lhs(row, pc);
+              c_rows[i] = &result(row, jc + jr);
+            }
+            matmul_micro_kernel<mr, nr>(kc, a_rows, panel,
+                                        c_rows, m, n,
+                                        pc != 0);
+          }
+        }
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace ND_Array_internals_
+
+#endif
@@ -2,20 +2,63 @@
 #ifndef _NDARRAY_HPP_
 #define _NDARRAY_HPP_
 
+#include <cstddef>
 #include <type_traits>
 
 #include "ct_array.hpp"
+#include "layout.hpp"
+#include "strided_view.hpp"
 
 namespace ND_Array_internals_ {
 
+// Informs the compiler that ptr is aligned to alignment
+// bytes, enabling aligned vector loads and stores in loops
+// over it
+template <std::size_t alignment, typename T>
+[[nodiscard]] constexpr T *assume_aligned(T *ptr) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<T *>(
+      __builtin_assume_aligned(ptr, alignment));
+#else
+  return ptr;
+#endif
+}
+
+// Specialized to true_type by the lazily evaluated
+// expressions in expr.hpp, which can be assigned to arrays
+template <typename T>
+struct is_nd_expr_ : std::false_type {};
+
 // A better implementation might have all nd_arrays inherit
 // from a 1D array (like std::array, but preferably without
 // exceptions as they don't work on all platforms; eg GPUs
 // https://reviews.llvm.org/D25036)
-template <typename value_type_, typename Dims_CT_Array>
+//
+// alignment_ is the alignment of the storage in bytes;
+// increasing it to the cache line or SIMD register width
+// lets loops over data() and begin() use aligned accesses.
+// Slices are not generally aligned, so outer_slice()
+// returns arrays with the natural alignment
+//
+// Layout_ determines where the elements are placed in the
+// storage and the order the iterators visit them in; see
+// layout.hpp. outer_slice() and reshape() require a row
+// major layout
+template <typename value_type_, typename Dims_CT_Array,
+          std::size_t alignment_ = alignof(value_type_),
+          typename Layout_ = row_major>
 class [[nodiscard]] nd_array_ {
  public:
   using DIMS = Dims_CT_Array;
+  using LAYOUT = Layout_;
+  using MAPPING =
+      typename Layout_::template mapping<Dims_CT_Array>;
+
+  static_assert(alignment_ >= alignof(value_type_),
+                "Alignment is less than the natural "
+                "alignment of the value type");
+  static_assert((alignment_ & (alignment_ - 1)) == 0,
+                "Alignment must be a power of two");
 
   using value_type = value_type_;
   using reference = value_type &;
@@ -27,29 +70,71 @@ class [[nodiscard]] nd_array_ {
   using difference_type = std::ptrdiff_t;
 
   using nd_array_type =
-      nd_array_<value_type, Dims_CT_Array>;
+      nd_array_<value_type, Dims_CT_Array, alignment_,
+                Layout_>;
 
   constexpr nd_array_() noexcept {}
 
+  // Copies the elements in row major order, so arrays with
+  // the same extents and a different layout are converted
+  // to this layout
   template <
-      typename Other_Dims,
+      typename Other_Dims, std::size_t other_alignment,
+      typename Other_Layout,
       typename std::enable_if<Other_Dims::product() ==
                                   Dims_CT_Array::product(),
                               int>::type = 0>
   explicit constexpr nd_array_(
-      const nd_array_<value_type, Other_Dims>
+      const nd_array_<value_type, Other_Dims,
+                      other_alignment, Other_Layout>
           &src) noexcept {
-    for(size_type i = 0; i < size(); i++) {
-      vals[i] = src.vals[i];
+    using Other_Mapping =
+        typename Other_Layout::template mapping<Other_Dims>;
+    if constexpr(MAPPING::is_row_major &&
+                 Other_Mapping::is_row_major) {
+      auto src_itr = src.cbegin();
+      for(reference elem : (*this)) {
+        elem = *src_itr;
+        ++src_itr;
+      }
+    } else {
+      const const_pointer src_vals = src.data();
+      for(size_type i = 0; i < size(); i++) {
+        vals[MAPPING::storage_idx(i)] =
+            src_vals[Other_Mapping::storage_idx(i)];
+      }
     }
   }
 
+  // Evaluates the expression in a single pass over the
+  // elements
+  template <typename Expr,
+            typename std::enable_if<
+                is_nd_expr_<Expr>::value, int>::type = 0>
+  constexpr nd_array_(const Expr &expr) noexcept {
+    assign(expr);
+  }
+
+  // Evaluates the expression in a single pass over the
+  // elements. Elements of this array used in the
+  // expression are read before they are written, so
+  // expressions like a = 2 * a + b are safe; expressions
+  // using reshaped or sliced views of this array aren't
+  template <typename Expr,
+            typename std::enable_if<
+                is_nd_expr_<Expr>::value, int>::type = 0>
+  constexpr nd_array_ &operator=(
+      const Expr &expr) noexcept {
+    assign(expr);
+    return *this;
+  }
+
   template <typename... int_t>
   [[nodiscard]] constexpr const_reference at(
       int_t... indices) const noexcept {
     static_assert(sizeof...(int_t) == DIMS::len(),
                   "Number of indices passed is incorrect");
-    return vals[DIMS::slice_idx(indices...)];
+    return vals[MAPPING::slice_idx(indices...)];
   }
 
   template <typename... int_t>
@@ -57,7 +142,7 @@ class [[nodiscard]] nd_array_ {
       int_t... indices) noexcept {
     static_assert(sizeof...(int_t) == DIMS::len(),
                   "Number of indices passed is incorrect");
-    return vals[DIMS::slice_idx(indices...)];
+    return vals[MAPPING::slice_idx(indices...)];
   }
 
   template <typename... int_t>
@@ -82,46 +167,143 @@ class [[nodiscard]] nd_array_ {
   }
 
   [[nodiscard]] constexpr reference back() noexcept {
-    return vals[size() - 1];
+    return *(end() - 1);
   }
 
   [[nodiscard]] constexpr const_reference back()
       const noexcept {
-    return vals[size() - 1];
+    return *(cend() - 1);
   }
 
   template <typename... int_t>
   [[nodiscard]] constexpr const nd_array_<
       value_type,
       typename forward_truncate_array<sizeof...(int_t),
-                                      Dims_CT_Array>::type>
+                                      Dims_CT_Array>::type,
+      alignof(value_type), Layout_>
       &outer_slice(int_t... indices) const noexcept {
+    static_assert(MAPPING::is_row_major,
+                  "Outer slices need a row major layout");
     using truncated_dims =
         typename forward_truncate_array<sizeof...(int_t),
                                         DIMS>::type;
-    using ret_type = nd_array_<value_type, truncated_dims>;
-    return *(reinterpret_cast<ret_type *const>(
-        &vals[0] + DIMS::slice_idx(indices...)));
+    using ret_type = nd_array_<value_type, truncated_dims,
+                               alignof(value_type), LAYOUT>;
+    return *(reinterpret_cast<const ret_type *>(
+        &vals[0] + MAPPING::slice_idx(indices...)));
   }
 
   template <typename... int_t>
   [[nodiscard]] constexpr nd_array_<
       value_type,
       typename forward_truncate_array<sizeof...(int_t),
-                                      Dims_CT_Array>::type>
+                                      Dims_CT_Array>::type,
+      alignof(value_type), Layout_>
       &outer_slice(int_t... indices) noexcept {
+    static_assert(MAPPING::is_row_major,
+                  "Outer slices need a row major layout");
     using truncated_dims =
         typename forward_truncate_array<sizeof...(int_t),
                                         DIMS>::type;
-    using ret_type = nd_array_<value_type, truncated_dims>;
+    using ret_type = nd_array_<value_type, truncated_dims,
+                               alignof(value_type), LAYOUT>;
     return *(reinterpret_cast<ret_type *>(
-        &vals[0] + DIMS::slice_idx(indices...)));
+        &vals[0] + MAPPING::slice_idx(indices...)));
+  }
+
+  using strided_view_type =
+      typename static_strided_view<value_type, DIMS,
+                                   MAPPING>::type;
+  using const_strided_view_type =
+      typename static_strided_view<const value_type, DIMS,
+                                   MAPPING>::type;
+
+  // A view of every element, from which views through any
+  // dimension can be taken. Its extents and strides are all
+  // compile time constants
+  [[nodiscard]] constexpr strided_view_type
+  strided_view() noexcept {
+    static_assert(MAPPING::is_strided,
+                  "This layout has no strided views");
+    return static_strided_view<value_type, DIMS,
+                               MAPPING>::make(data());
+  }
+
+  [[nodiscard]] constexpr const_strided_view_type
+  strided_view() const noexcept {
+    static_assert(MAPPING::is_strided,
+                  "This layout has no strided views");
+    return static_strided_view<const value_type, DIMS,
+                               MAPPING>::make(data());
   }
 
+  // The view with Dim fixed at idx; unlike outer_slice(),
+  // Dim can be any dimension
+  template <int Dim>
+  [[nodiscard]] constexpr
+      typename strided_view_type::template slice_type<Dim>
+      slice(const size_type idx) noexcept {
+    return strided_view().template slice<Dim>(idx);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr typename const_strided_view_type::
+      template slice_type<Dim>
+      slice(const size_type idx) const noexcept {
+    return strided_view().template slice<Dim>(idx);
+  }
+
+  // The view of the indices [begin, end) of Dim
+  template <int Dim>
+  [[nodiscard]] constexpr typename strided_view_type::
+      template subrange_type<Dim>
+      subrange(const size_type begin,
+               const size_type end) noexcept {
+    return strided_view().template subrange<Dim>(begin,
+                                                 end);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr typename const_strided_view_type::
+      template subrange_type<Dim>
+      subrange(const size_type begin,
+               const size_type end) const noexcept {
+    return strided_view().template subrange<Dim>(begin,
+                                                 end);
+  }
+
+  // The view of every step'th index of Dim
+  template <int Dim>
+  [[nodiscard]] constexpr
+      typename strided_view_type::template stride_type<Dim>
+      stride(const size_type step) noexcept {
+    return strided_view().template stride<Dim>(step);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr typename const_strided_view_type::
+      template stride_type<Dim>
+      stride(const size_type step) const noexcept {
+    return strided_view().template stride<Dim>(step);
+  }
+
+  // Padded arrays can only be reshaped into arrays with the
+  // same layout and last extent, so the padding stays in
+  // the same place
   template <typename Reshaped_Array>
   [[nodiscard]] Reshaped_Array &reshape() noexcept {
     static_assert(Reshaped_Array::size() == size(),
                   "Reshaped array is not the same size");
+    static_assert(
+        (MAPPING::is_contiguous &&
+         Reshaped_Array::MAPPING::is_contiguous) ||
+            (MAPPING::is_row_major &&
+             std::is_same<typename Reshaped_Array::LAYOUT,
+                          LAYOUT>::value &&
+             Reshaped_Array::extent(
+                 Reshaped_Array::dimension() - 1) ==
+                 extent(dimension() - 1)),
+        "Reshaped array has incompatible padding");
     return reinterpret_cast<Reshaped_Array &>(*this);
   }
 
@@ -142,12 +324,29 @@ class [[nodiscard]] nd_array_ {
     return size();
   }
 
+  // The number of elements in the storage, including any
+  // padding
+  [[nodiscard]] static constexpr size_type
+  storage_size() noexcept {
+    return MAPPING::storage_size();
+  }
+
   [[nodiscard]] static constexpr int dimension() {
     return DIMS::len();
   }
 
-  [[nodiscard]] constexpr pointer data() const noexcept {
-    return vals;
+  [[nodiscard]] static constexpr std::size_t
+  alignment() noexcept {
+    return alignment_;
+  }
+
+  [[nodiscard]] constexpr pointer data() noexcept {
+    return assume_aligned<alignment_>(&vals[0]);
+  }
+
+  [[nodiscard]] constexpr const_pointer data() const
+      noexcept {
+    return assume_aligned<alignment_>(&vals[0]);
   }
 
   constexpr void fill(const_reference value) noexcept {
@@ -156,8 +355,7 @@ class [[nodiscard]] nd_array_ {
     }
   }
 
-  constexpr void swap(nd_array_<value_type, Dims_CT_Array> &
-                      rhs) noexcept {
+  constexpr void swap(nd_array_type &rhs) noexcept {
     iterator iter_l = begin();
     iterator iter_r = rhs.begin();
     while(iter_l != end()) {
@@ -167,39 +365,35 @@ class [[nodiscard]] nd_array_ {
     }
   }
 
-  using iterator = value_type *;
+  using iterator =
+      typename MAPPING::template iterator<value_type>;
 
   [[nodiscard]] constexpr iterator begin() noexcept {
-    return &vals[0];
+    return MAPPING::make_iterator(data(), 0);
   }
 
   [[nodiscard]] constexpr iterator end() noexcept {
-    return &vals[size()];
+    return MAPPING::make_iterator(data(), size());
   }
 
-  using const_iterator = const value_type *;
+  using const_iterator =
+      typename MAPPING::template iterator<const value_type>;
 
   [[nodiscard]] constexpr const_iterator cbegin()
       const noexcept {
-    return &vals[0];
+    return MAPPING::make_iterator(data(), 0);
   }
 
   [[nodiscard]] constexpr const_iterator cend()
       const noexcept {
-    return &vals[size()];
+    return MAPPING::make_iterator(data(), size());
   }
 
   [[nodiscard]] constexpr size_type index(
-      const iterator &itr, const typename DIMS::FieldT dim)
-      const noexcept {
+      const const_iterator &itr,
+      const typename DIMS::FieldT dim) const noexcept {
     assert(dim < DIMS::len());
-    const difference_type idx = itr - cbegin();
-    if(dim + 1 == DIMS::len()) {
-      return idx % DIMS::value(dim);
-    } else {
-      return (idx / DIMS::trailing_product(dim + 1)) %
-             DIMS::value(dim);
-    }
+    return MAPPING::index(itr - cbegin(), dim);
   }
 
   // WARNING: This function can return an invalid iterator,
@@ -208,19 +402,42 @@ class [[nodiscard]] nd_array_ {
   template <typename... int_t>
   [[nodiscard]] static constexpr iterator offset(
       const iterator &origin, const int_t &... offset) {
+    static_assert(MAPPING::is_strided,
+                  "This layout can't offset iterators");
     iterator itr_offset =
         origin + static_cast<difference_type>(
-                     DIMS::slice_idx(offset...));
+                     MAPPING::offset_idx(offset...));
     return itr_offset;
   }
 
-  template <typename _value_type, typename _Dims_CT_Array>
+  template <typename _value_type, typename _Dims_CT_Array,
+            std::size_t _alignment, typename _Layout>
   friend class nd_array_;
 
  private:
-  value_type vals[size()];
+  template <typename Expr>
+  constexpr void assign(const Expr &expr) noexcept {
+    static_assert(
+        std::is_same<typename Expr::DIMS, DIMS>::value,
+        "Shapes don't match");
+    const pointer dest = data();
+    for(size_type i = 0; i < size(); i++) {
+      dest[MAPPING::storage_idx(i)] = expr.eval(i);
+    }
+  }
+
+  alignas(alignment_) value_type vals[storage_size()];
 };
 
+template <typename T>
+struct is_nd_array_ : std::false_type {};
+
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout>
+struct is_nd_array_<
+    nd_array_<value_type, Dims_CT_Array, alignment, Layout>>
+    : std::true_type {};
+
 }  // namespace ND_Array_internals_
 
 template <typename value_type, int... Dims>
@@ -228,4 +445,47 @@ using ND_Array = ND_Array_internals_::nd_array_<
     value_type,
     ND_Array_internals_::CT_Array<size_t, Dims...>>;
 
+// An ND_Array with storage aligned to alignment bytes,
+// typically the SIMD register width or cache line size
+template <typename value_type, std::size_t alignment,
+          int... Dims>
+using ND_Aligned_Array = ND_Array_internals_::nd_array_<
+    value_type,
+    ND_Array_internals_::CT_Array<size_t, Dims...>,
+    alignment>;
+
+// An ND_Array with pad unused elements after each row of
+// its last dimension
+template <typename value_type, std::size_t pad, int... Dims>
+using ND_Padded_Array = ND_Array_internals_::nd_array_<
+    value_type,
+    ND_Array_internals_::CT_Array<size_t, Dims...>,
+    alignof(value_type),
+    ND_Array_internals_::padded_row_major<pad>>;
+
+// An ND_Array stored in column major order
+template <typename value_type, int... Dims>
+using ND_Col_Major_Array = ND_Array_internals_::nd_array_<
+    value_type,
+    ND_Array_internals_::CT_Array<size_t, Dims...>,
+    alignof(value_type), ND_Array_internals_::col_major>;
+
+// An ND_Array whose last two dimensions are stored in
+// tile_rows x tile_cols tiles
+template <typename value_type, std::size_t tile_rows,
+          std::size_t tile_cols, int... Dims>
+using ND_Tiled_Array = ND_Array_internals_::nd_array_<
+    value_type,
+    ND_Array_internals_::CT_Array<size_t, Dims...>,
+    alignof(value_type),
+    ND_Array_internals_::tiled<tile_rows, tile_cols>>;
+
+// An ND_Array stored in Morton order, whose extents must be
+// powers of two
+template <typename value_type, int... Dims>
+using ND_Morton_Array = ND_Array_internals_::nd_array_<
+    value_type,
+    ND_Array_internals_::CT_Array<size_t, Dims...>,
+    alignof(value_type), ND_Array_internals_::morton>;
+
 #endif
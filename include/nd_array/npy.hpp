@@ -0,0 +1,1012 @@
+
+#ifndef _NPY_HPP_
+#define _NPY_HPP_
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "ct_array.hpp"
+#include "file_header.hpp"
+#include "layout.hpp"
+#include "mapped_array.hpp"
+#include "serialize.hpp"
+
+namespace ND_Array_internals_ {
+
+// Reads and writes numpy's .npy files, and .npz archives of
+// them, so arrays can be passed to and from numpy without
+// converting them. The element type maps onto the dtype,
+// and the layout onto the order: row major arrays and
+// arrays with runtime extents are C order, column major
+// arrays Fortran order. Like save() and load(), the
+// elements are written and read as a single block, and
+// .npy files can be mapped with ND_Mapped_Npy.
+//
+// Only the numeric dtypes in the byte order of the machine
+// are supported, and .npz archives must be uncompressed
+// (np.savez rather than np.savez_compressed) and smaller
+// than 4GB. Requires POSIX
+
+template <typename T>
+struct npy_is_complex_ : std::false_type {};
+
+template <typename T>
+struct npy_is_complex_<std::complex<T>> : std::true_type {};
+
+// The byte order character of multibyte dtypes
+[[nodiscard]] constexpr char npy_byte_order() noexcept {
+#if defined(__BYTE_ORDER__) && \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return '>';
+#else
+  return '<';
+#endif
+}
+
+// The numpy dtype of T, eg "<f8" for double
+template <typename T>
+[[nodiscard]] std::string npy_descr() {
+  static_assert(std::is_arithmetic<T>::value ||
+                    npy_is_complex_<T>::value,
+                "Only numeric types have numpy dtypes");
+  char kind = 'V';
+  if constexpr(std::is_same<T, bool>::value) {
+    kind = 'b';
+  } else if constexpr(std::is_floating_point<T>::value) {
+    kind = 'f';
+  } else if constexpr(npy_is_complex_<T>::value) {
+    kind = 'c';
+  } else {
+    kind = std::is_signed<T>::value ? 'i' : 'u';
+  }
+  const char order =
+      sizeof(T) == 1 ? '|' : npy_byte_order();
+  return std::string{order, kind} +
+         std::to_string(sizeof(T));
+}
+
+// The order of the elements of an Array in an .npy file;
+// arrays with runtime extents are row major
+template <typename Array, typename = void>
+struct npy_order_ {
+  static constexpr bool supported = true;
+  static constexpr bool fortran = false;
+};
+
+template <typename Array>
+struct npy_order_<Array,
+                  std::void_t<typename Array::MAPPING>> {
+  static constexpr bool is_col_major =
+      std::is_same<typename Array::LAYOUT,
+                   col_major>::value;
+  static constexpr bool supported =
+      Array::MAPPING::is_contiguous || is_col_major;
+  static constexpr bool fortran =
+      is_col_major && Array::dimension() > 1;
+};
+
+// The extents of an array, as recorded in an .npy file
+template <typename Array>
+[[nodiscard]] std::array<std::uint64_t, Array::dimension()>
+npy_extents(const Array &arr) noexcept {
+  std::array<std::uint64_t, Array::dimension()> extents;
+  for(int d = 0; d < Array::dimension(); d++) {
+    extents[d] = arr.extent(d);
+  }
+  return extents;
+}
+
+// The extents of an array with compile time extents
+template <typename Array>
+[[nodiscard]] std::array<std::uint64_t, Array::dimension()>
+npy_extents() noexcept {
+  std::array<std::uint64_t, Array::dimension()> extents;
+  for(int d = 0; d < Array::dimension(); d++) {
+    extents[d] = Array::extent(d);
+  }
+  return extents;
+}
+
+// The magic string and version
+constexpr char npy_magic[] = "\x93NUMPY";
+constexpr std::size_t npy_magic_bytes = 6;
+// The magic string, version, and header length of version
+// 1 files, and the longer header length of versions 2 and 3
+constexpr std::size_t npy_prelude_bytes = 10;
+constexpr std::size_t npy_long_prelude_bytes = 12;
+// The alignment of the elements, which numpy guarantees is
+// at least 16 bytes
+constexpr std::size_t npy_data_alignment = 64;
+
+// The start of an .npy file of an Array with extents, up to
+// its elements: the prelude and the header dictionary,
+// padded with spaces so the elements are aligned
+template <typename Array, std::size_t dims>
+[[nodiscard]] std::string npy_header_string(
+    const std::array<std::uint64_t, dims> &extents) {
+  using T = typename std::remove_const<
+      typename Array::value_type>::type;
+  std::string dict = "{'descr': '" + npy_descr<T>() +
+                     "', 'fortran_order': ";
+  dict += npy_order_<Array>::fortran ? "True" : "False";
+  dict += ", 'shape': (";
+  for(std::size_t d = 0; d < dims; d++) {
+    dict += std::to_string(extents[d]);
+    dict += d + 1 < dims || dims == 1 ? "," : "";
+    dict += d + 1 < dims ? " " : "";
+  }
+  dict += "), }";
+  const std::size_t unpadded =
+      npy_prelude_bytes + dict.size() + 1;
+  const std::size_t padded =
+      (unpadded + npy_data_alignment - 1) /
+      npy_data_alignment * npy_data_alignment;
+  dict.append(padded - unpadded, ' ');
+  dict += '\n';
+
+  std::string header(npy_magic, npy_magic_bytes);
+  // Version 1.0
+  header += '\x01';
+  header += '\x00';
+  const std::size_t dict_bytes = dict.size();
+  header += static_cast<char>(dict_bytes & 0xFF);
+  header += static_cast<char>(dict_bytes >> 8);
+  return header + dict;
+}
+
+// The fields of an .npy file's header
+struct npy_header {
+  std::string descr;
+  bool fortran_order = false;
+  std::vector<std::uint64_t> shape;
+  // The offset of the elements from the start of the file
+  std::uint64_t data_offset = 0;
+
+  [[nodiscard]] std::uint64_t size() const noexcept {
+    std::uint64_t elems = 1;
+    for(const std::uint64_t extent : shape) {
+      elems *= extent;
+    }
+    return elems;
+  }
+};
+
+// Finds the length of the prelude and header from the first
+// bytes of an .npy file, which must be at least
+// npy_long_prelude_bytes long
+[[nodiscard]] inline io_status npy_data_offset(
+    const unsigned char *prelude,
+    std::uint64_t &data_offset) noexcept {
+  if(std::memcmp(prelude, npy_magic, npy_magic_bytes) !=
+     0) {
+    return io_status::bad_header;
+  }
+  const unsigned major = prelude[npy_magic_bytes];
+  if(major == 1) {
+    data_offset = npy_prelude_bytes + prelude[8] +
+                  (std::uint64_t(prelude[9]) << 8);
+  } else if(major == 2 || major == 3) {
+    data_offset = npy_long_prelude_bytes + prelude[8] +
+                  (std::uint64_t(prelude[9]) << 8) +
+                  (std::uint64_t(prelude[10]) << 16) +
+                  (std::uint64_t(prelude[11]) << 24);
+  } else {
+    return io_status::unsupported;
+  }
+  return io_status::ok;
+}
+
+// Finds the value of key in the header dictionary, skipping
+// the colon and any spaces
+[[nodiscard]] inline std::size_t npy_find_value(
+    const std::string &dict, const char *key) noexcept {
+  std::size_t pos = dict.find(key);
+  if(pos == std::string::npos) {
+    return pos;
+  }
+  pos = dict.find(':', pos + std::strlen(key));
+  if(pos == std::string::npos) {
+    return pos;
+  }
+  pos++;
+  while(pos < dict.size() && dict[pos] == ' ') {
+    pos++;
+  }
+  return pos < dict.size() ? pos : std::string::npos;
+}
+
+// Parses the start of an .npy file, which must hold at
+// least the whole header
+[[nodiscard]] inline io_status parse_npy_header(
+    const unsigned char *file, const std::uint64_t bytes,
+    npy_header &header) noexcept {
+  if(bytes < npy_long_prelude_bytes) {
+    return io_status::bad_header;
+  }
+  const io_status status =
+      npy_data_offset(file, header.data_offset);
+  if(status != io_status::ok) {
+    return status;
+  }
+  if(header.data_offset > bytes) {
+    return io_status::truncated;
+  }
+  try {
+    const std::size_t dict_start =
+        file[npy_magic_bytes] == 1 ? npy_prelude_bytes
+                                   : npy_long_prelude_bytes;
+    const std::string dict(
+        reinterpret_cast<const char *>(file) + dict_start,
+        header.data_offset - dict_start);
+
+    // Structured dtypes are lists rather than strings
+    std::size_t pos = npy_find_value(dict, "'descr'");
+    if(pos == std::string::npos ||
+       (dict[pos] != '\'' && dict[pos] != '"')) {
+      return io_status::unsupported;
+    }
+    const std::size_t descr_end =
+        dict.find(dict[pos], pos + 1);
+    if(descr_end == std::string::npos) {
+      return io_status::bad_header;
+    }
+    header.descr =
+        dict.substr(pos + 1, descr_end - pos - 1);
+
+    pos = npy_find_value(dict, "'fortran_order'");
+    if(pos == std::string::npos) {
+      return io_status::bad_header;
+    }
+    header.fortran_order =
+        dict.compare(pos, 4, "True") == 0;
+
+    pos = npy_find_value(dict, "'shape'");
+    if(pos == std::string::npos || dict[pos] != '(') {
+      return io_status::bad_header;
+    }
+    header.shape.clear();
+    for(pos++; pos < dict.size() && dict[pos] != ')';
+        pos++) {
+      if(dict[pos] >= '0' && dict[pos] <= '9') {
+        std::uint64_t extent = 0;
+        for(; dict[pos] >= '0' && dict[pos] <= '9'; pos++) {
+          extent = 10 * extent + (dict[pos] - '0');
+        }
+        header.shape.push_back(extent);
+        pos--;
+      } else if(dict[pos] != ',' && dict[pos] != ' ') {
+        return io_status::bad_header;
+      }
+    }
+    return pos < dict.size() ? io_status::ok
+                             : io_status::bad_header;
+  } catch(const std::bad_alloc &) {
+    return io_status::out_of_memory;
+  }
+}
+
+// Checks that a header describes the elements of an Array
+// with extents
+template <typename Array, std::size_t dims>
+[[nodiscard]] io_status check_npy_header(
+    const npy_header &header,
+    const std::array<std::uint64_t, dims> &extents)
+    noexcept {
+  using T = typename std::remove_const<
+      typename Array::value_type>::type;
+  std::string expected;
+  std::string descr;
+  try {
+    expected = npy_descr<T>();
+    descr = header.descr;
+  } catch(const std::bad_alloc &) {
+    return io_status::out_of_memory;
+  }
+  // '=' is the native byte order, and the byte order of
+  // single byte types is irrelevant
+  if(!descr.empty() &&
+     (descr[0] == '=' ||
+      (sizeof(T) == 1 &&
+       (descr[0] == '<' || descr[0] == '>')))) {
+    descr[0] = expected[0];
+  }
+  if(descr != expected) {
+    return io_status::type_mismatch;
+  }
+  if(header.shape.size() != dims) {
+    return io_status::shape_mismatch;
+  }
+  for(std::size_t d = 0; d < dims; d++) {
+    if(header.shape[d] != extents[d]) {
+      return io_status::shape_mismatch;
+    }
+  }
+  if(dims > 1 &&
+     header.fortran_order != npy_order_<Array>::fortran) {
+    return io_status::shape_mismatch;
+  }
+  return io_status::ok;
+}
+
+/* CRC-32, for .npz archives */
+
+// The tables for computing the CRC-32 of zip files 8 bytes
+// at a time
+struct crc32_tables_ {
+  std::uint32_t entries[8][256];
+};
+
+[[nodiscard]] constexpr crc32_tables_
+make_crc32_tables() noexcept {
+  crc32_tables_ tables{};
+  for(std::uint32_t i = 0; i < 256; i++) {
+    std::uint32_t c = i;
+    for(int k = 0; k < 8; k++) {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    tables.entries[0][i] = c;
+  }
+  for(int s = 1; s < 8; s++) {
+    for(int i = 0; i < 256; i++) {
+      const std::uint32_t prev = tables.entries[s - 1][i];
+      tables.entries[s][i] =
+          (prev >> 8) ^ tables.entries[0][prev & 0xFF];
+    }
+  }
+  return tables;
+}
+
+inline constexpr crc32_tables_ crc32_tables =
+    make_crc32_tables();
+
+// Continues the CRC-32 crc of the preceding bytes over
+// bytes more bytes; crc is 0 for the first
+[[nodiscard]] inline std::uint32_t crc32_update(
+    std::uint32_t crc, const void *data,
+    std::size_t bytes) noexcept {
+  const auto &t = crc32_tables.entries;
+  const unsigned char *src =
+      static_cast<const unsigned char *>(data);
+  crc = ~crc;
+  if constexpr(npy_byte_order() == '<') {
+    for(; bytes >= 8; bytes -= 8, src += 8) {
+      std::uint32_t lo;
+      std::uint32_t hi;
+      std::memcpy(&lo, src, sizeof(lo));
+      std::memcpy(&hi, src + 4, sizeof(hi));
+      lo ^= crc;
+      crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^
+            t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+            t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^
+            t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+  }
+  for(; bytes > 0; bytes--, src++) {
+    crc = t[0][(crc ^ *src) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+/* .npy files */
+
+// Reads the .npy file at offset in the file, which has
+// bytes bytes from there, into arr after checking its
+// header; with crc, the CRC-32 of the whole .npy file is
+// computed, to check .npz archives
+template <typename Array>
+[[nodiscard]] io_status read_npy(
+    const int fd, const std::uint64_t offset,
+    const std::uint64_t bytes, Array &arr,
+    std::uint32_t *crc) noexcept {
+  static_assert(npy_order_<Array>::supported,
+                ".npy files must be row or column major");
+  using T = typename Array::value_type;
+  static_assert(!std::is_const<T>::value,
+                "Spans of const elements can't be loaded");
+  unsigned char prelude[npy_long_prelude_bytes];
+  std::uint64_t data_offset = 0;
+  if(bytes < sizeof(prelude) ||
+     !read_bytes(fd, prelude, sizeof(prelude), offset)) {
+    return io_status::bad_header;
+  }
+  io_status status = npy_data_offset(prelude, data_offset);
+  if(status != io_status::ok) {
+    return status;
+  }
+  if(data_offset > bytes) {
+    return io_status::truncated;
+  }
+  std::vector<unsigned char> start;
+  try {
+    start.resize(data_offset);
+  } catch(const std::bad_alloc &) {
+    return io_status::out_of_memory;
+  }
+  npy_header header;
+  if(!read_bytes(fd, start.data(), data_offset, offset)) {
+    return io_status::io_failed;
+  }
+  status =
+      parse_npy_header(start.data(), data_offset, header);
+  if(status == io_status::ok) {
+    status =
+        check_npy_header<Array>(header, npy_extents(arr));
+  }
+  if(status != io_status::ok) {
+    return status;
+  }
+  const std::uint64_t data_bytes = arr.size() * sizeof(T);
+  if(data_offset + data_bytes > bytes) {
+    return io_status::truncated;
+  }
+  if(!read_bytes(fd, arr.data(), data_bytes,
+                 offset + data_offset)) {
+    return io_status::io_failed;
+  }
+  if(crc != nullptr) {
+    *crc = crc32_update(
+        crc32_update(0, start.data(), data_offset),
+        arr.data(), data_bytes);
+  }
+  return io_status::ok;
+}
+
+// Writes arr, an nd_array_, nd_span_, or nd_dyn_array_, to
+// the .npy file at path, replacing it if it exists
+template <typename Array>
+[[nodiscard]] io_status save_npy(
+    const Array &arr, const char *path) noexcept {
+  static_assert(npy_order_<Array>::supported,
+                ".npy files must be row or column major");
+  using T = typename Array::value_type;
+  std::string header;
+  try {
+    header = npy_header_string<Array>(npy_extents(arr));
+  } catch(const std::bad_alloc &) {
+    return io_status::out_of_memory;
+  }
+  const int fd =
+      open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0) {
+    return io_status::open_failed;
+  }
+  iovec iov[2] = {
+      {const_cast<char *>(header.data()), header.size()},
+      {const_cast<void *>(
+           static_cast<const void *>(arr.data())),
+       arr.size() * sizeof(T)}};
+  const bool written = write_buffers(fd, iov, 2);
+  const bool closed = close(fd) == 0;
+  return written && closed ? io_status::ok
+                           : io_status::io_failed;
+}
+
+// Reads the .npy file at path into arr, which must have the
+// file's extents and order
+template <typename Array>
+[[nodiscard]] io_status load_npy(const char *path,
+                                 Array &arr) noexcept {
+  const int fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    return io_status::open_failed;
+  }
+  struct stat file_stat;
+  io_status status = io_status::io_failed;
+  if(fstat(fd, &file_stat) == 0) {
+    status =
+        read_npy(fd, 0, file_stat.st_size, arr, nullptr);
+  }
+  close(fd);
+  return status;
+}
+
+// Loads the .npy file at path into a new array on the heap,
+// see load()
+template <typename Array>
+[[nodiscard]] std::unique_ptr<Array> load_npy(
+    const char *path,
+    io_status *status = nullptr) noexcept {
+  static_assert(is_nd_array_<Array>::value,
+                "Only arrays can be allocated");
+  std::unique_ptr<Array> arr(new(std::nothrow) Array);
+  const io_status result = arr != nullptr
+                               ? load_npy(path, *arr)
+                               : io_status::out_of_memory;
+  if(status != nullptr) {
+    *status = result;
+  }
+  if(result != io_status::ok) {
+    arr.reset();
+  }
+  return arr;
+}
+
+// Reads the header of the .npy file at path, eg to find the
+// extents of an array with runtime extents to load it into
+[[nodiscard]] inline io_status read_npy_header(
+    const char *path, npy_header &header) noexcept {
+  const int fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    return io_status::open_failed;
+  }
+  unsigned char prelude[npy_long_prelude_bytes];
+  std::uint64_t data_offset = 0;
+  io_status status = io_status::bad_header;
+  if(read_bytes(fd, prelude, sizeof(prelude), 0)) {
+    status = npy_data_offset(prelude, data_offset);
+  }
+  if(status == io_status::ok) {
+    try {
+      std::vector<unsigned char> start(data_offset);
+      status = read_bytes(fd, start.data(), data_offset, 0)
+                   ? parse_npy_header(start.data(),
+                                      data_offset, header)
+                   : io_status::truncated;
+    } catch(const std::bad_alloc &) {
+      status = io_status::out_of_memory;
+    }
+  }
+  close(fd);
+  return status;
+}
+
+// The .npy format, for mapping .npy files with
+// nd_mapped_array_
+struct npy_format {
+  // The alignment guaranteed by numpy
+  static constexpr std::size_t data_alignment = 16;
+
+  template <typename Array>
+  [[nodiscard]] static std::uint64_t
+  data_offset() noexcept {
+    return npy_header_string<Array>(npy_extents<Array>())
+        .size();
+  }
+
+  template <typename Array>
+  static void write_header(void *file) noexcept {
+    const std::string header =
+        npy_header_string<Array>(npy_extents<Array>());
+    std::memcpy(file, header.data(), header.size());
+  }
+
+  template <typename Array>
+  [[nodiscard]] static io_status read_header(
+      void *file, const std::uint64_t file_bytes, bool,
+      std::uint64_t &data_offset) noexcept {
+    static_assert(npy_order_<Array>::supported,
+                  ".npy files must be row or column major");
+    npy_header header;
+    io_status status = parse_npy_header(
+        static_cast<const unsigned char *>(file),
+        file_bytes, header);
+    if(status == io_status::ok) {
+      status = check_npy_header<Array>(
+          header, npy_extents<Array>());
+    }
+    data_offset = header.data_offset;
+    if(status == io_status::ok &&
+       data_offset % data_alignment != 0) {
+      return io_status::unsupported;
+    }
+    const std::uint64_t data_bytes =
+        Array::size() * sizeof(typename Array::value_type);
+    if(status == io_status::ok &&
+       data_offset + data_bytes > file_bytes) {
+      return io_status::truncated;
+    }
+    return status;
+  }
+};
+
+/* .npz archives */
+
+// Little endian fields of zip headers
+template <typename T>
+void zip_put(std::string &buffer, const T value) {
+  for(std::size_t i = 0; i < sizeof(T); i++) {
+    buffer += static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+[[nodiscard]] inline std::uint32_t zip_get(
+    const unsigned char *field,
+    const std::size_t bytes) noexcept {
+  std::uint32_t value = 0;
+  for(std::size_t i = 0; i < bytes; i++) {
+    value |= std::uint32_t(field[i]) << (8 * i);
+  }
+  return value;
+}
+
+constexpr std::uint32_t zip_local_signature = 0x04034b50;
+constexpr std::uint32_t zip_central_signature = 0x02014b50;
+constexpr std::uint32_t zip_end_signature = 0x06054b50;
+constexpr std::size_t zip_local_bytes = 30;
+constexpr std::size_t zip_central_bytes = 46;
+constexpr std::size_t zip_end_bytes = 22;
+// Sizes and offsets must be smaller than this without the
+// zip64 extensions
+constexpr std::uint64_t zip_max_bytes = 0xFFFFFFFFull;
+
+// A file in a zip archive
+struct zip_entry {
+  std::string name;
+  std::uint32_t crc;
+  std::uint64_t bytes;
+  std::uint64_t offset;
+  std::uint16_t method;
+};
+
+// The fields shared by the local and central headers of an
+// uncompressed file, from the version needed to the
+// lengths of the name and extra field
+inline void zip_put_entry(std::string &buffer,
+                          const zip_entry &entry) {
+  // Version 2.0, no flags, stored, 1980-01-01 00:00
+  zip_put<std::uint16_t>(buffer, 20);
+  zip_put<std::uint16_t>(buffer, 0);
+  zip_put<std::uint16_t>(buffer, 0);
+  zip_put<std::uint16_t>(buffer, 0);
+  zip_put<std::uint16_t>(buffer, 0x21);
+  zip_put<std::uint32_t>(buffer, entry.crc);
+  zip_put<std::uint32_t>(buffer, entry.bytes);
+  zip_put<std::uint32_t>(buffer, entry.bytes);
+  zip_put<std::uint16_t>(buffer, entry.name.size());
+  zip_put<std::uint16_t>(buffer, 0);
+}
+
+// Writes an .npz archive, an uncompressed zip of .npy
+// files, an array at a time. The archive is completed by
+// finish(), or by the destructor
+class npz_writer {
+ public:
+  explicit npz_writer(const char *path) noexcept
+      : fd_(open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)),
+        offset_(0),
+        status_(fd_ < 0 ? io_status::open_failed
+                        : io_status::ok) {}
+
+  npz_writer(const npz_writer &) = delete;
+  npz_writer &operator=(const npz_writer &) = delete;
+
+  ~npz_writer() noexcept {
+    if(fd_ >= 0) {
+      (void)finish();
+    }
+  }
+
+  // The first error, if any
+  [[nodiscard]] io_status status() const noexcept {
+    return status_;
+  }
+
+  // Adds arr as name.npy, which np.load gives as name
+  template <typename Array>
+  io_status add(const char *name,
+                const Array &arr) noexcept {
+    static_assert(npy_order_<Array>::supported,
+                  ".npy files must be row or column major");
+    assert(fd_ >= 0);
+    if(status_ != io_status::ok) {
+      return status_;
+    }
+    try {
+      const std::string header =
+          npy_header_string<Array>(npy_extents(arr));
+      const std::uint64_t data_bytes =
+          arr.size() * sizeof(typename Array::value_type);
+      zip_entry entry;
+      entry.name = std::string(name) + ".npy";
+      entry.bytes = header.size() + data_bytes;
+      entry.offset = offset_;
+      entry.method = 0;
+      if(entry.bytes >= zip_max_bytes ||
+         offset_ + entry.bytes >= zip_max_bytes) {
+        status_ = io_status::unsupported;
+        return status_;
+      }
+      entry.crc = crc32_update(
+          crc32_update(0, header.data(), header.size()),
+          arr.data(), data_bytes);
+
+      std::string local;
+      zip_put(local, zip_local_signature);
+      zip_put_entry(local, entry);
+      local += entry.name;
+      iovec iov[3] = {
+          {const_cast<char *>(local.data()),
+           local.size()},
+          {const_cast<char *>(header.data()),
+           header.size()},
+          {const_cast<void *>(
+               static_cast<const void *>(arr.data())),
+           data_bytes}};
+      if(!write_buffers(fd_, iov, 3)) {
+        status_ = io_status::io_failed;
+        return status_;
+      }
+      offset_ += local.size() + entry.bytes;
+      entries_.push_back(std::move(entry));
+    } catch(const std::bad_alloc &) {
+      status_ = io_status::out_of_memory;
+    }
+    return status_;
+  }
+
+  // Writes the zip central directory, and closes the file
+  io_status finish() noexcept {
+    if(fd_ < 0) {
+      return status_;
+    }
+    if(status_ == io_status::ok) {
+      try {
+        std::string directory;
+        for(const zip_entry &entry : entries_) {
+          zip_put(directory, zip_central_signature);
+          // Made by version 2.0
+          zip_put<std::uint16_t>(directory, 20);
+          zip_put_entry(directory, entry);
+          // No comment, disk 0, and no attributes
+          zip_put<std::uint16_t>(directory, 0);
+          zip_put<std::uint16_t>(directory, 0);
+          zip_put<std::uint16_t>(directory, 0);
+          zip_put<std::uint32_t>(directory, 0);
+          zip_put<std::uint32_t>(directory, entry.offset);
+          directory += entry.name;
+        }
+        const std::size_t directory_bytes =
+            directory.size();
+        zip_put(directory, zip_end_signature);
+        zip_put<std::uint16_t>(directory, 0);
+        zip_put<std::uint16_t>(directory, 0);
+        zip_put<std::uint16_t>(directory, entries_.size());
+        zip_put<std::uint16_t>(directory, entries_.size());
+        zip_put<std::uint32_t>(directory, directory_bytes);
+        zip_put<std::uint32_t>(directory, offset_);
+        zip_put<std::uint16_t>(directory, 0);
+        iovec iov = {directory.data(), directory.size()};
+        if(offset_ + directory_bytes >= zip_max_bytes) {
+          status_ = io_status::unsupported;
+        } else if(!write_buffers(fd_, &iov, 1)) {
+          status_ = io_status::io_failed;
+        }
+      } catch(const std::bad_alloc &) {
+        status_ = io_status::out_of_memory;
+      }
+    }
+    if(close(fd_) != 0 && status_ == io_status::ok) {
+      status_ = io_status::io_failed;
+    }
+    fd_ = -1;
+    return status_;
+  }
+
+ private:
+  int fd_;
+  std::uint64_t offset_;
+  io_status status_;
+  std::vector<zip_entry> entries_;
+};
+
+// Reads the arrays of an .npz archive
+class npz_reader {
+ public:
+  explicit npz_reader(const char *path) noexcept
+      : fd_(open(path, O_RDONLY)),
+        status_(fd_ < 0 ? io_status::open_failed
+                        : read_directory()) {}
+
+  npz_reader(const npz_reader &) = delete;
+  npz_reader &operator=(const npz_reader &) = delete;
+
+  ~npz_reader() noexcept {
+    if(fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  // Whether the archive's directory was read
+  [[nodiscard]] io_status status() const noexcept {
+    return status_;
+  }
+
+  // The number of arrays
+  [[nodiscard]] std::size_t size() const noexcept {
+    return entries_.size();
+  }
+
+  // The name of array i, without the .npy extension
+  [[nodiscard]] std::string name(
+      const std::size_t i) const {
+    assert(i < size());
+    const std::string &name = entries_[i].name;
+    return name.size() > 4 &&
+                   name.compare(name.size() - 4, 4,
+                                ".npy") == 0
+               ? name.substr(0, name.size() - 4)
+               : name;
+  }
+
+  [[nodiscard]] bool contains(
+      const char *name) const noexcept {
+    return find(name) != nullptr;
+  }
+
+  // Reads the array called name into arr, which must have
+  // its extents and order, and checks its CRC-32
+  template <typename Array>
+  [[nodiscard]] io_status load(const char *name,
+                               Array &arr) const noexcept {
+    std::uint64_t data_offset = 0;
+    const zip_entry *entry = nullptr;
+    const io_status status =
+        locate(name, entry, data_offset);
+    if(status != io_status::ok) {
+      return status;
+    }
+    std::uint32_t crc = 0;
+    const io_status read = read_npy(
+        fd_, data_offset, entry->bytes, arr, &crc);
+    if(read == io_status::ok && crc != entry->crc) {
+      return io_status::checksum_mismatch;
+    }
+    return read;
+  }
+
+ private:
+  [[nodiscard]] const zip_entry *find(
+      const char *name) const noexcept {
+    const std::size_t length = std::strlen(name);
+    for(const zip_entry &entry : entries_) {
+      if(entry.name.size() == length + 4 &&
+         entry.name.compare(0, length, name) == 0 &&
+         entry.name.compare(length, 4, ".npy") == 0) {
+        return &entry;
+      }
+    }
+    return nullptr;
+  }
+
+  // Finds the entry and the start of its data, after its
+  // local header
+  [[nodiscard]] io_status locate(
+      const char *name, const zip_entry *&entry,
+      std::uint64_t &data_offset) const noexcept {
+    if(status_ != io_status::ok) {
+      return status_;
+    }
+    entry = find(name);
+    if(entry == nullptr) {
+      return io_status::open_failed;
+    }
+    if(entry->method != 0) {
+      return io_status::unsupported;
+    }
+    unsigned char local[zip_local_bytes];
+    if(!read_bytes(fd_, local, sizeof(local),
+                   entry->offset) ||
+       zip_get(local, 4) != zip_local_signature) {
+      return io_status::bad_header;
+    }
+    data_offset = entry->offset + zip_local_bytes +
+                  zip_get(local + 26, 2) +
+                  zip_get(local + 28, 2);
+    return io_status::ok;
+  }
+
+  // Reads the central directory, which is found from the
+  // end record at the end of the file
+  [[nodiscard]] io_status read_directory() noexcept {
+    struct stat file_stat;
+    if(fstat(fd_, &file_stat) != 0) {
+      return io_status::io_failed;
+    }
+    const std::uint64_t file_bytes = file_stat.st_size;
+    if(file_bytes < zip_end_bytes) {
+      return io_status::bad_header;
+    }
+    try {
+      // The end record is followed by a comment of up to
+      // 64KB
+      const std::uint64_t tail_bytes =
+          std::min<std::uint64_t>(file_bytes,
+                                  zip_end_bytes + 0xFFFF);
+      std::vector<unsigned char> tail(tail_bytes);
+      if(!read_bytes(fd_, tail.data(), tail_bytes,
+                     file_bytes - tail_bytes)) {
+        return io_status::io_failed;
+      }
+      std::size_t end = tail_bytes - zip_end_bytes + 1;
+      do {
+        end--;
+      } while(end > 0 &&
+              zip_get(&tail[end], 4) != zip_end_signature);
+      if(zip_get(&tail[end], 4) != zip_end_signature) {
+        return io_status::bad_header;
+      }
+      const std::size_t entries =
+          zip_get(&tail[end + 10], 2);
+      const std::uint64_t directory_bytes =
+          zip_get(&tail[end + 12], 4);
+      const std::uint64_t directory_offset =
+          zip_get(&tail[end + 16], 4);
+      if(entries == 0xFFFF ||
+         directory_bytes == 0xFFFFFFFF ||
+         directory_offset == 0xFFFFFFFF) {
+        // zip64 archives
+        return io_status::unsupported;
+      }
+      if(directory_offset + directory_bytes > file_bytes) {
+        return io_status::truncated;
+      }
+      std::vector<unsigned char> directory(directory_bytes);
+      if(!read_bytes(fd_, directory.data(), directory_bytes,
+                     directory_offset)) {
+        return io_status::io_failed;
+      }
+      std::size_t pos = 0;
+      for(std::size_t i = 0; i < entries; i++) {
+        if(pos + zip_central_bytes > directory_bytes ||
+           zip_get(&directory[pos], 4) !=
+               zip_central_signature) {
+          return io_status::bad_header;
+        }
+        const unsigned char *fields = &directory[pos];
+        const std::size_t name_bytes =
+            zip_get(fields + 28, 2);
+        zip_entry entry;
+        entry.method = zip_get(fields + 10, 2);
+        entry.crc = zip_get(fields + 16, 4);
+        entry.bytes = zip_get(fields + 20, 4);
+        entry.offset = zip_get(fields + 42, 4);
+        if(pos + zip_central_bytes + name_bytes >
+           directory_bytes) {
+          return io_status::bad_header;
+        }
+        entry.name.assign(reinterpret_cast<const char *>(
+                              fields + zip_central_bytes),
+                          name_bytes);
+        pos += zip_central_bytes + name_bytes +
+               zip_get(fields + 30, 2) +
+               zip_get(fields + 32, 2);
+        entries_.push_back(std::move(entry));
+      }
+    } catch(const std::bad_alloc &) {
+      return io_status::out_of_memory;
+    }
+    return io_status::ok;
+  }
+
+  int fd_;
+  std::vector<zip_entry> entries_;
+  io_status status_;
+};
+
+}  // namespace ND_Array_internals_
+
+// A row major array in a memory mapped .npy file; the file
+// is read only when value_type is const
+template <typename value_type, int... Dims>
+using ND_Mapped_Npy = ND_Array_internals_::nd_mapped_array_<
+    value_type,
+    ND_Array_internals_::CT_Array<size_t, Dims...>,
+    ND_Array_internals_::row_major,
+    ND_Array_internals_::npy_format>;
+
+#endif  // _NPY_HPP_
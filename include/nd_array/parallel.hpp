@@ -0,0 +1,462 @@
+
+#ifndef _PARALLEL_HPP_
+#define _PARALLEL_HPP_
+
+#include <assert.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ct_array.hpp"
+#include "tiled_range.hpp"
+
+namespace ND_Array_internals_ {
+
+// Loops over the elements of arrays split over the threads
+// of a persistent thread pool. The elements are traversed
+// in the order of the arrays' iterators, and are split
+// into chunks of consecutive elements small enough to stay
+// in the cache while they're processed. Each chunk is
+// processed by one thread, so the loop body must only be
+// safe to call concurrently for different elements.
+//
+// With static scheduling each thread processes an equal
+// block of the chunks, which keeps the elements a thread
+// touches together; with dynamic scheduling threads claim
+// chunks as they finish their previous ones, which balances
+// loop bodies whose cost varies between elements. Work
+// stealing starts like static scheduling, and threads which
+// finish their block early take half of the remaining
+// chunks of another thread's, balancing the load while
+// keeping most of the chunks on the thread they started on
+
+enum class schedule {
+  static_chunks,
+  dynamic_chunks,
+  work_stealing
+};
+
+// Set while a thread is running tasks of a thread pool, so
+// loops nested in the tasks run serially rather than
+// waiting on the threads which are running them
+inline bool &in_thread_pool() noexcept {
+  thread_local bool inside = false;
+  return inside;
+}
+
+// The tasks of a work stealing loop which haven't been
+// started. Each thread owns a range of the tasks, initially
+// an equal block, which it takes tasks from the front of;
+// once its range is empty it steals the back half of the
+// range of another thread
+class stealing_ranges {
+ public:
+  stealing_ranges(const std::size_t tasks,
+                  const unsigned threads)
+      : ranges_(new range[threads]), threads_(threads) {
+    for(unsigned t = 0; t < threads; t++) {
+      ranges_[t].begin = tasks * t / threads;
+      ranges_[t].end = tasks * (t + 1) / threads;
+    }
+  }
+
+  // Claims the next task for thread t, returning false once
+  // every task has been claimed
+  bool next(const unsigned t, std::size_t &task) {
+    range &own = ranges_[t];
+    {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if(own.begin < own.end) {
+        task = own.begin++;
+        return true;
+      }
+    }
+    for(unsigned i = 1; i < threads_; i++) {
+      range &victim = ranges_[(t + i) % threads_];
+      // Both are locked so the stolen tasks are always in
+      // one of the ranges
+      std::scoped_lock lock(own.mutex, victim.mutex);
+      const std::size_t remaining =
+          victim.end - victim.begin;
+      if(remaining > 0) {
+        own.begin = victim.end - (remaining + 1) / 2;
+        own.end = victim.end;
+        victim.end = own.begin;
+        task = own.begin++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  // Aligned to separate the ranges' cache lines
+  struct alignas(64) range {
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+  };
+
+  std::unique_ptr<range[]> ranges_;
+  unsigned threads_;
+};
+
+class thread_pool {
+ public:
+  // threads includes the thread calling run(), so a pool
+  // of one thread runs every task on the caller. If a
+  // thread can't be started, those which were are joined
+  // before the exception is rethrown
+  explicit thread_pool(
+      const unsigned threads = std::max(
+          std::thread::hardware_concurrency(), 1u))
+      : threads_(std::max(threads, 1u)) {
+    try {
+      workers_.reserve(threads_ - 1);
+      for(unsigned t = 1; t < threads_; t++) {
+        workers_.emplace_back(&thread_pool::work, this, t);
+      }
+    } catch(...) {
+      stop();
+      throw;
+    }
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  ~thread_pool() { stop(); }
+
+  [[nodiscard]] unsigned size() const noexcept {
+    return threads_;
+  }
+
+  // Calls f(task) for every task in [0, tasks) from the
+  // threads of the pool, including the calling thread, and
+  // returns once they have all returned. Calls from tasks
+  // of a pool run serially on the calling thread. If f
+  // throws, that thread stops running tasks and the first
+  // exception is rethrown once every thread has returned;
+  // the other threads' tasks may still run
+  template <typename F>
+  void run(const std::size_t tasks, const schedule sched,
+           F &&f) {
+    if(threads_ == 1 || tasks <= 1 || in_thread_pool()) {
+      for(std::size_t task = 0; task < tasks; task++) {
+        f(task);
+      }
+      return;
+    }
+    // Only one loop at a time can use the workers
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    std::atomic<std::size_t> next(0);
+    const unsigned participants = static_cast<unsigned>(
+        std::min<std::size_t>(threads_, tasks));
+    stealing_ranges stealing(
+        sched == schedule::work_stealing ? tasks : 0,
+        participants);
+    const auto run_tasks = [&](const unsigned t) {
+      if(sched == schedule::work_stealing) {
+        std::size_t task;
+        while(stealing.next(t, task)) {
+          f(task);
+        }
+      } else if(sched == schedule::static_chunks) {
+        const std::size_t end =
+            tasks * (t + 1) / participants;
+        for(std::size_t task = tasks * t / participants;
+            task < end; task++) {
+          f(task);
+        }
+      } else {
+        for(std::size_t task = next.fetch_add(
+                std::size_t(1), std::memory_order_relaxed);
+            task < tasks;
+            task = next.fetch_add(
+                std::size_t(1),
+                std::memory_order_relaxed)) {
+          f(task);
+        }
+      }
+    };
+    // Exceptions can't leave the threads, so the first is
+    // kept to be rethrown on the calling thread
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto body = [&](const unsigned t) noexcept {
+      if(t >= participants) {
+        return;
+      }
+      try {
+        run_tasks(t);
+      } catch(...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if(error == nullptr) {
+          error = std::current_exception();
+        }
+      }
+    };
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = &call_job<decltype(body)>;
+      job_data_ = &body;
+      pending_ = threads_ - 1;
+      generation_++;
+    }
+    start_.notify_all();
+    in_thread_pool() = true;
+    body(0);
+    in_thread_pool() = false;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this]() { return pending_ == 0; });
+    }
+    if(error != nullptr) {
+      std::rethrow_exception(error);
+    }
+  }
+
+ private:
+  template <typename Body>
+  static void call_job(void *body, const unsigned t) {
+    (*static_cast<Body *>(body))(t);
+  }
+
+  // Stops the workers and waits for them to return
+  void stop() noexcept {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for(std::thread &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  void work(const unsigned t) {
+    in_thread_pool() = true;
+    std::size_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true) {
+      start_.wait(lock, [&]() {
+        return stop_ || generation_ != seen;
+      });
+      if(stop_) {
+        return;
+      }
+      seen = generation_;
+      void (*const job)(void *, unsigned) = job_;
+      void *const job_data = job_data_;
+      lock.unlock();
+      job(job_data, t);
+      lock.lock();
+      pending_--;
+      if(pending_ == 0) {
+        done_.notify_one();
+      }
+    }
+  }
+
+  unsigned threads_;
+  std::vector<std::thread> workers_;
+
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  // Incremented to start each job
+  std::size_t generation_ = 0;
+  unsigned pending_ = 0;
+  bool stop_ = false;
+  void (*job_)(void *, unsigned) = nullptr;
+  void *job_data_ = nullptr;
+};
+
+// The pool used when none is specified, with a thread for
+// each hardware thread
+inline thread_pool &default_thread_pool() {
+  static thread_pool pool;
+  return pool;
+}
+
+// The size of the chunks of elements when none is
+// specified, which fits in the L2 cache with room for the
+// other operands of a loop
+constexpr std::size_t parallel_chunk_bytes = 1 << 16;
+
+struct parallel_policy {
+  schedule sched = schedule::static_chunks;
+  // The number of elements in each chunk, or 0 to use
+  // parallel_chunk_bytes of elements
+  std::size_t chunk_size = 0;
+  // The pool to run on, or nullptr for the default pool
+  thread_pool *pool = nullptr;
+};
+
+// Splits [0, n) into chunks as specified by policy, and
+// calls f(begin, end) for each chunk from the pool
+template <typename value_type, typename F>
+void parallel_chunks(const parallel_policy &policy,
+                     const std::size_t n, F &&f) {
+  const std::size_t chunk_size =
+      policy.chunk_size != 0
+          ? policy.chunk_size
+          : std::max<std::size_t>(
+                parallel_chunk_bytes / sizeof(value_type),
+                1);
+  const std::size_t chunks =
+      (n + chunk_size - 1) / chunk_size;
+  thread_pool &pool = policy.pool != nullptr
+                          ? *policy.pool
+                          : default_thread_pool();
+  pool.run(chunks, policy.sched, [&](std::size_t chunk) {
+    const std::size_t begin = chunk * chunk_size;
+    f(begin, std::min(begin + chunk_size, n));
+  });
+}
+
+// Calls f(element) for every element of the array, which
+// may be any array, span, or view with random access
+// iterators
+template <typename Array, typename F>
+void parallel_for_each(const parallel_policy &policy,
+                       Array &&arr, F f) {
+  using value_type = typename std::remove_reference<
+      Array>::type::value_type;
+  parallel_chunks<value_type>(
+      policy, arr.size(),
+      [&](const std::size_t begin, const std::size_t end) {
+        auto itr = arr.begin() + begin;
+        for(std::size_t i = begin; i < end; i++) {
+          f(*itr);
+          ++itr;
+        }
+      });
+}
+
+template <typename Array, typename F>
+void parallel_for_each(Array &&arr, F f) {
+  parallel_for_each(parallel_policy{},
+                    std::forward<Array>(arr), f);
+}
+
+template <typename Dest_Itr, typename F,
+          typename... Src_Itrs>
+void transform_chunk(std::size_t n, Dest_Itr dest, F &f,
+                     Src_Itrs... srcs) {
+  for(; n > 0; n--) {
+    *dest = f(*srcs...);
+    ++dest;
+    (++srcs, ...);
+  }
+}
+
+template <typename Args, std::size_t... srcs>
+void parallel_transform_impl(const parallel_policy &policy,
+                             Args args,
+                             std::index_sequence<srcs...>) {
+  constexpr std::size_t num_args = std::tuple_size<Args>();
+  auto &&dest = std::get<num_args - 2>(args);
+  auto &&f = std::get<num_args - 1>(args);
+  using value_type = typename std::remove_reference<
+      decltype(dest)>::type::value_type;
+  assert(((std::get<srcs>(args).size() == dest.size()) &&
+          ...));
+  parallel_chunks<value_type>(
+      policy, dest.size(),
+      [&](const std::size_t begin, const std::size_t end) {
+        transform_chunk(
+            end - begin, dest.begin() + begin, f,
+            (std::get<srcs>(args).cbegin() + begin)...);
+      });
+}
+
+// parallel_transform(srcs..., dest, f) sets each element of
+// dest to f applied to the corresponding elements of srcs.
+// The operands are matched by their iterators, so they
+// must have the same size and layout
+template <typename... Args>
+void parallel_transform(const parallel_policy &policy,
+                        Args &&... args) {
+  static_assert(sizeof...(Args) >= 3,
+                "Expected the sources, the destination, "
+                "and the function");
+  parallel_transform_impl(
+      policy, std::forward_as_tuple(args...),
+      std::make_index_sequence<sizeof...(Args) - 2>());
+}
+
+template <
+    typename First, typename... Args,
+    typename std::enable_if<
+        !std::is_same<typename std::decay<First>::type,
+                      parallel_policy>::value,
+        int>::type = 0>
+void parallel_transform(First &&first, Args &&... args) {
+  parallel_transform(parallel_policy{},
+                     std::forward<First>(first),
+                     std::forward<Args>(args)...);
+}
+
+// Splits the indices of Array into tiles of tile_extents,
+// which are smaller on the upper edges when the extents
+// aren't multiples of them, and calls f(tile_bounds) for
+// each tile from the pool. Each tile is a task, scheduled
+// by work stealing unless the policy specifies otherwise;
+// the chunk size of the policy is unused
+template <int... tile_extents, typename Array, typename F>
+void parallel_for_tiles(const parallel_policy &policy,
+                        const Array &, F f) {
+  using DIMS = typename Array::DIMS;
+  constexpr int dims = DIMS::len();
+  static_assert(sizeof...(tile_extents) == dims,
+                "Expected a tile extent for each "
+                "dimension");
+  static_assert(((tile_extents > 0) && ...),
+                "Tiles can't be empty");
+  constexpr std::array<int, dims> tile = {tile_extents...};
+  std::array<int, dims> tiles{};
+  std::size_t num_tiles = 1;
+  for(int d = 0; d < dims; d++) {
+    const int extent = static_cast<int>(DIMS::value(d));
+    tiles[d] = (extent + tile[d] - 1) / tile[d];
+    num_tiles *= tiles[d];
+  }
+  thread_pool &pool = policy.pool != nullptr
+                          ? *policy.pool
+                          : default_thread_pool();
+  // The tiles are numbered in row major order
+  pool.run(num_tiles, policy.sched, [&](std::size_t task) {
+    tile_bounds<dims> bounds;
+    for(int d = dims - 1; d >= 0; d--) {
+      const int t = static_cast<int>(task % tiles[d]);
+      task /= tiles[d];
+      bounds.begin[d] = t * tile[d];
+      bounds.end[d] =
+          std::min(bounds.begin[d] + tile[d],
+                   static_cast<int>(DIMS::value(d)));
+    }
+    f(bounds);
+  });
+}
+
+template <int... tile_extents, typename Array, typename F>
+void parallel_for_tiles(const Array &arr, F f) {
+  parallel_for_tiles<tile_extents...>(
+      parallel_policy{schedule::work_stealing}, arr, f);
+}
+
+}  // namespace ND_Array_internals_
+
+#endif
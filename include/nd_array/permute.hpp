@@ -0,0 +1,493 @@
+
+#ifndef _PERMUTE_HPP_
+#define _PERMUTE_HPP_
+
+#include <assert.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "nd_array.hpp"
+#include "simd.hpp"
+
+namespace ND_Array_internals_ {
+
+// Reorders the axes of arrays; dimension d of the result is
+// dimension Axes[d] of the source, as with numpy.transpose.
+//
+// The copies are cache oblivious: the indices are halved
+// along their longest dimension until the pieces fit in the
+// L1 cache, so both arrays are read and written in blocks
+// which fit in each level of the cache without knowing its
+// size. Within a piece, square blocks of elements which are
+// contiguous in the source along one axis and in the
+// destination along another are transposed in registers
+
+// The pieces copied by the vector kernels; the source and
+// destination elements of a piece fit in the L1 cache
+constexpr std::size_t permute_piece_bytes = 1 << 13;
+
+// Pieces are split on multiples of this along the axes the
+// kernels transpose, so only the edges of the arrays are
+// left for the scalar loops
+constexpr std::size_t permute_split_align = 16;
+
+template <int dims>
+[[nodiscard]] constexpr bool is_permutation(
+    const std::array<int, dims> &axes) noexcept {
+  for(int d = 0; d < dims; d++) {
+    int count = 0;
+    for(int a : axes) {
+      count += (a == d);
+    }
+    if(count != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The extents of the permuted array
+template <typename Dims, int... Axes>
+struct permute_dims_ {
+  static_assert(sizeof...(Axes) == Dims::len(),
+                "Expected an axis for each dimension");
+  static_assert(is_permutation<Dims::len()>({Axes...}),
+                "The axes must be a permutation of the "
+                "dimensions");
+
+  using type =
+      CT_Array<typename Dims::FieldT, Dims::value(Axes)...>;
+};
+
+// The type of the array permute() writes Array's elements
+// into, with Array's alignment and layout
+template <typename Array, int... Axes>
+using permuted_array_t = nd_array_<
+    typename Array::value_type,
+    typename permute_dims_<typename Array::DIMS,
+                           Axes...>::type,
+    Array::alignment(), typename Array::LAYOUT>;
+
+// The strides of both arrays along each dimension of the
+// destination, and the dimensions along which they're
+// contiguous, or -1 if they aren't
+template <std::size_t dims>
+struct permute_plan_ {
+  std::array<std::ptrdiff_t, dims> src_stride;
+  std::array<std::ptrdiff_t, dims> dest_stride;
+  int src_unit;
+  int dest_unit;
+};
+
+// The lane of the concatenation of a and b which lane l of
+// the low (or high) half of interleaving them in blocks of
+// w lanes comes from
+template <std::size_t lanes, std::size_t w, bool high>
+[[nodiscard]] constexpr int interleave_lane(
+    const std::size_t l) noexcept {
+  if((l & w) == 0) {
+    return int(high ? l + w : l);
+  } else {
+    return int(high ? lanes + l : lanes + l - w);
+  }
+}
+
+// Integers of the same size as T, for shuffle masks
+template <typename T>
+using shuffle_int_t = typename std::conditional<
+    sizeof(T) == 1, signed char,
+    typename std::conditional<
+        sizeof(T) == 2, short,
+        typename std::conditional<sizeof(T) == 4, int,
+                                  long long>::type>::type>::
+    type;
+
+template <std::size_t bytes, typename T>
+using permute_vec_t = typename simd_kernels_<bytes, T>::vec;
+
+// Sets out to the blocks of w lanes taken alternately from
+// a and b, starting from the first (or second) block of
+// each. The vectors are passed by reference, as passing
+// them by value changes the ABI (-Wpsabi)
+template <std::size_t bytes, typename T, std::size_t w,
+          bool high, std::size_t... Ls>
+void interleave_blocks(
+    permute_vec_t<bytes, T> &out,
+    const permute_vec_t<bytes, T> &a,
+    const permute_vec_t<bytes, T> &b,
+    std::index_sequence<Ls...>) noexcept {
+  constexpr std::size_t lanes = sizeof...(Ls);
+#if defined(__clang__)
+  out = __builtin_shufflevector(
+      a, b, interleave_lane<lanes, w, high>(Ls)...);
+#else
+  using mask =
+      typename simd_vec_<bytes, shuffle_int_t<T>>::type;
+  out = __builtin_shuffle(
+      a, b, mask{interleave_lane<lanes, w, high>(Ls)...});
+#endif
+}
+
+// Transposes the lanes x lanes block of rows in registers,
+// by interleaving pairs of rows in blocks of 1, 2, 4, ...
+// lanes, which compiles to unpack and permute instructions
+template <std::size_t bytes, typename T, std::size_t w = 1>
+void transpose_registers(
+    permute_vec_t<bytes, T> *rows) noexcept {
+  constexpr std::size_t lanes =
+      simd_kernels_<bytes, T>::lanes;
+  constexpr auto seq = std::make_index_sequence<lanes>{};
+  if constexpr(w < lanes) {
+    for(std::size_t k = 0; k < lanes; k++) {
+      if((k & w) == 0) {
+        permute_vec_t<bytes, T> low, high;
+        interleave_blocks<bytes, T, w, false>(
+            low, rows[k], rows[k + w], seq);
+        interleave_blocks<bytes, T, w, true>(
+            high, rows[k], rows[k + w], seq);
+        rows[k] = low;
+        rows[k + w] = high;
+      }
+    }
+    transpose_registers<bytes, T, 2 * w>(rows);
+  }
+}
+
+// Whether the kernels use vectors of bytes bytes for T;
+// only the scalar loops are used for one lane and for types
+// too large for the vector extensions
+template <std::size_t bytes, typename T>
+constexpr bool permute_vectorized =
+    bytes > sizeof(T) && sizeof(T) <= 8;
+
+// Calls f(src, dest) with the offsets of every combination
+// of indices of dimensions other than skip_a and skip_b
+template <std::size_t d, std::size_t dims, typename T,
+          typename F>
+void permute_loop(const std::array<std::size_t, dims> &ext,
+                  const permute_plan_<dims> &plan,
+                  const int skip_a, const int skip_b,
+                  const T *src, T *dest, F &f) noexcept {
+  if constexpr(d == dims) {
+    f(src, dest);
+  } else if(int(d) == skip_a || int(d) == skip_b) {
+    permute_loop<d + 1>(ext, plan, skip_a, skip_b, src,
+                        dest, f);
+  } else {
+    for(std::size_t i = 0; i < ext[d]; i++) {
+      permute_loop<d + 1>(
+          ext, plan, skip_a, skip_b,
+          src + std::ptrdiff_t(i) * plan.src_stride[d],
+          dest + std::ptrdiff_t(i) * plan.dest_stride[d],
+          f);
+    }
+  }
+}
+
+// Copies a piece of a permutation
+struct permute_piece_kernel_ {
+  template <std::size_t bytes, typename T, std::size_t dims>
+  static void run(
+      const T *src, T *dest,
+      std::array<std::size_t, dims> ext,
+      const permute_plan_<dims> *plan) noexcept {
+    const int a = plan->src_unit;
+    const int b = plan->dest_unit;
+    if constexpr(permute_vectorized<bytes, T>) {
+      if(a >= 0 && b >= 0 && a != b) {
+        // Each plane of a and b is a transpose
+        auto f = [&](const T *s, T *d) {
+          transpose_plane<bytes>(s, d, ext[a], ext[b],
+                                 plan->src_stride[b],
+                                 plan->dest_stride[a]);
+        };
+        permute_loop<0>(ext, *plan, a, b, src, dest, f);
+        return;
+      }
+    }
+    const int last = int(dims) - 1;
+    const std::size_t n = ext[last];
+    const std::ptrdiff_t src_stride =
+        plan->src_stride[last];
+    const std::ptrdiff_t dest_stride =
+        plan->dest_stride[last];
+    auto f = [&](const T *s, T *d) {
+      for(std::size_t j = 0; j < n; j++) {
+        d[std::ptrdiff_t(j) * dest_stride] =
+            s[std::ptrdiff_t(j) * src_stride];
+      }
+    };
+    permute_loop<0>(ext, *plan, last, last, src, dest, f);
+  }
+
+  // Copies the elements i, j at src[i + j * src_stride] to
+  // dest[i * dest_stride + j]
+  template <std::size_t bytes, typename T>
+  static void transpose_plane(
+      const T *src, T *dest, const std::size_t n_i,
+      const std::size_t n_j,
+      const std::ptrdiff_t src_stride,
+      const std::ptrdiff_t dest_stride) noexcept {
+    using kernels = simd_kernels_<bytes, T>;
+    constexpr std::size_t lanes = kernels::lanes;
+    std::size_t j = 0;
+    for(; j + lanes <= n_j; j += lanes) {
+      std::size_t i = 0;
+      for(; i + lanes <= n_i; i += lanes) {
+        typename kernels::vec rows[lanes];
+        for(std::size_t k = 0; k < lanes; k++) {
+          kernels::load(
+              rows[k],
+              src + i + std::ptrdiff_t(j + k) * src_stride);
+        }
+        transpose_registers<bytes, T>(rows);
+        for(std::size_t m = 0; m < lanes; m++) {
+          kernels::store(dest +
+                             std::ptrdiff_t(i + m) *
+                                 dest_stride +
+                             j,
+                         rows[m]);
+        }
+      }
+      for(; i < n_i; i++) {
+        for(std::size_t k = 0; k < lanes; k++) {
+          dest[std::ptrdiff_t(i) * dest_stride + j + k] =
+              src[i + std::ptrdiff_t(j + k) * src_stride];
+        }
+      }
+    }
+    for(; j < n_j; j++) {
+      for(std::size_t i = 0; i < n_i; i++) {
+        dest[std::ptrdiff_t(i) * dest_stride + j] =
+            src[i + std::ptrdiff_t(j) * src_stride];
+      }
+    }
+  }
+};
+
+// Swaps the rows x cols block at a with the transpose of
+// the cols x rows block at b, in a matrix whose rows are
+// stride elements apart
+struct transpose_swap_kernel_ {
+  template <std::size_t bytes, typename T>
+  static void run(T *a, T *b, std::size_t rows,
+                  std::size_t cols,
+                  std::ptrdiff_t stride) noexcept {
+    std::size_t r = 0;
+    if constexpr(permute_vectorized<bytes, T>) {
+      using kernels = simd_kernels_<bytes, T>;
+      constexpr std::size_t lanes = kernels::lanes;
+      for(; r + lanes <= rows; r += lanes) {
+        std::size_t c = 0;
+        for(; c + lanes <= cols; c += lanes) {
+          T *block_a = a + std::ptrdiff_t(r) * stride + c;
+          T *block_b = b + std::ptrdiff_t(c) * stride + r;
+          typename kernels::vec rows_a[lanes];
+          typename kernels::vec rows_b[lanes];
+          for(std::size_t k = 0; k < lanes; k++) {
+            kernels::load(
+                rows_a[k],
+                block_a + std::ptrdiff_t(k) * stride);
+            kernels::load(
+                rows_b[k],
+                block_b + std::ptrdiff_t(k) * stride);
+          }
+          transpose_registers<bytes, T>(rows_a);
+          transpose_registers<bytes, T>(rows_b);
+          for(std::size_t k = 0; k < lanes; k++) {
+            kernels::store(
+                block_a + std::ptrdiff_t(k) * stride,
+                rows_b[k]);
+            kernels::store(
+                block_b + std::ptrdiff_t(k) * stride,
+                rows_a[k]);
+          }
+        }
+        swap_scalar(a, b, r, r + lanes, c, cols, stride);
+      }
+    }
+    swap_scalar(a, b, r, rows, 0, cols, stride);
+  }
+
+  template <typename T>
+  static void swap_scalar(
+      T *a, T *b, const std::size_t row_begin,
+      const std::size_t row_end,
+      const std::size_t col_begin,
+      const std::size_t col_end,
+      const std::ptrdiff_t stride) noexcept {
+    for(std::size_t r = row_begin; r < row_end; r++) {
+      for(std::size_t c = col_begin; c < col_end; c++) {
+        std::swap(a[std::ptrdiff_t(r) * stride + c],
+                  b[std::ptrdiff_t(c) * stride + r]);
+      }
+    }
+  }
+};
+
+// Runs the kernel for the widest vectors the CPU supports
+// when T is arithmetic, otherwise with scalars
+template <typename Kernel, typename T, typename... Args>
+void permute_dispatch(Args... args) noexcept {
+  if constexpr(std::is_arithmetic<T>::value) {
+    simd_dispatch<Kernel, T>(args...);
+  } else {
+    Kernel::template run<sizeof(T), T>(args...);
+  }
+}
+
+// Where to split extent elements in two
+[[nodiscard]] constexpr std::size_t permute_split(
+    const std::size_t extent) noexcept {
+  const std::size_t half = extent / 2;
+  return half >= permute_split_align
+             ? half - half % permute_split_align
+             : half;
+}
+
+template <typename T, std::size_t dims>
+void permute_recursive(
+    const T *src, T *dest,
+    std::array<std::size_t, dims> ext,
+    const permute_plan_<dims> &plan) noexcept {
+  std::size_t elems = 1;
+  std::size_t longest = 0;
+  for(std::size_t d = 0; d < dims; d++) {
+    elems *= ext[d];
+    if(ext[d] > ext[longest]) {
+      longest = d;
+    }
+  }
+  if(elems * sizeof(T) <= permute_piece_bytes ||
+     ext[longest] == 1) {
+    permute_dispatch<permute_piece_kernel_, T>(
+        src, dest, ext, &plan);
+    return;
+  }
+  const std::size_t half = permute_split(ext[longest]);
+  const std::size_t full = ext[longest];
+  ext[longest] = half;
+  permute_recursive(src, dest, ext, plan);
+  ext[longest] = full - half;
+  permute_recursive(
+      src + std::ptrdiff_t(half) * plan.src_stride[longest],
+      dest +
+          std::ptrdiff_t(half) * plan.dest_stride[longest],
+      ext, plan);
+}
+
+// Writes src into dest with its axes reordered, so that
+// dest(i_0, ..., i_n) is src(j) where j[Axes[d]] = i_d.
+// Both layouts must be strided
+template <int... Axes, typename T, typename Src_Dims,
+          std::size_t src_alignment, typename Src_Layout,
+          std::size_t dest_alignment, typename Dest_Layout>
+void permute(
+    const nd_array_<T, Src_Dims, src_alignment, Src_Layout>
+        &src,
+    nd_array_<
+        T, typename permute_dims_<Src_Dims, Axes...>::type,
+        dest_alignment, Dest_Layout> &dest) noexcept {
+  using Src_Mapping =
+      typename Src_Layout::template mapping<Src_Dims>;
+  using Dest_Mapping =
+      typename Dest_Layout::template mapping<
+          typename permute_dims_<Src_Dims, Axes...>::type>;
+  static_assert(Src_Mapping::is_strided &&
+                    Dest_Mapping::is_strided,
+                "Only strided layouts can be permuted");
+  constexpr std::size_t dims = sizeof...(Axes);
+  constexpr std::array<int, dims> axes = {Axes...};
+  assert(static_cast<const void *>(src.data()) !=
+         static_cast<const void *>(dest.data()));
+  permute_plan_<dims> plan{{}, {}, -1, -1};
+  std::array<std::size_t, dims> ext{};
+  for(std::size_t d = 0; d < dims; d++) {
+    ext[d] = Src_Dims::value(axes[d]);
+    plan.src_stride[d] = Src_Mapping::stride(axes[d]);
+    plan.dest_stride[d] = Dest_Mapping::stride(int(d));
+    if(plan.src_stride[d] == 1) {
+      plan.src_unit = int(d);
+    }
+    if(plan.dest_stride[d] == 1) {
+      plan.dest_unit = int(d);
+    }
+  }
+  permute_recursive(src.data(), dest.data(), ext, plan);
+}
+
+// Swaps the rows x cols block at a with the transpose of
+// the cols x rows block at b
+template <typename T>
+void transpose_swap(T *a, T *b, const std::size_t rows,
+                    const std::size_t cols,
+                    const std::ptrdiff_t stride) noexcept {
+  if(rows * cols * sizeof(T) <= permute_piece_bytes) {
+    permute_dispatch<transpose_swap_kernel_, T>(
+        a, b, rows, cols, stride);
+  } else if(rows >= cols) {
+    const std::size_t half = permute_split(rows);
+    transpose_swap(a, b, half, cols, stride);
+    transpose_swap(a + std::ptrdiff_t(half) * stride,
+                   b + half, rows - half, cols, stride);
+  } else {
+    const std::size_t half = permute_split(cols);
+    transpose_swap(a, b, rows, half, stride);
+    transpose_swap(a + half,
+                   b + std::ptrdiff_t(half) * stride, rows,
+                   cols - half, stride);
+  }
+}
+
+// Transposes the n x n block at a in place
+template <typename T>
+void transpose_square(
+    T *a, const std::size_t n,
+    const std::ptrdiff_t stride) noexcept {
+  if(n * n * sizeof(T) <= permute_piece_bytes) {
+    for(std::size_t r = 0; r < n; r++) {
+      for(std::size_t c = r + 1; c < n; c++) {
+        std::swap(a[std::ptrdiff_t(r) * stride + c],
+                  a[std::ptrdiff_t(c) * stride + r]);
+      }
+    }
+    return;
+  }
+  const std::size_t half = permute_split(n);
+  transpose_square(a, half, stride);
+  transpose_square(a + std::ptrdiff_t(half) * stride + half,
+                   n - half, stride);
+  transpose_swap(a + half,
+                 a + std::ptrdiff_t(half) * stride, half,
+                 n - half, stride);
+}
+
+// Transposes a square matrix in place
+template <typename T, typename Dims, std::size_t alignment,
+          typename Layout>
+void transpose(
+    nd_array_<T, Dims, alignment, Layout> &arr) noexcept {
+  using Mapping = typename Layout::template mapping<Dims>;
+  static_assert(Dims::len() == 2 &&
+                    Dims::value(0) == Dims::value(1),
+                "Only square matrices can be transposed in "
+                "place");
+  static_assert(Mapping::is_strided,
+                "Only strided layouts can be transposed");
+  // Swapping a(i, j) with a(j, i) is symmetric in the
+  // strides, so only the larger one matters
+  constexpr std::size_t stride0 = Mapping::stride(0);
+  constexpr std::size_t stride1 = Mapping::stride(1);
+  static_assert(stride0 == 1 || stride1 == 1,
+                "One of the dimensions must be contiguous");
+  transpose_square(
+      arr.data(), Dims::value(0),
+      std::ptrdiff_t(std::max(stride0, stride1)));
+}
+
+}  // namespace ND_Array_internals_
+
+#endif  // _PERMUTE_HPP_
@@ -0,0 +1,307 @@
+
+#ifndef _REDUCE_HPP_
+#define _REDUCE_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "nd_array.hpp"
+#include "simd.hpp"
+
+namespace ND_Array_internals_ {
+
+// Reductions of arrays, either to a single value or along
+// one axis, which produces an array with that axis removed.
+// The reductions use the SIMD kernels, and sums are
+// computed pairwise over contiguous runs of elements to
+// limit the accumulated rounding error.
+//
+// Passing threads > 1 splits large reductions over that
+// many threads
+
+// The operations; each combines the mapped values with
+// apply(), and finish() computes the result from the
+// combined value and the number of values
+struct reduce_sum_t : simd_add_ {
+  template <typename T>
+  static T finish(const T &val, std::size_t) noexcept {
+    return val;
+  }
+};
+
+struct reduce_mean_t : simd_add_ {
+  template <typename T>
+  static T finish(const T &val, std::size_t n) noexcept {
+    return val / static_cast<T>(n);
+  }
+};
+
+// The Euclidean norm
+struct reduce_norm_t : simd_sum_sq_ {
+  template <typename T>
+  static T finish(const T &val, std::size_t) noexcept {
+    using std::sqrt;
+    return static_cast<T>(sqrt(val));
+  }
+};
+
+struct reduce_min_t : simd_min_ {
+  template <typename T>
+  static T finish(const T &val, std::size_t) noexcept {
+    return val;
+  }
+};
+
+struct reduce_max_t : simd_max_ {
+  template <typename T>
+  static T finish(const T &val, std::size_t) noexcept {
+    return val;
+  }
+};
+
+constexpr reduce_sum_t reduce_sum{};
+constexpr reduce_mean_t reduce_mean{};
+constexpr reduce_norm_t reduce_norm{};
+constexpr reduce_min_t reduce_min{};
+constexpr reduce_max_t reduce_max{};
+
+// Reductions of arrays smaller than this aren't split over
+// threads, as starting them costs more than they save
+constexpr std::size_t parallel_reduce_min_size = 1 << 16;
+
+// Splits [0, n) into up to threads ranges, and calls
+// f(thread, begin, end) for each from its own thread
+template <typename F>
+void parallel_ranges(const std::size_t n, unsigned threads,
+                     F f) {
+  threads = static_cast<unsigned>(
+      std::min<std::size_t>(std::max(threads, 1u), n));
+  if(threads <= 1) {
+    f(0u, std::size_t(0), n);
+    return;
+  }
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for(unsigned t = 1; t < threads; t++) {
+    workers.emplace_back(f, t, n * t / threads,
+                         n * (t + 1) / threads);
+  }
+  f(0u, std::size_t(0), n / threads);
+  for(std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+// Reduces n contiguous values by splitting them in half
+// until the pieces are small enough for the SIMD kernel,
+// so the rounding error of sums grows with log(n) rather
+// than n
+constexpr std::size_t pairwise_block = 256;
+
+template <typename Op, typename T>
+[[nodiscard]] T pairwise_reduce(
+    const T *src, const std::size_t n) noexcept {
+  if(n <= pairwise_block) {
+    return simd_reduce<Op>(src, n);
+  }
+  std::size_t half =
+      n / 2 / pairwise_block * pairwise_block;
+  if(half == 0) {
+    half = pairwise_block;
+  }
+  T result = pairwise_reduce<Op>(src, half);
+  Op::apply(result,
+            pairwise_reduce<Op>(src + half, n - half));
+  return result;
+}
+
+// Reduces every element of the array to a single value
+template <typename Array, typename Op,
+          typename std::enable_if<
+              is_nd_array_<Array>::value, int>::type = 0>
+[[nodiscard]] typename Array::value_type reduce(
+    const Array &arr, Op, unsigned threads = 1) {
+  using value_type = typename Array::value_type;
+  using MAPPING = typename Array::MAPPING;
+  static_assert(Array::size() > 0,
+                "Cannot reduce an empty array");
+  // The order of the elements doesn't matter, so storage
+  // without any unused elements is reduced as if it were
+  // contiguous
+  constexpr bool dense =
+      MAPPING::storage_size() == Array::size();
+  if constexpr(!dense && !MAPPING::is_row_major) {
+    value_type result{};
+    bool first = true;
+    MAPPING::for_each_run(
+        [&](std::size_t offset, std::size_t n) {
+          const value_type run_result =
+              pairwise_reduce<Op>(arr.data() + offset, n);
+          if(first) {
+            result = run_result;
+          } else {
+            Op::apply(result, run_result);
+          }
+          first = false;
+        });
+    return Op::finish(result, Array::size());
+  }
+  if(Array::size() < parallel_reduce_min_size) {
+    threads = 1;
+  }
+  // Dense storage is split into ranges of elements, padded
+  // storage into ranges of rows
+  constexpr std::size_t run_len =
+      dense ? 1 : Array::extent(Array::dimension() - 1);
+  constexpr std::size_t runs = Array::size() / run_len;
+  std::vector<value_type> partial(
+      std::max(std::min<std::size_t>(threads, runs),
+               std::size_t(1)));
+  parallel_ranges(
+      runs, threads,
+      [&](unsigned t, std::size_t begin, std::size_t end) {
+        if constexpr(dense) {
+          partial[t] = pairwise_reduce<Op>(
+              arr.data() + begin, end - begin);
+        } else {
+          value_type result = pairwise_reduce<Op>(
+              arr.data() +
+                  MAPPING::storage_idx(begin * run_len),
+              run_len);
+          for(std::size_t row = begin + 1; row < end;
+              row++) {
+            Op::apply(
+                result,
+                pairwise_reduce<Op>(
+                    arr.data() +
+                        MAPPING::storage_idx(row * run_len),
+                    run_len));
+          }
+          partial[t] = result;
+        }
+      });
+  value_type result = partial[0];
+  for(std::size_t t = 1; t < partial.size(); t++) {
+    Op::apply(result, partial[t]);
+  }
+  return Op::finish(result, Array::size());
+}
+
+// The type of the reduction of Array along Axis
+template <int Axis, typename Array>
+using reduced_array_t = nd_array_<
+    typename Array::value_type,
+    typename remove_axis_array<Axis,
+                               typename Array::DIMS>::type>;
+
+// Reduces the array along Axis into result, whose extents
+// are those of the array with Axis removed
+template <int Axis, typename Array, typename Op,
+          typename Result,
+          typename std::enable_if<
+              is_nd_array_<Array>::value &&
+                  is_nd_array_<Result>::value,
+              int>::type = 0>
+Result &reduce(const Array &arr, Op, Result &result,
+               unsigned threads = 1) {
+  using value_type = typename Array::value_type;
+  using MAPPING = typename Array::MAPPING;
+  static_assert(Array::dimension() > 1,
+                "Use the full reduction for 1D arrays");
+  static_assert(
+      std::is_same<typename Result::DIMS,
+                   typename remove_axis_array<
+                       Axis, typename Array::DIMS>::type>::
+          value,
+      "The result must have the extents of the array "
+      "without Axis");
+  static_assert(MAPPING::is_row_major,
+                "Axis reductions need a row major layout");
+  static_assert(Result::MAPPING::is_contiguous,
+                "The result must be contiguous");
+  constexpr int last = Array::dimension() - 1;
+  constexpr std::size_t n = Array::extent(Axis);
+  constexpr std::size_t inner =
+      Axis == last
+          ? 1
+          : Array::DIMS::trailing_product(Axis + 1);
+  constexpr std::size_t outer = Array::size() / (n * inner);
+  // The length of the contiguous runs in the storage
+  constexpr std::size_t run_len =
+      MAPPING::is_contiguous ? inner
+                             : Array::extent(last);
+  if(Array::size() < parallel_reduce_min_size) {
+    threads = 1;
+  }
+  const value_type *src = arr.data();
+  value_type *dest = result.data();
+  // Each thread computes a range of the result
+  parallel_ranges(
+      outer * inner, threads,
+      [&](unsigned, std::size_t begin, std::size_t end) {
+        if constexpr(Axis == last) {
+          if(n <= pairwise_block) {
+            // The rows are short enough to reduce directly,
+            // and are evenly spaced in the storage
+            simd_reduce_rows<Op>(
+                src + MAPPING::storage_idx(begin * n),
+                MAPPING::storage_idx(n), n, end - begin,
+                dest + begin);
+          } else {
+            for(std::size_t q = begin; q < end; q++) {
+              dest[q] = pairwise_reduce<Op>(
+                  src + MAPPING::storage_idx(q * n), n);
+            }
+          }
+          for(std::size_t q = begin; q < end; q++) {
+            dest[q] = Op::finish(dest[q], n);
+          }
+        } else {
+          // Accumulates the slabs along Axis into each
+          // row of the result, with the elementwise kernel
+          for(std::size_t o = begin / inner;
+              o * inner < end; o++) {
+            const std::size_t col_begin =
+                std::max(begin, o * inner) - o * inner;
+            const std::size_t col_end =
+                std::min(end, (o + 1) * inner) - o * inner;
+            value_type *acc = dest + o * inner;
+            for(std::size_t k = 0; k < n; k++) {
+              const std::size_t slab = (o * n + k) * inner;
+              std::size_t c = col_begin;
+              while(c < col_end) {
+                const std::size_t seg_end = std::min(
+                    col_end, (c / run_len + 1) * run_len);
+                simd_accumulate<Op>(
+                    src + MAPPING::storage_idx(slab + c),
+                    acc + c, seg_end - c, k == 0);
+                c = seg_end;
+              }
+            }
+            for(std::size_t c = col_begin; c < col_end;
+                c++) {
+              acc[c] = Op::finish(acc[c], n);
+            }
+          }
+        }
+      });
+  return result;
+}
+
+template <int Axis, typename Array, typename Op,
+          typename std::enable_if<
+              is_nd_array_<Array>::value, int>::type = 0>
+[[nodiscard]] reduced_array_t<Axis, Array> reduce(
+    const Array &arr, Op op, unsigned threads = 1) {
+  reduced_array_t<Axis, Array> result;
+  reduce<Axis>(arr, op, result, threads);
+  return result;
+}
+
+}  // namespace ND_Array_internals_
+
+#endif
@@ -0,0 +1,250 @@
+
+#ifndef _RTARRAY_HPP_
+#define _RTARRAY_HPP_
+
+#include <assert.h>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace ND_Array_internals_ {
+
+// Marks a value in an RT_Array which is only known at
+// runtime
+constexpr int dynamic_extent = -1;
+
+// A list of values, some of which are known at compile time
+// and some of which (marked with dynamic_extent) are only
+// known at runtime. The compile time values are returned as
+// constants by get(), so they cost nothing in index
+// computations; only the dynamic values need to be loaded
+template <typename FieldT_, int... vals>
+class RT_Array {
+ public:
+  using FieldT = FieldT_;
+  using Self = RT_Array<FieldT, vals...>;
+
+  static_assert(sizeof...(vals) > 0,
+                "RT_Array must have at least one value");
+
+  static constexpr int len() { return sizeof...(vals); }
+
+  static constexpr int num_dynamic() {
+    return ((vals == dynamic_extent ? 1 : 0) + ...);
+  }
+
+  static constexpr bool is_static(const int idx) {
+    return static_vals_[idx] != dynamic_extent;
+  }
+
+  static constexpr bool all_static() {
+    return num_dynamic() == 0;
+  }
+
+  // The compile time value, or dynamic_extent if it's only
+  // known at runtime
+  static constexpr int static_value(const int idx) {
+    return static_vals_[idx];
+  }
+
+  // The product of the values starting at idx, or
+  // dynamic_extent if any of them are dynamic
+  static constexpr int static_trailing_product(
+      const int idx) {
+    int p = 1;
+    for(int i = idx; i < len(); i++) {
+      if(!is_static(i)) {
+        return dynamic_extent;
+      }
+      p *= static_vals_[i];
+    }
+    return p;
+  }
+
+  // Only the dynamic values are passed, in order
+  template <typename... int_t>
+  explicit constexpr RT_Array(int_t... dynamic) noexcept
+      : values_{} {
+    static_assert(sizeof...(int_t) == num_dynamic(),
+                  "Number of dynamic values is incorrect");
+    const FieldT dyn_vals[] = {
+        static_cast<FieldT>(dynamic)..., FieldT(0)};
+    int d = 0;
+    for(int i = 0; i < len(); i++) {
+      if(is_static(i)) {
+        values_[i] = static_cast<FieldT>(static_vals_[i]);
+      } else {
+        values_[i] = dyn_vals[d];
+        d++;
+      }
+    }
+  }
+
+  // Constructs the array from every value, static or not;
+  // the static values must match
+  static constexpr Self from_values(
+      const FieldT *all_values) noexcept {
+    Self arr(std::true_type{});
+    for(int i = 0; i < len(); i++) {
+      assert(!is_static(i) ||
+             all_values[i] ==
+                 static_cast<FieldT>(static_vals_[i]));
+      arr.values_[i] = all_values[i];
+    }
+    return arr;
+  }
+
+  template <int idx>
+  [[nodiscard]] constexpr FieldT get() const noexcept {
+    static_assert(idx >= 0 && idx < len(),
+                  "Index is out of bounds");
+    if constexpr(is_static(idx)) {
+      return static_cast<FieldT>(static_vals_[idx]);
+    } else {
+      return values_[idx];
+    }
+  }
+
+  [[nodiscard]] constexpr FieldT value(const int idx) const
+      noexcept {
+    assert(idx >= 0);
+    assert(idx < len());
+    return values_[idx];
+  }
+
+  [[nodiscard]] constexpr FieldT product() const noexcept {
+    FieldT p = 1;
+    for(int i = 0; i < len(); i++) {
+      p *= values_[i];
+    }
+    return p;
+  }
+
+  [[nodiscard]] constexpr const FieldT *values() const
+      noexcept {
+    return values_.data();
+  }
+
+  template <typename _FieldT, int... _vals>
+  friend class RT_Array;
+
+ private:
+  // Private so that the dynamic values can be left for
+  // from_values to fill in even when there are some
+  constexpr RT_Array(std::true_type) noexcept : values_{} {}
+
+  static constexpr std::array<int, sizeof...(vals)>
+      static_vals_{{vals...}};
+
+  std::array<FieldT, sizeof...(vals)> values_;
+};
+
+/* Type computations for RT_Arrays */
+template <int to_remove, typename array,
+          typename seq = std::make_index_sequence<
+              array::len() - to_remove>>
+struct forward_truncate_rt_array;
+
+template <int to_remove, typename FieldT, int... vals,
+          std::size_t... Is>
+struct forward_truncate_rt_array<
+    to_remove, RT_Array<FieldT, vals...>,
+    std::index_sequence<Is...>> {
+  using type = RT_Array<
+      FieldT, RT_Array<FieldT, vals...>::static_value(
+                  to_remove + Is)...>;
+};
+
+// The array with the value at index axis removed
+template <int axis, typename array,
+          typename seq =
+              std::make_index_sequence<array::len() - 1>>
+struct remove_rt_axis;
+
+template <int axis, typename FieldT, int... vals,
+          std::size_t... Is>
+struct remove_rt_axis<axis, RT_Array<FieldT, vals...>,
+                      std::index_sequence<Is...>> {
+  static_assert(axis >= 0 && axis < int(sizeof...(vals)),
+                "Axis is out of bounds");
+  using type = RT_Array<
+      FieldT,
+      RT_Array<FieldT, vals...>::static_value(
+          int(Is) < axis ? int(Is) : int(Is) + 1)...>;
+};
+
+// The array with the value at index axis only known at
+// runtime
+template <int axis, typename array,
+          typename seq =
+              std::make_index_sequence<array::len()>>
+struct make_rt_dynamic;
+
+template <int axis, typename FieldT, int... vals,
+          std::size_t... Is>
+struct make_rt_dynamic<axis, RT_Array<FieldT, vals...>,
+                       std::index_sequence<Is...>> {
+  static_assert(axis >= 0 && axis < int(sizeof...(vals)),
+                "Axis is out of bounds");
+  using type = RT_Array<
+      FieldT, int(Is) == axis
+                  ? dynamic_extent
+                  : RT_Array<FieldT, vals...>::static_value(
+                        int(Is))...>;
+};
+
+// The strides of a row major array with the given extents;
+// a stride is static whenever the extents trailing it are
+template <typename extents,
+          typename seq =
+              std::make_index_sequence<extents::len()>>
+struct row_major_strides;
+
+template <typename FieldT, int... vals, std::size_t... Is>
+struct row_major_strides<RT_Array<FieldT, vals...>,
+                         std::index_sequence<Is...>> {
+  using extents = RT_Array<FieldT, vals...>;
+  using type = RT_Array<
+      FieldT,
+      extents::static_trailing_product(Is + 1)...>;
+
+  static constexpr type compute(
+      const extents &e) noexcept {
+    FieldT strides[extents::len()] = {};
+    FieldT p = 1;
+    for(int i = extents::len() - 1; i >= 0; i--) {
+      strides[i] = p;
+      p *= e.value(i);
+    }
+    return type::from_values(strides);
+  }
+};
+
+template <std::size_t... Is, typename strides_array,
+          typename... int_t>
+constexpr std::ptrdiff_t linear_idx_impl(
+    std::index_sequence<Is...>, const strides_array &s,
+    int_t... indices) noexcept {
+  return ((static_cast<std::ptrdiff_t>(indices) *
+           static_cast<std::ptrdiff_t>(
+               s.template get<Is>())) +
+          ... + 0);
+}
+
+// The offset of an element from the sum of its indices
+// multiplied by the strides; fewer indices than strides
+// computes the offset of the start of a slice
+template <typename strides_array, typename... int_t>
+constexpr std::ptrdiff_t linear_idx(
+    const strides_array &s, int_t... indices) noexcept {
+  static_assert(sizeof...(int_t) <= strides_array::len(),
+                "Too many indices");
+  return linear_idx_impl(
+      std::make_index_sequence<sizeof...(int_t)>{}, s,
+      indices...);
+}
+
+}  // namespace ND_Array_internals_
+
+#endif
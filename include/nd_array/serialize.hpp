@@ -0,0 +1,207 @@
+
+#ifndef _SERIALIZE_HPP_
+#define _SERIALIZE_HPP_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "file_header.hpp"
+#include "nd_array.hpp"
+#include "span.hpp"
+
+namespace ND_Array_internals_ {
+
+// Saves and loads arrays as array files, which are an
+// nd_file_header followed by the array's storage. The
+// storage is written and read as a single block with no
+// conversion, so the elements go straight between the
+// array and the page cache; the files can also be opened
+// as mapped arrays. The header is checked against the
+// type of the array being loaded, and a checksum of the
+// elements detects files which were corrupted.
+// Requires POSIX
+
+// Writes the buffers in order, retrying after partial
+// writes; iov is modified
+[[nodiscard]] inline bool write_buffers(
+    const int fd, iovec *iov, int count) noexcept {
+  while(count > 0) {
+    const ssize_t written = writev(fd, iov, count);
+    if(written < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    std::size_t remaining =
+        static_cast<std::size_t>(written);
+    while(count > 0 && remaining >= iov->iov_len) {
+      remaining -= iov->iov_len;
+      iov++;
+      count--;
+    }
+    if(count > 0) {
+      iov->iov_base = static_cast<char *>(iov->iov_base) +
+                      remaining;
+      iov->iov_len -= remaining;
+    }
+  }
+  return true;
+}
+
+// Reads bytes bytes from offset, retrying after partial
+// reads
+[[nodiscard]] inline bool read_bytes(
+    const int fd, void *dest, std::size_t bytes,
+    std::uint64_t offset) noexcept {
+  char *pos = static_cast<char *>(dest);
+  while(bytes > 0) {
+    const ssize_t read = pread(fd, pos, bytes, offset);
+    if(read < 0 && errno == EINTR) {
+      continue;
+    }
+    if(read <= 0) {
+      return false;
+    }
+    pos += read;
+    bytes -= read;
+    offset += read;
+  }
+  return true;
+}
+
+// Writes bytes bytes at offset, retrying after partial
+// writes
+[[nodiscard]] inline bool write_bytes(
+    const int fd, const void *src, std::size_t bytes,
+    std::uint64_t offset) noexcept {
+  const char *pos = static_cast<const char *>(src);
+  while(bytes > 0) {
+    const ssize_t written = pwrite(fd, pos, bytes, offset);
+    if(written < 0 && errno == EINTR) {
+      continue;
+    }
+    if(written <= 0) {
+      return false;
+    }
+    pos += written;
+    bytes -= written;
+    offset += written;
+  }
+  return true;
+}
+
+// Writes the elements of arr, an nd_array_ or nd_span_, to
+// the file at path, replacing it if it exists
+template <typename Array>
+[[nodiscard]] io_status save(const Array &arr,
+                             const char *path) noexcept {
+  static_assert(is_nd_array_<Array>::value ||
+                    is_nd_span_<Array>::value,
+                "Only arrays and spans can be saved");
+  nd_file_header header = make_file_header<Array>();
+  header.flags |= nd_file_header::checksum_flag;
+  header.checksum =
+      file_checksum(arr.data(), header.data_bytes);
+  unsigned char prefix[file_data_offset()] = {};
+  std::memcpy(prefix, &header, sizeof(header));
+
+  const int fd =
+      open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0) {
+    return io_status::open_failed;
+  }
+  iovec iov[2] = {
+      {prefix, sizeof(prefix)},
+      {const_cast<void *>(
+           static_cast<const void *>(arr.data())),
+       header.data_bytes}};
+  const bool written = write_buffers(fd, iov, 2);
+  // Errors writing back the data can be reported by close
+  const bool closed = close(fd) == 0;
+  return written && closed ? io_status::ok
+                           : io_status::io_failed;
+}
+
+// Reads the elements of the array file at path into arr,
+// an nd_array_ or a span of mutable elements, after
+// checking its header matches arr's type. If the elements
+// are read and don't match the checksum, arr is left with
+// the corrupt elements and checksum_mismatch is returned
+template <typename Array>
+[[nodiscard]] io_status load(const char *path,
+                             Array &arr) noexcept {
+  static_assert(is_nd_array_<Array>::value ||
+                    is_nd_span_<Array>::value,
+                "Only arrays and spans can be loaded");
+  static_assert(
+      !std::is_const<typename Array::value_type>::value,
+      "Spans of const elements can't be loaded");
+  const int fd = open(path, O_RDONLY);
+  if(fd < 0) {
+    return io_status::open_failed;
+  }
+  struct stat file_stat;
+  nd_file_header header;
+  io_status status = io_status::ok;
+  if(fstat(fd, &file_stat) != 0) {
+    status = io_status::io_failed;
+  } else if(std::uint64_t(file_stat.st_size) <
+                sizeof(header) ||
+            !read_bytes(fd, &header, sizeof(header), 0)) {
+    status = io_status::bad_header;
+  } else {
+    status = check_file_header<Array>(header,
+                                      file_stat.st_size);
+  }
+  if(status == io_status::ok &&
+     !read_bytes(fd, arr.data(), header.data_bytes,
+                 header.data_offset)) {
+    status = io_status::io_failed;
+  }
+  close(fd);
+  if(status == io_status::ok &&
+     (header.flags & nd_file_header::checksum_flag) &&
+     file_checksum(arr.data(), header.data_bytes) !=
+         header.checksum) {
+    status = io_status::checksum_mismatch;
+  }
+  return status;
+}
+
+// Loads the array file at path into a new array, which is
+// allocated on the heap as arrays can be large. Returns
+// nullptr when it can't be loaded, with the reason in
+// status, which is out_of_memory if it can't be allocated
+template <typename Array>
+[[nodiscard]] std::unique_ptr<Array> load(
+    const char *path,
+    io_status *status = nullptr) noexcept {
+  static_assert(is_nd_array_<Array>::value,
+                "Only arrays can be allocated");
+  std::unique_ptr<Array> arr(new(std::nothrow) Array);
+  const io_status result = arr != nullptr
+                               ? load(path, *arr)
+                               : io_status::out_of_memory;
+  if(status != nullptr) {
+    *status = result;
+  }
+  if(result != io_status::ok) {
+    arr.reset();
+  }
+  return arr;
+}
+
+}  // namespace ND_Array_internals_
+
+#endif  // _SERIALIZE_HPP_
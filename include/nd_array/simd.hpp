@@ -0,0 +1,641 @@
+
+#ifndef _SIMD_HPP_
+#define _SIMD_HPP_
+
+#include <assert.h>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include "nd_array.hpp"
+
+namespace ND_Array_internals_ {
+
+// Vectorized kernels over the storage of arrays, with an
+// implementation for each x86 vector instruction set which
+// is selected at runtime from the features of the CPU, so
+// a binary built for a baseline target still uses the
+// widest registers available where it runs.
+//
+// The kernels are written once with the GCC/Clang vector
+// extensions, and compiled for each instruction set by
+// inlining them into an entry point with the corresponding
+// target attribute. Without those extensions (or on other
+// architectures) only the scalar implementation is used
+
+enum class simd_isa { scalar, sse2, avx2, avx512 };
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define ND_ARRAY_SIMD_DISPATCH 1
+#endif
+
+[[nodiscard]] inline bool simd_isa_supported(
+    const simd_isa isa) noexcept {
+#ifdef ND_ARRAY_SIMD_DISPATCH
+  __builtin_cpu_init();
+  switch(isa) {
+    case simd_isa::avx512:
+      return __builtin_cpu_supports("avx512f");
+    case simd_isa::avx2:
+      return __builtin_cpu_supports("avx2") &&
+             __builtin_cpu_supports("fma");
+    case simd_isa::sse2:
+      return __builtin_cpu_supports("sse2");
+    default:
+      return true;
+  }
+#else
+  return isa == simd_isa::scalar;
+#endif
+}
+
+// The widest instruction set supported by the CPU
+[[nodiscard]] inline simd_isa detect_simd_isa() noexcept {
+  for(simd_isa isa : {simd_isa::avx512, simd_isa::avx2,
+                      simd_isa::sse2}) {
+    if(simd_isa_supported(isa)) {
+      return isa;
+    }
+  }
+  return simd_isa::scalar;
+}
+
+// The storage for the instruction set in use
+inline simd_isa &selected_simd_isa() noexcept {
+  static simd_isa isa = detect_simd_isa();
+  return isa;
+}
+
+// The instruction set the kernels are currently using
+[[nodiscard]] inline simd_isa active_simd_isa() noexcept {
+  return selected_simd_isa();
+}
+
+// Overrides the detected instruction set, eg for testing or
+// comparing the implementations; it must be supported
+inline void set_simd_isa(const simd_isa isa) noexcept {
+  assert(simd_isa_supported(isa));
+  selected_simd_isa() = isa;
+}
+
+[[nodiscard]] constexpr const char *simd_isa_name(
+    const simd_isa isa) noexcept {
+  switch(isa) {
+    case simd_isa::avx512:
+      return "AVX512";
+    case simd_isa::avx2:
+      return "AVX2";
+    case simd_isa::sse2:
+      return "SSE2";
+    default:
+      return "Scalar";
+  }
+}
+
+// A vector of bytes bytes of T; a single T is left as a
+// scalar, as the compilers handle one element vectors
+// poorly
+template <std::size_t bytes, typename T,
+          bool scalar = (bytes == sizeof(T))>
+struct simd_vec_ {
+#if defined(__GNUC__) || defined(__clang__)
+  typedef T type __attribute__((vector_size(bytes)));
+#else
+  static_assert(scalar,
+                "Vectors require the GCC/Clang extensions");
+#endif
+};
+
+template <std::size_t bytes, typename T>
+struct simd_vec_<bytes, T, true> {
+  using type = T;
+};
+
+// The kernels, for vectors of bytes bytes; with bytes equal
+// to sizeof(T) they're the scalar implementations. Vectors
+// are only passed to and returned from functions through
+// references: these functions are compiled for the baseline
+// target, whose ABI for wider vectors differs (-Wpsabi)
+template <std::size_t bytes, typename T>
+struct simd_kernels_ {
+  static_assert(std::is_arithmetic<T>::value,
+                "SIMD kernels require arithmetic types");
+
+  using vec = typename simd_vec_<bytes, T>::type;
+  static constexpr std::size_t lanes = bytes / sizeof(T);
+
+  static void load(vec &v, const T *src) noexcept {
+    std::memcpy(&v, src, bytes);
+  }
+
+  static void store(T *dest, const vec &v) noexcept {
+    std::memcpy(dest, &v, bytes);
+  }
+
+  static void broadcast(vec &v, const T val) noexcept {
+    v = vec{} + val;
+  }
+
+  static void fill(T *dest, const std::size_t n,
+                   const T val) noexcept {
+    vec v;
+    broadcast(v, val);
+    std::size_t i = 0;
+    for(; i + lanes <= n; i += lanes) {
+      store(dest + i, v);
+    }
+    for(; i < n; i++) {
+      dest[i] = val;
+    }
+  }
+
+  static void copy(const T *src, T *dest,
+                   const std::size_t n) noexcept {
+    std::size_t i = 0;
+    for(; i + lanes <= n; i += lanes) {
+      vec v;
+      load(v, src + i);
+      store(dest + i, v);
+    }
+    for(; i < n; i++) {
+      dest[i] = src[i];
+    }
+  }
+
+  // y = a * x + y
+  static void axpy(const T a, const T *x, T *y,
+                   const std::size_t n) noexcept {
+    vec va;
+    broadcast(va, a);
+    std::size_t i = 0;
+    for(; i + lanes <= n; i += lanes) {
+      vec vx, vy;
+      load(vx, x + i);
+      load(vy, y + i);
+      vy += va * vx;
+      store(y + i, vy);
+    }
+    for(; i < n; i++) {
+      y[i] = a * x[i] + y[i];
+    }
+  }
+
+  // z = op(x, y)
+  template <typename Op>
+  static void binary(const T *x, const T *y, T *z,
+                     const std::size_t n) noexcept {
+    std::size_t i = 0;
+    for(; i + lanes <= n; i += lanes) {
+      vec vx, vy;
+      load(vx, x + i);
+      load(vy, y + i);
+      Op::apply(vx, vy);
+      store(z + i, vx);
+    }
+    for(; i < n; i++) {
+      T val = x[i];
+      Op::apply(val, y[i]);
+      z[i] = val;
+    }
+  }
+
+  // acc = op(acc, map(src)), or acc = map(src) when first
+  // is set
+  template <typename Op>
+  static void accumulate(const T *src, T *acc,
+                         const std::size_t n,
+                         const bool first) noexcept {
+    std::size_t i = 0;
+    if(first) {
+      for(; i + lanes <= n; i += lanes) {
+        vec v;
+        load(v, src + i);
+        Op::map(v);
+        store(acc + i, v);
+      }
+      for(; i < n; i++) {
+        T val = src[i];
+        Op::map(val);
+        acc[i] = val;
+      }
+    } else {
+      for(; i + lanes <= n; i += lanes) {
+        vec va, v;
+        load(va, acc + i);
+        load(v, src + i);
+        Op::map(v);
+        Op::apply(va, v);
+        store(acc + i, va);
+      }
+      for(; i < n; i++) {
+        T val = src[i];
+        Op::map(val);
+        Op::apply(acc[i], val);
+      }
+    }
+  }
+
+  // Reduces the mapped values with four independent
+  // accumulators to hide the latency of the operation; n
+  // must be positive
+  template <typename Op>
+  static T reduce(const T *src,
+                  const std::size_t n) noexcept {
+    assert(n > 0);
+    T result = src[0];
+    Op::map(result);
+    std::size_t i = 1;
+    if(n >= 4 * lanes) {
+      vec acc[4];
+      for(std::size_t a = 0; a < 4; a++) {
+        load(acc[a], src + a * lanes);
+        Op::map(acc[a]);
+      }
+      for(i = 4 * lanes; i + 4 * lanes <= n;
+          i += 4 * lanes) {
+        for(std::size_t a = 0; a < 4; a++) {
+          vec v;
+          load(v, src + i + a * lanes);
+          Op::map(v);
+          Op::apply(acc[a], v);
+        }
+      }
+      Op::apply(acc[0], acc[1]);
+      Op::apply(acc[2], acc[3]);
+      Op::apply(acc[0], acc[2]);
+      T lane_vals[lanes];
+      std::memcpy(lane_vals, &acc[0], bytes);
+      result = lane_vals[0];
+      for(std::size_t l = 1; l < lanes; l++) {
+        Op::apply(result, lane_vals[l]);
+      }
+    }
+    for(; i < n; i++) {
+      T val = src[i];
+      Op::map(val);
+      Op::apply(result, val);
+    }
+    return result;
+  }
+};
+
+// The operations, applied in place to both scalars and
+// vectors. Reductions combine the values with apply()
+// after transforming them with map()
+struct simd_op_ {
+  template <typename V>
+  static void map(V &) noexcept {}
+};
+
+struct simd_add_ : simd_op_ {
+  template <typename V>
+  static void apply(V &x, const V &y) noexcept {
+    x += y;
+  }
+};
+
+struct simd_sub_ : simd_op_ {
+  template <typename V>
+  static void apply(V &x, const V &y) noexcept {
+    x -= y;
+  }
+};
+
+struct simd_mul_ : simd_op_ {
+  template <typename V>
+  static void apply(V &x, const V &y) noexcept {
+    x *= y;
+  }
+};
+
+struct simd_div_ : simd_op_ {
+  template <typename V>
+  static void apply(V &x, const V &y) noexcept {
+    x /= y;
+  }
+};
+
+struct simd_min_ : simd_op_ {
+  template <typename V>
+  static void apply(V &x, const V &y) noexcept {
+    x = y < x ? y : x;
+  }
+};
+
+struct simd_max_ : simd_op_ {
+  template <typename V>
+  static void apply(V &x, const V &y) noexcept {
+    x = x < y ? y : x;
+  }
+};
+
+// Sums the squares of the values
+struct simd_sum_sq_ : simd_add_ {
+  template <typename V>
+  static void map(V &x) noexcept {
+    x *= x;
+  }
+};
+
+// Each kernel is a type whose run<bytes>() calls the
+// implementation, so that the entry points for each
+// instruction set can be shared
+struct simd_fill_kernel_ {
+  template <std::size_t bytes, typename T>
+  static void run(T *dest, std::size_t n, T val) noexcept {
+    simd_kernels_<bytes, T>::fill(dest, n, val);
+  }
+};
+
+struct simd_copy_kernel_ {
+  template <std::size_t bytes, typename T>
+  static void run(const T *src, T *dest,
+                  std::size_t n) noexcept {
+    simd_kernels_<bytes, T>::copy(src, dest, n);
+  }
+};
+
+struct simd_axpy_kernel_ {
+  template <std::size_t bytes, typename T>
+  static void run(T a, const T *x, T *y,
+                  std::size_t n) noexcept {
+    simd_kernels_<bytes, T>::axpy(a, x, y, n);
+  }
+};
+
+template <typename Op>
+struct simd_binary_kernel_ {
+  template <std::size_t bytes, typename T>
+  static void run(const T *x, const T *y, T *z,
+                  std::size_t n) noexcept {
+    simd_kernels_<bytes, T>::template binary<Op>(x, y, z,
+                                                 n);
+  }
+};
+
+template <typename Op>
+struct simd_accumulate_kernel_ {
+  template <std::size_t bytes, typename T>
+  static void run(const T *src, T *acc, std::size_t n,
+                  bool first) noexcept {
+    simd_kernels_<bytes, T>::template accumulate<Op>(
+        src, acc, n, first);
+  }
+};
+
+template <typename Op>
+struct simd_reduce_rows_kernel_ {
+  template <std::size_t bytes, typename T>
+  static void run(const T *src, std::size_t stride,
+                  std::size_t n, std::size_t rows,
+                  T *dest) noexcept {
+    for(std::size_t r = 0; r < rows; r++) {
+      dest[r] =
+          simd_kernels_<bytes, T>::template reduce<Op>(
+              src + r * stride, n);
+    }
+  }
+};
+
+template <typename Op>
+struct simd_reduce_kernel_ {
+  template <std::size_t bytes, typename T>
+  static T run(const T *src, std::size_t n) noexcept {
+    return simd_kernels_<bytes, T>::template reduce<Op>(src,
+                                                        n);
+  }
+};
+
+// The entry points for each instruction set. flatten
+// inlines the kernel into them, so it's compiled for their
+// target
+template <typename Kernel, typename T, typename... Args>
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((flatten))
+#endif
+auto simd_run_scalar(Args... args) noexcept {
+  return Kernel::template run<sizeof(T), T>(args...);
+}
+
+#ifdef ND_ARRAY_SIMD_DISPATCH
+template <typename Kernel, typename T, typename... Args>
+__attribute__((target("sse2"), flatten)) auto
+simd_run_sse2(Args... args) noexcept {
+  return Kernel::template run<16, T>(args...);
+}
+
+template <typename Kernel, typename T, typename... Args>
+__attribute__((target("avx2,fma"), flatten)) auto
+simd_run_avx2(Args... args) noexcept {
+  return Kernel::template run<32, T>(args...);
+}
+
+template <typename Kernel, typename T, typename... Args>
+__attribute__((target("avx512f"), flatten)) auto
+simd_run_avx512(Args... args) noexcept {
+  return Kernel::template run<64, T>(args...);
+}
+#endif
+
+template <typename Kernel, typename T, typename... Args>
+auto simd_dispatch(Args... args) noexcept {
+#ifdef ND_ARRAY_SIMD_DISPATCH
+  switch(active_simd_isa()) {
+    case simd_isa::avx512:
+      return simd_run_avx512<Kernel, T>(args...);
+    case simd_isa::avx2:
+      return simd_run_avx2<Kernel, T>(args...);
+    case simd_isa::sse2:
+      return simd_run_sse2<Kernel, T>(args...);
+    default:
+      break;
+  }
+#endif
+  return simd_run_scalar<Kernel, T>(args...);
+}
+
+/* Kernels over pointers */
+template <typename T>
+void simd_fill(T *dest, const std::size_t n,
+               const T val) noexcept {
+  simd_dispatch<simd_fill_kernel_, T>(dest, n, val);
+}
+
+template <typename T>
+void simd_copy(const T *src, T *dest,
+               const std::size_t n) noexcept {
+  simd_dispatch<simd_copy_kernel_, T>(src, dest, n);
+}
+
+template <typename T>
+void simd_axpy(const T a, const T *x, T *y,
+               const std::size_t n) noexcept {
+  simd_dispatch<simd_axpy_kernel_, T>(a, x, y, n);
+}
+
+template <typename Op, typename T>
+void simd_binary(const T *x, const T *y, T *z,
+                 const std::size_t n) noexcept {
+  simd_dispatch<simd_binary_kernel_<Op>, T>(x, y, z, n);
+}
+
+template <typename Op, typename T>
+void simd_accumulate(const T *src, T *acc,
+                     const std::size_t n,
+                     const bool first) noexcept {
+  simd_dispatch<simd_accumulate_kernel_<Op>, T>(src, acc, n,
+                                                first);
+}
+
+// Reduces each of rows runs of n values, which start stride
+// elements apart, into dest; this avoids dispatching for
+// every run when they're short
+template <typename Op, typename T>
+void simd_reduce_rows(const T *src,
+                      const std::size_t stride,
+                      const std::size_t n,
+                      const std::size_t rows,
+                      T *dest) noexcept {
+  simd_dispatch<simd_reduce_rows_kernel_<Op>, T>(
+      src, stride, n, rows, dest);
+}
+
+template <typename Op, typename T>
+[[nodiscard]] T simd_reduce(const T *src,
+                            const std::size_t n) noexcept {
+  return simd_dispatch<simd_reduce_kernel_<Op>, T>(src, n);
+}
+
+// Calls f(offset, n) for each run of n contiguous elements
+// in the storage of the array, skipping any padding
+template <typename Array, typename F>
+void for_each_storage_run(F f) noexcept {
+  Array::MAPPING::for_each_run(f);
+}
+
+template <typename Array0, typename Array1>
+constexpr void assert_same_storage() noexcept {
+  static_assert(
+      std::is_same<typename Array0::DIMS,
+                   typename Array1::DIMS>::value &&
+          std::is_same<typename Array0::LAYOUT,
+                       typename Array1::LAYOUT>::value,
+      "Arrays must have the same shape and layout");
+}
+
+/* Kernels over arrays */
+template <typename Array>
+void simd_fill(
+    Array &arr,
+    const typename Array::value_type val) noexcept {
+  for_each_storage_run<Array>(
+      [&](std::size_t offset, std::size_t n) {
+        simd_fill(arr.data() + offset, n, val);
+      });
+}
+
+template <typename Array0, typename Array1>
+void simd_copy(const Array0 &src, Array1 &dest) noexcept {
+  assert_same_storage<Array0, Array1>();
+  for_each_storage_run<Array0>(
+      [&](std::size_t offset, std::size_t n) {
+        simd_copy(src.data() + offset, dest.data() + offset,
+                  n);
+      });
+}
+
+template <typename Array0, typename Array1>
+void simd_axpy(const typename Array1::value_type a,
+               const Array0 &x, Array1 &y) noexcept {
+  assert_same_storage<Array0, Array1>();
+  for_each_storage_run<Array0>(
+      [&](std::size_t offset, std::size_t n) {
+        simd_axpy(a, x.data() + offset, y.data() + offset,
+                  n);
+      });
+}
+
+template <typename Op, typename Array0, typename Array1,
+          typename Array2>
+void simd_binary(const Array0 &x, const Array1 &y,
+                 Array2 &z) noexcept {
+  assert_same_storage<Array0, Array1>();
+  assert_same_storage<Array0, Array2>();
+  for_each_storage_run<Array0>(
+      [&](std::size_t offset, std::size_t n) {
+        simd_binary<Op>(x.data() + offset,
+                        y.data() + offset,
+                        z.data() + offset, n);
+      });
+}
+
+template <typename Op, typename Array>
+[[nodiscard]] typename Array::value_type simd_reduce(
+    const Array &arr) noexcept {
+  static_assert(Array::size() > 0,
+                "Cannot reduce an empty array");
+  typename Array::value_type result{};
+  bool first = true;
+  for_each_storage_run<Array>(
+      [&](std::size_t offset, std::size_t n) {
+        const auto run_result =
+            simd_reduce<Op>(arr.data() + offset, n);
+        if(first) {
+          result = run_result;
+        } else {
+          Op::apply(result, run_result);
+        }
+        first = false;
+      });
+  return result;
+}
+
+template <typename Array0, typename Array1, typename Array2>
+void simd_add(const Array0 &x, const Array1 &y,
+              Array2 &z) noexcept {
+  simd_binary<simd_add_>(x, y, z);
+}
+
+template <typename Array0, typename Array1, typename Array2>
+void simd_sub(const Array0 &x, const Array1 &y,
+              Array2 &z) noexcept {
+  simd_binary<simd_sub_>(x, y, z);
+}
+
+template <typename Array0, typename Array1, typename Array2>
+void simd_mul(const Array0 &x, const Array1 &y,
+              Array2 &z) noexcept {
+  simd_binary<simd_mul_>(x, y, z);
+}
+
+template <typename Array0, typename Array1, typename Array2>
+void simd_div(const Array0 &x, const Array1 &y,
+              Array2 &z) noexcept {
+  simd_binary<simd_div_>(x, y, z);
+}
+
+template <typename Array>
+[[nodiscard]] typename Array::value_type simd_min(
+    const Array &arr) noexcept {
+  return simd_reduce<simd_min_>(arr);
+}
+
+template <typename Array>
+[[nodiscard]] typename Array::value_type simd_max(
+    const Array &arr) noexcept {
+  return simd_reduce<simd_max_>(arr);
+}
+
+// The elements are summed in a different order than a
+// sequential loop, so floating point results can differ in
+// the last bits
+template <typename Array>
+[[nodiscard]] typename Array::value_type simd_sum(
+    const Array &arr) noexcept {
+  return simd_reduce<simd_add_>(arr);
+}
+
+}  // namespace ND_Array_internals_
+
+#endif
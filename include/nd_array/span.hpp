@@ -0,0 +1,378 @@
+
+#ifndef _SPAN_HPP_
+#define _SPAN_HPP_
+
+#include <assert.h>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "ct_array.hpp"
+#include "layout.hpp"
+#include "nd_array.hpp"
+#include "strided_view.hpp"
+
+namespace ND_Array_internals_ {
+
+// A non-owning view of elements in storage it doesn't own,
+// such as a buffer received from the network, an array
+// passed in from another language, or a memory mapped file.
+// The elements are laid out as in an nd_array_ with the
+// same extents, alignment, and layout, and are accessed
+// with the same API, without copying them.
+//
+// Copying a span copies the pointer rather than the
+// elements; assigning an expression writes the elements.
+// The storage must outlive the span
+template <typename value_type_, typename Dims_CT_Array,
+          std::size_t alignment_ = alignof(value_type_),
+          typename Layout_ = row_major>
+class [[nodiscard]] nd_span_ {
+ public:
+  using DIMS = Dims_CT_Array;
+  using LAYOUT = Layout_;
+  using MAPPING =
+      typename Layout_::template mapping<Dims_CT_Array>;
+
+  static_assert(alignment_ >= alignof(value_type_),
+                "Alignment is less than the natural "
+                "alignment of the value type");
+  static_assert((alignment_ & (alignment_ - 1)) == 0,
+                "Alignment must be a power of two");
+
+  using value_type = value_type_;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using pointer = value_type *;
+  using const_pointer = const value_type *;
+
+  using size_type = typename Dims_CT_Array::FieldT;
+  using difference_type = std::ptrdiff_t;
+
+  // The type of the array with this span's layout
+  using nd_array_type = nd_array_<
+      typename std::remove_const<value_type>::type,
+      Dims_CT_Array, alignment_, Layout_>;
+
+  // vals must point to storage_size() elements aligned to
+  // alignment_ bytes
+  explicit constexpr nd_span_(pointer vals) noexcept
+      : vals_(vals) {
+    assert(reinterpret_cast<std::uintptr_t>(vals) %
+               alignment_ ==
+           0);
+  }
+
+  // Spans can be taken of arrays with the same layout and
+  // at least the same alignment
+  template <typename array_value_type,
+            std::size_t array_alignment,
+            typename std::enable_if<
+                (std::is_same<array_value_type,
+                              value_type>::value ||
+                 std::is_same<const array_value_type,
+                              value_type>::value) &&
+                    array_alignment >= alignment_,
+                int>::type = 0>
+  constexpr nd_span_(
+      nd_array_<array_value_type, Dims_CT_Array,
+                array_alignment, Layout_> &arr) noexcept
+      : vals_(arr.data()) {}
+
+  template <typename array_value_type,
+            std::size_t array_alignment,
+            typename std::enable_if<
+                std::is_same<const array_value_type,
+                             value_type>::value &&
+                    array_alignment >= alignment_,
+                int>::type = 0>
+  constexpr nd_span_(
+      const nd_array_<array_value_type, Dims_CT_Array,
+                      array_alignment, Layout_>
+          &arr) noexcept
+      : vals_(arr.data()) {}
+
+  // Spans of mutable elements can be used as spans of
+  // constant elements
+  template <typename other_value_type,
+            std::size_t other_alignment,
+            typename std::enable_if<
+                std::is_same<const other_value_type,
+                             value_type>::value &&
+                    other_alignment >= alignment_,
+                int>::type = 0>
+  constexpr nd_span_(
+      const nd_span_<other_value_type, Dims_CT_Array,
+                     other_alignment, Layout_>
+          &src) noexcept
+      : vals_(src.data()) {}
+
+  // Evaluates the expression into the elements, see
+  // nd_array_::operator=
+  template <typename Expr,
+            typename std::enable_if<
+                is_nd_expr_<Expr>::value, int>::type = 0>
+  constexpr nd_span_ &operator=(const Expr &expr) noexcept {
+    static_assert(
+        std::is_same<typename Expr::DIMS, DIMS>::value,
+        "Shapes don't match");
+    const pointer dest = data();
+    for(size_type i = 0; i < size(); i++) {
+      dest[MAPPING::storage_idx(i)] = expr.eval(i);
+    }
+    return *this;
+  }
+
+  // Like pointers, the constness of a span doesn't
+  // determine the constness of its elements
+  template <typename... int_t>
+  [[nodiscard]] constexpr reference at(
+      int_t... indices) const noexcept {
+    static_assert(sizeof...(int_t) == DIMS::len(),
+                  "Number of indices passed is incorrect");
+    return vals_[MAPPING::slice_idx(indices...)];
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] constexpr reference operator()(
+      int_t... indices) const noexcept {
+    return at(indices...);
+  }
+
+  [[nodiscard]] constexpr reference front() const noexcept {
+    return vals_[0];
+  }
+
+  [[nodiscard]] constexpr reference back() const noexcept {
+    return *(end() - 1);
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] constexpr nd_span_<
+      value_type,
+      typename forward_truncate_array<sizeof...(int_t),
+                                      Dims_CT_Array>::type,
+      alignof(value_type), Layout_>
+  outer_slice(int_t... indices) const noexcept {
+    static_assert(MAPPING::is_row_major,
+                  "Outer slices need a row major layout");
+    using truncated_dims =
+        typename forward_truncate_array<sizeof...(int_t),
+                                        DIMS>::type;
+    using ret_type = nd_span_<value_type, truncated_dims,
+                              alignof(value_type), LAYOUT>;
+    return ret_type(vals_ + MAPPING::slice_idx(indices...));
+  }
+
+  // The span of the elements with the extents and layout of
+  // Reshaped_Array, which may be an nd_array_ or an
+  // nd_span_; the same restrictions on padding as
+  // nd_array_::reshape() apply
+  template <typename Reshaped_Array>
+  [[nodiscard]] constexpr nd_span_<
+      value_type, typename Reshaped_Array::DIMS, alignment_,
+      typename Reshaped_Array::LAYOUT>
+  reshape() const noexcept {
+    static_assert(Reshaped_Array::size() == size(),
+                  "Reshaped array is not the same size");
+    static_assert(
+        (MAPPING::is_contiguous &&
+         Reshaped_Array::MAPPING::is_contiguous) ||
+            (MAPPING::is_row_major &&
+             std::is_same<typename Reshaped_Array::LAYOUT,
+                          LAYOUT>::value &&
+             Reshaped_Array::extent(
+                 Reshaped_Array::dimension() - 1) ==
+                 extent(dimension() - 1)),
+        "Reshaped array has incompatible padding");
+    return nd_span_<value_type,
+                    typename Reshaped_Array::DIMS,
+                    alignment_,
+                    typename Reshaped_Array::LAYOUT>(vals_);
+  }
+
+  using strided_view_type =
+      typename static_strided_view<value_type, DIMS,
+                                   MAPPING>::type;
+
+  [[nodiscard]] constexpr strided_view_type strided_view()
+      const noexcept {
+    static_assert(MAPPING::is_strided,
+                  "This layout has no strided views");
+    return static_strided_view<value_type, DIMS,
+                               MAPPING>::make(vals_);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr
+      typename strided_view_type::template slice_type<Dim>
+      slice(const size_type idx) const noexcept {
+    return strided_view().template slice<Dim>(idx);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr typename strided_view_type::
+      template subrange_type<Dim>
+      subrange(const size_type begin,
+               const size_type end) const noexcept {
+    return strided_view().template subrange<Dim>(begin,
+                                                 end);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr
+      typename strided_view_type::template stride_type<Dim>
+      stride(const size_type step) const noexcept {
+    return strided_view().template stride<Dim>(step);
+  }
+
+  [[nodiscard]] static constexpr bool empty() noexcept {
+    return size() == 0;
+  }
+
+  [[nodiscard]] static constexpr int extent(int dim) {
+    return DIMS::value(dim);
+  }
+
+  [[nodiscard]] static constexpr size_type size() noexcept {
+    return DIMS::product();
+  }
+
+  [[nodiscard]] static constexpr size_type
+  max_size() noexcept {
+    return size();
+  }
+
+  [[nodiscard]] static constexpr size_type
+  storage_size() noexcept {
+    return MAPPING::storage_size();
+  }
+
+  [[nodiscard]] static constexpr int dimension() {
+    return DIMS::len();
+  }
+
+  [[nodiscard]] static constexpr std::size_t
+  alignment() noexcept {
+    return alignment_;
+  }
+
+  [[nodiscard]] constexpr pointer data() const noexcept {
+    return assume_aligned<alignment_>(vals_);
+  }
+
+  constexpr void fill(const_reference value) const
+      noexcept {
+    for(reference elem : (*this)) {
+      elem = value;
+    }
+  }
+
+  // Exchanges the elements of the spans
+  template <typename other_value_type,
+            std::size_t other_alignment>
+  constexpr void swap(
+      const nd_span_<other_value_type, Dims_CT_Array,
+                     other_alignment, Layout_> &rhs) const
+      noexcept {
+    iterator iter_l = begin();
+    auto iter_r = rhs.begin();
+    while(iter_l != end()) {
+      std::swap(*iter_l, *iter_r);
+      iter_l++;
+      iter_r++;
+    }
+  }
+
+  using iterator =
+      typename MAPPING::template iterator<value_type>;
+
+  [[nodiscard]] constexpr iterator begin() const noexcept {
+    return MAPPING::make_iterator(data(), 0);
+  }
+
+  [[nodiscard]] constexpr iterator end() const noexcept {
+    return MAPPING::make_iterator(data(), size());
+  }
+
+  using const_iterator =
+      typename MAPPING::template iterator<const value_type>;
+
+  [[nodiscard]] constexpr const_iterator cbegin()
+      const noexcept {
+    return MAPPING::make_iterator(
+        static_cast<const_pointer>(data()), 0);
+  }
+
+  [[nodiscard]] constexpr const_iterator cend()
+      const noexcept {
+    return MAPPING::make_iterator(
+        static_cast<const_pointer>(data()), size());
+  }
+
+  [[nodiscard]] constexpr size_type index(
+      const const_iterator &itr,
+      const typename DIMS::FieldT dim) const noexcept {
+    assert(dim < DIMS::len());
+    return MAPPING::index(itr - cbegin(), dim);
+  }
+
+  // WARNING: This function can return an invalid iterator,
+  // comparisons of the returned iterator against begin()
+  // and end() should be inequalities rather than equalities
+  template <typename... int_t>
+  [[nodiscard]] static constexpr iterator offset(
+      const iterator &origin, const int_t &... offset) {
+    static_assert(MAPPING::is_strided,
+                  "This layout can't offset iterators");
+    iterator itr_offset =
+        origin + static_cast<difference_type>(
+                     MAPPING::offset_idx(offset...));
+    return itr_offset;
+  }
+
+ private:
+  pointer vals_;
+};
+
+template <typename T>
+struct is_nd_span_ : std::false_type {};
+
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout>
+struct is_nd_span_<
+    nd_span_<value_type, Dims_CT_Array, alignment, Layout>>
+    : std::true_type {};
+
+// The span of every element of the array
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout>
+[[nodiscard]] constexpr nd_span_<value_type, Dims_CT_Array,
+                                 alignment, Layout>
+make_span(nd_array_<value_type, Dims_CT_Array, alignment,
+                    Layout> &arr) noexcept {
+  return nd_span_<value_type, Dims_CT_Array, alignment,
+                  Layout>(arr);
+}
+
+template <typename value_type, typename Dims_CT_Array,
+          std::size_t alignment, typename Layout>
+[[nodiscard]] constexpr nd_span_<
+    const value_type, Dims_CT_Array, alignment, Layout>
+make_span(const nd_array_<value_type, Dims_CT_Array,
+                          alignment, Layout>
+              &arr) noexcept {
+  return nd_span_<const value_type, Dims_CT_Array,
+                  alignment, Layout>(arr);
+}
+
+}  // namespace ND_Array_internals_
+
+// A span of row major elements with the given extents
+template <typename value_type, int... Dims>
+using ND_Span = ND_Array_internals_::nd_span_<
+    value_type,
+    ND_Array_internals_::CT_Array<size_t, Dims...>>;
+
+#endif
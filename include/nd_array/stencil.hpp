@@ -0,0 +1,528 @@
+
+#ifndef _STENCIL_HPP_
+#define _STENCIL_HPP_
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "ct_array.hpp"
+#include "nd_array.hpp"
+#include "simd.hpp"
+
+namespace ND_Array_internals_ {
+
+// Stencils compute each element of an array from the
+// elements at fixed offsets from it in another array.
+// apply_stencil() splits the indices into the interior,
+// where every neighbour in the footprint is in bounds, and
+// the boundary, which is the halo of the footprint's radius
+// along each edge. The interior is computed without any
+// bounds checks, a vector of the contiguous dimension at a
+// time; the boundary is computed with scalars, reading the
+// neighbours through the indices chosen by a boundary
+// policy:
+//
+// apply_stencil<star_stencil<2, 1>, stencil_periodic>(
+//     src, dest, [](const auto &n) {
+//       return n(-1, 0) + n(1, 0) + n(0, -1) + n(0, 1) -
+//              4.0 * n(0, 0);
+//     });
+//
+// The kernel is called with both vectors and scalars, so it
+// should be written with operators which work for both; the
+// vectors support the arithmetic operators, with vectors or
+// scalars of the element type on either side
+
+// A point of a footprint, as its offsets from the element
+// being computed in each dimension
+template <int... offsets>
+using stencil_point = CT_Array<int, offsets...>;
+
+// The offsets a stencil reads from, which determine the
+// width of the boundary
+template <typename First, typename... Points>
+struct stencil_footprint {
+  static constexpr int dims = First::len();
+
+  static_assert(((Points::len() == dims) && ...),
+                "The points must have the same number of "
+                "dimensions");
+
+  [[nodiscard]] static constexpr std::size_t
+  size() noexcept {
+    return sizeof...(Points) + 1;
+  }
+
+  // The number of neighbours read below the element in dim
+  [[nodiscard]] static constexpr int halo_low(
+      const int dim) noexcept {
+    return std::max({0, -First::value(dim),
+                     -Points::value(dim)...});
+  }
+
+  // The number of neighbours read above the element in dim
+  [[nodiscard]] static constexpr int halo_high(
+      const int dim) noexcept {
+    return std::max(
+        {0, First::value(dim), Points::value(dim)...});
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] static constexpr bool contains(
+      const int_t... offsets) noexcept {
+    const std::array<int, dims> p = {
+        static_cast<int>(offsets)...};
+    return is_point<First>(p) ||
+           (is_point<Points>(p) || ...);
+  }
+
+ private:
+  template <typename Point>
+  [[nodiscard]] static constexpr bool is_point(
+      const std::array<int, dims> &p) noexcept {
+    for(int d = 0; d < dims; d++) {
+      if(Point::value(d) != p[d]) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// The offset in dim of point i of the star of radius
+// neighbours along each axis; point 0 is the center
+template <int dims, int radius>
+[[nodiscard]] constexpr int star_offset(
+    const std::size_t i, const std::size_t dim) noexcept {
+  if(i == 0) {
+    return 0;
+  }
+  const int axis = static_cast<int>((i - 1) / (2 * radius));
+  const int step = static_cast<int>((i - 1) % (2 * radius));
+  if(axis != static_cast<int>(dim)) {
+    return 0;
+  }
+  return step < radius ? -(step + 1) : step - radius + 1;
+}
+
+// The offset in dim of point i of the box of radius
+// neighbours in every direction, in row major order
+template <int dims, int radius>
+[[nodiscard]] constexpr int box_offset(
+    const std::size_t i, const std::size_t dim) noexcept {
+  std::size_t below = 1;
+  for(int d = static_cast<int>(dim) + 1; d < dims; d++) {
+    below *= 2 * radius + 1;
+  }
+  return static_cast<int>((i / below) % (2 * radius + 1)) -
+         radius;
+}
+
+template <int dims, int radius, bool box,
+          typename Point_Seq, typename Dim_Seq>
+struct regular_stencil_;
+
+template <int dims, int radius, bool box,
+          std::size_t... Is, std::size_t... Ds>
+struct regular_stencil_<dims, radius, box,
+                        std::index_sequence<Is...>,
+                        std::index_sequence<Ds...>> {
+  template <std::size_t i>
+  using point = stencil_point<
+      (box ? box_offset<dims, radius>(i, Ds)
+           : star_offset<dims, radius>(i, Ds))...>;
+
+  using type = stencil_footprint<point<Is>...>;
+};
+
+[[nodiscard]] constexpr std::size_t stencil_pow(
+    const std::size_t base, const int exp) noexcept {
+  return exp == 0 ? 1 : base * stencil_pow(base, exp - 1);
+}
+
+// The center and its neighbours up to radius away along
+// each axis; star_stencil<2, 1> is the 5 point stencil and
+// star_stencil<3, 1> the 7 point stencil
+template <int dims, int radius>
+using star_stencil = typename regular_stencil_<
+    dims, radius, false,
+    std::make_index_sequence<2 * radius * dims + 1>,
+    std::make_index_sequence<dims>>::type;
+
+// Every neighbour up to radius away in each dimension;
+// box_stencil<3, 1> is the 27 point stencil
+template <int dims, int radius>
+using box_stencil = typename regular_stencil_<
+    dims, radius, true,
+    std::make_index_sequence<stencil_pow(2 * radius + 1,
+                                         dims)>,
+    std::make_index_sequence<dims>>::type;
+
+/* Boundary policies */
+
+// Neighbours past an edge wrap around to the other edge
+struct stencil_periodic {
+  static constexpr bool computes_boundary = true;
+
+  [[nodiscard]] static constexpr int index(
+      const int i, const int extent) noexcept {
+    return i < 0 || i >= extent
+               ? (i % extent + extent) % extent
+               : i;
+  }
+};
+
+// Neighbours past an edge are the element on the edge
+struct stencil_clamp {
+  static constexpr bool computes_boundary = true;
+
+  [[nodiscard]] static constexpr int index(
+      const int i, const int extent) noexcept {
+    return std::clamp(i, 0, extent - 1);
+  }
+};
+
+// The boundary holds ghost elements, which are set by the
+// caller, eg from a neighbouring domain; only the interior
+// of dest is written
+struct stencil_ghost {
+  static constexpr bool computes_boundary = false;
+};
+
+// A vector of the contiguous dimension, as seen by kernels
+// in the interior. It wraps the vector rather than being
+// one, as the kernels return it by value, and returning
+// vectors wider than the baseline target's registers
+// changes the ABI (-Wpsabi); structs are returned in
+// memory either way
+template <std::size_t bytes, typename T>
+struct stencil_vec_ {
+  typename simd_kernels_<bytes, T>::vec val;
+
+  [[nodiscard]] friend stencil_vec_ operator-(
+      const stencil_vec_ &x) noexcept {
+    return {-x.val};
+  }
+
+// The compound assignment and the binary operator op, with
+// vectors and scalars of T on either side
+#define ND_ARRAY_STENCIL_VEC_OPERATOR(op)                  \
+  stencil_vec_ &operator op##=(                            \
+      const stencil_vec_ &x) noexcept {                    \
+    val op## = x.val;                                      \
+    return *this;                                          \
+  }                                                        \
+                                                           \
+  stencil_vec_ &operator op##=(const T x) noexcept {       \
+    val op## = x;                                          \
+    return *this;                                          \
+  }                                                        \
+                                                           \
+  [[nodiscard]] friend stencil_vec_ operator op(           \
+      const stencil_vec_ &x,                               \
+      const stencil_vec_ &y) noexcept {                    \
+    return {x.val op y.val};                               \
+  }                                                        \
+                                                           \
+  [[nodiscard]] friend stencil_vec_ operator op(           \
+      const stencil_vec_ &x, const T y) noexcept {         \
+    return {x.val op y};                                   \
+  }                                                        \
+                                                           \
+  [[nodiscard]] friend stencil_vec_ operator op(           \
+      const T x, const stencil_vec_ &y) noexcept {         \
+    return {x op y.val};                                   \
+  }
+
+  ND_ARRAY_STENCIL_VEC_OPERATOR(+)
+  ND_ARRAY_STENCIL_VEC_OPERATOR(-)
+  ND_ARRAY_STENCIL_VEC_OPERATOR(*)
+  ND_ARRAY_STENCIL_VEC_OPERATOR(/)
+
+#undef ND_ARRAY_STENCIL_VEC_OPERATOR
+};
+
+// The neighbours of an interior element, read at constant
+// offsets from it. With bytes larger than sizeof(T) they're
+// vectors of the following elements of the contiguous
+// dimension
+template <std::size_t bytes, typename T, typename Mapping,
+          typename Footprint>
+class stencil_interior_ {
+ public:
+  static constexpr int dims = Footprint::dims;
+
+  explicit constexpr stencil_interior_(
+      const T *center) noexcept
+      : center_(center) {}
+
+  template <typename... int_t>
+  [[nodiscard]] auto operator()(
+      const int_t... offsets) const noexcept {
+    static_assert(sizeof...(int_t) == dims,
+                  "Expected an offset for each dimension");
+    assert(Footprint::contains(offsets...));
+    std::ptrdiff_t offset = 0;
+    int dim = 0;
+    ((offset += std::ptrdiff_t(offsets) * stride(dim++)),
+     ...);
+    if constexpr(bytes == sizeof(T)) {
+      return center_[offset];
+    } else {
+      stencil_vec_<bytes, T> v;
+      simd_kernels_<bytes, T>::load(v.val,
+                                    center_ + offset);
+      return v;
+    }
+  }
+
+ private:
+  [[nodiscard]] static constexpr std::ptrdiff_t stride(
+      const int dim) noexcept {
+    return static_cast<std::ptrdiff_t>(
+        Mapping::stride(dim));
+  }
+
+  const T *center_;
+};
+
+// The neighbours of a boundary element, whose indices are
+// mapped back into the array by the boundary policy
+template <typename T, typename Mapping, typename Footprint,
+          typename Boundary>
+class stencil_boundary_ {
+ public:
+  static constexpr int dims = Footprint::dims;
+
+  constexpr stencil_boundary_(
+      const T *src, const std::array<int, dims> &idx,
+      const std::array<int, dims> &extents) noexcept
+      : src_(src), idx_(idx), extents_(extents) {}
+
+  template <typename... int_t>
+  [[nodiscard]] const T &operator()(
+      const int_t... offsets) const noexcept {
+    static_assert(sizeof...(int_t) == dims,
+                  "Expected an offset for each dimension");
+    assert(Footprint::contains(offsets...));
+    std::ptrdiff_t offset = 0;
+    int dim = 0;
+    ((offset +=
+      std::ptrdiff_t(Boundary::index(
+          idx_[dim] + static_cast<int>(offsets),
+          extents_[dim])) *
+      static_cast<std::ptrdiff_t>(Mapping::stride(dim)),
+      dim++),
+     ...);
+    return src_[offset];
+  }
+
+ private:
+  const T *src_;
+  const std::array<int, dims> &idx_;
+  const std::array<int, dims> &extents_;
+};
+
+// The indices [begin, end) of each dimension in the
+// interior; inner is the contiguous dimension, which is
+// looped over innermost
+template <int dims>
+struct stencil_region_ {
+  std::array<int, dims> extents;
+  std::array<int, dims> begin;
+  std::array<int, dims> end;
+  int inner;
+
+  [[nodiscard]] constexpr bool empty() const noexcept {
+    for(int d = 0; d < dims; d++) {
+      if(begin[d] == end[d]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Calls f(idx) for the first index of each row of the
+  // inner dimension with the other indices in [lo, hi)
+  template <typename F>
+  static void for_each_row(const std::array<int, dims> &lo,
+                           const std::array<int, dims> &hi,
+                           const int inner, F &&f) {
+    std::array<int, dims> idx = lo;
+    for(int d = 0; d < dims; d++) {
+      if(d != inner && lo[d] == hi[d]) {
+        return;
+      }
+    }
+    while(true) {
+      f(idx);
+      int d = dims - 1;
+      for(; d >= 0; d--) {
+        if(d == inner) {
+          continue;
+        }
+        idx[d]++;
+        if(idx[d] < hi[d]) {
+          break;
+        }
+        idx[d] = lo[d];
+      }
+      if(d < 0) {
+        return;
+      }
+    }
+  }
+};
+
+template <typename Mapping, int dims>
+[[nodiscard]] constexpr std::ptrdiff_t stencil_storage_idx(
+    const std::array<int, dims> &idx) noexcept {
+  std::ptrdiff_t offset = 0;
+  for(int d = 0; d < dims; d++) {
+    offset += std::ptrdiff_t(idx[d]) *
+              std::ptrdiff_t(Mapping::stride(d));
+  }
+  return offset;
+}
+
+// Computes the interior a row at a time, with vectors of
+// the inner dimension and scalars for the remainder
+template <typename Mapping, typename Footprint>
+struct stencil_interior_kernel_ {
+  static constexpr int dims = Footprint::dims;
+
+  template <std::size_t bytes, typename T, typename F>
+  static void run(const T *src, T *dest,
+                  const stencil_region_<dims> *region,
+                  const F *kernel) noexcept {
+    using vec_access =
+        stencil_interior_<bytes, T, Mapping, Footprint>;
+    using scalar_access =
+        stencil_interior_<sizeof(T), T, Mapping, Footprint>;
+    constexpr std::size_t lanes = bytes / sizeof(T);
+    const int inner = region->inner;
+    const std::ptrdiff_t n =
+        region->end[inner] - region->begin[inner];
+    stencil_region_<dims>::for_each_row(
+        region->begin, region->end, inner,
+        [=](const std::array<int, dims> &idx) {
+          const std::ptrdiff_t row =
+              stencil_storage_idx<Mapping, dims>(idx);
+          const T *s = src + row;
+          T *d = dest + row;
+          std::ptrdiff_t k = 0;
+          if constexpr(lanes > 1) {
+            for(; k + std::ptrdiff_t(lanes) <= n;
+                k += lanes) {
+              simd_kernels_<bytes, T>::store(
+                  d + k, (*kernel)(vec_access(s + k)).val);
+            }
+          }
+          for(; k < n; k++) {
+            d[k] = (*kernel)(scalar_access(s + k));
+          }
+        });
+  }
+};
+
+// Applies kernel to the neighbourhood of every element of
+// src in Footprint, writing the results to the same
+// elements of dest, which must be a different array. The
+// layout must be strided, and the interior is vectorized
+// when a dimension is contiguous
+template <typename Footprint,
+          typename Boundary = stencil_ghost,
+          typename T, typename Dims,
+          std::size_t src_alignment,
+          std::size_t dest_alignment, typename Layout,
+          typename F>
+void apply_stencil(
+    const nd_array_<T, Dims, src_alignment, Layout> &src,
+    nd_array_<T, Dims, dest_alignment, Layout> &dest,
+    const F &kernel) noexcept {
+  using array_t =
+      nd_array_<T, Dims, src_alignment, Layout>;
+  using mapping = typename array_t::MAPPING;
+  constexpr int dims = Dims::len();
+  static_assert(mapping::is_strided,
+                "Stencils require a strided layout");
+  static_assert(Footprint::dims == dims,
+                "The footprint must have the dimensions of "
+                "the array");
+  assert(static_cast<const void *>(src.data()) !=
+         static_cast<const void *>(dest.data()));
+
+  stencil_region_<dims> region;
+  region.inner = dims - 1;
+  for(int d = 0; d < dims; d++) {
+    region.extents[d] = Dims::value(d);
+    region.begin[d] =
+        std::min(Footprint::halo_low(d), region.extents[d]);
+    region.end[d] = std::max(
+        region.begin[d],
+        region.extents[d] - Footprint::halo_high(d));
+    if(mapping::stride(d) == 1) {
+      region.inner = d;
+    }
+  }
+
+  const T *s = src.data();
+  T *d = dest.data();
+  if(!region.empty()) {
+    using interior_kernel =
+        stencil_interior_kernel_<mapping, Footprint>;
+    if constexpr(std::is_arithmetic<T>::value) {
+      simd_dispatch<interior_kernel, T>(s, d, &region,
+                                        &kernel);
+    } else {
+      interior_kernel::template run<sizeof(T), T>(
+          s, d, &region, &kernel);
+    }
+  }
+
+  if constexpr(Boundary::computes_boundary) {
+    using boundary_access =
+        stencil_boundary_<T, mapping, Footprint, Boundary>;
+    const int inner = region.inner;
+    // Computes the elements [begin, end) of the row
+    const auto boundary_run =
+        [&](std::array<int, dims> idx, const int begin,
+            const int end) {
+          const boundary_access access(s, idx,
+                                       region.extents);
+          for(idx[inner] = begin; idx[inner] < end;
+              idx[inner]++) {
+            d[stencil_storage_idx<mapping, dims>(idx)] =
+                kernel(access);
+          }
+        };
+    const std::array<int, dims> zeros{};
+    stencil_region_<dims>::for_each_row(
+        zeros, region.extents, inner,
+        [&](const std::array<int, dims> &idx) {
+          bool interior_row = true;
+          for(int dim = 0; dim < dims; dim++) {
+            if(dim != inner &&
+               (idx[dim] < region.begin[dim] ||
+                idx[dim] >= region.end[dim])) {
+              interior_row = false;
+            }
+          }
+          if(interior_row) {
+            boundary_run(idx, 0, region.begin[inner]);
+            boundary_run(idx, region.end[inner],
+                         region.extents[inner]);
+          } else {
+            boundary_run(idx, 0, region.extents[inner]);
+          }
+        });
+  }
+}
+
+}  // namespace ND_Array_internals_
+
+#endif  // _STENCIL_HPP_
@@ -0,0 +1,626 @@
+
+#ifndef _STRIDED_VIEW_HPP_
+#define _STRIDED_VIEW_HPP_
+
+#include <assert.h>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "rt_array.hpp"
+
+namespace ND_Array_internals_ {
+
+// Iterates over the elements of a strided view in row major
+// order. The index of each dimension but the first is
+// tracked, so a step is a single add unless it ends a row,
+// in which case it carries into the previous dimension
+template <typename value_type_, typename Extents_RT_Array,
+          typename Strides_RT_Array>
+class strided_iterator {
+ public:
+  using EXTENTS = Extents_RT_Array;
+  using STRIDES = Strides_RT_Array;
+
+  using value_type =
+      typename std::remove_cv<value_type_>::type;
+  using reference = value_type_ &;
+  using pointer = value_type_ *;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+
+  constexpr strided_iterator() noexcept
+      : base_(nullptr),
+        ptr_(nullptr),
+        pos_(0),
+        extents_(static_values<EXTENTS>()),
+        strides_(static_values<STRIDES>()),
+        idx_{} {}
+
+  // pos is the index of the element in row major order
+  constexpr strided_iterator(
+      pointer base, const EXTENTS &extents,
+      const STRIDES &strides,
+      const difference_type pos) noexcept
+      : base_(base),
+        ptr_(base),
+        pos_(0),
+        extents_(extents),
+        strides_(strides),
+        idx_{} {
+    seek(pos);
+  }
+
+  // Allows converting iterators to const_iterators
+  template <typename other_value_type,
+            typename std::enable_if<
+                std::is_same<const other_value_type,
+                             value_type_>::value,
+                int>::type = 0>
+  constexpr strided_iterator(
+      const strided_iterator<other_value_type, EXTENTS,
+                             STRIDES> &src) noexcept
+      : base_(src.base_),
+        ptr_(src.ptr_),
+        pos_(src.pos_),
+        extents_(src.extents_),
+        strides_(src.strides_),
+        idx_(src.idx_) {}
+
+  [[nodiscard]] constexpr reference operator*() const
+      noexcept {
+    return *ptr_;
+  }
+
+  [[nodiscard]] constexpr pointer operator->() const
+      noexcept {
+    return ptr_;
+  }
+
+  [[nodiscard]] constexpr reference operator[](
+      const difference_type n) const noexcept {
+    return *(*this + n);
+  }
+
+  constexpr strided_iterator &operator++() noexcept {
+    ++pos_;
+    increment<last_>();
+    return *this;
+  }
+
+  constexpr strided_iterator &operator--() noexcept {
+    --pos_;
+    decrement<last_>();
+    return *this;
+  }
+
+  constexpr strided_iterator operator++(int) noexcept {
+    const auto copy = *this;
+    ++(*this);
+    return copy;
+  }
+
+  constexpr strided_iterator operator--(int) noexcept {
+    const auto copy = *this;
+    --(*this);
+    return copy;
+  }
+
+  constexpr strided_iterator &operator+=(
+      const difference_type n) noexcept {
+    seek(pos_ + n);
+    return *this;
+  }
+
+  constexpr strided_iterator &operator-=(
+      const difference_type n) noexcept {
+    seek(pos_ - n);
+    return *this;
+  }
+
+  [[nodiscard]] constexpr strided_iterator operator+(
+      const difference_type n) const noexcept {
+    strided_iterator sum = *this;
+    sum += n;
+    return sum;
+  }
+
+  [[nodiscard]] constexpr strided_iterator operator-(
+      const difference_type n) const noexcept {
+    strided_iterator diff = *this;
+    diff -= n;
+    return diff;
+  }
+
+  [[nodiscard]] friend constexpr strided_iterator operator+(
+      const difference_type n,
+      const strided_iterator &itr) noexcept {
+    return itr + n;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr difference_type operator-(
+      const strided_iterator<other_value_type, EXTENTS,
+                             STRIDES> &rhs) const noexcept {
+    return pos_ - rhs.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator==(
+      const strided_iterator<other_value_type, EXTENTS,
+                             STRIDES> &cmp) const noexcept {
+    return pos_ == cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator!=(
+      const strided_iterator<other_value_type, EXTENTS,
+                             STRIDES> &cmp) const noexcept {
+    return pos_ != cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator<(
+      const strided_iterator<other_value_type, EXTENTS,
+                             STRIDES> &cmp) const noexcept {
+    return pos_ < cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator<=(
+      const strided_iterator<other_value_type, EXTENTS,
+                             STRIDES> &cmp) const noexcept {
+    return pos_ <= cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator>(
+      const strided_iterator<other_value_type, EXTENTS,
+                             STRIDES> &cmp) const noexcept {
+    return pos_ > cmp.pos_;
+  }
+
+  template <typename other_value_type>
+  [[nodiscard]] constexpr bool operator>=(
+      const strided_iterator<other_value_type, EXTENTS,
+                             STRIDES> &cmp) const noexcept {
+    return pos_ >= cmp.pos_;
+  }
+
+  template <typename _value_type,
+            typename _Extents_RT_Array,
+            typename _Strides_RT_Array>
+  friend class strided_iterator;
+
+ private:
+  static constexpr int last_ = EXTENTS::len() - 1;
+
+  // The array with its dynamic values set to 0
+  template <typename array>
+  static constexpr array static_values() noexcept {
+    typename array::FieldT vals[array::len()] = {};
+    for(int i = 0; i < array::len(); i++) {
+      if(array::is_static(i)) {
+        vals[i] = static_cast<typename array::FieldT>(
+            array::static_value(i));
+      }
+    }
+    return array::from_values(vals);
+  }
+
+  template <int dim>
+  constexpr difference_type extent() const noexcept {
+    return static_cast<difference_type>(
+        extents_.template get<dim>());
+  }
+
+  template <int dim>
+  constexpr difference_type stride() const noexcept {
+    return static_cast<difference_type>(
+        strides_.template get<dim>());
+  }
+
+  template <int dim>
+  constexpr void increment() noexcept {
+    ptr_ += stride<dim>();
+    if constexpr(dim > 0) {
+      idx_[dim]++;
+      if(idx_[dim] == extent<dim>()) {
+        idx_[dim] = 0;
+        ptr_ -= extent<dim>() * stride<dim>();
+        increment<dim - 1>();
+      }
+    }
+  }
+
+  template <int dim>
+  constexpr void decrement() noexcept {
+    if constexpr(dim > 0) {
+      if(idx_[dim] == 0) {
+        idx_[dim] = extent<dim>();
+        ptr_ += extent<dim>() * stride<dim>();
+        decrement<dim - 1>();
+      }
+      idx_[dim]--;
+    }
+    ptr_ -= stride<dim>();
+  }
+
+  constexpr void seek(const difference_type pos) noexcept {
+    pos_ = pos;
+    ptr_ = base_;
+    difference_type rem = pos;
+    for(int d = last_; d >= 0; d--) {
+      const difference_type ext =
+          static_cast<difference_type>(extents_.value(d));
+      // Views with an empty dimension only have position 0
+      idx_[d] = (d == 0 || ext == 0) ? rem : rem % ext;
+      rem = ext == 0 ? 0 : rem / ext;
+      ptr_ += idx_[d] * static_cast<difference_type>(
+                            strides_.value(d));
+    }
+  }
+
+  pointer base_;
+  pointer ptr_;
+  // The index of the element in row major order
+  difference_type pos_;
+  EXTENTS extents_;
+  STRIDES strides_;
+  std::array<difference_type, EXTENTS::len()> idx_;
+};
+
+// A non-owning view of elements which are evenly spaced
+// along each dimension, such as a slice through any
+// dimension of an array, a subrange of one, or every n'th
+// element of one. Extents and strides which are known at
+// compile time are kept in the type, so a view of an
+// nd_array_ is indexed with the same multiply-adds as the
+// array unless it was taken with a runtime step.
+//
+// Taking a view never copies the elements, and views of
+// views can be taken to combine them
+template <typename value_type_, typename Extents_RT_Array,
+          typename Strides_RT_Array>
+class [[nodiscard]] nd_strided_view_ {
+ public:
+  using EXTENTS = Extents_RT_Array;
+  using STRIDES = Strides_RT_Array;
+
+  static_assert(EXTENTS::len() == STRIDES::len(),
+                "Every dimension needs a stride");
+
+  using value_type = value_type_;
+  using reference = value_type &;
+  using const_reference = const value_type &;
+  using pointer = value_type *;
+  using const_pointer = const value_type *;
+
+  using size_type = typename Extents_RT_Array::FieldT;
+  using difference_type = std::ptrdiff_t;
+
+  // The types of the views returned by slice<Dim>(),
+  // subrange<Dim>() and stride<Dim>()
+  template <int Dim, typename view_value_type = value_type>
+  using slice_type = nd_strided_view_<
+      view_value_type,
+      typename remove_rt_axis<Dim, EXTENTS>::type,
+      typename remove_rt_axis<Dim, STRIDES>::type>;
+
+  template <int Dim, typename view_value_type = value_type>
+  using subrange_type = nd_strided_view_<
+      view_value_type,
+      typename make_rt_dynamic<Dim, EXTENTS>::type,
+      STRIDES>;
+
+  template <int Dim, typename view_value_type = value_type>
+  using stride_type = nd_strided_view_<
+      view_value_type,
+      typename make_rt_dynamic<Dim, EXTENTS>::type,
+      typename make_rt_dynamic<Dim, STRIDES>::type>;
+
+  constexpr nd_strided_view_(
+      pointer vals, const EXTENTS &extents,
+      const STRIDES &strides) noexcept
+      : vals_(vals), extents_(extents), strides_(strides) {}
+
+  // Views of mutable elements can be used as views of
+  // constant elements
+  template <typename other_value_type,
+            typename std::enable_if<
+                std::is_same<const other_value_type,
+                             value_type>::value,
+                int>::type = 0>
+  constexpr nd_strided_view_(
+      const nd_strided_view_<other_value_type, EXTENTS,
+                             STRIDES> &src) noexcept
+      : vals_(src.vals_),
+        extents_(src.extents_),
+        strides_(src.strides_) {}
+
+  template <typename... int_t>
+  [[nodiscard]] constexpr const_reference at(
+      int_t... indices) const noexcept {
+    static_assert(sizeof...(int_t) == EXTENTS::len(),
+                  "Number of indices passed is incorrect");
+    assert(in_bounds(indices...));
+    return vals_[linear_idx(strides_, indices...)];
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] constexpr reference at(
+      int_t... indices) noexcept {
+    static_assert(sizeof...(int_t) == EXTENTS::len(),
+                  "Number of indices passed is incorrect");
+    assert(in_bounds(indices...));
+    return vals_[linear_idx(strides_, indices...)];
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] constexpr reference operator()(
+      int_t... indices) noexcept {
+    return at(indices...);
+  }
+
+  template <typename... int_t>
+  [[nodiscard]] constexpr const_reference operator()(
+      int_t... indices) const noexcept {
+    return at(indices...);
+  }
+
+  // The view with Dim fixed at idx, which has one fewer
+  // dimension
+  template <int Dim>
+  [[nodiscard]] constexpr slice_type<Dim> slice(
+      const size_type idx) noexcept {
+    return make_slice<slice_type<Dim>, Dim>(idx);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr slice_type<Dim, const value_type>
+  slice(const size_type idx) const noexcept {
+    return make_slice<slice_type<Dim, const value_type>,
+                      Dim>(idx);
+  }
+
+  // The view of the indices [begin, end) of Dim
+  template <int Dim>
+  [[nodiscard]] constexpr subrange_type<Dim> subrange(
+      const size_type begin, const size_type end) noexcept {
+    return make_subrange<subrange_type<Dim>, Dim>(begin,
+                                                  end);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr subrange_type<Dim,
+                                        const value_type>
+  subrange(const size_type begin, const size_type end) const
+      noexcept {
+    return make_subrange<
+        subrange_type<Dim, const value_type>, Dim>(begin,
+                                                   end);
+  }
+
+  // The view of every step'th index of Dim, starting at 0
+  template <int Dim>
+  [[nodiscard]] constexpr stride_type<Dim> stride(
+      const size_type step) noexcept {
+    return make_stride<stride_type<Dim>, Dim>(step);
+  }
+
+  template <int Dim>
+  [[nodiscard]] constexpr stride_type<Dim, const value_type>
+  stride(const size_type step) const noexcept {
+    return make_stride<stride_type<Dim, const value_type>,
+                       Dim>(step);
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  [[nodiscard]] constexpr size_type extent(
+      const int dim) const noexcept {
+    return extents_.value(dim);
+  }
+
+  // The distance in elements between consecutive indices
+  // of dim
+  [[nodiscard]] constexpr size_type stride(
+      const int dim) const noexcept {
+    return strides_.value(dim);
+  }
+
+  [[nodiscard]] constexpr size_type size() const noexcept {
+    return extents_.product();
+  }
+
+  [[nodiscard]] static constexpr int dimension() {
+    return EXTENTS::len();
+  }
+
+  [[nodiscard]] constexpr const EXTENTS &extents() const
+      noexcept {
+    return extents_;
+  }
+
+  [[nodiscard]] constexpr const STRIDES &strides() const
+      noexcept {
+    return strides_;
+  }
+
+  // The first element of the view
+  [[nodiscard]] constexpr pointer data() noexcept {
+    return vals_;
+  }
+
+  [[nodiscard]] constexpr const_pointer data() const
+      noexcept {
+    return vals_;
+  }
+
+  constexpr void fill(const_reference value) noexcept {
+    for(reference elem : (*this)) {
+      elem = value;
+    }
+  }
+
+  using iterator =
+      strided_iterator<value_type, EXTENTS, STRIDES>;
+
+  [[nodiscard]] constexpr iterator begin() noexcept {
+    return iterator(vals_, extents_, strides_, 0);
+  }
+
+  [[nodiscard]] constexpr iterator end() noexcept {
+    return iterator(vals_, extents_, strides_, size());
+  }
+
+  using const_iterator =
+      strided_iterator<const value_type, EXTENTS, STRIDES>;
+
+  [[nodiscard]] constexpr const_iterator begin() const
+      noexcept {
+    return cbegin();
+  }
+
+  [[nodiscard]] constexpr const_iterator end() const
+      noexcept {
+    return cend();
+  }
+
+  [[nodiscard]] constexpr const_iterator cbegin() const
+      noexcept {
+    return const_iterator(vals_, extents_, strides_, 0);
+  }
+
+  [[nodiscard]] constexpr const_iterator cend() const
+      noexcept {
+    return const_iterator(vals_, extents_, strides_,
+                          size());
+  }
+
+  template <typename _value_type,
+            typename _Extents_RT_Array,
+            typename _Strides_RT_Array>
+  friend class nd_strided_view_;
+
+ private:
+  template <typename ret_type, int Dim>
+  constexpr ret_type make_slice(
+      const size_type idx) const noexcept {
+    static_assert(EXTENTS::len() > 1,
+                  "Cannot slice a 1D view");
+    assert(idx < extents_.template get<Dim>());
+    size_type extents[EXTENTS::len()] = {};
+    size_type strides[EXTENTS::len()] = {};
+    for(int d = 0, r = 0; d < EXTENTS::len(); d++) {
+      if(d != Dim) {
+        extents[r] = extents_.value(d);
+        strides[r] = strides_.value(d);
+        r++;
+      }
+    }
+    return ret_type(
+        vals_ + idx * strides_.template get<Dim>(),
+        ret_type::EXTENTS::from_values(extents),
+        ret_type::STRIDES::from_values(strides));
+  }
+
+  template <typename ret_type, int Dim>
+  constexpr ret_type make_subrange(
+      const size_type begin, const size_type end) const
+      noexcept {
+    assert(begin <= end);
+    assert(end <= extents_.template get<Dim>());
+    size_type extents[EXTENTS::len()] = {};
+    for(int d = 0; d < EXTENTS::len(); d++) {
+      extents[d] = extents_.value(d);
+    }
+    extents[Dim] = end - begin;
+    return ret_type(
+        vals_ + begin * strides_.template get<Dim>(),
+        ret_type::EXTENTS::from_values(extents), strides_);
+  }
+
+  template <typename ret_type, int Dim>
+  constexpr ret_type make_stride(
+      const size_type step) const noexcept {
+    assert(step > 0);
+    size_type extents[EXTENTS::len()] = {};
+    size_type strides[EXTENTS::len()] = {};
+    for(int d = 0; d < EXTENTS::len(); d++) {
+      extents[d] = extents_.value(d);
+      strides[d] = strides_.value(d);
+    }
+    extents[Dim] = (extents[Dim] + step - 1) / step;
+    strides[Dim] *= step;
+    return ret_type(
+        vals_, ret_type::EXTENTS::from_values(extents),
+        ret_type::STRIDES::from_values(strides));
+  }
+
+  template <std::size_t... Is, typename... int_t>
+  constexpr bool in_bounds_impl(std::index_sequence<Is...>,
+                                int_t... indices) const
+      noexcept {
+    return ((static_cast<difference_type>(indices) >= 0 &&
+             static_cast<size_type>(indices) <
+                 extents_.template get<Is>()) &&
+            ... && true);
+  }
+
+  template <typename... int_t>
+  constexpr bool in_bounds(int_t... indices) const
+      noexcept {
+    return in_bounds_impl(
+        std::make_index_sequence<sizeof...(int_t)>{},
+        indices...);
+  }
+
+  pointer vals_;
+  EXTENTS extents_;
+  STRIDES strides_;
+};
+
+// The stride of dim in Mapping; layouts without strides
+// have views with placeholder strides, which can't be taken
+template <typename Mapping>
+constexpr int static_stride(const int dim) noexcept {
+  if constexpr(Mapping::is_strided) {
+    return static_cast<int>(Mapping::stride(dim));
+  } else {
+    return 0;
+  }
+}
+
+// The type of the view of every element of an array with
+// static extents Dims, stored with the strides of Mapping
+template <typename value_type, typename Dims,
+          typename Mapping,
+          typename seq = std::make_index_sequence<
+              std::size_t(Dims::len())>>
+struct static_strided_view;
+
+template <typename value_type, typename Dims,
+          typename Mapping, std::size_t... Is>
+struct static_strided_view<value_type, Dims, Mapping,
+                           std::index_sequence<Is...>> {
+  using type = nd_strided_view_<
+      value_type,
+      RT_Array<typename Dims::FieldT,
+               int(Dims::value(int(Is)))...>,
+      RT_Array<typename Dims::FieldT,
+               static_stride<Mapping>(int(Is))...>>;
+
+  static constexpr type make(value_type *vals) noexcept {
+    return type(vals, typename type::EXTENTS(),
+                typename type::STRIDES());
+  }
+};
+
+}  // namespace ND_Array_internals_
+
+#endif
@@ -0,0 +1,196 @@
+
+#ifndef _TILED_RANGE_HPP_
+#define _TILED_RANGE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+#include "nd_array.hpp"
+
+namespace ND_Array_internals_ {
+
+// The bounds of a tile of an array's indices; the tile
+// contains the indices i with begin[d] <= i[d] < end[d]
+template <int dims>
+struct tile_bounds {
+  std::array<int, dims> begin;
+  std::array<int, dims> end;
+
+  [[nodiscard]] constexpr std::size_t size() const
+      noexcept {
+    std::size_t elems = 1;
+    for(int d = 0; d < dims; d++) {
+      elems *= end[d] - begin[d];
+    }
+    return elems;
+  }
+};
+
+// A strided view of the elements of a tile, which also
+// knows where the tile is in the array
+template <typename View>
+struct array_tile : View {
+  static constexpr int dims = View::EXTENTS::len();
+
+  constexpr array_tile(const View &view,
+                       const tile_bounds<dims> &b) noexcept
+      : View(view), bounds(b) {}
+
+  tile_bounds<dims> bounds;
+};
+
+// Takes the subrange of each dimension of view in bounds
+template <int dim, typename View, int dims>
+[[nodiscard]] constexpr auto tile_view(
+    View view, const tile_bounds<dims> &bounds) noexcept {
+  if constexpr(dim == dims) {
+    return view;
+  } else {
+    return tile_view<dim + 1>(
+        view.template subrange<dim>(bounds.begin[dim],
+                                    bounds.end[dim]),
+        bounds);
+  }
+}
+
+// The tiles of tile_extents of an array in row major order,
+// which are smaller on the upper edges when the extents
+// aren't multiples of them. Each tile is a strided view of
+// the array's elements, so looping over the tiles and then
+// their elements blocks a loop nest for the cache:
+//
+// for(auto tile : tiled_range<32, 32>(src)) {
+//   for(int i = 0; i < tile.extent(0); i++) { ... }
+// }
+template <typename Array_View, int... tile_extents>
+class tiled_range_ {
+ public:
+  static constexpr int dims = sizeof...(tile_extents);
+  using tile_type = array_tile<decltype(tile_view<0>(
+      std::declval<Array_View>(),
+      std::declval<tile_bounds<dims>>()))>;
+
+  static_assert(Array_View::EXTENTS::len() == dims,
+                "Expected a tile extent for each "
+                "dimension");
+  static_assert(((tile_extents > 0) && ...),
+                "Tiles can't be empty");
+
+  class iterator {
+   public:
+    using value_type = tile_type;
+    using reference = tile_type;
+    using pointer = void;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    constexpr iterator(const tiled_range_ *range,
+                       const std::size_t pos) noexcept
+        : range_(range), pos_(pos), tile_{} {}
+
+    [[nodiscard]] constexpr tile_type operator*() const
+        noexcept {
+      return range_->tile(tile_);
+    }
+
+    // Steps to the next tile, carrying into the previous
+    // dimension at the end of a row of tiles
+    constexpr iterator &operator++() noexcept {
+      ++pos_;
+      for(int d = dims - 1; d >= 0; d--) {
+        tile_[d]++;
+        if(d == 0 || tile_[d] < range_->tiles_[d]) {
+          break;
+        }
+        tile_[d] = 0;
+      }
+      return *this;
+    }
+
+    constexpr iterator operator++(int) noexcept {
+      const auto copy = *this;
+      ++(*this);
+      return copy;
+    }
+
+    [[nodiscard]] constexpr bool operator==(
+        const iterator &cmp) const noexcept {
+      return pos_ == cmp.pos_;
+    }
+
+    [[nodiscard]] constexpr bool operator!=(
+        const iterator &cmp) const noexcept {
+      return pos_ != cmp.pos_;
+    }
+
+   private:
+    const tiled_range_ *range_;
+    // The number of the tile in row major order
+    std::size_t pos_;
+    std::array<int, dims> tile_;
+  };
+
+  explicit constexpr tiled_range_(
+      const Array_View &view) noexcept
+      : view_(view), tiles_{}, num_tiles_(1) {
+    for(int d = 0; d < dims; d++) {
+      const int extent = static_cast<int>(view.extent(d));
+      tiles_[d] = (extent + tile_[d] - 1) / tile_[d];
+      num_tiles_ *= tiles_[d];
+    }
+  }
+
+  [[nodiscard]] constexpr iterator begin() const noexcept {
+    return iterator(this, 0);
+  }
+
+  [[nodiscard]] constexpr iterator end() const noexcept {
+    return iterator(this, num_tiles_);
+  }
+
+  // The number of tiles
+  [[nodiscard]] constexpr std::size_t size() const
+      noexcept {
+    return num_tiles_;
+  }
+
+  // The tile with the tile indices t
+  [[nodiscard]] constexpr tile_type tile(
+      const std::array<int, dims> &t) const noexcept {
+    tile_bounds<dims> bounds;
+    for(int d = 0; d < dims; d++) {
+      bounds.begin[d] = t[d] * tile_[d];
+      bounds.end[d] =
+          std::min(bounds.begin[d] + tile_[d],
+                   static_cast<int>(view_.extent(d)));
+    }
+    return tile_type(tile_view<0>(view_, bounds), bounds);
+  }
+
+ private:
+  static constexpr std::array<int, dims> tile_ = {
+      tile_extents...};
+
+  Array_View view_;
+  // The number of tiles along each dimension
+  std::array<int, dims> tiles_;
+  std::size_t num_tiles_;
+};
+
+// The tiles of an array's elements; the array's layout must
+// be strided
+template <int... tile_extents, typename Array>
+[[nodiscard]] constexpr tiled_range_<
+    decltype(std::declval<Array &>().strided_view()),
+    tile_extents...>
+tiled_range(Array &arr) noexcept {
+  return tiled_range_<decltype(arr.strided_view()),
+                      tile_extents...>(arr.strided_view());
+}
+
+}  // namespace ND_Array_internals_
+
+#endif  // _TILED_RANGE_HPP_
@@ -5,9 +5,52 @@
 #include "zip_internal.hpp"
 
 #include <iterator>
+#include <vector>
 
 namespace zip {
 
+// A range of the elements of a Zip, such as the ranges
+// Zip::split() divides it into
+template <typename iterator_>
+class Zip_Range {
+ public:
+  using iterator = iterator_;
+  using size_type = typename iterator::size_type;
+  using difference_type =
+      typename iterator::difference_type;
+
+  constexpr Zip_Range(const iterator &begin,
+                      const iterator &end) noexcept
+      : begin_(begin), end_(end) {}
+
+  constexpr iterator begin() const noexcept {
+    return begin_;
+  }
+  constexpr iterator end() const noexcept { return end_; }
+
+  constexpr size_type size() const noexcept {
+    return static_cast<size_type>(end_ - begin_);
+  }
+
+  // Divides the range into n disjoint ranges of nearly
+  // equal sizes, in order
+  std::vector<Zip_Range> split(const size_type n) const {
+    std::vector<Zip_Range> ranges;
+    ranges.reserve(n);
+    const difference_type len = end_ - begin_;
+    const difference_type parts = n;
+    for(difference_type i = 0; i < parts; i++) {
+      ranges.emplace_back(begin_ + len * i / parts,
+                          begin_ + len * (i + 1) / parts);
+    }
+    return ranges;
+  }
+
+ private:
+  iterator begin_;
+  iterator end_;
+};
+
 // The actual Zip iterator
 // WARNING: The lifetime of the Zip object is dependent on
 // the lifetime of the containers its constructed with
@@ -22,16 +65,23 @@ namespace zip {
 // for(auto [&t1, &t2] : make_zip(vec_1, vec_2))
 // {...}
 //
-// An interesting and probably difficult to implement future
-// improvement would enable mixing the types of the
-// iterators used, so some could be marked as const
+// The iterators are random access when the containers'
+// are, so they can be used with the parallel algorithms,
+// and split() divides the elements into ranges for threads
+//
+// Const and mutable containers can be mixed; the elements
+// of const containers are accessed through their
+// const_iterators, so they're const references, e.g.
+// for(auto [x, y] : make_zip(std::as_const(x_vec), y_vec))
+//   y += a * x;
 template <typename iterator_tag_, typename... containers_>
 class Zip {
  public:
   // Container types
   using value_type =
       std::tuple<typename std::iterator_traits<
-          typename containers_::iterator>::value_type...>;
+          zip_internal_::container_iterator<containers_>>::
+                     value_type...>;
 
   using size_type = typename std::tuple_element<
       0, std::tuple<containers_...>>::type::size_type;
@@ -58,6 +108,8 @@ class Zip {
 
     using iterator_category = iterator_tag_;
 
+    constexpr iterator_t() = default;
+
     explicit constexpr iterator_t(
         const iterator_tuple &iters) noexcept
         : iters_(iters) {}
@@ -72,6 +124,11 @@ class Zip {
           iters_, zip_internal_::const_iterator_deref());
     }
 
+    constexpr reference operator[](
+        const difference_type n) const noexcept {
+      return *(*this + n);
+    }
+
     constexpr iterator_t &operator=(
         const iterator_t &src) noexcept {
       iters_ = src.iters_;
@@ -109,6 +166,40 @@ class Zip {
       return copy;
     }
 
+    constexpr iterator_t &operator+=(
+        const difference_type n) noexcept {
+      zip_internal_::ref_tuple_map(
+          iters_,
+          zip_internal_::iterator_advance<difference_type>{
+              n});
+      return *this;
+    }
+
+    constexpr iterator_t &operator-=(
+        const difference_type n) noexcept {
+      return (*this) += -n;
+    }
+
+    constexpr iterator_t operator+(
+        const difference_type n) const noexcept {
+      iterator_t sum = *this;
+      sum += n;
+      return sum;
+    }
+
+    constexpr iterator_t operator-(
+        const difference_type n) const noexcept {
+      iterator_t diff = *this;
+      diff -= n;
+      return diff;
+    }
+
+    friend constexpr iterator_t operator+(
+        const difference_type n,
+        const iterator_t &itr) noexcept {
+      return itr + n;
+    }
+
     // Very much looking forward to the spaceship operator
     constexpr bool operator==(const iterator_t &cmp) const
         noexcept {
@@ -146,8 +237,8 @@ class Zip {
 
   using const_iterator =
       iterator_t<typename containers_::const_iterator...>;
-  using iterator =
-      iterator_t<typename containers_::iterator...>;
+  using iterator = iterator_t<
+      zip_internal_::container_iterator<containers_>...>;
 
   // Constructor - due to the lifetime constraints, rvalues
   // are not permitted as inputs, only lvalue references
@@ -185,6 +276,18 @@ class Zip {
                   zip_internal_::end_iterator_converter()));
   }
 
+  constexpr size_type size() const noexcept {
+    return static_cast<size_type>(cend() - cbegin());
+  }
+
+  // Divides the elements into n disjoint ranges of nearly
+  // equal sizes, in order, which can be processed by
+  // separate threads
+  std::vector<Zip_Range<iterator>> split(
+      const size_type n) const {
+    return Zip_Range<iterator>(begin(), end()).split(n);
+  }
+
   std::tuple<containers_ &...> contents_;
 };
 
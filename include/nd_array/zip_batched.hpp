@@ -0,0 +1,291 @@
+
+#ifndef _ZIP_BATCHED_HPP_
+#define _ZIP_BATCHED_HPP_
+
+#include <assert.h>
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "simd.hpp"
+
+namespace zip {
+
+// Zips of contiguous containers which step over width
+// elements at a time, yielding tuples of batch_refs to the
+// elements, which load and store them as SIMD vectors.
+// The elements which don't fill a batch are in tail(),
+// whose batches are single elements, so a generic kernel
+// can process both:
+//
+// auto z = make_zip_batched<4>(std::as_const(x), y);
+// z.for_each([a](auto x, auto y) {
+//   typename decltype(x)::vec v;
+//   x.load(v);
+//   y += a * v;
+// });
+//
+// Vectors are loaded into references rather than returned,
+// as returning vectors wider than the baseline target's
+// registers changes the ABI (-Wpsabi)
+
+// A reference to width consecutive elements
+template <typename T, std::size_t width_>
+class batch_ref {
+ public:
+  using value_type = typename std::remove_const<T>::type;
+  // A single element is a scalar
+  using vec = typename ND_Array_internals_::simd_vec_<
+      width_ * sizeof(value_type), value_type>::type;
+
+  static constexpr std::size_t width = width_;
+
+  explicit constexpr batch_ref(T *ptr) noexcept
+      : ptr_(ptr) {}
+
+  constexpr batch_ref(const batch_ref &) noexcept = default;
+
+  void load(vec &v) const noexcept {
+    std::memcpy(&v, ptr_, sizeof(vec));
+  }
+
+  // Assignments store to the elements rather than
+  // rebinding the reference
+  batch_ref &operator=(const batch_ref &src) noexcept {
+    vec v;
+    src.load(v);
+    store(v);
+    return *this;
+  }
+
+  batch_ref &operator=(const vec &v) noexcept {
+    store(v);
+    return *this;
+  }
+
+  batch_ref &operator+=(const vec &v) noexcept {
+    vec elems;
+    load(elems);
+    elems += v;
+    store(elems);
+    return *this;
+  }
+
+  batch_ref &operator-=(const vec &v) noexcept {
+    vec elems;
+    load(elems);
+    elems -= v;
+    store(elems);
+    return *this;
+  }
+
+  batch_ref &operator*=(const vec &v) noexcept {
+    vec elems;
+    load(elems);
+    elems *= v;
+    store(elems);
+    return *this;
+  }
+
+  batch_ref &operator/=(const vec &v) noexcept {
+    vec elems;
+    load(elems);
+    elems /= v;
+    store(elems);
+    return *this;
+  }
+
+  [[nodiscard]] constexpr T *data() const noexcept {
+    return ptr_;
+  }
+
+ private:
+  void store(const vec &v) const noexcept {
+    static_assert(!std::is_const<T>::value,
+                  "Elements of const containers can't be "
+                  "assigned");
+    std::memcpy(ptr_, &v, sizeof(vec));
+  }
+
+  T *ptr_;
+};
+
+// The batches of width elements starting at the pointers
+template <std::size_t width, typename... Ts>
+class Batch_Range {
+ public:
+  using pointers = std::tuple<Ts *...>;
+  using batch_type = std::tuple<batch_ref<Ts, width>...>;
+  using size_type = std::size_t;
+
+  class iterator {
+   public:
+    using value_type = batch_type;
+    using reference = batch_type;
+    using pointer = void;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    constexpr iterator() noexcept = default;
+
+    explicit constexpr iterator(
+        const pointers &ptrs) noexcept
+        : ptrs_(ptrs) {}
+
+    [[nodiscard]] constexpr batch_type operator*() const
+        noexcept {
+      return std::apply(
+          [](Ts *... ptrs) {
+            return batch_type(
+                batch_ref<Ts, width>(ptrs)...);
+          },
+          ptrs_);
+    }
+
+    constexpr iterator &operator++() noexcept {
+      ptrs_ = advance(ptrs_, 1);
+      return *this;
+    }
+
+    constexpr iterator operator++(int) noexcept {
+      const auto copy = *this;
+      ++(*this);
+      return copy;
+    }
+
+    [[nodiscard]] constexpr bool operator==(
+        const iterator &cmp) const noexcept {
+      return std::get<0>(ptrs_) == std::get<0>(cmp.ptrs_);
+    }
+
+    [[nodiscard]] constexpr bool operator!=(
+        const iterator &cmp) const noexcept {
+      return !(*this == cmp);
+    }
+
+   private:
+    pointers ptrs_;
+  };
+
+  constexpr Batch_Range(const pointers &ptrs,
+                        const size_type batches) noexcept
+      : ptrs_(ptrs), batches_(batches) {}
+
+  [[nodiscard]] constexpr iterator begin() const noexcept {
+    return iterator(ptrs_);
+  }
+
+  [[nodiscard]] constexpr iterator end() const noexcept {
+    return iterator(advance(ptrs_, batches_));
+  }
+
+  // The number of batches
+  [[nodiscard]] constexpr size_type size() const noexcept {
+    return batches_;
+  }
+
+  // Calls f with the batch_refs of each batch
+  template <typename F>
+  void for_each(F &&f) const {
+    for(auto batch : *this) {
+      std::apply(f, batch);
+    }
+  }
+
+ protected:
+  static constexpr pointers advance(
+      const pointers &ptrs,
+      const size_type batches) noexcept {
+    return std::apply(
+        [batches](Ts *... p) {
+          return pointers((p + batches * width)...);
+        },
+        ptrs);
+  }
+
+  pointers ptrs_;
+  size_type batches_;
+};
+
+// The batches of a zip of containers of n elements, and the
+// remaining elements which don't fill a batch
+template <std::size_t width, typename... Ts>
+class Batched_Zip : public Batch_Range<width, Ts...> {
+ public:
+  using base = Batch_Range<width, Ts...>;
+  using typename base::pointers;
+  using typename base::size_type;
+  using tail_type = Batch_Range<1, Ts...>;
+
+  constexpr Batched_Zip(const pointers &ptrs,
+                        const size_type n) noexcept
+      : base(ptrs, n / width), n_(n) {}
+
+  // The elements after the last whole batch
+  [[nodiscard]] constexpr tail_type tail() const noexcept {
+    return tail_type(
+        base::advance(this->ptrs_, this->batches_),
+        n_ % width);
+  }
+
+  // Calls f with the batch_refs of each batch, and then
+  // with those of each element of the tail
+  template <typename F>
+  void for_each(F &&f) const {
+    base::for_each(f);
+    tail().for_each(f);
+  }
+
+ private:
+  size_type n_;
+};
+
+namespace zip_batched_internal_ {
+
+// The element type of a container, which is const for
+// const containers
+template <typename container>
+using element_t = typename std::remove_pointer<decltype(
+    std::declval<container &>().data())>::type;
+
+// Padded and tiled arrays have elements which aren't
+// contiguous in their storage
+template <typename container, typename = void>
+struct is_contiguous : std::true_type {};
+
+template <typename container>
+struct is_contiguous<
+    container, std::void_t<typename container::MAPPING>>
+    : std::integral_constant<
+          bool, container::MAPPING::is_contiguous> {};
+
+}  // namespace zip_batched_internal_
+
+// Zips contiguous containers of the same size, which must
+// have data() and size(), in batches of width elements
+template <std::size_t width, typename... containers_>
+[[nodiscard]] Batched_Zip<
+    width, zip_batched_internal_::element_t<containers_>...>
+make_zip_batched(containers_ &... c) noexcept {
+  static_assert(width > 0, "Batches can't be empty");
+  static_assert(
+      (zip_batched_internal_::is_contiguous<
+           typename std::remove_const<containers_>::type>::
+           value &&
+       ...),
+      "Batched zips need contiguous containers");
+  const std::size_t n =
+      std::get<0>(std::forward_as_tuple(c...)).size();
+  assert(
+      ((static_cast<std::size_t>(c.size()) == n) && ...));
+  return Batched_Zip<
+      width,
+      zip_batched_internal_::element_t<containers_>...>(
+      std::make_tuple(c.data()...), n);
+}
+
+}  // namespace zip
+
+#endif  // _ZIP_BATCHED_HPP_
@@ -3,10 +3,19 @@
 #define _ZIP_INTERNAL_HPP_
 
 #include <tuple>
+#include <type_traits>
 #include <utility>
 
 namespace zip_internal_ {
 
+// The iterator used for a container, which is its
+// const_iterator when the container is const
+template <typename container>
+using container_iterator = typename std::conditional<
+    std::is_const<container>::value,
+    typename container::const_iterator,
+    typename container::iterator>::type;
+
 // Converters for the standard iterator types
 struct value_converter {
   template <typename container>
@@ -35,21 +44,29 @@ struct const_pointer_converter {
 
 struct iterator_converter {
   template <typename container>
-  using convert = typename container::iterator;
+  using convert = container_iterator<container>;
 };
 
 struct begin_iterator_converter
     : public iterator_converter {
   template <typename container>
   convert<container> operator()(container &c) const {
-    return c.begin();
+    if constexpr(std::is_const<container>::value) {
+      return c.cbegin();
+    } else {
+      return c.begin();
+    }
   }
 };
 
 struct end_iterator_converter : public iterator_converter {
   template <typename container>
   convert<container> operator()(container &c) const {
-    return c.end();
+    if constexpr(std::is_const<container>::value) {
+      return c.cend();
+    } else {
+      return c.end();
+    }
   }
 };
 
@@ -107,6 +124,17 @@ struct iterator_decr {
   }
 };
 
+template <typename difference_type>
+struct iterator_advance {
+  difference_type n;
+
+  template <typename iter_t>
+  iter_t operator()(iter_t &i) const {
+    i += n;
+    return i;
+  }
+};
+
 // Source for the tuple_map object:
 // https://codereview.stackexchange.com/questions/193420/apply-a-function-to-each-element-of-a-tuple-map-a-tuple
 template <class F, typename Tuple, size_t... Is>
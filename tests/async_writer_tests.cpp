@@ -0,0 +1,163 @@
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "nd_array/async_writer.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/serialize.hpp"
+#include "temp_file.hpp"
+
+using ND_Array_internals_::async_backend;
+using ND_Array_internals_::async_writer;
+using ND_Array_internals_::io_status;
+
+TEST_CASE("async writes", "[Async_Writer]") {
+  temp_file path("async_writer_test");
+  using array_t = ND_Array<double, 17, 11, 13>;
+  auto src = std::make_unique<array_t>();
+  for(int i = 0; i < 17; i++) {
+    for(int j = 0; j < 11; j++) {
+      for(int k = 0; k < 13; k++) {
+        (*src)(i, j, k) = std::sin(0.1 * i) + j * 13 + k;
+      }
+    }
+  }
+  // io_uring where it's available, and the thread backend
+  const async_backend backends[2] = {
+      async_backend::automatic, async_backend::thread};
+
+  SECTION("whole arrays") {
+    for(const async_backend backend : backends) {
+      {
+        async_writer writer(path.c_str(),
+                            sizeof(array_t) / 3, backend);
+        REQUIRE(writer.status() == io_status::ok);
+        if(backend == async_backend::thread) {
+          REQUIRE(writer.backend() ==
+                  async_backend::thread);
+        }
+        auto future = writer.write_array(*src);
+        // The array can be modified once it's been copied
+        (*src)(0, 0, 0) += 1.0;
+        REQUIRE(writer.wait() == io_status::ok);
+        REQUIRE(future.get() == io_status::ok);
+        (*src)(0, 0, 0) -= 1.0;
+        REQUIRE(writer.close() == io_status::ok);
+      }
+      auto dest = std::make_unique<array_t>();
+      REQUIRE(ND_Array_internals_::load(
+                  path.c_str(), *dest) == io_status::ok);
+      REQUIRE(std::equal(dest->cbegin(), dest->cend(),
+                         src->cbegin()));
+    }
+  }
+  SECTION("outer slices") {
+    for(const async_backend backend : backends) {
+      {
+        // A few slices per buffer, written out of order
+        using slice_t = ND_Array<double, 11, 13>;
+        async_writer writer(
+            path.c_str(), 3 * sizeof(slice_t) + 8, backend);
+        writer.write_header<array_t>();
+        std::vector<async_writer::future_type> futures;
+        for(int i = 16; i >= 0; i -= 2) {
+          futures.push_back(writer.write_slice(*src, i));
+        }
+        for(int i = 1; i < 17; i += 2) {
+          futures.push_back(writer.write_slice(*src, i));
+        }
+        writer.flush();
+        for(auto &future : futures) {
+          REQUIRE(future.get() == io_status::ok);
+        }
+      }
+      auto dest = std::make_unique<array_t>();
+      REQUIRE(ND_Array_internals_::load(
+                  path.c_str(), *dest) == io_status::ok);
+      REQUIRE(std::equal(dest->cbegin(), dest->cend(),
+                         src->cbegin()));
+    }
+  }
+  SECTION("padded layouts") {
+    using padded_t = ND_Padded_Array<float, 3, 5, 30, 10>;
+    for(const async_backend backend : backends) {
+      padded_t padded;
+      float v = 0.0f;
+      for(float &elem : padded) {
+        elem = v;
+        v += 0.5f;
+      }
+      {
+        async_writer writer(path.c_str(), 4096, backend);
+        writer.write_header<padded_t>();
+        for(int i = 0; i < 5; i++) {
+          for(int j = 0; j < 30; j++) {
+            writer.write_slice(padded, i, j);
+          }
+        }
+        REQUIRE(writer.close() == io_status::ok);
+      }
+      padded_t loaded;
+      REQUIRE(ND_Array_internals_::load(path.c_str(),
+                                        loaded) ==
+              io_status::ok);
+      REQUIRE(std::equal(loaded.cbegin(), loaded.cend(),
+                         padded.cbegin()));
+    }
+  }
+  SECTION("scattered writes") {
+    for(const async_backend backend : backends) {
+      // More separate writes than fit in a buffer
+      std::vector<std::uint32_t> expected(1000, 0);
+      {
+        async_writer writer(path.c_str(), 256, backend);
+        for(std::uint32_t i = 0; i < 990; i += 3) {
+          expected[i] = i * 7 + 1;
+          writer.write(&expected[i], sizeof(std::uint32_t),
+                       i * sizeof(std::uint32_t));
+        }
+        for(std::uint32_t i = 990; i < 1000; i++) {
+          expected[i] = i;
+        }
+        auto future = writer.write(
+            &expected[990], 10 * sizeof(std::uint32_t),
+            990 * sizeof(std::uint32_t));
+        writer.flush();
+        REQUIRE(future.get() == io_status::ok);
+        REQUIRE(writer.status() == io_status::ok);
+      }
+      std::vector<std::uint32_t> read(1000, 1);
+      std::FILE *file = std::fopen(path.c_str(), "rb");
+      REQUIRE(file != nullptr);
+      REQUIRE(std::fread(read.data(), sizeof(std::uint32_t),
+                         1000, file) == 1000);
+      std::fclose(file);
+      REQUIRE(read == expected);
+    }
+  }
+  SECTION("errors") {
+    for(const async_backend backend : backends) {
+      async_writer writer("/tmp/nd_array_missing/array",
+                          4096, backend);
+      REQUIRE(writer.status() == io_status::open_failed);
+      // Writes fail at once rather than being staged
+      REQUIRE(writer.write_array(*src).get() ==
+              io_status::open_failed);
+      REQUIRE(writer.write_slice(*src, 3).get() ==
+              io_status::open_failed);
+      REQUIRE(writer.flush().get() ==
+              io_status::open_failed);
+      REQUIRE(writer.close() == io_status::open_failed);
+    }
+    async_writer writer(path.c_str(), 4096);
+    REQUIRE(writer.close() == io_status::ok);
+    REQUIRE(writer.write_array(*src).get() ==
+            io_status::io_failed);
+  }
+}
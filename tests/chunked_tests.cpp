@@ -0,0 +1,276 @@
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "nd_array/chunked.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/parallel.hpp"
+#include "nd_array/serialize.hpp"
+#include "nd_array/span.hpp"
+#include "temp_file.hpp"
+
+#include <unistd.h>
+
+using ND_Array_internals_::chunk_entry;
+using ND_Array_internals_::chunked_file_header;
+using ND_Array_internals_::chunked_options;
+using ND_Array_internals_::chunked_reader;
+using ND_Array_internals_::io_status;
+using ND_Array_internals_::load_chunked;
+using ND_Array_internals_::lz_compressor;
+using ND_Array_internals_::save_chunked;
+using ND_Array_internals_::thread_pool;
+
+// Compresses and decompresses src at level, returning the
+// compressed size
+static std::size_t lz_round_trip(
+    const std::vector<unsigned char> &src,
+    const int level) {
+  lz_compressor compressor;
+  std::vector<unsigned char> compressed(
+      ND_Array_internals_::lz_compress_bound(src.size()));
+  const std::size_t bytes = compressor.compress(
+      src.data(), src.size(), compressed.data(), level);
+  REQUIRE(bytes <= compressed.size());
+  std::vector<unsigned char> decompressed(src.size() + 1);
+  REQUIRE(ND_Array_internals_::lz_decompress(
+      compressed.data(), bytes, decompressed.data(),
+      src.size()));
+  REQUIRE(std::equal(src.begin(), src.end(),
+                     decompressed.begin()));
+  // Truncated or corrupt data is rejected
+  if(bytes > 1) {
+    REQUIRE(!ND_Array_internals_::lz_decompress(
+        compressed.data(), bytes - 1, decompressed.data(),
+        src.size()));
+  }
+  REQUIRE(!ND_Array_internals_::lz_decompress(
+      compressed.data(), bytes, decompressed.data(),
+      src.size() + 1));
+  return bytes;
+}
+
+TEST_CASE("lz compression", "[Chunked]") {
+  std::mt19937 rng(42);
+  std::vector<unsigned char> random(100000);
+  for(unsigned char &v : random) {
+    v = static_cast<unsigned char>(rng());
+  }
+  std::vector<unsigned char> zeros(100000, 0);
+  std::vector<unsigned char> text;
+  const std::string words = "the quick brown fox jumps ";
+  while(text.size() < 100000) {
+    text.insert(text.end(), words.begin(),
+                words.begin() + rng() % words.size());
+  }
+  for(int level = 1;
+      level <= ND_Array_internals_::max_compression_level;
+      level++) {
+    for(std::size_t bytes : {0, 1, 3, 4, 5, 16, 300}) {
+      lz_round_trip(std::vector<unsigned char>(
+                        random.begin(),
+                        random.begin() + bytes),
+                    level);
+      lz_round_trip(std::vector<unsigned char>(bytes, 7),
+                    level);
+    }
+    REQUIRE(lz_round_trip(random, level) >= random.size());
+    REQUIRE(lz_round_trip(zeros, level) < 1000);
+    REQUIRE(lz_round_trip(text, level) < text.size() / 2);
+  }
+  // Higher levels search for longer matches
+  REQUIRE(lz_round_trip(text, 9) < lz_round_trip(text, 1));
+}
+
+TEST_CASE("byte shuffle", "[Chunked]") {
+  const std::uint32_t src[3] = {0x04030201, 0x08070605,
+                                0x0C0B0A09};
+  unsigned char shuffled[12];
+  ND_Array_internals_::byte_shuffle<4>(
+      reinterpret_cast<const unsigned char *>(src),
+      shuffled, 3);
+  if(reinterpret_cast<const unsigned char *>(src)[0] ==
+     0x01) {
+    const unsigned char expected[12] = {1, 5, 9,  2, 6, 10,
+                                        3, 7, 11, 4, 8, 12};
+    REQUIRE(std::equal(shuffled, shuffled + 12, expected));
+  }
+  std::uint32_t dest[3];
+  ND_Array_internals_::byte_unshuffle<4>(
+      shuffled, reinterpret_cast<unsigned char *>(dest), 3);
+  REQUIRE(std::equal(src, src + 3, dest));
+}
+
+TEST_CASE("chunked files", "[Chunked]") {
+  temp_file path("chunked_test");
+  using array_t = ND_Array<double, 37, 19, 23>;
+  auto src = std::make_unique<array_t>();
+  for(int i = 0; i < 37; i++) {
+    for(int j = 0; j < 19; j++) {
+      for(int k = 0; k < 23; k++) {
+        (*src)(i, j, k) = std::sin(0.1 * i) *
+                              std::cos(0.05 * j) +
+                          0.01 * k;
+      }
+    }
+  }
+  // 3 outer slices per chunk, so 13 chunks
+  chunked_options options;
+  options.chunk_bytes = 3 * 19 * 23 * sizeof(double) + 100;
+  thread_pool pool(4);
+  options.pool = &pool;
+
+  SECTION("round trip") {
+    for(int level : {0, 1, 4, 9}) {
+      for(bool shuffle : {false, true}) {
+        options.level = level;
+        options.shuffle = shuffle;
+        REQUIRE(save_chunked(*src, path.c_str(), options) ==
+                io_status::ok);
+        chunked_reader reader(path.c_str());
+        REQUIRE(reader.status() == io_status::ok);
+        REQUIRE(reader.chunks() == 13);
+        REQUIRE(reader.header().chunk_slices == 3);
+        if(level == 0) {
+          REQUIRE(reader.compressed_bytes() ==
+                  sizeof(array_t));
+        } else {
+          REQUIRE(reader.compressed_bytes() <
+                  sizeof(array_t));
+        }
+        auto dest = std::make_unique<array_t>();
+        REQUIRE(reader.load(*dest, &pool) == io_status::ok);
+        REQUIRE(std::equal(dest->cbegin(), dest->cend(),
+                           src->cbegin()));
+      }
+    }
+  }
+  SECTION("sub regions") {
+    REQUIRE(save_chunked(*src, path.c_str(), options) ==
+            io_status::ok);
+    chunked_reader reader(path.c_str());
+    auto dest = std::make_unique<array_t>();
+    dest->fill(-1.0);
+    // Slices 7 and 8 are in the chunk of slices 6 to 8
+    REQUIRE(reader.load_slices(*dest, 7, 9) ==
+            io_status::ok);
+    REQUIRE((*dest)(5, 18, 22) == -1.0);
+    REQUIRE((*dest)(6, 0, 0) == (*src)(6, 0, 0));
+    REQUIRE((*dest)(8, 18, 22) == (*src)(8, 18, 22));
+    REQUIRE((*dest)(9, 0, 0) == -1.0);
+    // The last chunk only has slice 36
+    REQUIRE(reader.load_slices(*dest, 36, 37) ==
+            io_status::ok);
+    REQUIRE((*dest)(35, 0, 0) == -1.0);
+    REQUIRE((*dest)(36, 18, 22) == (*src)(36, 18, 22));
+  }
+  SECTION("padded layouts and default options") {
+    using padded_t = ND_Padded_Array<float, 5, 30, 10>;
+    padded_t padded;
+    float v = 0.0f;
+    for(float &elem : padded) {
+      elem = v;
+      v += 0.5f;
+    }
+    REQUIRE(save_chunked(padded, path.c_str()) ==
+            io_status::ok);
+    padded_t loaded;
+    REQUIRE(load_chunked(path.c_str(), loaded) ==
+            io_status::ok);
+    REQUIRE(std::equal(loaded.cbegin(), loaded.cend(),
+                       padded.cbegin()));
+  }
+  SECTION("mismatches") {
+    REQUIRE(save_chunked(*src, path.c_str(), options) ==
+            io_status::ok);
+    using floats = ND_Array<float, 37, 19, 23>;
+    using reshaped = ND_Array<double, 19, 37, 23>;
+    auto wrong_type = std::make_unique<floats>();
+    auto wrong_shape = std::make_unique<reshaped>();
+    REQUIRE(load_chunked(path.c_str(), *wrong_type) ==
+            io_status::type_mismatch);
+    REQUIRE(load_chunked(path.c_str(), *wrong_shape) ==
+            io_status::shape_mismatch);
+    auto dest = std::make_unique<array_t>();
+    REQUIRE(load_chunked("/tmp/nd_array_missing", *dest) ==
+            io_status::open_failed);
+    // Array files aren't chunked files
+    REQUIRE(ND_Array_internals_::save(*src, path.c_str()) ==
+            io_status::ok);
+    REQUIRE(load_chunked(path.c_str(), *dest) ==
+            io_status::bad_header);
+  }
+  SECTION("corruption") {
+    options.level = 1;
+    REQUIRE(save_chunked(*src, path.c_str(), options) ==
+            io_status::ok);
+    std::uint64_t index_offset;
+    {
+      chunked_reader reader(path.c_str());
+      index_offset = reader.header().index_offset;
+    }
+    // A byte of the first chunk
+    const long offset =
+        ND_Array_internals_::chunked_data_offset() + 20;
+    std::FILE *file = std::fopen(path.c_str(), "r+b");
+    REQUIRE(file != nullptr);
+    std::fseek(file, offset, SEEK_SET);
+    std::fputc(0x55, file);
+    std::fclose(file);
+    auto dest = std::make_unique<array_t>();
+    chunked_reader reader(path.c_str());
+    REQUIRE(reader.load(*dest) ==
+            io_status::checksum_mismatch);
+    // The other chunks are still loaded
+    REQUIRE(reader.load_slices(*dest, 3, 37) ==
+            io_status::ok);
+    REQUIRE((*dest)(36, 1, 2) == (*src)(36, 1, 2));
+    // Sizes in the file which would overflow
+    const auto overwrite = [&](const void *bytes,
+                               const std::size_t size,
+                               const long at) {
+      std::FILE *f = std::fopen(path.c_str(), "r+b");
+      REQUIRE(f != nullptr);
+      std::fseek(f, at, SEEK_SET);
+      REQUIRE(std::fwrite(bytes, size, 1, f) == 1);
+      std::fclose(f);
+    };
+    const chunked_file_header header = reader.header();
+    chunk_entry entry;
+    {
+      std::FILE *f = std::fopen(path.c_str(), "rb");
+      REQUIRE(f != nullptr);
+      std::fseek(f, index_offset, SEEK_SET);
+      REQUIRE(std::fread(&entry, sizeof(entry), 1, f) == 1);
+      std::fclose(f);
+    }
+    chunk_entry wrapped = entry;
+    wrapped.offset = ~std::uint64_t(0) - 1;
+    wrapped.bytes = 3;
+    overwrite(&wrapped, sizeof(wrapped), index_offset);
+    REQUIRE(load_chunked(path.c_str(), *dest) ==
+            io_status::truncated);
+    overwrite(&entry, sizeof(entry), index_offset);
+    chunked_file_header huge = header;
+    huge.array.extents[0] = std::uint64_t(1) << 59;
+    huge.chunk_slices = 1;
+    huge.chunks = huge.array.extents[0];
+    overwrite(&huge, sizeof(huge), 0);
+    REQUIRE(chunked_reader(path.c_str()).status() ==
+            io_status::truncated);
+    overwrite(&header, sizeof(header), 0);
+    REQUIRE(chunked_reader(path.c_str()).status() ==
+            io_status::ok);
+    REQUIRE(truncate(path.c_str(), index_offset) == 0);
+    REQUIRE(load_chunked(path.c_str(), *dest) ==
+            io_status::truncated);
+  }
+}
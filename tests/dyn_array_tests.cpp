@@ -0,0 +1,226 @@
+
+#include "catch.hpp"
+
+#include <utility>
+
+#include "nd_array/dyn_array.hpp"
+#include "nd_array/nd_array.hpp"
+
+TEST_CASE("dynamic get, set, slice, reshape",
+          "[ND_Dyn_Array]") {
+  ND_Dyn_Array<int, ND_Dynamic, 3, ND_Dynamic> arr(2, 5);
+  REQUIRE(arr.extent(0) == 2);
+  REQUIRE(arr.extent(1) == 3);
+  REQUIRE(arr.extent(2) == 5);
+  REQUIRE(arr.size() == 30);
+  REQUIRE(arr.stride(0) == 15);
+  REQUIRE(arr.stride(1) == 5);
+  REQUIRE(arr.stride(2) == 1);
+  int count = 1;
+  for(decltype(arr)::size_type i = 0; i < arr.extent(0);
+      ++i) {
+    for(decltype(arr)::size_type j = 0; j < arr.extent(1);
+        ++j) {
+      for(decltype(arr)::size_type k = 0; k < arr.extent(2);
+          ++k) {
+        arr(i, j, k) = count;
+        count++;
+      }
+    }
+  }
+  count = 1;
+  for(int v : arr) {
+    REQUIRE(v == count);
+    count++;
+  }
+  auto slice1 = arr.outer_slice(0);
+  REQUIRE(slice1.dimension() == 2);
+  REQUIRE(slice1.extent(0) == 3);
+  REQUIRE(slice1.extent(1) == 5);
+  count = 1;
+  for(int j = 0; j < 3; ++j) {
+    for(int k = 0; k < 5; ++k) {
+      REQUIRE(slice1(j, k) == count);
+      count++;
+    }
+  }
+  auto slice2 = arr.outer_slice(1);
+  for(int j = 0; j < 3; ++j) {
+    for(int k = 0; k < 5; ++k) {
+      REQUIRE(&slice2(j, k) == &arr(1, j, k));
+    }
+  }
+  auto slice3 = arr.outer_slice(1, 2);
+  REQUIRE(slice3.dimension() == 1);
+  for(int k = 0; k < 5; ++k) {
+    REQUIRE(&slice3(k) == &arr(1, 2, k));
+  }
+  auto reshape =
+      slice2.template reshape<ND_Dyn_Array<int, 5, 3>>();
+  for(int i = 0; i < 3; i++) {
+    REQUIRE(&reshape(0, i) == &slice2(0, i));
+  }
+  auto flat = arr.template reshape<
+      ND_Dyn_Array<int, ND_Dynamic>>(arr.size());
+  for(int i = 0; i < 30; i++) {
+    REQUIRE(flat(i) == i + 1);
+  }
+}
+
+TEST_CASE("dynamic iterate 3D", "[ND_Dyn_Array]") {
+  ND_Dyn_Array<int, ND_Dynamic, ND_Dynamic, ND_Dynamic>
+      arr(5, 7, 11);
+  int count = 0;
+  for(int i = 0; i < 5; i++) {
+    for(int j = 0; j < 7; j++) {
+      for(int k = 0; k < 11; k++) {
+        arr(i, j, k) = count;
+        count++;
+      }
+    }
+  }
+  auto itr = arr.begin();
+  count = 0;
+  for(int i = 0; i < 5; i++) {
+    for(int j = 0; j < 7; j++) {
+      for(int k = 0; k < 11; k++) {
+        REQUIRE(*itr == count);
+        REQUIRE(arr.index(itr, 0) == i);
+        REQUIRE(arr.index(itr, 1) == j);
+        REQUIRE(arr.index(itr, 2) == k);
+        count++;
+        ++itr;
+      }
+    }
+  }
+  auto center = arr.begin() + 3 * 77 + 4 * 11 + 5;
+  REQUIRE(*arr.offset(center, 1, -2, 3) ==
+          arr(4, 2, 8));
+}
+
+TEST_CASE("matches ND_Array", "[ND_Dyn_Array]") {
+  ND_Array<int, 4, 6, 3> s_arr;
+  ND_Dyn_Array<int, 4, ND_Dynamic, 3> d_arr(6);
+  int count = 0;
+  for(int &v : s_arr) {
+    v = count;
+    count++;
+  }
+  count = 0;
+  for(int &v : d_arr) {
+    v = count;
+    count++;
+  }
+  for(int i = 0; i < 4; i++) {
+    for(int j = 0; j < 6; j++) {
+      for(int k = 0; k < 3; k++) {
+        REQUIRE(s_arr(i, j, k) == d_arr(i, j, k));
+      }
+    }
+  }
+}
+
+TEST_CASE("dynamic copy, fill, swap", "[ND_Dyn_Array]") {
+  ND_Dyn_Array<int, 7, ND_Dynamic> arr1(6), arr2(6);
+  const int fill_val = 756;
+  arr1.fill(fill_val);
+  for(int v : arr1) {
+    REQUIRE(v == fill_val);
+  }
+  ND_Dyn_Array<int, 7, ND_Dynamic> arr3 = arr1;
+  REQUIRE(arr3.data() != arr1.data());
+  arr3(0, 0) = 0;
+  REQUIRE(arr1(0, 0) == fill_val);
+
+  int i = 23;
+  for(int &v : arr1) {
+    v = i;
+    i++;
+  }
+  for(int &v : arr2) {
+    v = i;
+    i++;
+  }
+  arr1.swap(arr2);
+  i = 23;
+  for(int v : arr2) {
+    REQUIRE(v == i);
+    i++;
+  }
+  for(int v : arr1) {
+    REQUIRE(v == i);
+    i++;
+  }
+
+  // Swapping views swaps the elements they refer to
+  auto row0 = arr1.outer_slice(0);
+  auto row1 = arr1.outer_slice(1);
+  const int r0 = arr1(0, 0);
+  const int r1 = arr1(1, 0);
+  row0.swap(row1);
+  REQUIRE(arr1(0, 0) == r1);
+  REQUIRE(arr1(1, 0) == r0);
+
+  // Moved from arrays are empty
+  const int *const storage = arr1.data();
+  ND_Dyn_Array<int, 7, ND_Dynamic> arr4(std::move(arr1));
+  REQUIRE(arr4.data() == storage);
+  REQUIRE(arr4.extent(1) == 6);
+  REQUIRE(arr1.size() == 0);
+  REQUIRE(arr1.extent(1) == 0);
+  REQUIRE(arr1.begin() == arr1.end());
+  arr1.fill(fill_val);
+  arr2 = std::move(arr4);
+  REQUIRE(arr2.data() == storage);
+  REQUIRE(arr4.size() == 0);
+  REQUIRE(arr4.data() == nullptr);
+  arr1 = std::move(arr2);
+  REQUIRE(arr1.size() == 42);
+  REQUIRE(arr1(0, 0) == r1);
+}
+
+/* Runtime Array Tests */
+
+using RArr0 =
+    ND_Array_internals_::RT_Array<int, 2, ND_Dynamic, 5>;
+static_assert(RArr0::len() == 3,
+              "Incorrect RT Array Length");
+static_assert(RArr0::num_dynamic() == 1,
+              "Incorrect number of dynamic values");
+static_assert(RArr0::is_static(0),
+              "Incorrect static value");
+static_assert(!RArr0::is_static(1),
+              "Incorrect static value");
+static_assert(RArr0::static_trailing_product(0) ==
+                  ND_Dynamic,
+              "Incorrect static trailing product");
+static_assert(RArr0::static_trailing_product(2) == 5,
+              "Incorrect static trailing product");
+static_assert(RArr0::static_trailing_product(3) == 1,
+              "Incorrect static trailing product");
+
+using RStrides0 =
+    ND_Array_internals_::row_major_strides<RArr0>::type;
+static_assert(!RStrides0::is_static(0),
+              "Strides over dynamic extents are static");
+static_assert(RStrides0::static_value(1) == 5,
+              "Incorrect static stride");
+static_assert(RStrides0::static_value(2) == 1,
+              "Incorrect static stride");
+
+static_assert(RArr0(3).product() == 30,
+              "Incorrect RT Array Product");
+static_assert(RArr0(3).get<1>() == 3,
+              "Incorrect RT Array value");
+static_assert(ND_Array_internals_::linear_idx(
+                  ND_Array_internals_::row_major_strides<
+                      RArr0>::compute(RArr0(3)),
+                  1, 2, 3) == 28,
+              "Incorrect Runtime Linear Index");
+using RTruncated0 =
+    ND_Array_internals_::forward_truncate_rt_array<
+        1, RArr0>::type;
+static_assert(RTruncated0::len() == 2,
+              "forward_truncate_rt_array failed");
+static_assert(RTruncated0::static_value(0) == ND_Dynamic,
+              "forward_truncate_rt_array failed");
@@ -0,0 +1,79 @@
+
+#include "catch.hpp"
+
+#include <array>
+#include <type_traits>
+
+#include "nd_array/enumerate.hpp"
+#include "nd_array/nd_array.hpp"
+
+using ND_Array_internals_::enumerate;
+
+// Checks that the indices of each element are those of its
+// position in row major order
+template <typename Array>
+static void check_enumerate(Array &arr) {
+  std::size_t i = 0;
+  std::size_t j = 0;
+  std::size_t k = 0;
+  std::size_t count = 0;
+  for(auto [idx, v] : enumerate(arr)) {
+    REQUIRE(idx[0] == i);
+    REQUIRE(idx[1] == j);
+    REQUIRE(idx[2] == k);
+    REQUIRE(&v == &arr(i, j, k));
+    count++;
+    k++;
+    if(k == std::size_t(Array::extent(2))) {
+      k = 0;
+      j++;
+      if(j == std::size_t(Array::extent(1))) {
+        j = 0;
+        i++;
+      }
+    }
+  }
+  REQUIRE(count == Array::size());
+}
+
+TEST_CASE("enumerate", "[ND_Array]") {
+  SECTION("row major") {
+    ND_Array<int, 3, 4, 5> arr;
+    check_enumerate(arr);
+    for(auto [idx, v] : enumerate(arr)) {
+      v = 100 * idx[0] + 10 * idx[1] + idx[2];
+    }
+    REQUIRE(arr(2, 3, 4) == 234);
+    const ND_Array<int, 3, 4, 5> &c = arr;
+    for(auto [idx, v] : enumerate(c)) {
+      static_assert(
+          std::is_same<decltype(v), const int &>::value,
+          "Elements of const arrays must be const");
+      REQUIRE(v == 100 * idx[0] + 10 * idx[1] + idx[2]);
+    }
+  }
+  SECTION("other layouts") {
+    ND_Padded_Array<int, 3, 2, 3, 5> padded;
+    check_enumerate(padded);
+    ND_Col_Major_Array<int, 2, 3, 4> col;
+    check_enumerate(col);
+    ND_Tiled_Array<int, 2, 4, 3, 5, 6> tiled;
+    check_enumerate(tiled);
+    ND_Morton_Array<int, 2, 4, 8> morton;
+    check_enumerate(morton);
+  }
+  SECTION("indexed iterators") {
+    ND_Array<double, 6, 7> arr;
+    auto itr = ND_Array_internals_::indexed_begin(arr);
+    const auto end = ND_Array_internals_::indexed_end(arr);
+    auto plain = arr.cbegin();
+    for(; itr != end; ++itr, ++plain) {
+      REQUIRE(itr.index<0>() == arr.index(plain, 0));
+      REQUIRE(itr.index<1>() == arr.index(plain, 1));
+      REQUIRE(&*itr == &*plain);
+    }
+    REQUIRE(plain == arr.cend());
+    REQUIRE((itr.indices() ==
+             std::array<std::size_t, 2>{6, 0}));
+  }
+}
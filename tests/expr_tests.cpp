@@ -0,0 +1,127 @@
+
+#include "catch.hpp"
+
+#include <cmath>
+
+#include "nd_array/expr.hpp"
+#include "nd_array/nd_array.hpp"
+
+TEST_CASE("expression arithmetic", "[ND_Array]") {
+  ND_Array<double, 3, 4, 5> u, v, w;
+  int count = 0;
+  for(int i = 0; i < 3; i++) {
+    for(int j = 0; j < 4; j++) {
+      for(int k = 0; k < 5; k++) {
+        u(i, j, k) = count;
+        v(i, j, k) = 2 * count + 1;
+        w(i, j, k) = count % 7;
+        count++;
+      }
+    }
+  }
+  const ND_Array<double, 3, 4, 5> u0 = u;
+  SECTION("fused update") {
+    u = 0.5 * u + 2.0 * (v - w);
+    for(int i = 0; i < 3; i++) {
+      for(int j = 0; j < 4; j++) {
+        for(int k = 0; k < 5; k++) {
+          REQUIRE(u(i, j, k) ==
+                  0.5 * u0(i, j, k) +
+                      2.0 * (v(i, j, k) - w(i, j, k)));
+        }
+      }
+    }
+  }
+  SECTION("construct from expression") {
+    const ND_Array<double, 3, 4, 5> q = (u + 1) / v - -w;
+    auto q_itr = q.cbegin();
+    auto u_itr = u.cbegin();
+    auto v_itr = v.cbegin();
+    auto w_itr = w.cbegin();
+    while(q_itr != q.cend()) {
+      REQUIRE(*q_itr == (*u_itr + 1) / *v_itr + *w_itr);
+      ++q_itr;
+      ++u_itr;
+      ++v_itr;
+      ++w_itr;
+    }
+  }
+  SECTION("compound assignment") {
+    u += v;
+    u *= 2;
+    u -= w * w;
+    u /= 4.0;
+    auto u_itr = u.cbegin();
+    auto u0_itr = u0.cbegin();
+    auto v_itr = v.cbegin();
+    auto w_itr = w.cbegin();
+    while(u_itr != u.cend()) {
+      REQUIRE(*u_itr ==
+              ((*u0_itr + *v_itr) * 2 - *w_itr * *w_itr) /
+                  4.0);
+      ++u_itr;
+      ++u0_itr;
+      ++v_itr;
+      ++w_itr;
+    }
+  }
+  SECTION("math functions") {
+    u = sqrt(v) + exp(-abs(w)) * cos(u) - log(v) +
+        pow(w, 2) + sin(2.0 * u);
+    auto u_itr = u.cbegin();
+    auto u0_itr = u0.cbegin();
+    auto v_itr = v.cbegin();
+    auto w_itr = w.cbegin();
+    while(u_itr != u.cend()) {
+      REQUIRE(*u_itr ==
+              Approx(std::sqrt(*v_itr) +
+                     std::exp(-std::abs(*w_itr)) *
+                         std::cos(*u0_itr) -
+                     std::log(*v_itr) +
+                     std::pow(*w_itr, 2) +
+                     std::sin(2.0 * *u0_itr)));
+      ++u_itr;
+      ++u0_itr;
+      ++v_itr;
+      ++w_itr;
+    }
+  }
+}
+
+TEST_CASE("expression layouts", "[ND_Array]") {
+  ND_Padded_Array<int, 3, 6, 5> padded;
+  ND_Aligned_Array<int, 64, 6, 5> aligned;
+  ND_Array<int, 6, 5> result;
+  int count = 0;
+  for(int i = 0; i < 6; i++) {
+    for(int j = 0; j < 5; j++) {
+      padded(i, j) = count;
+      aligned(i, j) = 100 - count;
+      count++;
+    }
+  }
+  result = padded * 3 - aligned;
+  padded = result + padded;
+  for(int i = 0; i < 6; i++) {
+    for(int j = 0; j < 5; j++) {
+      const int c = i * 5 + j;
+      REQUIRE(result(i, j) == 3 * c - (100 - c));
+      REQUIRE(padded(i, j) == result(i, j) + c);
+    }
+  }
+}
+
+using Expr0 = decltype(std::declval<ND_Array<int, 2, 3>>() +
+                       std::declval<ND_Array<int, 2, 3>>());
+static_assert(
+    ND_Array_internals_::is_nd_expr_<Expr0>::value,
+    "Sum of arrays is not an expression");
+static_assert(
+    std::is_same<typename Expr0::DIMS,
+                 ND_Array<int, 2, 3>::DIMS>::value,
+    "Incorrect expression shape");
+using Expr1 =
+    decltype(2.0 * std::declval<ND_Array<int, 2, 3>>());
+static_assert(std::is_same<typename Expr1::value_type,
+                           double>::value,
+              "Incorrect expression value type");
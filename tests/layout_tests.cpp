@@ -0,0 +1,195 @@
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "nd_array/expr.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/reduce.hpp"
+#include "nd_array/simd.hpp"
+
+// Checks that the iterators visit every element once, that
+// index() gives the indices of the element at each
+// position, and that stepping and seeking agree
+template <typename Array>
+static void check_traversal(Array &arr) {
+  static_assert(Array::dimension() == 3,
+                "Only checks 3D arrays");
+  std::set<const typename Array::value_type *> visited;
+  auto itr = arr.begin();
+  for(std::size_t pos = 0; pos < Array::size(); pos++) {
+    REQUIRE(itr == arr.begin() + pos);
+    REQUIRE(itr - arr.begin() ==
+            static_cast<std::ptrdiff_t>(pos));
+    REQUIRE(&*itr == &arr(arr.index(itr, 0),
+                          arr.index(itr, 1),
+                          arr.index(itr, 2)));
+    REQUIRE(&*itr >= arr.data());
+    REQUIRE(&*itr < arr.data() + Array::storage_size());
+    visited.insert(&*itr);
+    ++itr;
+  }
+  REQUIRE(itr == arr.end());
+  REQUIRE(visited.size() == Array::size());
+  for(std::size_t pos = Array::size(); pos > 0; pos--) {
+    --itr;
+    REQUIRE(&*itr == &*(arr.begin() + (pos - 1)));
+  }
+  REQUIRE(itr == arr.begin());
+
+  std::size_t run_elems = 0;
+  Array::MAPPING::for_each_run(
+      [&](std::size_t offset, std::size_t n) {
+        for(std::size_t i = 0; i < n; i++) {
+          REQUIRE(visited.count(arr.data() + offset + i) ==
+                  1);
+        }
+        run_elems += n;
+      });
+  REQUIRE(run_elems == Array::size());
+}
+
+template <typename Array>
+static void fill_indices(Array &arr) {
+  for(int i = 0; i < Array::extent(0); i++) {
+    for(int j = 0; j < Array::extent(1); j++) {
+      for(int k = 0; k < Array::extent(2); k++) {
+        arr(i, j, k) = 100 * i + 10 * j + k;
+      }
+    }
+  }
+}
+
+TEST_CASE("column major layout", "[ND_Array]") {
+  ND_Col_Major_Array<int, 2, 3, 4> arr;
+  fill_indices(arr);
+  REQUIRE(&arr(1, 0, 0) == arr.data() + 1);
+  REQUIRE(&arr(0, 1, 0) == arr.data() + 2);
+  REQUIRE(&arr(0, 0, 1) == arr.data() + 6);
+  // The iterators traverse the storage in order
+  REQUIRE(arr.begin()[1] == 100);
+  REQUIRE(*decltype(arr)::offset(arr.begin(), 1, 2, 1) ==
+          121);
+  check_traversal(arr);
+
+  auto view = arr.slice<2>(3);
+  REQUIRE(&view(1, 2) == &arr(1, 2, 3));
+}
+
+TEST_CASE("tiled layout", "[ND_Array]") {
+  SECTION("whole tiles") {
+    ND_Tiled_Array<int, 2, 4, 3, 4, 8> arr;
+    REQUIRE(arr.storage_size() == arr.size());
+    fill_indices(arr);
+    REQUIRE(&arr(0, 0, 4) == arr.data() + 8);
+    REQUIRE(&arr(0, 1, 0) == arr.data() + 4);
+    REQUIRE(&arr(0, 2, 0) == arr.data() + 16);
+    REQUIRE(&arr(1, 0, 0) == arr.data() + 32);
+    check_traversal(arr);
+  }
+  SECTION("partial tiles") {
+    ND_Tiled_Array<int, 4, 4, 2, 7, 5> arr;
+    REQUIRE(arr.storage_size() == 2 * 2 * 2 * 16);
+    fill_indices(arr);
+    check_traversal(arr);
+    const int sum = ND_Array_internals_::reduce(
+        arr, ND_Array_internals_::reduce_sum);
+    int expected = 0;
+    for(int i = 0; i < 2; i++) {
+      for(int j = 0; j < 7; j++) {
+        for(int k = 0; k < 5; k++) {
+          expected += 100 * i + 10 * j + k;
+        }
+      }
+    }
+    REQUIRE(sum == expected);
+    REQUIRE(ND_Array_internals_::simd_max(arr) == 164);
+  }
+}
+
+TEST_CASE("morton layout", "[ND_Array]") {
+  using ND_Array_internals_::deposit_bits;
+  using ND_Array_internals_::extract_bits;
+  REQUIRE(deposit_bits(0b1011, 0b1101'0010) == 0b1001'0010);
+  REQUIRE(extract_bits(0b1001'0110, 0b1101'0010) == 0b1011);
+
+  SECTION("equal extents") {
+    ND_Morton_Array<int, 4, 4, 4> arr;
+    fill_indices(arr);
+    REQUIRE(&arr(0, 0, 1) == arr.data() + 1);
+    REQUIRE(&arr(0, 1, 0) == arr.data() + 2);
+    REQUIRE(&arr(1, 0, 0) == arr.data() + 4);
+    REQUIRE(&arr(0, 0, 2) == arr.data() + 8);
+    REQUIRE(&arr(3, 3, 3) == arr.data() + 63);
+    check_traversal(arr);
+  }
+  SECTION("unequal extents") {
+    ND_Morton_Array<int, 2, 8, 4> arr;
+    REQUIRE(arr.storage_size() == arr.size());
+    fill_indices(arr);
+    check_traversal(arr);
+    // Only the middle dimension has a fourth bit
+    REQUIRE(&arr(0, 4, 0) == arr.data() + 32);
+
+    const ND_Array<int, 2, 8, 4> row(arr);
+    const ND_Morton_Array<int, 2, 8, 4> back(row);
+    REQUIRE(std::equal(arr.cbegin(), arr.cend(),
+                       back.cbegin()));
+    REQUIRE(row(1, 6, 3) == 163);
+  }
+  SECTION("neighbour steps") {
+    using array_t = ND_Morton_Array<int, 4, 8, 2>;
+    using mapping = array_t::MAPPING;
+    for(int i = 0; i < 4; i++) {
+      for(int j = 0; j < 8; j++) {
+        for(int k = 0; k < 2; k++) {
+          const std::size_t c = mapping::slice_idx(i, j, k);
+          // Steps wrap around the edges
+          for(int d = -5; d <= 5; d++) {
+            const int i_d = (i + d + 8) % 4;
+            const int j_d = (j + d + 8) % 8;
+            const int k_d = (k + d + 8) % 2;
+            REQUIRE(mapping::step<0>(c, d) ==
+                    mapping::slice_idx(i_d, j, k));
+            REQUIRE(mapping::step<1>(c, d) ==
+                    mapping::slice_idx(i, j_d, k));
+            REQUIRE(mapping::step<2>(c, d) ==
+                    mapping::slice_idx(i, j, k_d));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("layout conversion", "[ND_Array]") {
+  auto row = std::make_unique<ND_Array<int, 3, 5, 6>>();
+  fill_indices(*row);
+  const ND_Col_Major_Array<int, 3, 5, 6> col(*row);
+  const ND_Tiled_Array<int, 2, 4, 3, 5, 6> tiled(col);
+  const ND_Padded_Array<int, 2, 3, 5, 6> padded(tiled);
+  const ND_Array<int, 3, 5, 6> back(padded);
+  for(int i = 0; i < 3; i++) {
+    for(int j = 0; j < 5; j++) {
+      for(int k = 0; k < 6; k++) {
+        const int expected = 100 * i + 10 * j + k;
+        REQUIRE(col(i, j, k) == expected);
+        REQUIRE(tiled(i, j, k) == expected);
+        REQUIRE(padded(i, j, k) == expected);
+        REQUIRE(back(i, j, k) == expected);
+      }
+    }
+  }
+  // Expressions match the elements by their indices
+  ND_Tiled_Array<int, 2, 4, 3, 5, 6> sum;
+  sum = tiled + col - 2 * *row;
+  for(int v : sum) {
+    REQUIRE(v == 0);
+  }
+  // Reshaping copies are in row major order
+  const ND_Col_Major_Array<int, 15, 6> reshaped(tiled);
+  REQUIRE(reshaped(7, 4) == (*row)(1, 2, 4));
+}
@@ -0,0 +1,91 @@
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+
+#include "nd_array/mapped_array.hpp"
+#include "temp_file.hpp"
+
+#include <unistd.h>
+
+using ND_Array_internals_::io_status;
+using ND_Array_internals_::mmap_advice;
+
+TEST_CASE("mapped arrays", "[ND_Array]") {
+  using array_t = ND_Mapped_Array<double, 4, 5, 6>;
+  temp_file path("mapped_array_test");
+  {
+    auto arr = array_t::create(path.c_str());
+    REQUIRE(arr.status() == io_status::ok);
+    for(double v : arr) {
+      REQUIRE(v == 0.0);
+    }
+    REQUIRE(reinterpret_cast<std::uintptr_t>(arr.data()) %
+                array_t::alignment() ==
+            0);
+    int count = 0;
+    for(double &v : arr) {
+      v = count++;
+    }
+    arr(3, 4, 5) = -1.0;
+    REQUIRE(arr.flush());
+  }
+  SECTION("read only") {
+    ND_Mapped_Array<const double, 4, 5, 6> arr(
+        path.c_str());
+    REQUIRE(arr.is_open());
+    REQUIRE(arr(0, 1, 2) == 8.0);
+    REQUIRE(arr(3, 4, 5) == -1.0);
+    REQUIRE(arr.outer_slice(2)(1, 1) == 2 * 30 + 7);
+    REQUIRE(arr.advise(mmap_advice::sequential));
+    REQUIRE(arr.advise(mmap_advice::willneed, 3));
+    REQUIRE(arr.advise(mmap_advice::random, 1, 2));
+    double sum = 0.0;
+    for(double v : arr.span()) {
+      sum += v;
+    }
+    REQUIRE(sum == 119.0 * 118.0 / 2.0 - 1.0);
+  }
+  SECTION("read write") {
+    {
+      array_t arr(path.c_str());
+      REQUIRE(arr.is_open());
+      arr.outer_slice(1).fill(7.0);
+    }
+    array_t arr(path.c_str());
+    REQUIRE(arr(1, 4, 5) == 7.0);
+    REQUIRE(arr(2, 0, 0) == 60.0);
+    array_t moved(std::move(arr));
+    REQUIRE(!arr.is_open());
+    REQUIRE(moved(1, 0, 0) == 7.0);
+  }
+  SECTION("header checks") {
+    using floats = ND_Mapped_Array<const float, 4, 5, 6>;
+    using reshaped = ND_Mapped_Array<const double, 5, 4, 6>;
+    using col_major_array =
+        ND_Array_internals_::nd_mapped_array_<
+            const double,
+            ND_Array_internals_::CT_Array<size_t, 4, 5, 6>,
+            ND_Array_internals_::col_major>;
+    using doubles = ND_Mapped_Array<const double, 4, 5, 6>;
+    REQUIRE(floats(path.c_str()).status() ==
+            io_status::type_mismatch);
+    REQUIRE(reshaped(path.c_str()).status() ==
+            io_status::shape_mismatch);
+    REQUIRE(col_major_array(path.c_str()).status() ==
+            io_status::shape_mismatch);
+    REQUIRE(doubles("/tmp/nd_array_missing").status() ==
+            io_status::open_failed);
+    REQUIRE(truncate(path.c_str(), 1000) == 0);
+    REQUIRE(doubles(path.c_str()).status() ==
+            io_status::truncated);
+    std::FILE *file = std::fopen(path.c_str(), "r+b");
+    REQUIRE(file != nullptr);
+    std::fputs("NOTARRAY", file);
+    std::fclose(file);
+    REQUIRE(doubles(path.c_str()).status() ==
+            io_status::bad_header);
+  }
+}
@@ -0,0 +1,70 @@
+
+#include "catch.hpp"
+
+#include <memory>
+
+#include "nd_array/matmul.hpp"
+#include "nd_array/nd_array.hpp"
+
+template <typename M1, typename M2, typename M3>
+static void check_matmul() {
+  auto lhs = std::make_unique<M1>();
+  auto rhs = std::make_unique<M2>();
+  auto result = std::make_unique<M3>();
+  // Small integers keep the floating point sums exact
+  int count = 0;
+  for(auto &v : *lhs) {
+    v = count % 7 - 3;
+    count++;
+  }
+  for(auto &v : *rhs) {
+    v = count % 5 - 2;
+    count++;
+  }
+  result->fill(-1);
+  matmul(*lhs, *rhs, *result);
+  for(int i = 0; i < M3::extent(0); i++) {
+    for(int j = 0; j < M3::extent(1); j++) {
+      typename M3::value_type expected = 0;
+      for(int k = 0; k < M1::extent(1); k++) {
+        expected += (*lhs)(i, k) * (*rhs)(k, j);
+      }
+      REQUIRE((*result)(i, j) == expected);
+    }
+  }
+}
+
+TEST_CASE("matmul", "[ND_Array]") {
+  SECTION("small") {
+    check_matmul<ND_Array<double, 1, 1>,
+                 ND_Array<double, 1, 1>,
+                 ND_Array<double, 1, 1>>();
+    check_matmul<ND_Array<double, 3, 2>,
+                 ND_Array<double, 2, 5>,
+                 ND_Array<double, 3, 5>>();
+  }
+  SECTION("partial tiles") {
+    check_matmul<ND_Array<double, 7, 13>,
+                 ND_Array<double, 13, 9>,
+                 ND_Array<double, 7, 9>>();
+    check_matmul<ND_Array<float, 37, 11>,
+                 ND_Array<float, 11, 29>,
+                 ND_Array<float, 37, 29>>();
+  }
+  SECTION("multiple blocks") {
+    check_matmul<ND_Array<double, 80, 100>,
+                 ND_Array<double, 100, 120>,
+                 ND_Array<double, 80, 120>>();
+    check_matmul<ND_Array<double, 130, 1100>,
+                 ND_Array<double, 1100, 70>,
+                 ND_Array<double, 130, 70>>();
+    check_matmul<ND_Array<int, 300, 40>,
+                 ND_Array<int, 40, 1030>,
+                 ND_Array<int, 300, 1030>>();
+  }
+  SECTION("padded") {
+    check_matmul<ND_Padded_Array<double, 3, 17, 19>,
+                 ND_Array<double, 19, 23>,
+                 ND_Padded_Array<double, 5, 17, 23>>();
+  }
+}
@@ -0,0 +1,248 @@
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "nd_array/dyn_array.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/npy.hpp"
+#include "temp_file.hpp"
+
+using ND_Array_internals_::io_status;
+using ND_Array_internals_::load_npy;
+using ND_Array_internals_::npy_header;
+using ND_Array_internals_::npz_reader;
+using ND_Array_internals_::npz_writer;
+using ND_Array_internals_::save_npy;
+
+TEST_CASE("npy dtypes and crc", "[ND_Array]") {
+  using ND_Array_internals_::npy_descr;
+  const std::string order(
+      1, ND_Array_internals_::npy_byte_order());
+  REQUIRE(npy_descr<double>() == order + "f8");
+  REQUIRE(npy_descr<float>() == order + "f4");
+  REQUIRE(npy_descr<std::int32_t>() == order + "i4");
+  REQUIRE(npy_descr<std::uint16_t>() == order + "u2");
+  REQUIRE(npy_descr<std::complex<double>>() ==
+          order + "c16");
+  REQUIRE(npy_descr<bool>() == "|b1");
+  REQUIRE(npy_descr<std::uint8_t>() == "|u1");
+
+  const char check[] = "123456789";
+  REQUIRE(ND_Array_internals_::crc32_update(0, check, 9) ==
+          0xCBF43926u);
+  // Split across the 8 byte blocks
+  const std::uint32_t first =
+      ND_Array_internals_::crc32_update(0, check, 3);
+  REQUIRE(ND_Array_internals_::crc32_update(
+              first, check + 3, 6) == 0xCBF43926u);
+}
+
+TEST_CASE("npy files", "[ND_Array]") {
+  temp_file path("npy_test.npy");
+  using array_t = ND_Array<double, 7, 11, 13>;
+  auto src = std::make_unique<array_t>();
+  int count = 0;
+  for(double &v : *src) {
+    v = 0.5 * count++;
+  }
+  REQUIRE(save_npy(*src, path.c_str()) == io_status::ok);
+
+  SECTION("header") {
+    npy_header header;
+    REQUIRE(ND_Array_internals_::read_npy_header(
+                path.c_str(), header) == io_status::ok);
+    REQUIRE(header.descr ==
+            ND_Array_internals_::npy_descr<double>());
+    REQUIRE(!header.fortran_order);
+    REQUIRE(header.shape.size() == 3);
+    REQUIRE(header.shape[0] == 7);
+    REQUIRE(header.shape[1] == 11);
+    REQUIRE(header.shape[2] == 13);
+    REQUIRE(header.size() == array_t::size());
+    REQUIRE(header.data_offset % 64 == 0);
+  }
+  SECTION("round trip") {
+    io_status status = io_status::io_failed;
+    auto loaded = load_npy<array_t>(path.c_str(), &status);
+    REQUIRE(status == io_status::ok);
+    REQUIRE(loaded != nullptr);
+    REQUIRE(std::equal(loaded->cbegin(), loaded->cend(),
+                       src->cbegin()));
+  }
+  SECTION("runtime extents") {
+    npy_header header;
+    REQUIRE(ND_Array_internals_::read_npy_header(
+                path.c_str(), header) == io_status::ok);
+    ND_Dyn_Array<double, ND_Dynamic, ND_Dynamic, 13> dyn(
+        header.shape[0], header.shape[1]);
+    REQUIRE(load_npy(path.c_str(), dyn) == io_status::ok);
+    REQUIRE(dyn(6, 10, 12) == (*src)(6, 10, 12));
+    dyn(0, 0, 0) = -1.0;
+    REQUIRE(save_npy(dyn, path.c_str()) == io_status::ok);
+    array_t loaded;
+    REQUIRE(load_npy(path.c_str(), loaded) ==
+            io_status::ok);
+    REQUIRE(loaded(0, 0, 0) == -1.0);
+    REQUIRE(loaded(3, 4, 5) == (*src)(3, 4, 5));
+  }
+  SECTION("fortran order") {
+    using col_major_array = ND_Col_Major_Array<float, 3, 4>;
+    col_major_array cols;
+    for(int i = 0; i < 3; i++) {
+      for(int j = 0; j < 4; j++) {
+        cols(i, j) = 10.0f * i + j;
+      }
+    }
+    REQUIRE(save_npy(cols, path.c_str()) == io_status::ok);
+    npy_header header;
+    REQUIRE(ND_Array_internals_::read_npy_header(
+                path.c_str(), header) == io_status::ok);
+    REQUIRE(header.fortran_order);
+    col_major_array loaded;
+    REQUIRE(load_npy(path.c_str(), loaded) ==
+            io_status::ok);
+    REQUIRE(loaded(2, 3) == 23.0f);
+    REQUIRE(loaded(1, 0) == 10.0f);
+    ND_Array<float, 3, 4> rows;
+    REQUIRE(load_npy(path.c_str(), rows) ==
+            io_status::shape_mismatch);
+  }
+  SECTION("mismatches") {
+    using floats = ND_Array<float, 7, 11, 13>;
+    using reshaped = ND_Array<double, 11, 7, 13>;
+    io_status status = io_status::ok;
+    REQUIRE(load_npy<floats>(path.c_str(), &status) ==
+            nullptr);
+    REQUIRE(status == io_status::type_mismatch);
+    REQUIRE(load_npy<reshaped>(path.c_str(), &status) ==
+            nullptr);
+    REQUIRE(status == io_status::shape_mismatch);
+    REQUIRE(load_npy<array_t>("/tmp/nd_array_missing",
+                              &status) == nullptr);
+    REQUIRE(status == io_status::open_failed);
+  }
+  SECTION("mapped") {
+    {
+      ND_Mapped_Npy<double, 7, 11, 13> mapped(path.c_str());
+      REQUIRE(mapped.is_open());
+      REQUIRE(mapped(3, 4, 5) == (*src)(3, 4, 5));
+      mapped(3, 4, 5) = -2.0;
+    }
+    ND_Mapped_Npy<const double, 7, 13, 11> reshaped(
+        path.c_str());
+    REQUIRE(reshaped.status() == io_status::shape_mismatch);
+    array_t loaded;
+    REQUIRE(load_npy(path.c_str(), loaded) ==
+            io_status::ok);
+    REQUIRE(loaded(3, 4, 5) == -2.0);
+  }
+}
+
+TEST_CASE("npy files written by numpy", "[ND_Array]") {
+  temp_file path("npy_numpy.npy");
+  // np.save of np.arange(5, dtype=np.uint8): version 1.0
+  // with the header padded to 128 bytes, but with '|'
+  // replaced by the equivalent '='
+  std::string dict =
+      "{'descr': '=u1', 'fortran_order': False, "
+      "'shape': (5,), }";
+  dict.append(128 - 10 - dict.size() - 1, ' ');
+  dict += '\n';
+  std::string file("\x93NUMPY\x01\x00", 8);
+  file += static_cast<char>(dict.size());
+  file += '\0';
+  file += dict;
+  for(char v = 0; v < 5; v++) {
+    file += v;
+  }
+  std::FILE *out = std::fopen(path.c_str(), "wb");
+  REQUIRE(out != nullptr);
+  std::fwrite(file.data(), 1, file.size(), out);
+  std::fclose(out);
+
+  ND_Array<std::uint8_t, 5> arr;
+  REQUIRE(load_npy(path.c_str(), arr) == io_status::ok);
+  REQUIRE(arr(4) == 4);
+  ND_Array<std::uint8_t, 6> longer;
+  REQUIRE(load_npy(path.c_str(), longer) ==
+          io_status::shape_mismatch);
+  ND_Array<std::int8_t, 5> signed_arr;
+  REQUIRE(load_npy(path.c_str(), signed_arr) ==
+          io_status::type_mismatch);
+}
+
+TEST_CASE("npz archives", "[ND_Array]") {
+  temp_file path("npz_test.npz");
+  ND_Array<double, 4, 5> a;
+  ND_Array<std::int32_t, 9> b;
+  ND_Dyn_Array<float, ND_Dynamic> c(6);
+  int count = 0;
+  for(double &v : a) {
+    v = 1.5 * count++;
+  }
+  for(std::int32_t &v : b) {
+    v = -count++;
+  }
+  for(float &v : c) {
+    v = 0.25f * count++;
+  }
+  {
+    npz_writer writer(path.c_str());
+    REQUIRE(writer.add("a", a) == io_status::ok);
+    REQUIRE(writer.add("b", b) == io_status::ok);
+    REQUIRE(writer.add("c", c) == io_status::ok);
+    REQUIRE(writer.finish() == io_status::ok);
+  }
+
+  npz_reader reader(path.c_str());
+  REQUIRE(reader.status() == io_status::ok);
+  REQUIRE(reader.size() == 3);
+  REQUIRE(reader.name(0) == "a");
+  REQUIRE(reader.name(2) == "c");
+  REQUIRE(reader.contains("b"));
+  REQUIRE(!reader.contains("d"));
+  ND_Array<double, 4, 5> a_loaded;
+  ND_Array<std::int32_t, 9> b_loaded;
+  ND_Array<float, 6> c_loaded;
+  REQUIRE(reader.load("a", a_loaded) == io_status::ok);
+  REQUIRE(reader.load("b", b_loaded) == io_status::ok);
+  REQUIRE(reader.load("c", c_loaded) == io_status::ok);
+  REQUIRE(std::equal(a.cbegin(), a.cend(),
+                     a_loaded.cbegin()));
+  REQUIRE(std::equal(b.cbegin(), b.cend(),
+                     b_loaded.cbegin()));
+  REQUIRE(std::equal(c.cbegin(), c.cend(),
+                     c_loaded.cbegin()));
+  REQUIRE(reader.load("b", a_loaded) ==
+          io_status::type_mismatch);
+  REQUIRE(reader.load("d", a_loaded) ==
+          io_status::open_failed);
+
+  SECTION("corruption") {
+    // The last element of c, before the central directory
+    std::FILE *file = std::fopen(path.c_str(), "r+b");
+    REQUIRE(file != nullptr);
+    std::fseek(file, 0, SEEK_END);
+    const long bytes = std::ftell(file);
+    const long directory = bytes - 22 - 3 * (46 + 5);
+    std::fseek(file, directory - 1, SEEK_SET);
+    std::fputc(0x55, file);
+    std::fclose(file);
+    npz_reader corrupt(path.c_str());
+    REQUIRE(corrupt.load("a", a_loaded) == io_status::ok);
+    REQUIRE(corrupt.load("c", c_loaded) ==
+            io_status::checksum_mismatch);
+  }
+  SECTION("not an archive") {
+    temp_file npy("npz_test.npy");
+    REQUIRE(save_npy(a, npy.c_str()) == io_status::ok);
+    npz_reader not_zip(npy.c_str());
+    REQUIRE(not_zip.status() == io_status::bad_header);
+  }
+}
@@ -0,0 +1,194 @@
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "nd_array/dyn_array.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/parallel.hpp"
+#include "nd_array/span.hpp"
+
+using ND_Array_internals_::parallel_for_each;
+using ND_Array_internals_::parallel_for_tiles;
+using ND_Array_internals_::parallel_policy;
+using ND_Array_internals_::parallel_transform;
+using ND_Array_internals_::schedule;
+using ND_Array_internals_::thread_pool;
+
+TEST_CASE("thread pool", "[Parallel]") {
+  for(unsigned threads : {1u, 2u, 5u}) {
+    thread_pool pool(threads);
+    REQUIRE(pool.size() == threads);
+    for(schedule sched : {schedule::static_chunks,
+                          schedule::dynamic_chunks,
+                          schedule::work_stealing}) {
+      // Every task runs exactly once, including when there
+      // are fewer tasks than threads
+      for(std::size_t tasks : {0, 1, 3, 100}) {
+        std::vector<std::atomic<int>> runs(tasks);
+        pool.run(tasks, sched, [&](std::size_t task) {
+          runs[task]++;
+        });
+        for(const auto &r : runs) {
+          REQUIRE(r == 1);
+        }
+      }
+    }
+    // Nested loops run serially on the calling thread
+    std::atomic<int> total(0);
+    pool.run(8, schedule::dynamic_chunks, [&](std::size_t) {
+      pool.run(4, schedule::static_chunks,
+               [&](std::size_t) { total++; });
+    });
+    REQUIRE(total == 32);
+    // Exceptions from any thread are rethrown by run(), and
+    // the pool can still be used
+    for(std::size_t thrower : {0, 7}) {
+      for(schedule sched : {schedule::static_chunks,
+                            schedule::dynamic_chunks,
+                            schedule::work_stealing}) {
+        REQUIRE_THROWS_WITH(
+            pool.run(8, sched,
+                     [&](std::size_t task) {
+                       if(task == thrower) {
+                         throw std::runtime_error("task");
+                       }
+                     }),
+            "task");
+        REQUIRE(!ND_Array_internals_::in_thread_pool());
+        total = 0;
+        pool.run(8, sched, [&](std::size_t) { total++; });
+        REQUIRE(total == 8);
+      }
+    }
+  }
+}
+
+TEST_CASE("parallel for_each", "[Parallel]") {
+  thread_pool pool(3);
+  auto arr = std::make_unique<ND_Array<int, 7, 9, 11>>();
+  arr->fill(1);
+  for(schedule sched : {schedule::static_chunks,
+                        schedule::dynamic_chunks}) {
+    parallel_for_each(parallel_policy{sched, 10, &pool},
+                      *arr, [](int &v) { v *= 2; });
+  }
+  for(int v : *arr) {
+    REQUIRE(v == 4);
+  }
+  // The padding isn't visited
+  ND_Padded_Array<int, 3, 5, 6> padded;
+  padded.fill(0);
+  parallel_for_each(
+      parallel_policy{schedule::static_chunks, 4, &pool},
+      padded, [](int &v) { v++; });
+  for(int v : padded) {
+    REQUIRE(v == 1);
+  }
+  // Spans and dynamic arrays work as well
+  parallel_for_each(ND_Array_internals_::make_span(*arr),
+                    [](int &v) { v = -v; });
+  REQUIRE((*arr)(6, 8, 10) == -4);
+  ND_Dyn_Array<int, ND_Dynamic, 4> dyn(100);
+  dyn.fill(3);
+  parallel_for_each(
+      parallel_policy{schedule::dynamic_chunks, 7, &pool},
+      dyn, [](int &v) { v += 1; });
+  for(int v : dyn) {
+    REQUIRE(v == 4);
+  }
+}
+
+TEST_CASE("parallel transform", "[Parallel]") {
+  thread_pool pool(4);
+  ND_Array<int, 12, 17> a;
+  ND_Array<int, 12, 17> b;
+  ND_Array<int, 12, 17> dest;
+  for(int i = 0; i < 12; i++) {
+    for(int j = 0; j < 17; j++) {
+      a(i, j) = i;
+      b(i, j) = j;
+    }
+  }
+  parallel_transform(
+      parallel_policy{schedule::dynamic_chunks, 5, &pool},
+      a, b, dest, [](int x, int y) { return 100 * x + y; });
+  for(int i = 0; i < 12; i++) {
+    for(int j = 0; j < 17; j++) {
+      REQUIRE(dest(i, j) == 100 * i + j);
+    }
+  }
+  // The default policy, with one source and the
+  // destination given as a span
+  parallel_transform(
+      dest, ND_Array_internals_::make_span(a),
+      [](int x) { return x + 1; });
+  REQUIRE(a(11, 16) == 1117);
+  // Padded layouts are matched by their iterators
+  ND_Padded_Array<int, 3, 12, 17> padded;
+  parallel_transform(
+      parallel_policy{schedule::static_chunks, 8, &pool},
+      a, padded, [](int x) { return -x; });
+  for(int i = 0; i < 12; i++) {
+    for(int j = 0; j < 17; j++) {
+      REQUIRE(padded(i, j) == -a(i, j));
+    }
+  }
+}
+
+TEST_CASE("work stealing", "[Parallel]") {
+  // A thread which finishes its own tasks takes the rest
+  ND_Array_internals_::stealing_ranges ranges(10, 3);
+  std::vector<int> runs(10);
+  std::size_t task;
+  while(ranges.next(0, task)) {
+    runs[task]++;
+  }
+  for(int r : runs) {
+    REQUIRE(r == 1);
+  }
+  REQUIRE(!ranges.next(1, task));
+  REQUIRE(!ranges.next(2, task));
+}
+
+TEST_CASE("parallel tiles", "[Parallel]") {
+  auto arr = std::make_unique<ND_Array<int, 5, 7, 9>>();
+  for(unsigned threads : {1u, 3u}) {
+    thread_pool pool(threads);
+    for(schedule sched : {schedule::static_chunks,
+                          schedule::dynamic_chunks,
+                          schedule::work_stealing}) {
+      arr->fill(0);
+      // The tiles on the upper edges are partial
+      parallel_for_tiles<2, 3, 4>(
+          parallel_policy{sched, 0, &pool}, *arr,
+          [&](const auto &tile) {
+            for(int i = tile.begin[0]; i < tile.end[0];
+                i++) {
+              for(int j = tile.begin[1]; j < tile.end[1];
+                  j++) {
+                for(int k = tile.begin[2]; k < tile.end[2];
+                    k++) {
+                  (*arr)(i, j, k)++;
+                }
+              }
+            }
+          });
+      for(int v : *arr) {
+        REQUIRE(v == 1);
+      }
+    }
+  }
+  // Catch's assertions can't be used from other threads
+  std::atomic<int> tiles(0);
+  std::atomic<int> full_tiles(0);
+  parallel_for_tiles<5, 1, 9>(*arr, [&](const auto &tile) {
+    tiles++;
+    full_tiles += (tile.size() == 45);
+  });
+  REQUIRE(tiles == 7);
+  REQUIRE(full_tiles == 7);
+}
@@ -1,5 +1,11 @@
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <memory>
+#include <string>
+#include <thread>
 #include <typeinfo>
 
 #include <benchmark/benchmark.h>
@@ -12,9 +18,25 @@ void initialize() {}
 }  // namespace Kokkos
 #endif
 
+#include "nd_array/async_writer.hpp"
+#include "nd_array/chunked.hpp"
+#include "nd_array/dyn_array.hpp"
+#include "nd_array/enumerate.hpp"
+#include "nd_array/expr.hpp"
+#include "nd_array/mapped_array.hpp"
+#include "nd_array/matmul.hpp"
 #include "nd_array/nd_array.hpp"
+#include "nd_array/npy.hpp"
+#include "nd_array/parallel.hpp"
+#include "nd_array/permute.hpp"
+#include "nd_array/reduce.hpp"
+#include "nd_array/serialize.hpp"
+#include "nd_array/simd.hpp"
+#include "nd_array/stencil.hpp"
+#include "nd_array/tiled_range.hpp"
 
 #include "nd_array/zip.hpp"
+#include "nd_array/zip_batched.hpp"
 
 #ifdef COMPARE_XTENSOR
 #include "xtensor/xtensor.hpp"
@@ -100,10 +122,74 @@ static void BM_ND_Array_Iterate_Pointer(
   }
 }
 
+// Places the array one element past the start of a cache
+// line, unless its alignment moves it further; this keeps
+// the unaligned arrays consistently unaligned, so they can
+// be compared against the aligned arrays
+template <typename array_t>
+struct alignas(64) offset_array {
+  typename array_t::value_type offset;
+  array_t array;
+};
+
+template <typename array_t>
 static void BM_ND_Array_Iterate_Iterator(
     benchmark::State &state) {
-  ND_Array<double, 5, 7, 11, 13, 17> array;
+  offset_array<array_t> storage;
+  array_t &array = storage.array;
+  benchmark::DoNotOptimize(array);
+  while(state.KeepRunning()) {
+    for(auto i = array.begin(); i != array.end(); i++) {
+      benchmark::DoNotOptimize(*i);
+    }
+  }
+}
+
+template <typename array_t>
+static void BM_ND_Array_Iterate_Sum(
+    benchmark::State &state) {
+  offset_array<array_t> storage;
+  array_t &array = storage.array;
+  array.fill(1.0);
   benchmark::DoNotOptimize(array);
+  while(state.KeepRunning()) {
+    double sum = 0.0;
+    for(const double v : array) {
+      sum += v;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+// The fully dynamic and the mixed static/dynamic arrays
+// only differ in which strides are known at compile time
+template <typename array_t, typename... int_t>
+static void BM_ND_Dyn_Array_Iterate_Index(
+    benchmark::State &state, int_t... dynamic_extents) {
+  array_t array(dynamic_extents...);
+  benchmark::DoNotOptimize(array.data());
+  while(state.KeepRunning()) {
+    for(int i1 = 0; i1 < 5; i1++) {
+      for(int i2 = 0; i2 < 7; i2++) {
+        for(int i3 = 0; i3 < 11; i3++) {
+          for(int i4 = 0; i4 < 13; i4++) {
+            for(int i5 = 0; i5 < 17; i5++) {
+              const double *val =
+                  &array(i1, i2, i3, i4, i5);
+              benchmark::DoNotOptimize(*val);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename array_t, typename... int_t>
+static void BM_ND_Dyn_Array_Iterate_Iterator(
+    benchmark::State &state, int_t... dynamic_extents) {
+  array_t array(dynamic_extents...);
+  benchmark::DoNotOptimize(array.data());
   while(state.KeepRunning()) {
     for(auto i = array.begin(); i != array.end(); i++) {
       benchmark::DoNotOptimize(*i);
@@ -177,9 +263,11 @@ static void BM_ND_Array_Initialize_Pointer(
   }
 }
 
+template <typename array_t>
 static void BM_ND_Array_Initialize_Iterator(
     benchmark::State &state) {
-  ND_Array<double, 5, 7, 11, 13, 17> array;
+  offset_array<array_t> storage;
+  array_t &array = storage.array;
   benchmark::DoNotOptimize(array);
   double counter = 1.0;
   while(state.KeepRunning()) {
@@ -190,6 +278,42 @@ static void BM_ND_Array_Initialize_Iterator(
   }
 }
 
+template <typename array_t, typename... int_t>
+static void BM_ND_Dyn_Array_Initialize_Index(
+    benchmark::State &state, int_t... dynamic_extents) {
+  array_t array(dynamic_extents...);
+  double counter = 1.0;
+  while(state.KeepRunning()) {
+    for(int i1 = 0; i1 < array.extent(0); i1++) {
+      for(int i2 = 0; i2 < array.extent(1); i2++) {
+        for(int i3 = 0; i3 < array.extent(2); i3++) {
+          for(int i4 = 0; i4 < array.extent(3); i4++) {
+            for(int i5 = 0; i5 < array.extent(4); i5++) {
+              benchmark::DoNotOptimize(
+                  array(i1, i2, i3, i4, i5) = counter);
+              counter += 1.0;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename array_t, typename... int_t>
+static void BM_ND_Dyn_Array_Initialize_Iterator(
+    benchmark::State &state, int_t... dynamic_extents) {
+  array_t array(dynamic_extents...);
+  benchmark::DoNotOptimize(array.data());
+  double counter = 1.0;
+  while(state.KeepRunning()) {
+    for(auto i = array.begin(); i != array.end(); i++) {
+      benchmark::DoNotOptimize(*i = counter);
+      counter += 1.0;
+    }
+  }
+}
+
 static void BM_ND_Array_Iterate_2_Index(
     benchmark::State &state) {
   using array_t = ND_Array<double, 5, 7, 11, 13, 17>;
@@ -263,6 +387,63 @@ static void BM_ND_Array_Iterate_2_Zip(
   }
 }
 
+// Iterate_2_Zip with the elements split into a range for
+// each thread of the pool
+static void BM_ND_Array_Iterate_2_Zip_Split(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 5, 7, 11, 13, 17>;
+  array_t a1, a2;
+  auto &pool = ND_Array_internals_::default_thread_pool();
+  const auto ranges =
+      zip::make_zip(a1, a2).split(pool.size());
+  while(state.KeepRunning()) {
+    pool.run(ranges.size(),
+             ND_Array_internals_::schedule::static_chunks,
+             [&](std::size_t r) {
+               for(auto [v1, v2] : ranges[r]) {
+                 benchmark::DoNotOptimize(v1);
+                 benchmark::DoNotOptimize(v2);
+               }
+             });
+  }
+}
+
+// y += 2 x with a loop over pointers, and with a zip of the
+// const x and mutable y, which should compile to the same
+// vectorized loop
+static void BM_ND_Array_Axpy_Pointer(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 5, 7, 11, 13, 17>;
+  array_t x, y;
+  x.fill(1.0);
+  y.fill(0.0);
+  while(state.KeepRunning()) {
+    const double *src = x.data();
+    double *dest = y.data();
+    for(std::size_t i = 0; i < array_t::size(); i++) {
+      dest[i] += 2.0 * src[i];
+    }
+    benchmark::DoNotOptimize(y.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_ND_Array_Axpy_Zip_Const(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 5, 7, 11, 13, 17>;
+  array_t x, y;
+  x.fill(1.0);
+  y.fill(0.0);
+  const array_t &const_x = x;
+  while(state.KeepRunning()) {
+    for(auto [src, dest] : zip::make_zip(const_x, y)) {
+      dest += 2.0 * src;
+    }
+    benchmark::DoNotOptimize(y.data());
+    benchmark::ClobberMemory();
+  }
+}
+
 static void BM_ND_Array_Initialize_2_Index(
     benchmark::State &state) {
   using array_t = ND_Array<double, 5, 7, 11, 13, 17>;
@@ -348,6 +529,970 @@ static void BM_ND_Array_Initialize_2_Zip(
   }
 }
 
+// Transposes a matrix by looping over the rows of the
+// source, so each write to the destination is to a
+// different row
+static void BM_ND_Array_Transpose_Flat(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 1024, 1024>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  src->fill(1.0);
+  while(state.KeepRunning()) {
+    for(int i = 0; i < array_t::extent(0); i++) {
+      for(int j = 0; j < array_t::extent(1); j++) {
+        (*dest)(j, i) = (*src)(i, j);
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// Transposes a matrix one tile at a time, so the rows of
+// the destination tile stay in the cache
+template <int tile_size>
+static void BM_ND_Array_Transpose_Tiled(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 1024, 1024>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  src->fill(1.0);
+  while(state.KeepRunning()) {
+    for(auto tile :
+        ND_Array_internals_::tiled_range<tile_size,
+                                         tile_size>(*src)) {
+      const int i0 = tile.bounds.begin[0];
+      const int j0 = tile.bounds.begin[1];
+      for(int i = 0; i < int(tile.extent(0)); i++) {
+        for(int j = 0; j < int(tile.extent(1)); j++) {
+          (*dest)(j0 + j, i0 + i) = tile(i, j);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// Transposes a matrix with the cache oblivious permute()
+static void BM_ND_Array_Transpose_Permute(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 1024, 1024>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  src->fill(1.0);
+  while(state.KeepRunning()) {
+    ND_Array_internals_::permute<1, 0>(*src, *dest);
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_ND_Array_Transpose_In_Place(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 1024, 1024>;
+  auto arr = std::make_unique<array_t>();
+  arr->fill(1.0);
+  while(state.KeepRunning()) {
+    ND_Array_internals_::transpose(*arr);
+    benchmark::DoNotOptimize(arr->data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// Reverses the axes of a 3D array by looping over the
+// source
+static void BM_ND_Array_Permute_3D_Loops(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 96, 96, 96>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  src->fill(1.0);
+  while(state.KeepRunning()) {
+    for(int i = 0; i < array_t::extent(0); i++) {
+      for(int j = 0; j < array_t::extent(1); j++) {
+        for(int k = 0; k < array_t::extent(2); k++) {
+          (*dest)(k, j, i) = (*src)(i, j, k);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+}
+
+static void BM_ND_Array_Permute_3D(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 96, 96, 96>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  src->fill(1.0);
+  while(state.KeepRunning()) {
+    ND_Array_internals_::permute<2, 1, 0>(*src, *dest);
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// Stencils with clamped boundaries, computed with loops
+// which clamp the indices of every neighbour, or with
+// apply_stencil(), which only does so in the boundary and
+// vectorizes the interior
+template <bool engine>
+static void BM_ND_Array_Stencil_5_Point(
+    benchmark::State &state) {
+  constexpr int N = 512;
+  using array_t = ND_Array<double, N, N>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  double counter = 1.0;
+  for(double &v : *src) {
+    v = counter;
+    counter += 1.0;
+  }
+  const auto c = [](const int i) {
+    return std::clamp(i, 0, N - 1);
+  };
+  while(state.KeepRunning()) {
+    if constexpr(engine) {
+      ND_Array_internals_::apply_stencil<
+          ND_Array_internals_::star_stencil<2, 1>,
+          ND_Array_internals_::stencil_clamp>(
+          *src, *dest, [](const auto &n) {
+            return n(-1, 0) + n(1, 0) + n(0, -1) +
+                   n(0, 1) - 4.0 * n(0, 0);
+          });
+    } else {
+      const array_t &s = *src;
+      for(int i = 0; i < N; i++) {
+        for(int j = 0; j < N; j++) {
+          (*dest)(i, j) = s(c(i - 1), j) + s(c(i + 1), j) +
+                          s(i, c(j - 1)) + s(i, c(j + 1)) -
+                          4.0 * s(i, j);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          array_t::size());
+}
+
+template <bool engine>
+static void BM_ND_Array_Stencil_7_Point(
+    benchmark::State &state) {
+  constexpr int N = 96;
+  using array_t = ND_Array<double, N, N, N>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  double counter = 1.0;
+  for(double &v : *src) {
+    v = counter;
+    counter += 1.0;
+  }
+  const auto c = [](const int i) {
+    return std::clamp(i, 0, N - 1);
+  };
+  while(state.KeepRunning()) {
+    if constexpr(engine) {
+      ND_Array_internals_::apply_stencil<
+          ND_Array_internals_::star_stencil<3, 1>,
+          ND_Array_internals_::stencil_clamp>(
+          *src, *dest, [](const auto &n) {
+            return n(-1, 0, 0) + n(1, 0, 0) + n(0, -1, 0) +
+                   n(0, 1, 0) + n(0, 0, -1) + n(0, 0, 1) -
+                   6.0 * n(0, 0, 0);
+          });
+    } else {
+      const array_t &s = *src;
+      for(int i = 0; i < N; i++) {
+        for(int j = 0; j < N; j++) {
+          for(int k = 0; k < N; k++) {
+            (*dest)(i, j, k) =
+                s(c(i - 1), j, k) + s(c(i + 1), j, k) +
+                s(i, c(j - 1), k) + s(i, c(j + 1), k) +
+                s(i, j, c(k - 1)) + s(i, j, c(k + 1)) -
+                6.0 * s(i, j, k);
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          array_t::size());
+}
+
+template <bool engine>
+static void BM_ND_Array_Stencil_27_Point(
+    benchmark::State &state) {
+  constexpr int N = 96;
+  using array_t = ND_Array<double, N, N, N>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  double counter = 1.0;
+  for(double &v : *src) {
+    v = counter;
+    counter += 1.0;
+  }
+  const auto c = [](const int i) {
+    return std::clamp(i, 0, N - 1);
+  };
+  while(state.KeepRunning()) {
+    if constexpr(engine) {
+      ND_Array_internals_::apply_stencil<
+          ND_Array_internals_::box_stencil<3, 1>,
+          ND_Array_internals_::stencil_clamp>(
+          *src, *dest, [](const auto &n) {
+            auto sum = 0.0 * n(0, 0, 0);
+            for(int di = -1; di <= 1; di++) {
+              for(int dj = -1; dj <= 1; dj++) {
+                for(int dk = -1; dk <= 1; dk++) {
+                  sum += n(di, dj, dk);
+                }
+              }
+            }
+            return sum;
+          });
+    } else {
+      const array_t &s = *src;
+      for(int i = 0; i < N; i++) {
+        for(int j = 0; j < N; j++) {
+          for(int k = 0; k < N; k++) {
+            double sum = 0.0;
+            for(int di = -1; di <= 1; di++) {
+              for(int dj = -1; dj <= 1; dj++) {
+                for(int dk = -1; dk <= 1; dk++) {
+                  sum += s(c(i + di), c(j + dj), c(k + dk));
+                }
+              }
+            }
+            (*dest)(i, j, k) = sum;
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          array_t::size());
+}
+
+// Sums an array file of 64MB which is in the page cache,
+// either reading it into an array with fread or mapping it
+template <bool mapped>
+static void BM_ND_Array_Load_File(benchmark::State &state) {
+  using file_t = ND_Mapped_Array<double, 1024, 8192>;
+  using array_t = ND_Array<double, 1024, 8192>;
+  const char *path = "/tmp/nd_array_load_benchmark";
+  {
+    auto arr = file_t::create(path);
+    double counter = 0.0;
+    for(double &v : arr) {
+      v = counter;
+      counter += 1.0;
+    }
+  }
+  const std::size_t data_offset =
+      ND_Array_internals_::make_file_header<file_t>()
+          .data_offset;
+  auto buffer = std::make_unique<array_t>();
+  while(state.KeepRunning()) {
+    double sum = 0.0;
+    if constexpr(mapped) {
+      ND_Mapped_Array<const double, 1024, 8192> arr(path);
+      arr.advise(
+          ND_Array_internals_::mmap_advice::sequential);
+      for(const double v : arr) {
+        sum += v;
+      }
+    } else {
+      std::FILE *file = std::fopen(path, "rb");
+      std::fseek(file, data_offset, SEEK_SET);
+      const std::size_t read =
+          std::fread(buffer->data(), sizeof(double),
+                     array_t::size(), file);
+      std::fclose(file);
+      benchmark::DoNotOptimize(read);
+      for(const double v : *buffer) {
+        sum += v;
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  std::remove(path);
+  state.SetBytesProcessed(state.iterations() *
+                          sizeof(array_t));
+}
+
+// Writes and reads back a 16MB array, either with save()
+// and load(), or element by element with file streams
+template <bool serialize>
+static void BM_ND_Array_Save_Load(benchmark::State &state) {
+  using array_t = ND_Array<double, 512, 4096>;
+  const char *path = "/tmp/nd_array_save_benchmark";
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  double counter = 0.0;
+  for(double &v : *src) {
+    v = counter;
+    counter += 1.0;
+  }
+  while(state.KeepRunning()) {
+    if constexpr(serialize) {
+      benchmark::DoNotOptimize(
+          ND_Array_internals_::save(*src, path));
+      benchmark::DoNotOptimize(
+          ND_Array_internals_::load(path, *dest));
+    } else {
+      {
+        std::ofstream out(path, std::ios::binary);
+        for(const double v : *src) {
+          out.write(reinterpret_cast<const char *>(&v),
+                    sizeof(v));
+        }
+      }
+      std::ifstream in(path, std::ios::binary);
+      for(double &v : *dest) {
+        in.read(reinterpret_cast<char *>(&v), sizeof(v));
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+  std::remove(path);
+  state.SetBytesProcessed(state.iterations() * 2 *
+                          sizeof(array_t));
+}
+
+// Writes and reads back a 16MB array as an .npy file, or in
+// an .npz archive, which also computes its CRC-32
+template <bool archive>
+static void BM_ND_Array_Npy_Save_Load(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 512, 4096>;
+  const char *path = "/tmp/nd_array_npy_benchmark";
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  double counter = 0.0;
+  for(double &v : *src) {
+    v = counter;
+    counter += 1.0;
+  }
+  while(state.KeepRunning()) {
+    if constexpr(archive) {
+      {
+        ND_Array_internals_::npz_writer writer(path);
+        benchmark::DoNotOptimize(writer.add("src", *src));
+      }
+      ND_Array_internals_::npz_reader reader(path);
+      benchmark::DoNotOptimize(reader.load("src", *dest));
+    } else {
+      benchmark::DoNotOptimize(
+          ND_Array_internals_::save_npy(*src, path));
+      benchmark::DoNotOptimize(
+          ND_Array_internals_::load_npy(path, *dest));
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+  std::remove(path);
+  state.SetBytesProcessed(state.iterations() * 2 *
+                          sizeof(array_t));
+}
+
+// Sums a 64MB .npy file which is in the page cache by
+// mapping it
+static void BM_ND_Array_Npy_Mapped(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 1024, 8192>;
+  const char *path = "/tmp/nd_array_npy_mapped_benchmark";
+  {
+    auto src = std::make_unique<array_t>();
+    double counter = 0.0;
+    for(double &v : *src) {
+      v = counter;
+      counter += 1.0;
+    }
+    benchmark::DoNotOptimize(
+        ND_Array_internals_::save_npy(*src, path));
+  }
+  while(state.KeepRunning()) {
+    ND_Mapped_Npy<const double, 1024, 8192> arr(path);
+    arr.advise(
+        ND_Array_internals_::mmap_advice::sequential);
+    double sum = 0.0;
+    for(const double v : arr) {
+      sum += v;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  std::remove(path);
+  state.SetBytesProcessed(state.iterations() *
+                          sizeof(array_t));
+}
+
+// Saves or loads a 64MB smooth field as a chunked file at
+// the compression level state.range(0), on every hardware
+// thread; the compressed size is reported as the ratio
+template <bool load>
+static void BM_ND_Array_Chunked(benchmark::State &state) {
+  using array_t = ND_Array<double, 256, 256, 128>;
+  const char *path = "/tmp/nd_array_chunked_benchmark";
+  auto src = std::make_unique<array_t>();
+  for(int i = 0; i < 256; i++) {
+    for(int j = 0; j < 256; j++) {
+      for(int k = 0; k < 128; k++) {
+        (*src)(i, j, k) = std::sin(0.02 * i) *
+                              std::cos(0.03 * j) +
+                          0.001 * k;
+      }
+    }
+  }
+  ND_Array_internals_::chunked_options options;
+  options.level = static_cast<int>(state.range(0));
+  benchmark::DoNotOptimize(
+      ND_Array_internals_::save_chunked(*src, path,
+                                        options));
+  auto dest = std::make_unique<array_t>();
+  while(state.KeepRunning()) {
+    if constexpr(load) {
+      benchmark::DoNotOptimize(
+          ND_Array_internals_::load_chunked(path, *dest));
+      benchmark::DoNotOptimize(dest->data());
+      benchmark::ClobberMemory();
+    } else {
+      benchmark::DoNotOptimize(
+          ND_Array_internals_::save_chunked(*src, path,
+                                            options));
+    }
+  }
+  const ND_Array_internals_::chunked_reader reader(path);
+  state.counters["ratio"] =
+      double(sizeof(array_t)) / reader.compressed_bytes();
+  std::remove(path);
+  state.SetBytesProcessed(state.iterations() *
+                          sizeof(array_t));
+}
+
+// A synthetic time stepping loop, which smooths a field
+// and checkpoints it each step; with async writes the
+// checkpoint is written while the next steps are computed
+enum class checkpoint_mode {
+  none,
+  blocking,
+  thread,
+  io_uring
+};
+
+template <checkpoint_mode mode>
+static void BM_ND_Array_Checkpoint(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 512, 4096>;
+  using ND_Array_internals_::async_backend;
+  using ND_Array_internals_::async_writer;
+  const char *path = "/tmp/nd_array_checkpoint";
+  auto field = std::make_unique<array_t>();
+  auto next = std::make_unique<array_t>();
+  for(int i = 0; i < 512; i++) {
+    for(int j = 0; j < 4096; j++) {
+      (*field)(i, j) =
+          std::sin(0.01 * i) * std::cos(0.002 * j);
+    }
+  }
+  *next = *field;
+  const int sweeps = static_cast<int>(state.range(0));
+  std::unique_ptr<async_writer> writer;
+  if constexpr(mode != checkpoint_mode::none) {
+    writer = std::make_unique<async_writer>(
+        path,
+        sizeof(array_t) +
+            ND_Array_internals_::file_data_offset(),
+        mode == checkpoint_mode::thread
+            ? async_backend::thread
+            : async_backend::automatic);
+  }
+  while(state.KeepRunning()) {
+    for(int s = 0; s < sweeps; s++) {
+      for(int i = 1; i < 511; i++) {
+        for(int j = 1; j < 4095; j++) {
+          (*next)(i, j) =
+              0.2 *
+              ((*field)(i, j) + (*field)(i - 1, j) +
+               (*field)(i + 1, j) + (*field)(i, j - 1) +
+               (*field)(i, j + 1));
+        }
+      }
+      std::swap(field, next);
+    }
+    if constexpr(mode != checkpoint_mode::none) {
+      writer->write_array(*field);
+      if constexpr(mode == checkpoint_mode::blocking) {
+        benchmark::DoNotOptimize(writer->wait());
+      } else {
+        writer->flush();
+      }
+    }
+    benchmark::DoNotOptimize(field->data());
+    benchmark::ClobberMemory();
+  }
+  if(writer != nullptr) {
+    benchmark::DoNotOptimize(writer->close());
+  }
+  std::remove(path);
+  state.SetBytesProcessed(state.iterations() *
+                          sizeof(array_t));
+}
+
+// A source term which depends on the coordinates of each
+// element, computed from the iterator with index()
+static void BM_ND_Array_Coordinates_Index(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 32, 48, 64>;
+  auto arr = std::make_unique<array_t>();
+  while(state.KeepRunning()) {
+    for(auto itr = arr->begin(); itr != arr->end(); ++itr) {
+      *itr = 0.5 * arr->index(itr, 0) +
+             0.25 * arr->index(itr, 1) + arr->index(itr, 2);
+    }
+    benchmark::DoNotOptimize(arr->data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// The same source term, with the coordinates tracked by
+// enumerate()
+static void BM_ND_Array_Coordinates_Enumerate(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 32, 48, 64>;
+  auto arr = std::make_unique<array_t>();
+  while(state.KeepRunning()) {
+    for(auto [idx, v] :
+        ND_Array_internals_::enumerate(*arr)) {
+      v = 0.5 * idx[0] + 0.25 * idx[1] + idx[2];
+    }
+    benchmark::DoNotOptimize(arr->data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// Initializes the arrays to the same values as
+// BM_ND_Array_Initialize_2_Zip, width elements at a time
+template <std::size_t width>
+static void BM_ND_Array_Initialize_2_Zip_Batched(
+    benchmark::State &state) {
+  using array_t = ND_Array<double, 5, 7, 11, 13, 17>;
+  array_t a1, a2;
+  auto z = zip::make_zip_batched<width>(a1, a2);
+  using vec = typename std::tuple_element<
+      0, decltype(*z.begin())>::type::vec;
+  vec lanes{};
+  for(std::size_t i = 0; i < width; i++) {
+    lanes[i] = 2.0 * i;
+  }
+  double counter = 1.0;
+  while(state.KeepRunning()) {
+    for(auto [v1, v2] : z) {
+      const vec c = counter + lanes;
+      v1 = c;
+      v2 = c + 1.0;
+      counter += 2.0 * width;
+    }
+    for(auto [v1, v2] : z.tail()) {
+      v1 = counter;
+      v2 = counter + 1.0;
+      counter += 2.0;
+    }
+    benchmark::DoNotOptimize(a1.data());
+    benchmark::DoNotOptimize(a2.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+// A 7 point stencil sweep over an N^3 array; when N is a
+// power of two, the neighbors in the outer dimensions map
+// onto the same cache sets unless the rows are padded
+template <int N, std::size_t pad>
+static void BM_ND_Array_Stencil_Pow2(
+    benchmark::State &state) {
+  using array_t = ND_Padded_Array<double, pad, N, N, N>;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  double counter = 1.0;
+  for(double &v : *src) {
+    v = counter;
+    counter += 1.0;
+  }
+  while(state.KeepRunning()) {
+    for(int i = 1; i < N - 1; i++) {
+      for(int j = 1; j < N - 1; j++) {
+        for(int k = 1; k < N - 1; k++) {
+          (*dest)(i, j, k) =
+              (*src)(i - 1, j, k) + (*src)(i + 1, j, k) +
+              (*src)(i, j - 1, k) + (*src)(i, j + 1, k) +
+              (*src)(i, j, k - 1) + (*src)(i, j, k + 1) -
+              6.0 * (*src)(i, j, k);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+  }
+}
+
+// Sums a 2D array stored in Layout, either with its
+// iterators, which follow the storage order, or with a row
+// major loop over the indices
+template <typename Layout, bool iterators>
+static void BM_ND_Array_Layout_Iterate(
+    benchmark::State &state) {
+  constexpr int N = 512;
+  using array_t = ND_Array_internals_::nd_array_<
+      double, ND_Array_internals_::CT_Array<size_t, N, N>,
+      alignof(double), Layout>;
+  auto arr = std::make_unique<array_t>();
+  double counter = 1.0;
+  for(double &v : *arr) {
+    v = counter;
+    counter += 1.0;
+  }
+  while(state.KeepRunning()) {
+    double sum = 0.0;
+    if constexpr(iterators) {
+      for(const double v : *arr) {
+        sum += v;
+      }
+    } else {
+      for(int i = 0; i < N; i++) {
+        for(int j = 0; j < N; j++) {
+          sum += (*arr)(i, j);
+        }
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          sizeof(array_t));
+}
+
+// Sums the 7 point neighbourhood of every element of a 3D
+// array with periodic boundaries. The row major and
+// indexed Morton versions compute every neighbour's offset
+// from its indices, the stepped Morton version walks the
+// storage in order and steps to the neighbours without
+// decoding their offsets
+enum class neighbour_access {
+  row_major,
+  morton,
+  morton_step
+};
+
+template <neighbour_access access>
+static void BM_ND_Array_Neighbours_3D(
+    benchmark::State &state) {
+  constexpr int N = 128;
+  using layout_t = typename std::conditional<
+      access == neighbour_access::row_major,
+      ND_Array_internals_::row_major,
+      ND_Array_internals_::morton>::type;
+  using array_t = ND_Array_internals_::nd_array_<
+      float, ND_Array_internals_::CT_Array<size_t, N, N, N>,
+      alignof(float), layout_t>;
+  using mapping = typename array_t::MAPPING;
+  auto src = std::make_unique<array_t>();
+  auto dest = std::make_unique<array_t>();
+  float counter = 0.0f;
+  for(float &v : *src) {
+    v = counter;
+    counter += 1.0f;
+  }
+  const auto wrap = [](const int i) { return i & (N - 1); };
+  while(state.KeepRunning()) {
+    if constexpr(access == neighbour_access::morton_step) {
+      const float *s = src->data();
+      float *d = dest->data();
+      for(std::size_t c = 0; c < array_t::size(); c++) {
+        d[c] = s[c] + s[mapping::template step<0>(c, -1)] +
+               s[mapping::template step<0>(c, 1)] +
+               s[mapping::template step<1>(c, -1)] +
+               s[mapping::template step<1>(c, 1)] +
+               s[mapping::template step<2>(c, -1)] +
+               s[mapping::template step<2>(c, 1)];
+      }
+    } else {
+      const array_t &s = *src;
+      for(int i = 0; i < N; i++) {
+        for(int j = 0; j < N; j++) {
+          for(int k = 0; k < N; k++) {
+            (*dest)(i, j, k) =
+                s(i, j, k) + s(wrap(i - 1), j, k) +
+                s(wrap(i + 1), j, k) +
+                s(i, wrap(j - 1), k) +
+                s(i, wrap(j + 1), k) +
+                s(i, j, wrap(k - 1)) +
+                s(i, j, wrap(k + 1));
+          }
+        }
+      }
+    }
+    benchmark::DoNotOptimize(dest->data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          array_t::size());
+}
+
+// Computes u = a * u + b * (v - w), which is a single pass
+// over the arrays with expression templates, a pass per
+// operation with temporary arrays, or a hand written loop
+using field_t = ND_Array<double, 5, 7, 11, 13, 17>;
+
+template <int variant>
+static void BM_ND_Array_Field_Update(
+    benchmark::State &state) {
+  auto u = std::make_unique<field_t>();
+  auto v = std::make_unique<field_t>();
+  auto w = std::make_unique<field_t>();
+  auto tmp1 = std::make_unique<field_t>();
+  auto tmp2 = std::make_unique<field_t>();
+  u->fill(1.0);
+  v->fill(2.0);
+  w->fill(1.5);
+  const double a = 0.5, b = 0.25;
+  while(state.KeepRunning()) {
+    if constexpr(variant == 0) {
+      *u = a * *u + b * (*v - *w);
+    } else if constexpr(variant == 1) {
+      *tmp1 = *v - *w;
+      *tmp1 = b * *tmp1;
+      *tmp2 = a * *u;
+      *u = *tmp2 + *tmp1;
+    } else {
+      double *u_ptr = u->data();
+      const double *v_ptr = v->data();
+      const double *w_ptr = w->data();
+      for(std::size_t i = 0; i < field_t::size(); i++) {
+        u_ptr[i] = a * u_ptr[i] + b * (v_ptr[i] - w_ptr[i]);
+      }
+    }
+    benchmark::DoNotOptimize(u->data());
+  }
+}
+
+// The explicitly vectorized kernels, run with the given
+// instruction set; reports the bytes read and written
+template <int kernel>
+static void BM_ND_Array_SIMD(
+    benchmark::State &state,
+    const ND_Array_internals_::simd_isa isa) {
+  auto x = std::make_unique<field_t>();
+  auto y = std::make_unique<field_t>();
+  auto z = std::make_unique<field_t>();
+  x->fill(1.0);
+  y->fill(2.0);
+  const auto prev_isa =
+      ND_Array_internals_::active_simd_isa();
+  ND_Array_internals_::set_simd_isa(isa);
+  std::size_t arrays = 0;
+  while(state.KeepRunning()) {
+    if constexpr(kernel == 0) {
+      ND_Array_internals_::simd_axpy(0.5, *x, *y);
+      arrays = 3;
+    } else if constexpr(kernel == 1) {
+      ND_Array_internals_::simd_add(*x, *y, *z);
+      arrays = 3;
+    } else {
+      benchmark::DoNotOptimize(
+          ND_Array_internals_::simd_sum(*x));
+      arrays = 1;
+    }
+    benchmark::DoNotOptimize(y->data());
+    benchmark::DoNotOptimize(z->data());
+  }
+  ND_Array_internals_::set_simd_isa(prev_isa);
+  state.SetBytesProcessed(state.iterations() * arrays *
+                          sizeof(field_t));
+}
+
+// Updates a 128^3 field in place with parallel_for_each,
+// or computes dest = 2 * x + y with parallel_transform, on
+// a pool of state.range(0) threads
+template <bool transform,
+          ND_Array_internals_::schedule sched>
+static void BM_ND_Array_Parallel(benchmark::State &state) {
+  using grid_t = ND_Array<double, 128, 128, 128>;
+  ND_Array_internals_::thread_pool pool(
+      static_cast<unsigned>(state.range(0)));
+  const ND_Array_internals_::parallel_policy policy{
+      sched, 0, &pool};
+  auto x = std::make_unique<grid_t>();
+  auto y = std::make_unique<grid_t>();
+  auto dest = std::make_unique<grid_t>();
+  double counter = 1.0;
+  for(double &v : *x) {
+    v = counter;
+    counter += 1.0;
+  }
+  y->fill(1.0);
+  while(state.KeepRunning()) {
+    if constexpr(transform) {
+      ND_Array_internals_::parallel_transform(
+          policy, *x, *y, *dest,
+          [](double a, double b) { return 2.0 * a + b; });
+      benchmark::DoNotOptimize(dest->data());
+    } else {
+      ND_Array_internals_::parallel_for_each(
+          policy, *x,
+          [](double &v) { v = v * 0.5 + 1.0; });
+      benchmark::DoNotOptimize(x->data());
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          (transform ? 3 : 2) *
+                          sizeof(grid_t));
+}
+
+// Updates a 64^3 grid in 8^3 tiles with parallel_for_tiles,
+// where the cells of the first eighth of the grid iterate
+// 64 times as often as the others, so the tiles of one
+// thread's static block take most of the time
+template <ND_Array_internals_::schedule sched>
+static void BM_ND_Array_Tiles_Imbalanced(
+    benchmark::State &state) {
+  using grid_t = ND_Array<double, 64, 64, 64>;
+  ND_Array_internals_::thread_pool pool;
+  const ND_Array_internals_::parallel_policy policy{
+      sched, 0, &pool};
+  auto grid = std::make_unique<grid_t>();
+  grid->fill(1.0);
+  while(state.KeepRunning()) {
+    ND_Array_internals_::parallel_for_tiles<8, 8, 8>(
+        policy, *grid, [&](const auto &tile) {
+          const int iters = tile.begin[0] < 8 ? 64 : 1;
+          for(int i = tile.begin[0]; i < tile.end[0]; i++) {
+            for(int j = tile.begin[1]; j < tile.end[1];
+                j++) {
+              for(int k = tile.begin[2]; k < tile.end[2];
+                  k++) {
+                double v = (*grid)(i, j, k);
+                for(int n = 0; n < iters; n++) {
+                  v = std::sqrt(v + 1.0);
+                }
+                (*grid)(i, j, k) = v;
+              }
+            }
+          }
+        });
+    benchmark::DoNotOptimize(grid->data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          grid_t::size());
+}
+
+// Sums field_t along Axis, with the reduction or with a
+// loop computing the indices with index()
+template <int Axis>
+static void BM_ND_Array_Reduce(benchmark::State &state,
+                               const unsigned threads) {
+  using result_t =
+      ND_Array_internals_::reduced_array_t<Axis, field_t>;
+  auto arr = std::make_unique<field_t>();
+  auto result = std::make_unique<result_t>();
+  double counter = 1.0;
+  for(double &v : *arr) {
+    v = counter;
+    counter += 1.0;
+  }
+  while(state.KeepRunning()) {
+    ND_Array_internals_::reduce<Axis>(
+        *arr, ND_Array_internals_::reduce_sum, *result,
+        threads);
+    benchmark::DoNotOptimize(result->data());
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          sizeof(field_t));
+}
+
+template <int Axis>
+static void BM_ND_Array_Reduce_Index_Loop(
+    benchmark::State &state) {
+  using result_t =
+      ND_Array_internals_::reduced_array_t<Axis, field_t>;
+  auto arr = std::make_unique<field_t>();
+  auto result = std::make_unique<result_t>();
+  double counter = 1.0;
+  for(double &v : *arr) {
+    v = counter;
+    counter += 1.0;
+  }
+  while(state.KeepRunning()) {
+    result->fill(0.0);
+    for(auto itr = arr->cbegin(); itr != arr->cend();
+        ++itr) {
+      int out = 0;
+      for(int d = 0; d < field_t::dimension(); d++) {
+        if(d != Axis) {
+          out = out * field_t::extent(d) +
+                arr->index(itr, d);
+        }
+      }
+      result->data()[out] += *itr;
+    }
+    benchmark::DoNotOptimize(result->data());
+  }
+  state.SetBytesProcessed(state.iterations() *
+                          sizeof(field_t));
+}
+
+// Sums the boundary face of a cube normal to Axis, either
+// directly through a strided view or after gathering it
+// into a contiguous array
+template <int Axis, bool gather>
+static void BM_ND_Array_Boundary_Face(
+    benchmark::State &state) {
+  constexpr int N = 64;
+  using array_t = ND_Array<double, N, N, N>;
+  auto arr = std::make_unique<array_t>();
+  auto face = std::make_unique<ND_Array<double, N, N>>();
+  double counter = 1.0;
+  for(double &v : *arr) {
+    v = counter;
+    counter += 1.0;
+  }
+  while(state.KeepRunning()) {
+    double sum = 0.0;
+    const auto view = arr->template slice<Axis>(N - 1);
+    if constexpr(gather) {
+      std::copy(view.cbegin(), view.cend(), face->begin());
+      for(double v : *face) {
+        sum += v;
+      }
+    } else {
+      for(double v : view) {
+        sum += v;
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * N * N *
+                          sizeof(double));
+}
+
+// Reports the floating point operations per second of the
+// matrix multiplications, for comparison against the peak
+static void set_mmul_flops(benchmark::State &state,
+                           const size_t D1, const size_t D2,
+                           const size_t D3) {
+  state.counters["FLOPS"] = benchmark::Counter(
+      2.0 * D1 * D2 * D3,
+      benchmark::Counter::kIsIterationInvariantRate);
+}
+
 #ifdef COMPARE_XTENSOR
 
 static xt::xtensor<double, 2> &mmul_xtensor(
@@ -368,10 +1513,11 @@ static xt::xtensor<double, 2> &mmul_xtensor(
   return result;
 }
 
+template <size_t D1, size_t D2, size_t D3>
 static void BM_XTensor_MMul(benchmark::State &state) {
-  xt::xtensor<double, 2> a1({80, 100});
-  xt::xtensor<double, 2> a2({100, 120});
-  xt::xtensor<double, 2> a3({80, 120});
+  xt::xtensor<double, 2> a1({D1, D2});
+  xt::xtensor<double, 2> a2({D2, D3});
+  xt::xtensor<double, 2> a3({D1, D3});
   double counter = 1.0;
   for(double &v : a1) {
     v = counter;
@@ -388,6 +1534,7 @@ static void BM_XTensor_MMul(benchmark::State &state) {
   while(state.KeepRunning()) {
     benchmark::DoNotOptimize(mmul_xtensor(a1, a2, a3));
   }
+  set_mmul_flops(state, D1, D2, D3);
 }
 
 #endif  // COMPARE_XTENSOR
@@ -412,11 +1559,12 @@ static M3 &mmul_nd_array(const M1 &lhs, const M2 &rhs,
   return result;
 }
 
+template <size_t D1, size_t D2, size_t D3>
 static void BM_ND_Array_Deref_MMul(
     benchmark::State &state) {
-  auto a1 = std::make_unique<ND_Array<double, 80, 100>>();
-  auto a2 = std::make_unique<ND_Array<double, 100, 120>>();
-  auto a3 = std::make_unique<ND_Array<double, 80, 120>>();
+  auto a1 = std::make_unique<ND_Array<double, D1, D2>>();
+  auto a2 = std::make_unique<ND_Array<double, D2, D3>>();
+  auto a3 = std::make_unique<ND_Array<double, D1, D3>>();
   double counter = 1.0;
   for(double &v : *a1) {
     v = counter;
@@ -433,12 +1581,14 @@ static void BM_ND_Array_Deref_MMul(
   while(state.KeepRunning()) {
     benchmark::DoNotOptimize(mmul_nd_array(*a1, *a2, *a3));
   }
+  set_mmul_flops(state, D1, D2, D3);
 }
 
+template <size_t D1, size_t D2, size_t D3>
 static void BM_ND_Array_MMul(benchmark::State &state) {
-  ND_Array<double, 80, 100> a1;
-  ND_Array<double, 100, 120> a2;
-  ND_Array<double, 80, 120> a3;
+  ND_Array<double, D1, D2> a1;
+  ND_Array<double, D2, D3> a2;
+  ND_Array<double, D1, D3> a3;
   double counter = 1.0;
   for(double &v : a1) {
     v = counter;
@@ -455,6 +1605,65 @@ static void BM_ND_Array_MMul(benchmark::State &state) {
   while(state.KeepRunning()) {
     benchmark::DoNotOptimize(mmul_nd_array(a1, a2, a3));
   }
+  set_mmul_flops(state, D1, D2, D3);
+}
+
+template <size_t D1, size_t D2, size_t D3>
+static void BM_ND_Array_Blocked_MMul(
+    benchmark::State &state) {
+  auto a1 = std::make_unique<ND_Array<double, D1, D2>>();
+  auto a2 = std::make_unique<ND_Array<double, D2, D3>>();
+  auto a3 = std::make_unique<ND_Array<double, D1, D3>>();
+  double counter = 1.0;
+  for(double &v : *a1) {
+    v = counter;
+    counter += 1.0;
+  }
+  for(double &v : *a2) {
+    v = counter;
+    counter += 1.0;
+  }
+  for(double &v : *a3) {
+    v = std::numeric_limits<double>::quiet_NaN();
+  }
+
+  while(state.KeepRunning()) {
+    benchmark::DoNotOptimize(matmul(*a1, *a2, *a3));
+  }
+  set_mmul_flops(state, D1, D2, D3);
+}
+
+// The naive multiplication with every array stored in
+// Layout, whose access pattern favors row major arrays
+template <typename Layout, size_t D1, size_t D2, size_t D3>
+static void BM_ND_Array_Layout_MMul(
+    benchmark::State &state) {
+  using ND_Array_internals_::CT_Array;
+  using ND_Array_internals_::nd_array_;
+  using lhs_t = nd_array_<double, CT_Array<size_t, D1, D2>,
+                          alignof(double), Layout>;
+  using rhs_t = nd_array_<double, CT_Array<size_t, D2, D3>,
+                          alignof(double), Layout>;
+  using result_t =
+      nd_array_<double, CT_Array<size_t, D1, D3>,
+                alignof(double), Layout>;
+  auto a1 = std::make_unique<lhs_t>();
+  auto a2 = std::make_unique<rhs_t>();
+  auto a3 = std::make_unique<result_t>();
+  double counter = 1.0;
+  for(double &v : *a1) {
+    v = counter;
+    counter += 1.0;
+  }
+  for(double &v : *a2) {
+    v = counter;
+    counter += 1.0;
+  }
+
+  while(state.KeepRunning()) {
+    benchmark::DoNotOptimize(mmul_nd_array(*a1, *a2, *a3));
+  }
+  set_mmul_flops(state, D1, D2, D3);
 }
 
 template <size_t d>
@@ -475,10 +1684,8 @@ static array_2d<D3> mmul_c_array(const double lhs[D1][D2],
   return result;
 }
 
+template <size_t D1, size_t D2, size_t D3>
 static void BM_C_Array_MMul(benchmark::State &state) {
-  constexpr size_t D1 = 80;
-  constexpr size_t D2 = 100;
-  constexpr size_t D3 = 120;
   double a1[D1][D2];
   double a2[D2][D3];
   double a3[D1][D3];
@@ -505,6 +1712,7 @@ static void BM_C_Array_MMul(benchmark::State &state) {
     benchmark::DoNotOptimize(
         mmul_c_array<D1, D2, D3>(a1, a2, a3));
   }
+  set_mmul_flops(state, D1, D2, D3);
 }
 
 static double *mmul_ptr_array(const double *lhs,
@@ -524,10 +1732,8 @@ static double *mmul_ptr_array(const double *lhs,
   return result;
 }
 
+template <size_t D1, size_t D2, size_t D3>
 static void BM_C_Ptr_MMul(benchmark::State &state) {
-  constexpr size_t D1 = 80;
-  constexpr size_t D2 = 100;
-  constexpr size_t D3 = 120;
   double a1[D1][D2];
   double a2[D2][D3];
   double a3[D1][D3];
@@ -554,6 +1760,33 @@ static void BM_C_Ptr_MMul(benchmark::State &state) {
     benchmark::DoNotOptimize(mmul_ptr_array(
         &a1[0][0], &a2[0][0], &a3[0][0], D1, D2, D3));
   }
+  set_mmul_flops(state, D1, D2, D3);
+}
+
+// Registers each of the matrix multiplication benchmarks
+// for a D1 x D2 by D2 x D3 product
+template <size_t D1, size_t D2, size_t D3>
+static void register_mmul(const std::string &suffix) {
+#ifdef COMPARE_XTENSOR
+  benchmark::RegisterBenchmark(
+      ("BM_XTensor_MMul" + suffix).c_str(),
+      BM_XTensor_MMul<D1, D2, D3>);
+#endif  // COMPARE_XTENSOR
+  benchmark::RegisterBenchmark(
+      ("BM_ND_Array_Deref_MMul" + suffix).c_str(),
+      BM_ND_Array_Deref_MMul<D1, D2, D3>);
+  benchmark::RegisterBenchmark(
+      ("BM_ND_Array_MMul" + suffix).c_str(),
+      BM_ND_Array_MMul<D1, D2, D3>);
+  benchmark::RegisterBenchmark(
+      ("BM_ND_Array_Blocked_MMul" + suffix).c_str(),
+      BM_ND_Array_Blocked_MMul<D1, D2, D3>);
+  benchmark::RegisterBenchmark(
+      ("BM_C_Array_MMul" + suffix).c_str(),
+      BM_C_Array_MMul<D1, D2, D3>);
+  benchmark::RegisterBenchmark(
+      ("BM_C_Ptr_MMul" + suffix).c_str(),
+      BM_C_Ptr_MMul<D1, D2, D3>);
 }
 
 int main(int argc, char **argv) {
@@ -561,22 +1794,178 @@ int main(int argc, char **argv) {
 
   benchmark::RegisterBenchmark("BM_Null", BM_Null);
 
-#ifdef COMPARE_XTENSOR
-  benchmark::RegisterBenchmark("BM_XTensor_MMul",
-                               BM_XTensor_MMul);
-#endif  // COMPARE_XTENSOR
-  benchmark::RegisterBenchmark("BM_ND_Array_Deref_MMul",
-                               BM_ND_Array_Deref_MMul);
-  benchmark::RegisterBenchmark("BM_ND_Array_MMul",
-                               BM_ND_Array_MMul);
-  benchmark::RegisterBenchmark("BM_C_Array_MMul",
-                               BM_C_Array_MMul);
-  benchmark::RegisterBenchmark("BM_C_Ptr_MMul",
-                               BM_C_Ptr_MMul);
-#ifdef COMPARE_XTENSOR
-  benchmark::RegisterBenchmark("BM_XTensor_MMul_2",
-                               BM_XTensor_MMul);
-#endif  // COMPARE_XTENSOR
+  register_mmul<80, 100, 120>("");
+  register_mmul<128, 128, 128>("_128");
+  register_mmul<256, 256, 256>("_256");
+
+  using ND_Array_internals_::col_major;
+  using ND_Array_internals_::row_major;
+  using tiled_8x8 = ND_Array_internals_::tiled<8, 8>;
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_MMul_Row_Major_128",
+      BM_ND_Array_Layout_MMul<row_major, 128, 128, 128>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_MMul_Col_Major_128",
+      BM_ND_Array_Layout_MMul<col_major, 128, 128, 128>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_MMul_Tiled_128",
+      BM_ND_Array_Layout_MMul<tiled_8x8, 128, 128, 128>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_Iterate_Row_Major",
+      BM_ND_Array_Layout_Iterate<row_major, true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_Iterate_Col_Major",
+      BM_ND_Array_Layout_Iterate<col_major, true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_Iterate_Tiled",
+      BM_ND_Array_Layout_Iterate<tiled_8x8, true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_Index_Row_Major",
+      BM_ND_Array_Layout_Iterate<row_major, false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_Index_Col_Major",
+      BM_ND_Array_Layout_Iterate<col_major, false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Layout_Index_Tiled",
+      BM_ND_Array_Layout_Iterate<tiled_8x8, false>);
+
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Neighbours_3D_Row_Major",
+      BM_ND_Array_Neighbours_3D<
+          neighbour_access::row_major>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Neighbours_3D_Morton",
+      BM_ND_Array_Neighbours_3D<neighbour_access::morton>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Neighbours_3D_Morton_Step",
+      BM_ND_Array_Neighbours_3D<
+          neighbour_access::morton_step>);
+
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Field_Update_Expr",
+      BM_ND_Array_Field_Update<0>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Field_Update_Temporaries",
+      BM_ND_Array_Field_Update<1>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Field_Update_Loop",
+      BM_ND_Array_Field_Update<2>);
+
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Boundary_Face_Inner_View",
+      BM_ND_Array_Boundary_Face<2, false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Boundary_Face_Inner_Gather",
+      BM_ND_Array_Boundary_Face<2, true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Boundary_Face_Middle_View",
+      BM_ND_Array_Boundary_Face<1, false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Boundary_Face_Middle_Gather",
+      BM_ND_Array_Boundary_Face<1, true>);
+
+  const unsigned hw_threads =
+      std::max(std::thread::hardware_concurrency(), 1u);
+  using ND_Array_internals_::schedule;
+  constexpr schedule static_chunks =
+      schedule::static_chunks;
+  constexpr schedule dynamic_chunks =
+      schedule::dynamic_chunks;
+  for(auto bm :
+      {benchmark::RegisterBenchmark(
+           "BM_ND_Array_Parallel_For_Each",
+           BM_ND_Array_Parallel<false, static_chunks>),
+       benchmark::RegisterBenchmark(
+           "BM_ND_Array_Parallel_Transform_Static",
+           BM_ND_Array_Parallel<true, static_chunks>),
+       benchmark::RegisterBenchmark(
+           "BM_ND_Array_Parallel_Transform_Dynamic",
+           BM_ND_Array_Parallel<true, dynamic_chunks>)}) {
+    // Scales from 1 thread to every hardware thread
+    for(unsigned threads = 1; threads < hw_threads;
+        threads *= 2) {
+      bm->Arg(threads);
+    }
+    bm->Arg(hw_threads);
+    bm->UseRealTime();
+  }
+
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Tiles_Imbalanced_Static",
+      BM_ND_Array_Tiles_Imbalanced<static_chunks>)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Tiles_Imbalanced_Dynamic",
+      BM_ND_Array_Tiles_Imbalanced<dynamic_chunks>)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Tiles_Imbalanced_Stealing",
+      BM_ND_Array_Tiles_Imbalanced<schedule::work_stealing>)
+      ->UseRealTime();
+
+  benchmark::RegisterBenchmark("BM_ND_Array_Reduce_Inner",
+                               BM_ND_Array_Reduce<4>, 1u);
+  benchmark::RegisterBenchmark("BM_ND_Array_Reduce_Middle",
+                               BM_ND_Array_Reduce<2>, 1u);
+  benchmark::RegisterBenchmark("BM_ND_Array_Reduce_Outer",
+                               BM_ND_Array_Reduce<0>, 1u);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Reduce_Inner_Parallel",
+      BM_ND_Array_Reduce<4>, hw_threads);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Reduce_Middle_Parallel",
+      BM_ND_Array_Reduce<2>, hw_threads);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Reduce_Outer_Parallel",
+      BM_ND_Array_Reduce<0>, hw_threads);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Reduce_Inner_Index_Loop",
+      BM_ND_Array_Reduce_Index_Loop<4>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Reduce_Middle_Index_Loop",
+      BM_ND_Array_Reduce_Index_Loop<2>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Reduce_Outer_Index_Loop",
+      BM_ND_Array_Reduce_Index_Loop<0>);
+
+  for(auto isa : {ND_Array_internals_::simd_isa::scalar,
+                  ND_Array_internals_::simd_isa::sse2,
+                  ND_Array_internals_::simd_isa::avx2,
+                  ND_Array_internals_::simd_isa::avx512}) {
+    if(!ND_Array_internals_::simd_isa_supported(isa)) {
+      continue;
+    }
+    const std::string name =
+        ND_Array_internals_::simd_isa_name(isa);
+    benchmark::RegisterBenchmark(
+        ("BM_ND_Array_SIMD_Axpy_" + name).c_str(),
+        BM_ND_Array_SIMD<0>, isa);
+    benchmark::RegisterBenchmark(
+        ("BM_ND_Array_SIMD_Add_" + name).c_str(),
+        BM_ND_Array_SIMD<1>, isa);
+    benchmark::RegisterBenchmark(
+        ("BM_ND_Array_SIMD_Sum_" + name).c_str(),
+        BM_ND_Array_SIMD<2>, isa);
+  }
+
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_Pow2_32",
+      BM_ND_Array_Stencil_Pow2<32, 0>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_Pow2_32_Padded",
+      BM_ND_Array_Stencil_Pow2<32, 8>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_Pow2_64",
+      BM_ND_Array_Stencil_Pow2<64, 0>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_Pow2_64_Padded",
+      BM_ND_Array_Stencil_Pow2<64, 8>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_Pow2_128",
+      BM_ND_Array_Stencil_Pow2<128, 0>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_Pow2_128_Padded",
+      BM_ND_Array_Stencil_Pow2<128, 8>);
 
   benchmark::RegisterBenchmark("BM_ND_Array_Create",
                                BM_ND_Array_Create);
@@ -588,9 +1977,48 @@ int main(int argc, char **argv) {
   benchmark::RegisterBenchmark(
       "BM_ND_Array_Iterate_Pointer",
       BM_ND_Array_Iterate_Pointer);
+  using array_t = ND_Array<double, 5, 7, 11, 13, 17>;
+  using array_32_t =
+      ND_Aligned_Array<double, 32, 5, 7, 11, 13, 17>;
+  using array_64_t =
+      ND_Aligned_Array<double, 64, 5, 7, 11, 13, 17>;
   benchmark::RegisterBenchmark(
       "BM_ND_Array_Iterate_Iterator",
-      BM_ND_Array_Iterate_Iterator);
+      BM_ND_Array_Iterate_Iterator<array_t>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Iterate_Iterator_Aligned_32",
+      BM_ND_Array_Iterate_Iterator<array_32_t>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Iterate_Iterator_Aligned_64",
+      BM_ND_Array_Iterate_Iterator<array_64_t>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Iterate_Sum",
+      BM_ND_Array_Iterate_Sum<array_t>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Iterate_Sum_Aligned_32",
+      BM_ND_Array_Iterate_Sum<array_32_t>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Iterate_Sum_Aligned_64",
+      BM_ND_Array_Iterate_Sum<array_64_t>);
+
+  using dyn_array_t =
+      ND_Dyn_Array<double, ND_Dynamic, ND_Dynamic,
+                   ND_Dynamic, ND_Dynamic, ND_Dynamic>;
+  using mixed_array_t =
+      ND_Dyn_Array<double, ND_Dynamic, 7, 11, 13, 17>;
+  benchmark::RegisterBenchmark(
+      "BM_ND_Dyn_Array_Iterate_Index",
+      BM_ND_Dyn_Array_Iterate_Index<dyn_array_t, int, int,
+                                    int, int, int>,
+      5, 7, 11, 13, 17);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Mixed_Array_Iterate_Index",
+      BM_ND_Dyn_Array_Iterate_Index<mixed_array_t, int>, 5);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Dyn_Array_Iterate_Iterator",
+      BM_ND_Dyn_Array_Iterate_Iterator<dyn_array_t, int,
+                                       int, int, int, int>,
+      5, 7, 11, 13, 17);
 
   benchmark::RegisterBenchmark("BM_C_Array_Initialize",
                                BM_C_Array_Initialize);
@@ -602,7 +2030,28 @@ int main(int argc, char **argv) {
       BM_ND_Array_Initialize_Pointer);
   benchmark::RegisterBenchmark(
       "BM_ND_Array_Initialize_Iterator",
-      BM_ND_Array_Initialize_Iterator);
+      BM_ND_Array_Initialize_Iterator<array_t>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Initialize_Iterator_Aligned_32",
+      BM_ND_Array_Initialize_Iterator<array_32_t>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Initialize_Iterator_Aligned_64",
+      BM_ND_Array_Initialize_Iterator<array_64_t>);
+
+  benchmark::RegisterBenchmark(
+      "BM_ND_Dyn_Array_Initialize_Index",
+      BM_ND_Dyn_Array_Initialize_Index<dyn_array_t, int,
+                                       int, int, int, int>,
+      5, 7, 11, 13, 17);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Mixed_Array_Initialize_Index",
+      BM_ND_Dyn_Array_Initialize_Index<mixed_array_t, int>,
+      5);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Dyn_Array_Initialize_Iterator",
+      BM_ND_Dyn_Array_Initialize_Iterator<
+          dyn_array_t, int, int, int, int, int>,
+      5, 7, 11, 13, 17);
 
   benchmark::RegisterBenchmark(
       "BM_ND_Array_Iterate_2_Index",
@@ -615,6 +2064,14 @@ int main(int argc, char **argv) {
       BM_ND_Array_Iterate_2_Iterator);
   benchmark::RegisterBenchmark("BM_ND_Array_Iterate_2_Zip",
                                BM_ND_Array_Iterate_2_Zip);
+  benchmark::RegisterBenchmark("BM_ND_Array_Axpy_Pointer",
+                               BM_ND_Array_Axpy_Pointer);
+  benchmark::RegisterBenchmark("BM_ND_Array_Axpy_Zip_Const",
+                               BM_ND_Array_Axpy_Zip_Const);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Iterate_2_Zip_Split",
+      BM_ND_Array_Iterate_2_Zip_Split)
+      ->UseRealTime();
 
   benchmark::RegisterBenchmark(
       "BM_ND_Array_Initialize_2_Index",
@@ -628,6 +2085,106 @@ int main(int argc, char **argv) {
   benchmark::RegisterBenchmark(
       "BM_ND_Array_Initialize_2_Zip",
       BM_ND_Array_Initialize_2_Zip);
+  benchmark::RegisterBenchmark("BM_ND_Array_Transpose_Flat",
+                               BM_ND_Array_Transpose_Flat);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Transpose_Tiled<8>",
+      BM_ND_Array_Transpose_Tiled<8>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Transpose_Tiled<16>",
+      BM_ND_Array_Transpose_Tiled<16>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Transpose_Permute",
+      BM_ND_Array_Transpose_Permute);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Transpose_In_Place",
+      BM_ND_Array_Transpose_In_Place);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Permute_3D_Loops",
+      BM_ND_Array_Permute_3D_Loops);
+  benchmark::RegisterBenchmark("BM_ND_Array_Permute_3D",
+                               BM_ND_Array_Permute_3D);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_5_Point_Clamped_Loops",
+      BM_ND_Array_Stencil_5_Point<false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_5_Point",
+      BM_ND_Array_Stencil_5_Point<true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_7_Point_Clamped_Loops",
+      BM_ND_Array_Stencil_7_Point<false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_7_Point",
+      BM_ND_Array_Stencil_7_Point<true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_27_Point_Clamped_Loops",
+      BM_ND_Array_Stencil_27_Point<false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Stencil_27_Point",
+      BM_ND_Array_Stencil_27_Point<true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Load_File_Fread",
+      BM_ND_Array_Load_File<false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Load_File_Mapped",
+      BM_ND_Array_Load_File<true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Save_Load_Stream",
+      BM_ND_Array_Save_Load<false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Save_Load",
+      BM_ND_Array_Save_Load<true>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Npy_Save_Load",
+      BM_ND_Array_Npy_Save_Load<false>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Npz_Save_Load",
+      BM_ND_Array_Npy_Save_Load<true>);
+  benchmark::RegisterBenchmark("BM_ND_Array_Npy_Mapped",
+                               BM_ND_Array_Npy_Mapped);
+  for(auto *bm : {benchmark::RegisterBenchmark(
+                     "BM_ND_Array_Chunked_Save",
+                     BM_ND_Array_Chunked<false>),
+                 benchmark::RegisterBenchmark(
+                     "BM_ND_Array_Chunked_Load",
+                     BM_ND_Array_Chunked<true>)}) {
+    for(int level : {0, 1, 3, 6, 9}) {
+      bm->Arg(level);
+    }
+    bm->UseRealTime();
+  }
+  for(auto *bm :
+      {benchmark::RegisterBenchmark(
+           "BM_ND_Array_Checkpoint_None",
+           BM_ND_Array_Checkpoint<checkpoint_mode::none>),
+       benchmark::RegisterBenchmark(
+           "BM_ND_Array_Checkpoint_Blocking",
+           BM_ND_Array_Checkpoint<
+               checkpoint_mode::blocking>),
+       benchmark::RegisterBenchmark(
+           "BM_ND_Array_Checkpoint_Thread",
+           BM_ND_Array_Checkpoint<checkpoint_mode::thread>),
+       benchmark::RegisterBenchmark(
+           "BM_ND_Array_Checkpoint_Io_Uring",
+           BM_ND_Array_Checkpoint<
+               checkpoint_mode::io_uring>)}) {
+    for(int sweeps : {1, 4}) {
+      bm->Arg(sweeps);
+    }
+    bm->UseRealTime();
+  }
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Coordinates_Index",
+      BM_ND_Array_Coordinates_Index);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Coordinates_Enumerate",
+      BM_ND_Array_Coordinates_Enumerate);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Initialize_2_Zip_Batched<4>",
+      BM_ND_Array_Initialize_2_Zip_Batched<4>);
+  benchmark::RegisterBenchmark(
+      "BM_ND_Array_Initialize_2_Zip_Batched<8>",
+      BM_ND_Array_Initialize_2_Zip_Batched<8>);
 
   benchmark::Initialize(&argc, argv);
   benchmark::RunSpecifiedBenchmarks();
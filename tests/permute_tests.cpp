@@ -0,0 +1,136 @@
+
+#include "catch.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "nd_array/nd_array.hpp"
+#include "nd_array/permute.hpp"
+
+using ND_Array_internals_::permute;
+using ND_Array_internals_::permuted_array_t;
+using ND_Array_internals_::transpose;
+
+template <typename Array>
+static void fill_indices(Array &arr) {
+  for(int i = 0; i < Array::extent(0); i++) {
+    for(int j = 0; j < Array::extent(1); j++) {
+      for(int k = 0; k < Array::extent(2); k++) {
+        arr(i, j, k) = 10000 * i + 100 * j + k;
+      }
+    }
+  }
+}
+
+// Permutes src and checks that each element of the result
+// is the source element with its indices reordered
+template <int a0, int a1, int a2, typename Array>
+static void check_permute(const Array &src) {
+  auto dest = std::make_unique<
+      permuted_array_t<Array, a0, a1, a2>>();
+  permute<a0, a1, a2>(src, *dest);
+  for(int i = 0; i < Array::extent(0); i++) {
+    for(int j = 0; j < Array::extent(1); j++) {
+      for(int k = 0; k < Array::extent(2); k++) {
+        const std::array<int, 3> idx = {i, j, k};
+        REQUIRE((*dest)(idx[a0], idx[a1], idx[a2]) ==
+                src(i, j, k));
+      }
+    }
+  }
+}
+
+TEST_CASE("permute", "[ND_Array]") {
+  SECTION("all permutations") {
+    auto src = std::make_unique<ND_Array<int, 5, 7, 9>>();
+    fill_indices(*src);
+    check_permute<0, 1, 2>(*src);
+    check_permute<0, 2, 1>(*src);
+    check_permute<1, 0, 2>(*src);
+    check_permute<1, 2, 0>(*src);
+    check_permute<2, 0, 1>(*src);
+    check_permute<2, 1, 0>(*src);
+  }
+  SECTION("split into pieces") {
+    // Large enough to be split, with partial vectors
+    auto src =
+        std::make_unique<ND_Array<double, 19, 33, 45>>();
+    fill_indices(*src);
+    check_permute<2, 0, 1>(*src);
+    check_permute<0, 2, 1>(*src);
+    check_permute<1, 0, 2>(*src);
+  }
+  SECTION("layouts") {
+    auto src = std::make_unique<
+        ND_Col_Major_Array<int, 6, 10, 17>>();
+    fill_indices(*src);
+    check_permute<2, 1, 0>(*src);
+    auto padded = std::make_unique<
+        ND_Padded_Array<int, 3, 17, 6, 10>>();
+    permute<2, 0, 1>(*src, *padded);
+    REQUIRE((*padded)(16, 5, 9) == (*src)(5, 9, 16));
+  }
+  SECTION("2D transpose") {
+    using matrix = ND_Array<float, 70, 100>;
+    auto src = std::make_unique<matrix>();
+    auto dest =
+        std::make_unique<permuted_array_t<matrix, 1, 0>>();
+    static_assert(
+        std::is_same<permuted_array_t<matrix, 1, 0>,
+                     ND_Array<float, 100, 70>>::value,
+        "The extents must be permuted");
+    int count = 0;
+    for(float &v : *src) {
+      v = count++;
+    }
+    permute<1, 0>(*src, *dest);
+    for(int i = 0; i < 70; i++) {
+      for(int j = 0; j < 100; j++) {
+        REQUIRE((*dest)(j, i) == (*src)(i, j));
+      }
+    }
+  }
+  SECTION("non-arithmetic elements") {
+    ND_Array<std::string, 3, 4> src;
+    ND_Array<std::string, 4, 3> dest;
+    for(int i = 0; i < 3; i++) {
+      for(int j = 0; j < 4; j++) {
+        src(i, j) = std::to_string(10 * i + j);
+      }
+    }
+    permute<1, 0>(src, dest);
+    REQUIRE(dest(3, 2) == "23");
+  }
+}
+
+// Transposes arr in place and checks the result against a
+// copy
+template <typename Array>
+static void check_transpose(Array &arr) {
+  auto copy = std::make_unique<Array>();
+  int count = 0;
+  for(auto &v : arr) {
+    v = count++;
+  }
+  *copy = arr;
+  transpose(arr);
+  for(int i = 0; i < Array::extent(0); i++) {
+    for(int j = 0; j < Array::extent(1); j++) {
+      REQUIRE(arr(i, j) == (*copy)(j, i));
+    }
+  }
+}
+
+TEST_CASE("transpose in place", "[ND_Array]") {
+  check_transpose(*std::make_unique<ND_Array<int, 5, 5>>());
+  check_transpose(
+      *std::make_unique<ND_Array<double, 64, 64>>());
+  check_transpose(
+      *std::make_unique<ND_Array<float, 101, 101>>());
+  check_transpose(*std::make_unique<
+                  ND_Padded_Array<double, 3, 50, 50>>());
+  check_transpose(
+      *std::make_unique<ND_Col_Major_Array<int, 70, 70>>());
+}
@@ -0,0 +1,166 @@
+
+#include "catch.hpp"
+
+#include <cmath>
+#include <memory>
+
+#include "nd_array/nd_array.hpp"
+#include "nd_array/reduce.hpp"
+
+using ND_Array_internals_::reduce;
+using ND_Array_internals_::reduce_max;
+using ND_Array_internals_::reduce_mean;
+using ND_Array_internals_::reduce_min;
+using ND_Array_internals_::reduce_norm;
+using ND_Array_internals_::reduce_sum;
+
+template <typename Array>
+static std::unique_ptr<Array> make_reduce_array() {
+  auto arr = std::make_unique<Array>();
+  int count = 0;
+  for(auto &v : *arr) {
+    // Small integers keep the sums exact
+    v = count % 23 - 11;
+    count++;
+  }
+  return arr;
+}
+
+// Compares the reductions along each axis of a 3D array
+// against loops over the indices
+template <typename Array>
+static void check_axis_reductions(const unsigned threads) {
+  const auto arr = make_reduce_array<Array>();
+  constexpr int d0 = Array::extent(0);
+  constexpr int d1 = Array::extent(1);
+  constexpr int d2 = Array::extent(2);
+
+  auto sum0 = std::make_unique<
+      ND_Array_internals_::reduced_array_t<0, Array>>();
+  reduce<0>(*arr, reduce_sum, *sum0, threads);
+  auto min1 = std::make_unique<
+      ND_Array_internals_::reduced_array_t<1, Array>>();
+  reduce<1>(*arr, reduce_min, *min1, threads);
+  auto max2 = std::make_unique<
+      ND_Array_internals_::reduced_array_t<2, Array>>();
+  reduce<2>(*arr, reduce_max, *max2, threads);
+  auto mean2 = std::make_unique<
+      ND_Array_internals_::reduced_array_t<2, Array>>();
+  reduce<2>(*arr, reduce_mean, *mean2, threads);
+  auto norm1 = std::make_unique<
+      ND_Array_internals_::reduced_array_t<1, Array>>();
+  reduce<1>(*arr, reduce_norm, *norm1, threads);
+
+  for(int j = 0; j < d1; j++) {
+    for(int k = 0; k < d2; k++) {
+      double expected = 0;
+      for(int i = 0; i < d0; i++) {
+        expected += (*arr)(i, j, k);
+      }
+      REQUIRE((*sum0)(j, k) == expected);
+    }
+  }
+  for(int i = 0; i < d0; i++) {
+    for(int k = 0; k < d2; k++) {
+      double expected_min = (*arr)(i, 0, k);
+      double expected_sq = 0;
+      for(int j = 0; j < d1; j++) {
+        expected_min =
+            std::min(expected_min, (*arr)(i, j, k));
+        expected_sq += (*arr)(i, j, k) * (*arr)(i, j, k);
+      }
+      REQUIRE((*min1)(i, k) == expected_min);
+      REQUIRE((*norm1)(i, k) ==
+              Approx(std::sqrt(expected_sq)));
+    }
+  }
+  for(int i = 0; i < d0; i++) {
+    for(int j = 0; j < d1; j++) {
+      double expected_max = (*arr)(i, j, 0);
+      double expected_sum = 0;
+      for(int k = 0; k < d2; k++) {
+        expected_max =
+            std::max(expected_max, (*arr)(i, j, k));
+        expected_sum += (*arr)(i, j, k);
+      }
+      REQUIRE((*max2)(i, j) == expected_max);
+      REQUIRE((*mean2)(i, j) == Approx(expected_sum / d2));
+    }
+  }
+
+  double expected_sum = 0;
+  double expected_min = arr->front();
+  double expected_max = arr->front();
+  for(double v : *arr) {
+    expected_sum += v;
+    expected_min = std::min(expected_min, v);
+    expected_max = std::max(expected_max, v);
+  }
+  REQUIRE(reduce(*arr, reduce_sum, threads) ==
+          expected_sum);
+  REQUIRE(reduce(*arr, reduce_min, threads) ==
+          expected_min);
+  REQUIRE(reduce(*arr, reduce_max, threads) ==
+          expected_max);
+  REQUIRE(reduce(*arr, reduce_mean, threads) ==
+          Approx(expected_sum / Array::size()));
+}
+
+TEST_CASE("axis reductions", "[ND_Array]") {
+  SECTION("small") {
+    check_axis_reductions<ND_Array<double, 3, 4, 5>>(1);
+    check_axis_reductions<ND_Array<double, 7, 1, 37>>(1);
+  }
+  SECTION("padded") {
+    check_axis_reductions<
+        ND_Padded_Array<double, 3, 5, 6, 13>>(1);
+  }
+  SECTION("parallel") {
+    check_axis_reductions<ND_Array<double, 9, 64, 129>>(4);
+    check_axis_reductions<
+        ND_Padded_Array<double, 5, 9, 64, 129>>(3);
+  }
+  SECTION("returned array") {
+    const ND_Array<int, 2, 3> arr = [] {
+      ND_Array<int, 2, 3> init;
+      int count = 0;
+      for(int &v : init) {
+        v = count;
+        count++;
+      }
+      return init;
+    }();
+    const ND_Array<int, 3> sum = reduce<0>(arr, reduce_sum);
+    REQUIRE(sum(0) == 3);
+    REQUIRE(sum(1) == 5);
+    REQUIRE(sum(2) == 7);
+    const ND_Array<int, 2> max = reduce<1>(arr, reduce_max);
+    REQUIRE(max(0) == 2);
+    REQUIRE(max(1) == 5);
+  }
+}
+
+TEST_CASE("pairwise summation", "[ND_Array]") {
+  using array_t = ND_Array<float, 1024, 1024>;
+  auto arr = std::make_unique<array_t>();
+  arr->fill(0.1f);
+  const double exact = 0.1f * double(array_t::size());
+  float sequential = 0.0f;
+  for(float v : *arr) {
+    sequential += v;
+  }
+  const float pairwise = reduce(*arr, reduce_sum);
+  REQUIRE(std::abs(pairwise - exact) / exact < 1e-5);
+  // The sequential sum loses several digits
+  REQUIRE(std::abs(pairwise - exact) <
+          std::abs(sequential - exact));
+}
+
+using Removed0 = ND_Array_internals_::remove_axis_array<
+    1, ND_Array_internals_::CT_Array<int, 2, 3, 5>>::type;
+static_assert(Removed0::len() == 2,
+              "remove_axis_array failed");
+static_assert(Removed0::value(0) == 2,
+              "remove_axis_array failed");
+static_assert(Removed0::value(1) == 5,
+              "remove_axis_array failed");
@@ -0,0 +1,102 @@
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+#include "nd_array/mapped_array.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/serialize.hpp"
+#include "nd_array/span.hpp"
+#include "temp_file.hpp"
+
+#include <unistd.h>
+
+using ND_Array_internals_::io_status;
+using ND_Array_internals_::load;
+using ND_Array_internals_::save;
+
+TEST_CASE("serialization", "[ND_Array]") {
+  temp_file path("serialize_test");
+  using array_t = ND_Array<double, 7, 11, 13>;
+  auto src = std::make_unique<array_t>();
+  int count = 0;
+  for(double &v : *src) {
+    v = 0.5 * count++;
+  }
+  REQUIRE(save(*src, path.c_str()) == io_status::ok);
+
+  SECTION("round trip") {
+    io_status status = io_status::io_failed;
+    auto loaded = load<array_t>(path.c_str(), &status);
+    REQUIRE(status == io_status::ok);
+    REQUIRE(loaded != nullptr);
+    REQUIRE(std::equal(loaded->cbegin(), loaded->cend(),
+                       src->cbegin()));
+    array_t into;
+    REQUIRE(load(path.c_str(), into) == io_status::ok);
+    REQUIRE(into(6, 10, 12) == (*src)(6, 10, 12));
+  }
+  SECTION("spans and layouts") {
+    using padded_t = ND_Padded_Array<float, 5, 9, 10>;
+    padded_t padded;
+    padded.fill(2.0f);
+    padded(8, 9) = 3.0f;
+    REQUIRE(save(ND_Array_internals_::make_span(padded),
+                 path.c_str()) == io_status::ok);
+    padded_t loaded;
+    ND_Array_internals_::nd_span_<float,
+                                  padded_t::DIMS,
+                                  alignof(float),
+                                  padded_t::LAYOUT>
+        span(loaded);
+    REQUIRE(load(path.c_str(), span) == io_status::ok);
+    REQUIRE(std::equal(loaded.cbegin(), loaded.cend(),
+                       padded.cbegin()));
+    ND_Array<float, 9, 10> row_major;
+    REQUIRE(load(path.c_str(), row_major) ==
+            io_status::shape_mismatch);
+  }
+  SECTION("mismatches") {
+    using floats = ND_Array<float, 7, 11, 13>;
+    using reshaped = ND_Array<double, 11, 7, 13>;
+    io_status status = io_status::ok;
+    REQUIRE(load<floats>(path.c_str(), &status) == nullptr);
+    REQUIRE(status == io_status::type_mismatch);
+    REQUIRE(load<reshaped>(path.c_str(), &status) ==
+            nullptr);
+    REQUIRE(status == io_status::shape_mismatch);
+    REQUIRE(load<array_t>("/tmp/nd_array_missing",
+                          &status) == nullptr);
+    REQUIRE(status == io_status::open_failed);
+  }
+  SECTION("corruption") {
+    const long offset =
+        ND_Array_internals_::file_data_offset() + 100;
+    std::FILE *file = std::fopen(path.c_str(), "r+b");
+    REQUIRE(file != nullptr);
+    std::fseek(file, offset, SEEK_SET);
+    std::fputc(0x55, file);
+    std::fclose(file);
+    array_t loaded;
+    REQUIRE(load(path.c_str(), loaded) ==
+            io_status::checksum_mismatch);
+    REQUIRE(truncate(path.c_str(), offset) == 0);
+    REQUIRE(load(path.c_str(), loaded) ==
+            io_status::truncated);
+  }
+  SECTION("mapped files") {
+    {
+      ND_Mapped_Array<double, 7, 11, 13> mapped(
+          path.c_str());
+      REQUIRE(mapped.is_open());
+      REQUIRE(mapped(3, 4, 5) == (*src)(3, 4, 5));
+      mapped(3, 4, 5) = -1.0;
+    }
+    // Mapping the file for writing drops the checksum
+    auto loaded = load<array_t>(path.c_str());
+    REQUIRE(loaded != nullptr);
+    REQUIRE((*loaded)(3, 4, 5) == -1.0);
+  }
+}
@@ -0,0 +1,115 @@
+
+#include "catch.hpp"
+
+#include <memory>
+
+#include "nd_array/nd_array.hpp"
+#include "nd_array/simd.hpp"
+
+using ND_Array_internals_::simd_isa;
+
+template <typename Array>
+static void check_simd_kernels() {
+  using value_type = typename Array::value_type;
+  auto x = std::make_unique<Array>();
+  auto y = std::make_unique<Array>();
+  auto z = std::make_unique<Array>();
+  int count = 0;
+  for(auto &v : *x) {
+    v = static_cast<value_type>(count % 17 + 1);
+    count++;
+  }
+  for(auto &v : *y) {
+    v = static_cast<value_type>(count % 13 + 1);
+    count++;
+  }
+  // Extreme values in the middle and at the end, so they
+  // land in both the vector loop and the tail
+  x->at(Array::extent(0) / 2, 1) = value_type(100);
+  x->back() = value_type(-100);
+
+  ND_Array_internals_::simd_fill(*z, value_type(3));
+  for(value_type v : *z) {
+    REQUIRE(v == value_type(3));
+  }
+
+  ND_Array_internals_::simd_copy(*x, *z);
+  auto x_itr = x->cbegin();
+  for(value_type v : *z) {
+    REQUIRE(v == *x_itr);
+    ++x_itr;
+  }
+
+  ND_Array_internals_::simd_axpy(value_type(2), *x, *z);
+  x_itr = x->cbegin();
+  for(value_type v : *z) {
+    REQUIRE(v == 3 * *x_itr);
+    ++x_itr;
+  }
+
+  ND_Array_internals_::simd_add(*x, *y, *z);
+  x_itr = x->cbegin();
+  auto y_itr = y->cbegin();
+  for(value_type v : *z) {
+    REQUIRE(v == *x_itr + *y_itr);
+    ++x_itr;
+    ++y_itr;
+  }
+  ND_Array_internals_::simd_sub(*x, *y, *z);
+  x_itr = x->cbegin();
+  y_itr = y->cbegin();
+  for(value_type v : *z) {
+    REQUIRE(v == *x_itr - *y_itr);
+    ++x_itr;
+    ++y_itr;
+  }
+  ND_Array_internals_::simd_mul(*x, *y, *z);
+  x_itr = x->cbegin();
+  y_itr = y->cbegin();
+  for(value_type v : *z) {
+    REQUIRE(v == *x_itr * *y_itr);
+    ++x_itr;
+    ++y_itr;
+  }
+  ND_Array_internals_::simd_div(*x, *y, *z);
+  x_itr = x->cbegin();
+  y_itr = y->cbegin();
+  for(value_type v : *z) {
+    REQUIRE(v == *x_itr / *y_itr);
+    ++x_itr;
+    ++y_itr;
+  }
+
+  // The values are small integers, so the sum is exact
+  value_type sum = 0;
+  for(value_type v : *x) {
+    sum += v;
+  }
+  REQUIRE(ND_Array_internals_::simd_sum(*x) == sum);
+  REQUIRE(ND_Array_internals_::simd_min(*x) ==
+          value_type(-100));
+  REQUIRE(ND_Array_internals_::simd_max(*x) ==
+          value_type(100));
+}
+
+TEST_CASE("simd kernels", "[ND_Array]") {
+  const simd_isa detected =
+      ND_Array_internals_::active_simd_isa();
+  REQUIRE(detected ==
+          ND_Array_internals_::detect_simd_isa());
+  for(simd_isa isa : {simd_isa::scalar, simd_isa::sse2,
+                      simd_isa::avx2, simd_isa::avx512}) {
+    if(!ND_Array_internals_::simd_isa_supported(isa)) {
+      continue;
+    }
+    ND_Array_internals_::set_simd_isa(isa);
+    SECTION(ND_Array_internals_::simd_isa_name(isa)) {
+      check_simd_kernels<ND_Array<double, 37, 29>>();
+      check_simd_kernels<ND_Array<float, 5, 3>>();
+      check_simd_kernels<ND_Array<int, 7, 61>>();
+      check_simd_kernels<
+          ND_Padded_Array<double, 5, 9, 13>>();
+    }
+  }
+  ND_Array_internals_::set_simd_isa(detected);
+}
@@ -0,0 +1,107 @@
+
+#include "catch.hpp"
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "nd_array/expr.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/span.hpp"
+
+TEST_CASE("span of external buffer", "[ND_Span]") {
+  std::vector<int> buffer(30);
+  for(std::size_t i = 0; i < buffer.size(); i++) {
+    buffer[i] = static_cast<int>(i);
+  }
+  const ND_Span<int, 2, 3, 5> span(buffer.data());
+  REQUIRE(span.size() == 30);
+  REQUIRE(span.extent(1) == 3);
+  REQUIRE(span.data() == buffer.data());
+  for(int i = 0; i < 2; i++) {
+    for(int j = 0; j < 3; j++) {
+      for(int k = 0; k < 5; k++) {
+        REQUIRE(&span(i, j, k) ==
+                &buffer[i * 15 + j * 5 + k]);
+      }
+    }
+  }
+  // Writes go to the buffer, even through a const span
+  span(1, 2, 3) = -1;
+  REQUIRE(buffer[28] == -1);
+  REQUIRE(span.back() == 29);
+
+  auto slice = span.outer_slice(1);
+  REQUIRE(slice.dimension() == 2);
+  REQUIRE(&slice(2, 3) == &buffer[28]);
+  auto row = span.outer_slice(1, 2);
+  REQUIRE(&row(4) == &buffer[29]);
+
+  auto reshaped = span.reshape<ND_Array<int, 6, 5>>();
+  REQUIRE(&reshaped(5, 3) == &buffer[28]);
+
+  auto col = span.slice<2>(3);
+  REQUIRE(&col(1, 2) == &buffer[28]);
+
+  int count = 0;
+  for(int &v : span) {
+    REQUIRE(&v == &buffer[count]);
+    count++;
+  }
+  REQUIRE(span.index(span.cbegin() + 28, 1) == 2);
+  REQUIRE(*span.offset(span.begin(), 1, 1, 1) == 21);
+
+  span.fill(7);
+  for(int v : buffer) {
+    REQUIRE(v == 7);
+  }
+}
+
+TEST_CASE("span of array", "[ND_Span]") {
+  using array_t = ND_Padded_Array<double, 3, 4, 5>;
+  auto arr = std::make_unique<array_t>();
+  auto span = ND_Array_internals_::make_span(*arr);
+  static_assert(std::is_same<decltype(span)::MAPPING,
+                             array_t::MAPPING>::value,
+                "Spans of arrays must have their layout");
+  int count = 0;
+  for(double &v : span) {
+    v = count;
+    count++;
+  }
+  for(int i = 0; i < 4; i++) {
+    for(int j = 0; j < 5; j++) {
+      REQUIRE(&span(i, j) == &(*arr)(i, j));
+      REQUIRE((*arr)(i, j) == i * 5 + j);
+    }
+  }
+
+  const auto &const_arr = *arr;
+  ND_Array_internals_::nd_span_<
+      const double, array_t::DIMS, alignof(double),
+      array_t::LAYOUT>
+      const_span =
+          ND_Array_internals_::make_span(const_arr);
+  static_assert(
+      std::is_same<decltype(const_span(0, 0)),
+                   const double &>::value,
+      "Spans of const arrays must be const");
+  decltype(const_span) converted = span;
+  REQUIRE(converted.data() == const_span.data());
+}
+
+TEST_CASE("span expressions", "[ND_Span]") {
+  std::vector<double> u_buf(12, 1.0), v_buf(12, 2.0);
+  ND_Span<double, 3, 4> u(u_buf.data());
+  const ND_Span<const double, 3, 4> v(v_buf.data());
+  ND_Array<double, 3, 4> w;
+  w.fill(0.5);
+  u = 2.0 * u + v * w;
+  for(double x : u_buf) {
+    REQUIRE(x == 3.0);
+  }
+  w = u - v;
+  for(double x : w) {
+    REQUIRE(x == 1.0);
+  }
+}
@@ -0,0 +1,153 @@
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <memory>
+
+#include "nd_array/nd_array.hpp"
+#include "nd_array/stencil.hpp"
+
+using ND_Array_internals_::apply_stencil;
+using ND_Array_internals_::box_stencil;
+using ND_Array_internals_::stencil_clamp;
+using ND_Array_internals_::stencil_footprint;
+using ND_Array_internals_::stencil_ghost;
+using ND_Array_internals_::stencil_periodic;
+using ND_Array_internals_::stencil_point;
+using ND_Array_internals_::star_stencil;
+
+TEST_CASE("stencil footprints", "[ND_Array]") {
+  static_assert(star_stencil<2, 1>::size() == 5);
+  static_assert(star_stencil<3, 1>::size() == 7);
+  static_assert(box_stencil<3, 1>::size() == 27);
+  static_assert(star_stencil<2, 2>::halo_low(1) == 2);
+  static_assert(star_stencil<2, 2>::contains(0, -2));
+  static_assert(!star_stencil<2, 2>::contains(1, 1));
+  static_assert(box_stencil<2, 1>::contains(1, -1));
+  using upwind =
+      stencil_footprint<stencil_point<0, 0>,
+                        stencil_point<-2, 0>,
+                        stencil_point<0, 1>>;
+  static_assert(upwind::halo_low(0) == 2);
+  static_assert(upwind::halo_high(0) == 0);
+  static_assert(upwind::halo_low(1) == 0);
+  static_assert(upwind::halo_high(1) == 1);
+}
+
+// The 5 point laplacian at (i, j), reading the neighbours
+// through Boundary
+template <typename Boundary, typename Array>
+static double laplacian(const Array &a, const int i,
+                        const int j) {
+  const int rows = Array::extent(0);
+  const int cols = Array::extent(1);
+  const auto at = [&](const int di, const int dj) {
+    return a(Boundary::index(i + di, rows),
+             Boundary::index(j + dj, cols));
+  };
+  return at(-1, 0) + at(1, 0) + at(0, -1) + at(0, 1) -
+         4.0 * at(0, 0);
+}
+
+template <typename Boundary, typename Array>
+static void check_laplacian(const int seed) {
+  auto src = std::make_unique<Array>();
+  auto dest = std::make_unique<Array>();
+  int count = seed;
+  for(double &v : *src) {
+    v = (count * 37) % 101;
+    count++;
+  }
+  apply_stencil<star_stencil<2, 1>, Boundary>(
+      *src, *dest, [](const auto &n) {
+        return n(-1, 0) + n(1, 0) + n(0, -1) + n(0, 1) -
+               4.0 * n(0, 0);
+      });
+  for(int i = 0; i < Array::extent(0); i++) {
+    for(int j = 0; j < Array::extent(1); j++) {
+      REQUIRE((*dest)(i, j) ==
+              laplacian<Boundary>(*src, i, j));
+    }
+  }
+}
+
+TEST_CASE("stencils", "[ND_Array]") {
+  SECTION("boundary policies") {
+    check_laplacian<stencil_periodic,
+                    ND_Array<double, 13, 37>>(0);
+    check_laplacian<stencil_clamp,
+                    ND_Array<double, 20, 16>>(5);
+  }
+  SECTION("layouts") {
+    check_laplacian<stencil_periodic,
+                    ND_Padded_Array<double, 3, 11, 29>>(2);
+    check_laplacian<stencil_clamp,
+                    ND_Col_Major_Array<double, 31, 9>>(7);
+  }
+  SECTION("arrays smaller than the halo") {
+    check_laplacian<stencil_periodic,
+                    ND_Array<double, 1, 5>>(1);
+    check_laplacian<stencil_clamp,
+                    ND_Array<double, 2, 1>>(3);
+  }
+  SECTION("ghost boundary") {
+    ND_Array<int, 6, 19> src;
+    ND_Array<int, 6, 19> dest;
+    int count = 0;
+    for(int &v : src) {
+      v = count++;
+    }
+    dest.fill(-1);
+    apply_stencil<star_stencil<2, 2>>(
+        src, dest, [](const auto &n) {
+          return n(-2, 0) + n(2, 0) + n(0, -2) + n(0, 2);
+        });
+    for(int i = 0; i < 6; i++) {
+      for(int j = 0; j < 19; j++) {
+        if(i < 2 || i >= 4 || j < 2 || j >= 17) {
+          REQUIRE(dest(i, j) == -1);
+        } else {
+          REQUIRE(dest(i, j) == 4 * src(i, j));
+        }
+      }
+    }
+  }
+  SECTION("27 point box") {
+    using array_t = ND_Array<float, 7, 9, 21>;
+    auto src = std::make_unique<array_t>();
+    auto dest = std::make_unique<array_t>();
+    int count = 0;
+    for(float &v : *src) {
+      v = count++ % 17;
+    }
+    apply_stencil<box_stencil<3, 1>, stencil_clamp>(
+        *src, *dest, [](const auto &n) {
+          auto sum = n(0, 0, 0);
+          for(int i = -1; i <= 1; i++) {
+            for(int j = -1; j <= 1; j++) {
+              for(int k = -1; k <= 1; k++) {
+                sum += n(i, j, k);
+              }
+            }
+          }
+          return sum - n(0, 0, 0);
+        });
+    for(int i = 0; i < 7; i++) {
+      for(int j = 0; j < 9; j++) {
+        for(int k = 0; k < 21; k++) {
+          float sum = 0.0f;
+          for(int di = -1; di <= 1; di++) {
+            for(int dj = -1; dj <= 1; dj++) {
+              for(int dk = -1; dk <= 1; dk++) {
+                sum += (*src)(std::clamp(i + di, 0, 6),
+                              std::clamp(j + dj, 0, 8),
+                              std::clamp(k + dk, 0, 20));
+              }
+            }
+          }
+          REQUIRE((*dest)(i, j, k) == sum);
+        }
+      }
+    }
+  }
+}
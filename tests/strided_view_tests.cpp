@@ -0,0 +1,168 @@
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "nd_array/dyn_array.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/zip.hpp"
+
+template <typename Array>
+static void fill_count(Array &arr) {
+  int count = 0;
+  for(auto &v : arr) {
+    v = count;
+    count++;
+  }
+}
+
+TEST_CASE("strided views", "[ND_Array]") {
+  ND_Array<int, 3, 4, 5> arr;
+  fill_count(arr);
+  SECTION("slice any dimension") {
+    auto s0 = arr.slice<0>(2);
+    auto s1 = arr.slice<1>(3);
+    auto s2 = arr.slice<2>(1);
+    REQUIRE(s1.dimension() == 2);
+    REQUIRE(s1.extent(0) == 3);
+    REQUIRE(s1.extent(1) == 5);
+    REQUIRE(s1.stride(0) == 20);
+    REQUIRE(s1.stride(1) == 1);
+    for(int i = 0; i < 3; i++) {
+      for(int j = 0; j < 4; j++) {
+        REQUIRE(&s2(i, j) == &arr(i, j, 1));
+      }
+      for(int k = 0; k < 5; k++) {
+        REQUIRE(&s1(i, k) == &arr(i, 3, k));
+      }
+    }
+    for(int j = 0; j < 4; j++) {
+      for(int k = 0; k < 5; k++) {
+        REQUIRE(&s0(j, k) == &arr(2, j, k));
+      }
+    }
+    // Writes go to the array
+    s2.fill(-1);
+    REQUIRE(arr(1, 2, 1) == -1);
+    REQUIRE(arr(1, 2, 2) != -1);
+    auto s12 = s1.slice<1>(4);
+    REQUIRE(s12.dimension() == 1);
+    REQUIRE(&s12(2) == &arr(2, 3, 4));
+  }
+  SECTION("subrange and stride") {
+    auto sub = arr.subrange<2>(1, 4);
+    REQUIRE(sub.extent(2) == 3);
+    REQUIRE(sub.size() == 36);
+    REQUIRE(&sub(1, 2, 0) == &arr(1, 2, 1));
+    auto every_other = arr.stride<2>(2);
+    REQUIRE(every_other.extent(2) == 3);
+    REQUIRE(every_other.stride(2) == 2);
+    REQUIRE(&every_other(2, 1, 2) == &arr(2, 1, 4));
+    auto combined =
+        arr.stride<0>(2).subrange<1>(1, 3).slice<2>(4);
+    REQUIRE(combined.extent(0) == 2);
+    REQUIRE(combined.extent(1) == 2);
+    for(int i = 0; i < 2; i++) {
+      for(int j = 0; j < 2; j++) {
+        REQUIRE(&combined(i, j) == &arr(2 * i, j + 1, 4));
+      }
+    }
+    auto empty = arr.subrange<1>(2, 2);
+    REQUIRE(empty.empty());
+    REQUIRE(empty.begin() == empty.end());
+  }
+  SECTION("iteration") {
+    auto s = arr.subrange<1>(1, 3).stride<2>(2);
+    std::vector<int> expected;
+    for(int i = 0; i < 3; i++) {
+      for(int j = 1; j < 3; j++) {
+        for(int k = 0; k < 5; k += 2) {
+          expected.push_back(arr(i, j, k));
+        }
+      }
+    }
+    REQUIRE(std::distance(s.begin(), s.end()) ==
+            static_cast<std::ptrdiff_t>(expected.size()));
+    REQUIRE(std::equal(s.cbegin(), s.cend(),
+                       expected.begin()));
+    std::vector<int> reversed;
+    auto itr = s.end();
+    while(itr != s.begin()) {
+      --itr;
+      reversed.push_back(*itr);
+    }
+    REQUIRE(std::equal(reversed.rbegin(), reversed.rend(),
+                       expected.begin()));
+    for(std::size_t i = 0; i < expected.size(); i++) {
+      REQUIRE(s.begin()[i] == expected[i]);
+      REQUIRE(*(s.end() - (expected.size() - i)) ==
+              expected[i]);
+    }
+  }
+  SECTION("const views") {
+    const ND_Array<int, 3, 4, 5> &c = arr;
+    auto s = c.slice<1>(0);
+    static_assert(
+        std::is_same<decltype(s(0, 0)), const int &>::value,
+        "Views of const arrays must be const");
+    typename decltype(arr.slice<1>(0))::const_iterator itr =
+        arr.slice<1>(0).begin();
+    REQUIRE(*itr == s(0, 0));
+  }
+}
+
+TEST_CASE("strided views of padded arrays", "[ND_Array]") {
+  ND_Padded_Array<double, 3, 4, 6> arr;
+  fill_count(arr);
+  auto col = arr.slice<1>(5);
+  for(int i = 0; i < 4; i++) {
+    REQUIRE(&col(i) == &arr(i, 5));
+  }
+  auto sub = arr.subrange<0>(1, 3);
+  REQUIRE(std::equal(sub.cbegin(), sub.cend(),
+                     arr.cbegin() + 6));
+}
+
+TEST_CASE("strided views of dynamic arrays",
+          "[ND_Dyn_Array]") {
+  ND_Dyn_Array<int, ND_Dynamic, 4, ND_Dynamic> arr(3, 5);
+  fill_count(arr);
+  auto s = arr.slice<1>(2).stride<1>(2);
+  REQUIRE(s.extent(0) == 3);
+  REQUIRE(s.extent(1) == 3);
+  for(int i = 0; i < 3; i++) {
+    for(int k = 0; k < 3; k++) {
+      REQUIRE(&s(i, k) == &arr(i, 2, 2 * k));
+    }
+  }
+}
+
+TEST_CASE("zip strided views", "[ND_Array]") {
+  ND_Array<int, 4, 6> arr;
+  fill_count(arr);
+  // Transposes the first column onto the first row
+  auto row = arr.slice<0>(0);
+  auto col = arr.slice<1>(0).subrange<0>(0, 4);
+  auto row_part = row.subrange<0>(0, 4);
+  for(auto [r, c] : zip::make_zip(row_part, col)) {
+    r = c;
+  }
+  for(int i = 0; i < 4; i++) {
+    REQUIRE(arr(0, i) == 6 * i);
+  }
+}
+
+using View0 = decltype(
+    std::declval<ND_Array<int, 3, 4, 5> &>().slice<1>(0));
+static_assert(View0::EXTENTS::all_static() &&
+                  View0::STRIDES::all_static(),
+              "Slices of arrays must be static");
+using View1 = decltype(
+    std::declval<ND_Array<int, 3, 4, 5> &>().stride<1>(2));
+static_assert(View1::STRIDES::is_static(0) &&
+                  !View1::STRIDES::is_static(1),
+              "Only the strided dimension is dynamic");
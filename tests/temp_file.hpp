@@ -0,0 +1,30 @@
+
+#ifndef _TEMP_FILE_HPP_
+#define _TEMP_FILE_HPP_
+
+#include <cstdio>
+#include <string>
+
+#include <unistd.h>
+
+// A path for a temporary file, which is removed when the
+// test case ends. The path includes the process ID, so
+// concurrent runs of the tests use different files
+struct temp_file {
+  explicit temp_file(const char *name)
+      : path(std::string("/tmp/nd_array_") +
+             std::to_string(getpid()) + "_" + name) {
+    std::remove(path.c_str());
+  }
+
+  temp_file(const temp_file &) = delete;
+  temp_file &operator=(const temp_file &) = delete;
+
+  ~temp_file() { std::remove(path.c_str()); }
+
+  const char *c_str() const { return path.c_str(); }
+
+  std::string path;
+};
+
+#endif  // _TEMP_FILE_HPP_
@@ -2,6 +2,8 @@
 #define CATCH_CONFIG_MAIN
 #include "catch.hpp"
 
+#include <cstdint>
+
 #include "nd_array/nd_array.hpp"
 
 TEST_CASE("get, set, slice, reshape", "[ND_Array]") {
@@ -143,6 +145,101 @@ TEST_CASE("castable", "[ND_Array]") {
       a1.reshape<ND_Array<int, 3, 6>>();
 }
 
+TEST_CASE("aligned", "[ND_Array]") {
+  ND_Aligned_Array<double, 64, 3, 5, 7> arr;
+  REQUIRE(reinterpret_cast<std::uintptr_t>(arr.data()) %
+              64 ==
+          0);
+  REQUIRE(arr.begin() == arr.data());
+  REQUIRE(arr.end() == arr.data() + arr.size());
+  double count = 0.0;
+  for(double &v : arr) {
+    v = count;
+    count += 1.0;
+  }
+  ND_Array<double, 5, 7> &slice = arr.outer_slice(1);
+  REQUIRE(slice(0, 0) == 35.0);
+  ND_Array<double, 3, 5, 7> unaligned(arr);
+  REQUIRE(unaligned(2, 4, 6) == arr(2, 4, 6));
+  ND_Aligned_Array<double, 32, 5, 21> realigned(unaligned);
+  REQUIRE(reinterpret_cast<std::uintptr_t>(
+              realigned.data()) %
+              32 ==
+          0);
+  REQUIRE(realigned(4, 20) == unaligned(2, 4, 6));
+}
+
+TEST_CASE("padded", "[ND_Array]") {
+  using PaddedT = ND_Padded_Array<int, 3, 4, 5, 8>;
+  static_assert(PaddedT::size() == 4 * 5 * 8,
+                "Incorrect padded size");
+  static_assert(PaddedT::storage_size() == 4 * 5 * 11,
+                "Incorrect padded storage size");
+  PaddedT arr;
+  int count = 0;
+  for(int i = 0; i < arr.extent(0); i++) {
+    for(int j = 0; j < arr.extent(1); j++) {
+      for(int k = 0; k < arr.extent(2); k++) {
+        arr(i, j, k) = count;
+        REQUIRE(&arr(i, j, k) ==
+                arr.data() + (i * 5 + j) * 11 + k);
+        count++;
+      }
+    }
+  }
+  count = 0;
+  auto itr = arr.begin();
+  for(int i = 0; i < arr.extent(0); i++) {
+    for(int j = 0; j < arr.extent(1); j++) {
+      for(int k = 0; k < arr.extent(2); k++) {
+        REQUIRE(*itr == count);
+        REQUIRE(itr - arr.begin() == count);
+        REQUIRE(arr.begin() + count == itr);
+        REQUIRE(arr.index(itr, 0) == i);
+        REQUIRE(arr.index(itr, 1) == j);
+        REQUIRE(arr.index(itr, 2) == k);
+        count++;
+        ++itr;
+      }
+    }
+  }
+  REQUIRE(itr == arr.end());
+  REQUIRE(arr.end() - arr.begin() == arr.size());
+  REQUIRE(arr.back() == count - 1);
+  --itr;
+  REQUIRE(*itr == count - 1);
+  auto center = arr.begin() + 2 * 40 + 3 * 8 + 4;
+  REQUIRE(*arr.offset(center, 1, -2, 3) == arr(3, 1, 7));
+  REQUIRE(*arr.offset(center, -1, 1, -4) == arr(1, 4, 0));
+  REQUIRE(center[-5] == arr(2, 2, 7));
+
+  auto &slice = arr.outer_slice(2);
+  REQUIRE(slice.storage_size() == 5 * 11);
+  for(int j = 0; j < 5; j++) {
+    for(int k = 0; k < 8; k++) {
+      REQUIRE(&slice(j, k) == &arr(2, j, k));
+    }
+  }
+  auto &row = arr.outer_slice(1, 3);
+  for(int k = 0; k < 8; k++) {
+    REQUIRE(&row(k) == &arr(1, 3, k));
+  }
+  auto &reshaped =
+      arr.reshape<ND_Padded_Array<int, 3, 20, 8>>();
+  REQUIRE(&reshaped(7, 5) == &arr(1, 2, 5));
+
+  ND_Array<int, 4, 5, 8> unpadded(arr);
+  count = 0;
+  for(int v : unpadded) {
+    REQUIRE(v == count);
+    count++;
+  }
+  arr.fill(3);
+  for(int v : arr) {
+    REQUIRE(v == 3);
+  }
+}
+
 /* Compile Time List Tests */
 
 using ND_Array_0 =
@@ -174,6 +271,15 @@ static_assert(
     ND_Array_0::empty() == false,
     "Incorrect empty - ND_Array should never be empty");
 
+static_assert(ND_Array_0::alignment() == alignof(int),
+              "Incorrect default alignment");
+static_assert(
+    ND_Aligned_Array<float, 32, 3, 5>::alignment() == 32,
+    "Incorrect alignment");
+static_assert(alignof(ND_Aligned_Array<float, 64, 3, 5>) ==
+                  64,
+              "Incorrect alignment");
+
 using Arr0 = ND_Array_internals_::CT_Array<int, 4>;
 
 static_assert(Arr0::len() == 1,
@@ -197,6 +303,17 @@ static_assert(Arr1::sum() == 10, "Incorrect CT Array Sum");
 static_assert(Arr1::product() == 24,
               "Incorrect CT Array Product");
 
+static_assert(Arr1::padded_product<3>() == 42,
+              "Incorrect CT Array Padded Product");
+static_assert(Arr1::slice_idx<3>(0, 0, 1, 2) == 9,
+              "Incorrect Padded Slice Index");
+static_assert(Arr1::slice_idx<3>(0, 1, 0, 0) == 21,
+              "Incorrect Padded Slice Index");
+static_assert(Arr1::slice_idx<3>(0, 1) == 21,
+              "Incorrect Padded Slice Index");
+static_assert(Arr1::offset_idx(1, -1, 0, 2) == 14,
+              "Incorrect Offset Index");
+
 using Arr2 = ND_Array_internals_::CT_Array<int, 0, 1>;
 static_assert(Arr1::slice_idx<Arr2>() == 12,
               "Incorrect Template Slice Index");
@@ -0,0 +1,78 @@
+
+#include "catch.hpp"
+
+#include <type_traits>
+
+#include "nd_array/dyn_array.hpp"
+#include "nd_array/nd_array.hpp"
+#include "nd_array/tiled_range.hpp"
+
+using ND_Array_internals_::tiled_range;
+
+TEST_CASE("tiled range", "[ND_Array]") {
+  SECTION("partial tiles") {
+    ND_Array<int, 5, 7, 9> arr;
+    arr.fill(0);
+    auto tiles = tiled_range<2, 3, 4>(arr);
+    REQUIRE(tiles.size() == 3 * 3 * 3);
+    int prev_begin = -1;
+    for(auto tile : tiles) {
+      // The tiles are visited in row major order
+      const int begin = 100 * tile.bounds.begin[0] +
+                        10 * tile.bounds.begin[1] +
+                        tile.bounds.begin[2];
+      REQUIRE(begin > prev_begin);
+      prev_begin = begin;
+      REQUIRE(tile.size() == tile.bounds.size());
+      for(int d = 0; d < 3; d++) {
+        REQUIRE(tile.extent(d) ==
+                std::size_t(tile.bounds.end[d] -
+                            tile.bounds.begin[d]));
+      }
+      REQUIRE(&tile(0, 0, 0) == &arr(tile.bounds.begin[0],
+                                     tile.bounds.begin[1],
+                                     tile.bounds.begin[2]));
+      for(int &v : tile) {
+        v++;
+      }
+    }
+    for(int v : arr) {
+      REQUIRE(v == 1);
+    }
+  }
+  SECTION("const and padded arrays") {
+    ND_Padded_Array<int, 3, 6, 5> padded;
+    int count = 0;
+    for(int &v : padded) {
+      v = count++;
+    }
+    const auto &c = padded;
+    int sum = 0;
+    for(auto tile : tiled_range<4, 4>(c)) {
+      static_assert(
+          std::is_same<decltype(tile(0, 0)),
+                       const int &>::value,
+          "Tiles of const arrays must be const");
+      for(int i = 0; i < int(tile.extent(0)); i++) {
+        for(int j = 0; j < int(tile.extent(1)); j++) {
+          REQUIRE(tile(i, j) ==
+                  padded(tile.bounds.begin[0] + i,
+                         tile.bounds.begin[1] + j));
+          sum += tile(i, j);
+        }
+      }
+    }
+    REQUIRE(sum == 29 * 30 / 2);
+  }
+  SECTION("dynamic arrays") {
+    ND_Dyn_Array<int, ND_Dynamic, 4> dyn(10);
+    dyn.fill(2);
+    auto tiles = tiled_range<3, 4>(dyn);
+    REQUIRE(tiles.size() == 4);
+    for(auto tile : tiles) {
+      tile.fill(tile.bounds.begin[0]);
+    }
+    REQUIRE(dyn(9, 3) == 9);
+    REQUIRE(dyn(5, 0) == 3);
+  }
+}
@@ -1,10 +1,16 @@
 
 #include "catch.hpp"
 
+#include <algorithm>
+#include <iterator>
 #include <random>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "nd_array/nd_array.hpp"
 #include "nd_array/zip.hpp"
+#include "nd_array/zip_batched.hpp"
 
 TEST_CASE("get, difference, compare, increment, set",
           "[Zip]") {
@@ -113,3 +119,163 @@ TEST_CASE("for auto loop", "[Zip]") {
     REQUIRE(a3 == a1 + a2);
   }
 }
+
+TEST_CASE("random access", "[Zip]") {
+  std::vector<int> v1(10);
+  std::vector<double> v2(10);
+  for(int i = 0; i < 10; i++) {
+    v1[i] = i;
+    v2[i] = 0.5 * i;
+  }
+  auto z = zip::make_zip(v1, v2);
+  using iterator = decltype(z)::iterator;
+  static_assert(
+      std::is_same<typename std::iterator_traits<
+                       iterator>::iterator_category,
+                   std::random_access_iterator_tag>::value,
+      "Zips of vectors are random access");
+  REQUIRE(z.size() == 10);
+  iterator itr = z.begin() + 3;
+  REQUIRE(std::get<0>(*itr) == 3);
+  REQUIRE(std::get<1>(itr[2]) == 2.5);
+  itr += 4;
+  REQUIRE(std::get<0>(*itr) == 7);
+  itr -= 6;
+  REQUIRE(std::get<0>(*itr) == 1);
+  REQUIRE(std::get<0>(*(2 + itr)) == 3);
+  REQUIRE(std::get<0>(*(z.end() - 1)) == 9);
+  REQUIRE(std::distance(z.begin(), z.end()) == 10);
+  REQUIRE(std::next(z.begin(), 5) == z.begin() + 5);
+  std::for_each(z.begin() + 8, z.end(), [](auto t) {
+    std::get<0>(t) = -std::get<0>(t);
+  });
+  REQUIRE(v1[7] == 7);
+  REQUIRE(v1[8] == -8);
+  REQUIRE(v1[9] == -9);
+}
+
+TEST_CASE("split", "[Zip]") {
+  using Array = ND_Array<int, 3, 5, 7>;
+  Array arr_1, arr_2;
+  int count = 0;
+  for(int &i : arr_1) {
+    i = count;
+    count++;
+  }
+  auto z = zip::make_zip(arr_1, arr_2);
+  for(std::size_t n : {1, 4, 13, 200}) {
+    const auto ranges = z.split(n);
+    REQUIRE(ranges.size() == n);
+    // The ranges are disjoint, ordered, and cover every
+    // element
+    REQUIRE(ranges.front().begin() == z.begin());
+    REQUIRE(ranges.back().end() == z.end());
+    std::size_t total = 0;
+    for(std::size_t i = 0; i < n; i++) {
+      if(i > 0) {
+        REQUIRE(ranges[i].begin() == ranges[i - 1].end());
+      }
+      REQUIRE(ranges[i].size() >= Array::size() / n);
+      REQUIRE(ranges[i].size() <= Array::size() / n + 1);
+      total += ranges[i].size();
+    }
+    REQUIRE(total == Array::size());
+  }
+  const auto ranges = z.split(4);
+  std::vector<std::thread> threads;
+  for(const auto &range : ranges) {
+    threads.emplace_back([range]() {
+      for(auto [a1, a2] : range) {
+        a2 = 2 * a1;
+      }
+    });
+  }
+  for(std::thread &t : threads) {
+    t.join();
+  }
+  for(auto [a1, a2] : z) {
+    REQUIRE(a2 == 2 * a1);
+  }
+}
+
+TEST_CASE("mixed const containers", "[Zip]") {
+  const std::vector<int> src{1, 2, 3, 4};
+  ND_Array<int, 2, 2> arr;
+  const ND_Array<int, 2, 2> &const_arr = arr;
+  std::vector<long> dest(4);
+  arr.fill(10);
+  auto z = zip::make_zip(src, dest, const_arr);
+  static_assert(
+      std::is_same<decltype(std::get<0>(*z.begin())),
+                   const int &>::value,
+      "Elements of const containers must be const");
+  static_assert(
+      std::is_same<decltype(std::get<1>(*z.begin())),
+                   long &>::value,
+      "Elements of mutable containers are mutable");
+  static_assert(
+      std::is_same<decltype(std::get<2>(*z.begin())),
+                   const int &>::value,
+      "Elements of const arrays must be const");
+  for(auto [s, d, a] : z) {
+    d = s + a;
+  }
+  REQUIRE((dest == std::vector<long>{11, 12, 13, 14}));
+  REQUIRE(z.size() == 4);
+  for(auto [d, a, s] : zip::make_zip(std::as_const(dest),
+                                     arr, src)) {
+    a = d - s;
+  }
+  REQUIRE(arr(1, 1) == 10);
+}
+
+TEST_CASE("batched zip", "[Zip]") {
+  // Sizes with no batches, only whole batches, and a tail
+  for(std::size_t n : {0, 3, 8, 13}) {
+    std::vector<double> x(n);
+    std::vector<double> y(n);
+    for(std::size_t i = 0; i < n; i++) {
+      x[i] = i;
+      y[i] = 100.0 * i;
+    }
+    auto z = zip::make_zip_batched<4>(std::as_const(x), y);
+    REQUIRE(z.size() == n / 4);
+    REQUIRE(z.tail().size() == n % 4);
+    z.for_each([](auto xb, auto yb) {
+      typename decltype(xb)::vec x_vec;
+      xb.load(x_vec);
+      yb += 2.0 * x_vec;
+    });
+    for(std::size_t i = 0; i < n; i++) {
+      REQUIRE(y[i] == 102.0 * i);
+    }
+  }
+  ND_Array<int, 3, 5> a;
+  ND_Array<int, 3, 5> b;
+  a.fill(3);
+  auto z = zip::make_zip_batched<8>(a, b);
+  using batch_t =
+      std::tuple_element<0, decltype(*z.begin())>::type;
+  static_assert(sizeof(batch_t::vec) == 8 * sizeof(int),
+                "Batches must be whole vectors");
+  for(auto [ab, bb] : z) {
+    // Copying a batch copies the elements
+    bb = ab;
+    batch_t::vec a_vec;
+    ab.load(a_vec);
+    bb *= a_vec;
+  }
+  using tail_t =
+      std::tuple_element<0,
+                         decltype(*z.tail().begin())>::type;
+  static_assert(std::is_same<tail_t::vec, int>::value,
+                "The tail must be scalars");
+  for(auto [ab, bb] : z.tail()) {
+    int a_val;
+    ab.load(a_val);
+    bb = -a_val;
+  }
+  for(int i = 0; i < 15; i++) {
+    REQUIRE(b.data()[i] == (i < 8 ? 9 : -3));
+  }
+}